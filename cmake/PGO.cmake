@@ -0,0 +1,79 @@
+# Profile-guided optimization + LTO.
+#
+# FILE_VTF_PGO selects the stage:
+#  OFF      - normal build
+#  GENERATE - instrumented build; the pgo-train target runs vtf-train to write a profile
+#  USE      - optimized build using that profile
+# Both stages use LTO. The flags are added globally before sourcepp is added, so vtfpp (where
+#  the encode/decode/resample code lives) is trained and optimized along with our own code.
+#
+# cmake/pgo-release.cmake runs all of the stages in one go. The GENERATE and USE stages have to
+#  share a build directory, since GCC matches profiles to object files by path.
+
+set(FILE_VTF_PGO OFF CACHE STRING "Profile-guided optimization stage (OFF, GENERATE or USE)")
+set_property(CACHE FILE_VTF_PGO PROPERTY STRINGS OFF GENERATE USE)
+set(FILE_VTF_PGO_DIR "${CMAKE_BINARY_DIR}/pgo-profile" CACHE PATH "Where PGO profile data is written and read")
+
+if(NOT FILE_VTF_PGO STREQUAL "OFF")
+    if(NOT FILE_VTF_PGO STREQUAL "GENERATE" AND NOT FILE_VTF_PGO STREQUAL "USE")
+        message(FATAL_ERROR "FILE_VTF_PGO must be OFF, GENERATE or USE (got ${FILE_VTF_PGO})")
+    endif()
+
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT FILE_VTF_IPO_SUPPORTED OUTPUT FILE_VTF_IPO_ERROR LANGUAGES C CXX)
+    if(FILE_VTF_IPO_SUPPORTED)
+        set(CMAKE_INTERPROCEDURAL_OPTIMIZATION ON)
+    else()
+        message(WARNING "LTO isn't supported by this toolchain, continuing with PGO only: ${FILE_VTF_IPO_ERROR}")
+    endif()
+
+    if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        if(FILE_VTF_PGO STREQUAL "GENERATE")
+            add_compile_options(-fprofile-generate -fprofile-update=atomic "-fprofile-dir=${FILE_VTF_PGO_DIR}")
+            add_link_options(-fprofile-generate)
+        else()
+            # Partial training keeps code the workload never reached optimized for speed instead of size
+            add_compile_options(-fprofile-use -fprofile-partial-training -Wno-missing-profile "-fprofile-dir=${FILE_VTF_PGO_DIR}")
+            add_link_options(-fprofile-use)
+        endif()
+    elseif(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        set(FILE_VTF_PGO_PROFDATA "${FILE_VTF_PGO_DIR}/file-vtf.profdata")
+        if(FILE_VTF_PGO STREQUAL "GENERATE")
+            add_compile_options("-fprofile-instr-generate=${FILE_VTF_PGO_DIR}/file-vtf.profraw")
+            add_link_options("-fprofile-instr-generate=${FILE_VTF_PGO_DIR}/file-vtf.profraw")
+        else()
+            add_compile_options("-fprofile-instr-use=${FILE_VTF_PGO_PROFDATA}" -Wno-profile-instr-unprofiled)
+            add_link_options("-fprofile-instr-use=${FILE_VTF_PGO_PROFDATA}")
+        endif()
+    else()
+        message(FATAL_ERROR "FILE_VTF_PGO is only supported with GCC and Clang")
+    endif()
+endif()
+
+# Adds the pgo-train target, which runs the training workload against the instrumented build
+function(file_vtf_add_pgo_train_target train_target)
+    if(NOT FILE_VTF_PGO STREQUAL "GENERATE")
+        return()
+    endif()
+
+    set(train_commands
+        COMMAND ${CMAKE_COMMAND} -E make_directory "${FILE_VTF_PGO_DIR}"
+        COMMAND $<TARGET_FILE:${train_target}> --iterations 2
+    )
+    if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        find_program(LLVM_PROFDATA NAMES llvm-profdata)
+        if(NOT LLVM_PROFDATA)
+            message(FATAL_ERROR "llvm-profdata is needed for PGO with Clang")
+        endif()
+        list(APPEND train_commands
+            COMMAND ${LLVM_PROFDATA} merge "-output=${FILE_VTF_PGO_PROFDATA}" "${FILE_VTF_PGO_DIR}/file-vtf.profraw"
+        )
+    endif()
+
+    add_custom_target(pgo-train
+        ${train_commands}
+        DEPENDS ${train_target}
+        COMMENT "Running the PGO training workload"
+        VERBATIM
+    )
+endfunction()
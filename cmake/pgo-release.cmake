@@ -0,0 +1,37 @@
+# Builds an optimized release of file-vtf with PGO + LTO, start to finish.
+#
+# Usage (from the repo root):
+#   cmake -DBINARY_DIR=build-pgo -P cmake/pgo-release.cmake
+# Optional: -DSOURCE_DIR=<repo> -DCONFIGURE_ARGS="-DCMAKE_CXX_COMPILER=clang++;-DCMAKE_C_COMPILER=clang"
+#
+# Steps: instrumented build -> run vtf-train -> rebuild everything with the profile.
+
+if(NOT DEFINED SOURCE_DIR)
+    get_filename_component(SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}/.." ABSOLUTE)
+endif()
+if(NOT DEFINED BINARY_DIR)
+    set(BINARY_DIR "${SOURCE_DIR}/build-pgo")
+endif()
+
+function(pgo_run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Command failed (${result}): ${ARGN}")
+    endif()
+endfunction()
+
+# Stale profile data from an earlier run would be merged with the new one
+file(REMOVE_RECURSE "${BINARY_DIR}/pgo-profile")
+
+message(STATUS "PGO: configuring instrumented build")
+pgo_run(${CMAKE_COMMAND} -S "${SOURCE_DIR}" -B "${BINARY_DIR}"
+    -DCMAKE_BUILD_TYPE=Release -DFILE_VTF_PGO=GENERATE ${CONFIGURE_ARGS})
+
+message(STATUS "PGO: building and running the training workload")
+pgo_run(${CMAKE_COMMAND} --build "${BINARY_DIR}" --config Release --target pgo-train)
+
+message(STATUS "PGO: rebuilding with profile data")
+pgo_run(${CMAKE_COMMAND} -S "${SOURCE_DIR}" -B "${BINARY_DIR}" -DFILE_VTF_PGO=USE)
+pgo_run(${CMAKE_COMMAND} --build "${BINARY_DIR}" --config Release)
+
+message(STATUS "PGO: done, optimized file-vtf is in ${BINARY_DIR}")
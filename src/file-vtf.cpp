@@ -14,10 +14,25 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
 #include "vtfpp/ImageConversion.h"
 #include "vtfpp/ImageFormats.h"
 #include "vtfpp/VTF.h"
 #include "file-vtf.h"
+#include "vtf-core.h"
+#include "vtf-cubemap.h"
+#include "vtf-edit.h"
+#include "vtf-flags.h"
+#include "vtf-formats.h"
+#include "vtf-material.h"
+#include "vtf-pool.h"
+#include "vtf-report.h"
+#include "vtf-trace.h"
 #include <libgimp/gimp.h>
 #include <libgimp/gimpui.h>
 
@@ -29,8 +44,13 @@
 // Procedures prefixed with 'plug-in-chev' to avoid procedure name conflicts, like another VTF loading plugin
 #define PROC_VTF_LOAD "plug-in-chev-file-vtf-load"
 #define PROC_VTF_EXPORT "plug-in-chev-file-vtf-export"
+#define PROC_VTF_EDIT "plug-in-chev-file-vtf-edit"
 #define PROC_VTF_BINARY "file-vtf"
 
+// Taken during static initialization, the first point where any of the plug-in's own code runs.
+// The dynamic loader has already done its work by then; use the startup tracepoint to see that too.
+static const std::chrono::steady_clock::time_point startup_time = std::chrono::steady_clock::now();
+
 struct _GimpVtf {
     GimpPlugIn parent_instance;
 };
@@ -51,16 +71,76 @@ static void gimp_vtf_class_init(GimpVtfClass *gclass) {
 
 static void gimp_vtf_init(GimpVtf *gimp_vtf) {}
 
+// Startup timing, shown when running GIMP with G_MESSAGES_DEBUG=all
+static void mark_startup(VtfStartupMark mark, const char *description) {
+    VTF_TRACE1(startup, (int)mark);
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startup_time;
+    g_debug("Startup: %s at %.3f ms", description, elapsed.count());
+}
+
 static GList *gimp_vtf_query_procedures(GimpPlugIn *plugin) {
+    mark_startup(STARTUP_QUERY_PROCEDURES, "query procedures");
+
     GList *list = NULL;
     
     list = g_list_append(list, g_strdup(PROC_VTF_LOAD));
     list = g_list_append(list, g_strdup(PROC_VTF_EXPORT));
+    list = g_list_append(list, g_strdup(PROC_VTF_EDIT));
 
     return list;
 }
 
+// Not shown in the export dialog; GIMP's own thread setting is what most people want.
+// Mainly for scripts and batch jobs that run several plug-in instances side by side.
+static void add_threads_argument(GimpProcedure *procedure) {
+    gimp_procedure_add_int_argument(
+        procedure,
+        "threads",
+        "Threads",
+        "Number of threads to use for loading/exporting."
+        "\n0 uses the number of threads set in GIMP's preferences.",
+        0,
+        GIMP_MAX_NUM_THREADS,
+        0,
+        G_PARAM_READWRITE
+    );
+}
+
+// Sizes the shared thread pool from the "threads" argument, or GIMP's setting if that's 0.
+// libgimp copies GIMP's "Number of threads to use" preference into gegl_config() on startup.
+static void configure_thread_pool(GimpProcedureConfig *config) {
+    int threads = 0;
+    g_object_get(config, "threads", &threads, NULL);
+
+    if (threads <= 0) {
+        g_object_get(gegl_config(), "threads", &threads, NULL);
+    }
+
+    vtf_pool_shared().configure(threads);
+    vtf_pool_shared().reset_stats();
+}
+
+// Per-worker pool utilization, shown when running GIMP with G_MESSAGES_DEBUG=all
+static void log_thread_pool_stats() {
+    std::vector<VtfPoolWorkerStats> stats = vtf_pool_shared().stats();
+    for (size_t i = 0; i < stats.size(); i++) {
+        g_debug(
+            "Pool worker %zu%s: %" G_GUINT64_FORMAT " tasks (%" G_GUINT64_FORMAT " stolen), %.3f ms busy",
+            i,
+            (i == stats.size() - 1) ? " (caller)" : "",
+            stats[i].tasks_run,
+            stats[i].tasks_stolen,
+            stats[i].busy_ns / 1e6
+        );
+    }
+}
+
+// GIMP only creates the procedure it's about to run (or all of them, when registering the plug-in),
+//  so anything only one procedure needs belongs in its branch, not up here.
 static GimpProcedure *gimp_vtf_create_procedure(GimpPlugIn *plugin, const gchar *name) {
+    mark_startup(STARTUP_CREATE_PROCEDURE, name);
+
     GimpProcedure *procedure = NULL;
 
     if (g_strcmp0(name, PROC_VTF_LOAD) == 0) {
@@ -84,6 +164,8 @@ static GimpProcedure *gimp_vtf_create_procedure(GimpPlugIn *plugin, const gchar
         gimp_file_procedure_set_mime_types(GIMP_FILE_PROCEDURE(procedure), "image/x-vtf");
         gimp_file_procedure_set_extensions(GIMP_FILE_PROCEDURE(procedure), "vtf");
         gimp_file_procedure_set_magics(GIMP_FILE_PROCEDURE(procedure), "0,string,VTF\000");
+
+        add_threads_argument(procedure);
     } else if (g_strcmp0(name, PROC_VTF_EXPORT) == 0) {
         procedure = gimp_export_procedure_new(
             plugin, name, GIMP_PDB_PROC_TYPE_PLUGIN, TRUE, gimp_vtf_export, NULL, NULL);
@@ -149,67 +231,11 @@ static GimpProcedure *gimp_vtf_create_procedure(GimpPlugIn *plugin, const gchar
         );
 
         // Image format (DXT5, RGBA8888, etc.)
-        // TODO: Indent these better (I'm lazy)
-        GimpChoice *choice_image_format = gimp_choice_new_with_values(
-            "RGBA8888",                     (int)vtfpp::ImageFormat::RGBA8888, "RGBA8888", NULL,
-            "ABGR8888",                     (int)vtfpp::ImageFormat::ABGR8888, "ABGR8888", NULL,
-            "RGB888",                       (int)vtfpp::ImageFormat::RGB888, "RGB888", NULL,
-            "BGR888",                       (int)vtfpp::ImageFormat::BGR888, "BGR888", NULL,
-            "RGB565",                       (int)vtfpp::ImageFormat::RGB565, "RGB565", NULL,
-            "I8",                           (int)vtfpp::ImageFormat::I8, "I8", NULL,
-            "IA88",                         (int)vtfpp::ImageFormat::IA88, "IA88", NULL,
-            "P8",                           (int)vtfpp::ImageFormat::P8, "P8", NULL,
-            "A8",                           (int)vtfpp::ImageFormat::A8, "A8", NULL,
-            "RGB888_BLUESCREEN",            (int)vtfpp::ImageFormat::RGB888_BLUESCREEN, "RGB888_BLUESCREEN", NULL,
-            "BGR888_BLUESCREEN",            (int)vtfpp::ImageFormat::BGR888_BLUESCREEN, "BGR888_BLUESCREEN", NULL,
-            "ARGB8888",                     (int)vtfpp::ImageFormat::ARGB8888, "ARGB8888", NULL,
-            "BGRA8888",                     (int)vtfpp::ImageFormat::BGRA8888, "BGRA8888", NULL,
-            "DXT1",                         (int)vtfpp::ImageFormat::DXT1, "DXT1", NULL,
-            "DXT3",                         (int)vtfpp::ImageFormat::DXT3, "DXT3", NULL,
-            "DXT5",                         (int)vtfpp::ImageFormat::DXT5, "DXT5", NULL,
-            "BGRX8888",                     (int)vtfpp::ImageFormat::BGRX8888, "BGRX8888", NULL,
-            "BGR565",                       (int)vtfpp::ImageFormat::BGR565, "BGR565", NULL,
-            "BGRX5551",                     (int)vtfpp::ImageFormat::BGRX5551, "BGRX5551", NULL,
-            "BGRA4444",                     (int)vtfpp::ImageFormat::BGRA4444, "BGRA4444", NULL,
-            "DXT1_ONE_BIT_ALPHA",           (int)vtfpp::ImageFormat::DXT1_ONE_BIT_ALPHA, "DXT1_ONE_BIT_ALPHA", NULL,
-            "BGRA5551",                     (int)vtfpp::ImageFormat::BGRA5551, "BGRA5551", NULL,
-            "UV88",                         (int)vtfpp::ImageFormat::UV88, "UV88", NULL,
-            "UVWQ8888",                     (int)vtfpp::ImageFormat::UVWQ8888, "UVWQ8888", NULL,
-            "RGBA16161616F",                (int)vtfpp::ImageFormat::RGBA16161616F, "RGBA16161616F", NULL,
-            "RGBA16161616",                 (int)vtfpp::ImageFormat::RGBA16161616, "RGBA16161616", NULL,
-            "UVLX8888",                     (int)vtfpp::ImageFormat::UVLX8888, "UVLX8888", NULL,
-            "R32F",                         (int)vtfpp::ImageFormat::R32F, "R32F", NULL,
-            "RGB323232F",                   (int)vtfpp::ImageFormat::RGB323232F, "RGB323232F", NULL,
-            "RGBA32323232F",                (int)vtfpp::ImageFormat::RGBA32323232F, "RGBA32323232F", NULL,
-
-            "RG1616F",                      (int)vtfpp::ImageFormat::RG1616F, "RG1616F", NULL,
-            "RG3232F",                      (int)vtfpp::ImageFormat::RG3232F, "RG3232F", NULL,
-            "RGBX8888",                     (int)vtfpp::ImageFormat::RGBX8888, "RGBX8888", NULL,
-            "EMPTY",                        (int)vtfpp::ImageFormat::EMPTY, "EMPTY", NULL,
-            "ATI2N",                        (int)vtfpp::ImageFormat::ATI2N, "ATI2N", NULL,
-            "ATI1N",                        (int)vtfpp::ImageFormat::ATI1N, "ATI1N", NULL,
-            "RGBA1010102",                  (int)vtfpp::ImageFormat::RGBA1010102, "RGBA1010102", NULL,
-            "BGRA1010102",                  (int)vtfpp::ImageFormat::BGRA1010102, "BGRA1010102", NULL,
-            "R16F",                         (int)vtfpp::ImageFormat::R16F, "R16F", NULL,
-
-            "CONSOLE_BGRX8888_LINEAR",      (int)vtfpp::ImageFormat::CONSOLE_BGRX8888_LINEAR, "CONSOLE_BGRX8888_LINEAR", NULL,
-            "CONSOLE_RGBA8888_LINEAR",      (int)vtfpp::ImageFormat::CONSOLE_RGBA8888_LINEAR, "CONSOLE_RGBA8888_LINEAR", NULL,
-            "CONSOLE_ABGR8888_LINEAR",      (int)vtfpp::ImageFormat::CONSOLE_ABGR8888_LINEAR, "CONSOLE_ABGR8888_LINEAR", NULL,
-            "CONSOLE_ARGB8888_LINEAR",      (int)vtfpp::ImageFormat::CONSOLE_ARGB8888_LINEAR, "CONSOLE_ARGB8888_LINEAR", NULL,
-            "CONSOLE_BGRA8888_LINEAR",      (int)vtfpp::ImageFormat::CONSOLE_BGRA8888_LINEAR, "CONSOLE_BGRA8888_LINEAR", NULL,
-            "CONSOLE_RGB888_LINEAR",        (int)vtfpp::ImageFormat::CONSOLE_RGB888_LINEAR, "CONSOLE_RGB888_LINEAR", NULL,
-            "CONSOLE_BGR888_LINEAR",        (int)vtfpp::ImageFormat::CONSOLE_BGR888_LINEAR, "CONSOLE_BGR888_LINEAR", NULL,
-            "CONSOLE_BGRX5551_LINEAR",      (int)vtfpp::ImageFormat::CONSOLE_BGRX5551_LINEAR, "CONSOLE_BGRX5551_LINEAR", NULL,
-            "CONSOLE_I8_LINEAR",            (int)vtfpp::ImageFormat::CONSOLE_I8_LINEAR, "CONSOLE_I8_LINEAR", NULL,
-            "CONSOLE_RGBA16161616_LINEAR",  (int)vtfpp::ImageFormat::CONSOLE_RGBA16161616_LINEAR, "CONSOLE_RGBA16161616_LINEAR", NULL,
-            "CONSOLE_BGRX8888_LE",          (int)vtfpp::ImageFormat::CONSOLE_BGRX8888_LE, "CONSOLE_BGRX8888_LE", NULL,
-            "CONSOLE_BGRA8888_LE",          (int)vtfpp::ImageFormat::CONSOLE_BGRA8888_LE, "CONSOLE_BGRA8888_LE", NULL,
-        
-            "R8",                           (int)vtfpp::ImageFormat::R8, "R8", NULL,
-            "BC7",                          (int)vtfpp::ImageFormat::BC7, "BC7", NULL,
-            "BC6H",                         (int)vtfpp::ImageFormat::BC6H, "BC6H", NULL,
-            NULL
-        );
+        // The list itself lives in vtf-formats.h, so the standalone tools stay in sync with it
+        GimpChoice *choice_image_format = gimp_choice_new();
+        for (const VtfFormatChoice &format_choice : VTF_EXPORT_FORMATS) {
+            gimp_choice_add(choice_image_format, format_choice.nick, (int)format_choice.format, format_choice.nick, NULL);
+        }
         gimp_procedure_add_choice_argument(
             procedure,
             "image_format",
@@ -224,36 +250,28 @@ static GimpProcedure *gimp_vtf_create_procedure(GimpPlugIn *plugin, const gchar
         );
 
         // Type (Standard, Environment Map, Volumetric Texture)
-        GimpChoice *choice_image_type = gimp_choice_new_with_values(
-            "standard",     0, "Standard", NULL,
-            "envmap",       1, "Environment Map", NULL,
-            "volumetric",   2, "Volumetric Texture", NULL,
-            NULL
-        );
+        GimpChoice *choice_image_type = gimp_choice_new();
+        for (const VtfChoice &choice : VTF_IMAGE_TYPE_CHOICES) {
+            gimp_choice_add(choice_image_type, choice.nick, choice.value, choice.label, NULL);
+        }
         gimp_procedure_add_choice_argument(
             procedure,
             "image_type",
             "Image type",
             "Image type (Standard, Environment Map, or Volumetric Texture)."
-            "\nRecommended: Standard, unless you're making skyboxes, then use Environment Map.",
+            "\nRecommended: Standard, unless you're making skyboxes, then use Environment Map."
+            "\nAn environment map exported from a single 2:1 layer is treated as an equirectangular"
+            " panorama and split into the six cubemap faces.",
             choice_image_type,
             "standard",
             G_PARAM_READWRITE
         );
 
         // Mipmaps (as well as an option of whether or not to even generate them)
-        GimpChoice *choice_mipmaps = gimp_choice_new_with_values(
-            "none",         -1,                                                         "None (don't generate mipmaps)", NULL,
-            "default",      (int)vtfpp::ImageConversion::ResizeFilter::DEFAULT,         "Default", NULL,
-            "box",          (int)vtfpp::ImageConversion::ResizeFilter::BOX,             "Box", NULL,
-            "bilinear",     (int)vtfpp::ImageConversion::ResizeFilter::BILINEAR,        "Bilinear", NULL,
-            "cubic",        (int)vtfpp::ImageConversion::ResizeFilter::CUBIC_BSPLINE,   "Cubic", NULL,
-            "catmull",      (int)vtfpp::ImageConversion::ResizeFilter::CATMULL_ROM,     "Catmull/Catrom", NULL,
-            "mitchell",     (int)vtfpp::ImageConversion::ResizeFilter::MITCHELL,        "Mitchell", NULL,
-            "point",        (int)vtfpp::ImageConversion::ResizeFilter::POINT_SAMPLE,    "Point", NULL,
-            "kaiser",       (int)vtfpp::ImageConversion::ResizeFilter::KAISER,          "Kaiser", NULL,
-            NULL
-        );
+        GimpChoice *choice_mipmaps = gimp_choice_new();
+        for (const VtfChoice &choice : VTF_MIPMAP_FILTER_CHOICES) {
+            gimp_choice_add(choice_mipmaps, choice.nick, choice.value, choice.label, NULL);
+        }
         gimp_procedure_add_choice_argument(
             procedure,
             "mipmap_filter",
@@ -266,12 +284,10 @@ static GimpProcedure *gimp_vtf_create_procedure(GimpPlugIn *plugin, const gchar
         );
 
         // Resize method (how to resize the image when the width and height aren't a power-of-two)
-        GimpChoice *choice_resize_method = gimp_choice_new_with_values(
-            "bigger",   (int)vtfpp::ImageConversion::ResizeMethod::POWER_OF_TWO_BIGGER,     "Power of two (bigger)", NULL,
-            "smaller",  (int)vtfpp::ImageConversion::ResizeMethod::POWER_OF_TWO_SMALLER,    "Power of two (smaller)", NULL,
-            "nearest",  (int)vtfpp::ImageConversion::ResizeMethod::POWER_OF_TWO_NEAREST,    "Power of two (nearest)", NULL,
-            NULL
-        );
+        GimpChoice *choice_resize_method = gimp_choice_new();
+        for (const VtfChoice &choice : VTF_RESIZE_METHOD_CHOICES) {
+            gimp_choice_add(choice_resize_method, choice.nick, choice.value, choice.label, NULL);
+        }
         gimp_procedure_add_choice_argument(
             procedure,
             "resize_method",
@@ -316,6 +332,43 @@ static GimpProcedure *gimp_vtf_create_procedure(GimpPlugIn *plugin, const gchar
             G_PARAM_READWRITE
         );
 
+        gimp_procedure_add_boolean_argument(
+            procedure,
+            "report_enabled",
+            "Write export report",
+            "If enabled, also write <name>.vtf.json next to the VTF, with the settings and flags used,"
+            " reflectivity, timings, memory use and compression ratio."
+            "\nMeant for asset pipelines; you don't need this otherwise.",
+            FALSE,
+            G_PARAM_READWRITE
+        );
+
+        gimp_procedure_add_string_argument(
+            procedure,
+            "material_outputs",
+            "Material outputs",
+            "If set, export a material set instead: one VTF per named layer or layer group, with its"
+            " suffix added to the file name. Outputs are separated by semicolons, each one"
+            " SUFFIX=LAYER[:KEY=VALUE,...], where the options override these export settings."
+            "\ne.g. _basecolor=Color; _normal=Normal:image_format=RGBA8888,flag_normal_map=true; _mask=Roughness",
+            "",
+            G_PARAM_READWRITE
+        );
+
+        gimp_procedure_add_string_argument(
+            procedure,
+            "channel_pack",
+            "Pack channels",
+            "If set, export one image packed from up to four grayscale layers or channels instead,"
+            " named in R|G|B|A order (- skips one), e.g. AO|Roughness|Metalness."
+            "\nSkipped color channels are black and a skipped alpha channel is opaque."
+            " Material outputs can be packed the same way.",
+            "",
+            G_PARAM_READWRITE
+        );
+
+        add_threads_argument(procedure);
+
         gimp_procedure_add_double_argument(
             procedure,
             "bumpmap_scale",
@@ -327,6 +380,56 @@ static GimpProcedure *gimp_vtf_create_procedure(GimpPlugIn *plugin, const gchar
             G_PARAM_READWRITE
         );
 
+        // Height map conversion (normal map or SSBump generated on export)
+        GimpChoice *choice_height_conversion = gimp_choice_new();
+        for (const VtfChoice &choice : VTF_HEIGHT_CONVERSION_CHOICES) {
+            gimp_choice_add(choice_height_conversion, choice.nick, choice.value, choice.label, NULL);
+        }
+        gimp_procedure_add_choice_argument(
+            procedure,
+            "height_conversion",
+            "Height conversion",
+            "If set, each layer is treated as a grayscale height map (white is high) and exported as"
+            " the normal map or SSBump generated from it, with the matching flag set."
+            "\nClamp S/Clamp T stop the edges from wrapping around.",
+            choice_height_conversion,
+            "none",
+            G_PARAM_READWRITE
+        );
+
+        gimp_procedure_add_double_argument(
+            procedure,
+            "height_scale",
+            "Height scale",
+            "How many pixels high white is over black, for height conversion. Higher is bumpier.",
+            0.0f,
+            256.0f,
+            4.0f,
+            G_PARAM_READWRITE
+        );
+
+        gimp_procedure_add_boolean_argument(
+            procedure,
+            "prefilter_enabled",
+            "Prefilter envmap mipmaps",
+            "If enabled, environment map mipmaps are GGX-prefiltered for increasing roughness"
+            " (mirror at the top mipmap, fully rough at the last) instead of plainly downsampled."
+            "\nFor PBR shaders that pick the mipmap by roughness.",
+            FALSE,
+            G_PARAM_READWRITE
+        );
+
+        gimp_procedure_add_int_argument(
+            procedure,
+            "prefilter_samples",
+            "Prefilter samples",
+            "Samples per pixel when prefiltering envmap mipmaps. More is smoother, but slower.",
+            VTF_CUBEMAP_PREFILTER_MIN_SAMPLES,
+            VTF_CUBEMAP_PREFILTER_MAX_SAMPLES,
+            64,
+            G_PARAM_READWRITE
+        );
+
         // These descriptions are from the Valve wiki
         // https://developer.valvesoftware.com/wiki/VTF_(Valve_Texture_Format)#Texture_flags
         // Flags not configurable (because they're automatically set upon export):
@@ -373,6 +476,45 @@ static GimpProcedure *gimp_vtf_create_procedure(GimpPlugIn *plugin, const gchar
         gimp_export_procedure_set_support_profile(GIMP_EXPORT_PROCEDURE(procedure), false);
         gimp_export_procedure_set_support_thumbnail(GIMP_EXPORT_PROCEDURE(procedure), false);
         gimp_export_procedure_set_support_comment(GIMP_EXPORT_PROCEDURE(procedure), false);
+    } else if (g_strcmp0(name, PROC_VTF_EDIT) == 0) {
+        // For scripts: no menu entry or dialog
+        procedure = gimp_procedure_new(
+            plugin, name, GIMP_PDB_PROC_TYPE_PLUGIN, gimp_vtf_edit, NULL, NULL);
+        gimp_procedure_set_documentation(
+            procedure,
+            "Edits the header of a VTF file",
+            "Changes the version, flags, start frame, bumpmap scale or reflectivity of an existing"
+            " VTF file without re-encoding its image data, or recomputes its reflectivity and"
+            " thumbnail from one of its small mips."
+            "\nEdits are KEY=VALUE strings using the export procedure's argument names,"
+            " e.g. \"flag_clamp_s=true\", \"version=7_4\" or \"recompute_reflectivity_enabled=true\","
+            " plus \"start_frame=N\" and \"reflectivity=R,G,B\".",
+            NULL
+        );
+        gimp_procedure_set_attribution(
+            procedure,
+            ATTRIBUTION_AUTHOR,
+            ATTRIBUTION_COPYRIGHT,
+            ATTRIBUTION_DATE
+        );
+
+        gimp_procedure_add_file_argument(
+            procedure,
+            "file",
+            "File",
+            "The VTF file to edit.",
+            GIMP_FILE_CHOOSER_ACTION_OPEN,
+            FALSE,
+            NULL,
+            G_PARAM_READWRITE
+        );
+        gimp_procedure_add_string_array_argument(
+            procedure,
+            "edits",
+            "Edits",
+            "KEY=VALUE edits to make.",
+            G_PARAM_READWRITE
+        );
     }
 
     return procedure;
@@ -394,10 +536,16 @@ static GimpValueArray *gimp_vtf_load(
     GimpValueArray *return_vals;
     GError *error = NULL;
 
+    mark_startup(STARTUP_RUN, "load");
+
+    configure_thread_pool(config);
+
     // Attempt to parse the VTF file
     GimpImage *image = load_image(file, &error);
+    log_thread_pool_stats();
     // Generic catch-all if the image wasn't loaded for whatever reason
     if (!image) {
+        mark_startup(STARTUP_RESPONSE, "load failed");
         return gimp_procedure_new_return_values(procedure, GIMP_PDB_EXECUTION_ERROR, error);
     }
 
@@ -405,16 +553,62 @@ static GimpValueArray *gimp_vtf_load(
 
     GIMP_VALUES_SET_IMAGE(return_vals, 1, image);
 
+    mark_startup(STARTUP_RESPONSE, "load done");
+
     return return_vals;
 }
 
+static GimpValueArray *gimp_vtf_edit(
+    GimpProcedure *procedure,
+    GimpProcedureConfig *config,
+    gpointer run_data
+) {
+    mark_startup(STARTUP_RUN, "edit");
+
+    GFile *file = NULL;
+    gchar **edits = NULL;
+    g_object_get(config, "file", &file, "edits", &edits, NULL);
+
+    VtfHeaderEdit edit;
+    std::string error_message;
+    bool edit_successful = file != NULL;
+    if (!file) {
+        error_message = "No file given";
+    }
+    for (gchar **option = edits; edit_successful && option && *option; option++) {
+        edit_successful = vtf_edit_set_option(edit, *option, error_message);
+    }
+
+    if (edit_successful) {
+        char *file_path = g_file_get_path(file);
+        edit_successful = vtf_edit_file(file_path, edit, error_message);
+        g_free(file_path);
+    }
+
+    g_strfreev(edits);
+    g_clear_object(&file);
+
+    mark_startup(STARTUP_RESPONSE, "edit done");
+
+    if (!edit_successful) {
+        GError *error = g_error_new_literal(GIMP_PLUG_IN_ERROR, 0, error_message.c_str());
+        return gimp_procedure_new_return_values(procedure, GIMP_PDB_EXECUTION_ERROR, error);
+    }
+    return gimp_procedure_new_return_values(procedure, GIMP_PDB_SUCCESS, NULL);
+}
+
 // Gets a GFile, returns a GimpImage.
 // Most of the VTF loading work is done here.
 static GimpImage *load_image(GFile *file, GError **error) {
+    VTF_TRACE(load_start);
+
     char *file_path = g_file_get_path(file);
 
     // TODO: error handling here
+    VTF_TRACE_STAGE_START(TRACE_STAGE_PARSE);
     vtfpp::VTF vtf_file = vtfpp::VTF(file_path, false);
+    VTF_TRACE_STAGE_END(TRACE_STAGE_PARSE);
+    g_free(file_path);
     int width = vtf_file.getWidth();
     int height = vtf_file.getHeight();
 
@@ -431,54 +625,48 @@ static GimpImage *load_image(GFile *file, GError **error) {
 
     // For each frame, for each face
     // https://developer.valvesoftware.com/wiki/VTF_(Valve_Texture_Format)#Image_data_formats
-    int frame_count = vtf_file.getFrameCount();
-    int face_count = vtf_file.getFaceCount();
-    int layer_number = 0;
-    for (int fr_i = 0; fr_i < frame_count; fr_i++) {
-        for (int fa_i = 0; fa_i < face_count; fa_i++) {
-            gchar *layer_name = g_strdup_printf("Layer %.3d", layer_number + 1);
-            layer_number++;
-            
-            // TODO: same as before, but for GimpImageType
-            //  We'll just use GIMP_RGBA_IMAGE for now (RGB with alpha)
-            GimpLayer *layer = gimp_layer_new(
-                image,
-                layer_name,
-                width,
-                height,
-                GIMP_RGBA_IMAGE,
-                100,
-                gimp_image_get_default_new_layer_mode(image)
-            );
-            gimp_image_insert_layer(image, layer, NULL, 0);
-            g_free(layer_name);
-
-            GeglBuffer *buffer = gimp_drawable_get_buffer(GIMP_DRAWABLE(layer));
-            std::vector<std::byte> image_data_rgba = vtf_file.getImageDataAsRGBA8888(0, fr_i, fa_i, 0);
-
-            // Get the bits per pixel for the RGBA8888 format (the one we're using above)
-            // Divide by 8 to get bytes
-            int bpp = vtfpp::ImageFormatDetails::bpp(vtfpp::ImageFormat::RGBA8888) / 8;
-            uint8_t *dst_buf = g_new(uint8_t, width * height * bpp);
-            for (int i = 0; i < image_data_rgba.size(); i++) {
-                dst_buf[i] = (uint8_t)image_data_rgba[i];
-            }
+    VTF_TRACE_STAGE_START(TRACE_STAGE_DECODE);
+
+    // Subimages are decoded in parallel on the shared pool, a batch at a time (see vtf-core.h).
+    //  They're handed to GIMP here, on this thread, in order, since libgimp calls can't be made
+    //  from other threads. The batch buffers are freed with the arena at the end of the load.
+    VtfScratchArena arena;
+    vtf_core_decode_frames_rgba8888(vtf_file, vtf_pool_shared(), arena, [&](int subimage, std::span<const std::byte> rgba) {
+        gchar *layer_name = g_strdup_printf("Layer %.3d", subimage + 1);
+
+        // TODO: same as before, but for GimpImageType
+        //  We'll just use GIMP_RGBA_IMAGE for now (RGB with alpha)
+        GimpLayer *layer = gimp_layer_new(
+            image,
+            layer_name,
+            width,
+            height,
+            GIMP_RGBA_IMAGE,
+            100,
+            gimp_image_get_default_new_layer_mode(image)
+        );
+        gimp_image_insert_layer(image, layer, NULL, 0);
+        g_free(layer_name);
 
-            gegl_buffer_set(
-                buffer,
-                GEGL_RECTANGLE(0, 0, width, height),
-                0,
-                babl_format_with_space(
-                    "R'G'B'A u8",
-                    gimp_drawable_get_format(GIMP_DRAWABLE(layer))
-                ),
-                dst_buf,
-                GEGL_AUTO_ROWSTRIDE
-            );
+        GeglBuffer *buffer = gimp_drawable_get_buffer(GIMP_DRAWABLE(layer));
 
-            g_object_unref(buffer);
-        }
-    }
+        gegl_buffer_set(
+            buffer,
+            GEGL_RECTANGLE(0, 0, width, height),
+            0,
+            babl_format_with_space(
+                "R'G'B'A u8",
+                gimp_drawable_get_format(GIMP_DRAWABLE(layer))
+            ),
+            rgba.data(),
+            GEGL_AUTO_ROWSTRIDE
+        );
+
+        g_object_unref(buffer);
+    });
+    VTF_TRACE_STAGE_END(TRACE_STAGE_DECODE);
+
+    VTF_TRACE1(load_end, 1);
 
     return image;
 }
@@ -500,6 +688,8 @@ static GimpValueArray *gimp_vtf_export(
     gboolean has_alpha;
     GError *error = NULL;
 
+    mark_startup(STARTUP_RUN, "export");
+
     gegl_init(NULL, NULL);
 
     orig_image = image;
@@ -530,6 +720,8 @@ static GimpValueArray *gimp_vtf_export(
 
     // If we're ready to continue with exporting the image to disk
     if (status == GIMP_PDB_SUCCESS) {
+        configure_thread_pool(config);
+
         gboolean export_successful = export_image(
             file,
             image,
@@ -544,6 +736,8 @@ static GimpValueArray *gimp_vtf_export(
         if (!export_successful) {
             status = GIMP_PDB_EXECUTION_ERROR;
         }
+
+        log_thread_pool_stats();
     }
 
     if (export_type == GIMP_EXPORT_EXPORT) {
@@ -552,7 +746,9 @@ static GimpValueArray *gimp_vtf_export(
 
     g_list_free(drawables);
 
-    return gimp_procedure_new_return_values(procedure, status, NULL);
+    mark_startup(STARTUP_RESPONSE, "export done");
+
+    return gimp_procedure_new_return_values(procedure, status, error);
 }
 
 static gboolean export_dialog(
@@ -619,9 +815,16 @@ static gboolean export_dialog(
         "mipmap_filter",
         "resize_method",
         "bumpmap_scale",
+        "height_conversion",
+        "height_scale",
+        "prefilter_enabled",
+        "prefilter_samples",
         "thumbnail_enabled",
         "recompute_reflectivity_enabled",
         "merge_layers_enabled",
+        "report_enabled",
+        "material_outputs",
+        "channel_pack",
 
         "vtf_flags_frame",
 
@@ -644,6 +847,8 @@ static gboolean export_image(GFile *file,
     GimpRunMode run_mode,
     GError **error
 ) {
+    VTF_TRACE(export_start);
+
     // This is specifically the VTF minor version. So if the user chose 7.4, this would be '4'
     int file_version;
     // Image format (DXT1, RGBA8888, etc.)
@@ -657,11 +862,20 @@ static gboolean export_image(GFile *file,
     int mipmap_filter;
     // Resize method (power-of-two bigger, smaller, or nearest)
     vtfpp::ImageConversion::ResizeMethod resize_method;
-    bool thumbnail_enabled;
+    // Booleans are gboolean, not bool: g_object_get() writes a whole gboolean
+    gboolean thumbnail_enabled;
     // TODO: implement
-    bool merge_layers_enabled;
-    bool recompute_reflectivity_enabled;
+    gboolean merge_layers_enabled;
+    gboolean recompute_reflectivity_enabled;
+    gboolean report_enabled;
     double bumpmap_scale;
+    // A VtfHeightConversion
+    int height_conversion;
+    double height_scale;
+    gboolean prefilter_enabled;
+    int prefilter_samples;
+    gchar *material_outputs;
+    gchar *channel_pack;
 
     // Specifically, if we're not running with re-used previous values
     // TODO: This code doesn't work
@@ -680,12 +894,19 @@ static gboolean export_image(GFile *file,
     mipmap_filter = gimp_procedure_config_get_choice_id(config, "mipmap_filter");
     image_format = (vtfpp::ImageFormat)gimp_procedure_config_get_choice_id(config, "image_format");
     resize_method = (vtfpp::ImageConversion::ResizeMethod)gimp_procedure_config_get_choice_id(config, "resize_method");
+    height_conversion = gimp_procedure_config_get_choice_id(config, "height_conversion");
     g_object_get(
         config,
         "thumbnail_enabled",                &thumbnail_enabled,
         "merge_layers_enabled",             &merge_layers_enabled,
         "recompute_reflectivity_enabled",   &recompute_reflectivity_enabled,
+        "report_enabled",                   &report_enabled,
         "bumpmap_scale",                    &bumpmap_scale,
+        "height_scale",                     &height_scale,
+        "prefilter_enabled",                &prefilter_enabled,
+        "prefilter_samples",                &prefilter_samples,
+        "material_outputs",                 &material_outputs,
+        "channel_pack",                     &channel_pack,
         NULL
     );
 
@@ -696,207 +917,258 @@ static gboolean export_image(GFile *file,
     int height = gegl_buffer_get_height(buffer_for_res);
     g_object_unref(buffer_for_res);
 
-    // Set up some basic information in the exported VTF
-    vtfpp::VTF export_vtf;
-    export_vtf.setVersion(7, file_version);
-    // SRGB flag (the standard color space GIMP uses)
-    export_vtf.setFlags(vtfpp::VTF::FLAG_PWL_CORRECTED);
-    export_vtf.setImageResizeMethods(resize_method, resize_method);
-    export_vtf.setSize(width, height, vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+    //
+    // Compute VTF settings
+    //
+    
+    // Set flags
+    // Every user-settable flag has a boolean argument of the same name, see vtf-flags.h
+    vtfpp::VTF::Flags current_flags = vtfpp::VTF::FLAG_NONE;
+    for (const VtfFlagName &flag_name : VTF_FLAG_NAMES) {
+        if (!flag_name.user_settable) continue;
+
+        gboolean flag_enabled;
+        g_object_get(config, flag_name.name, &flag_enabled, NULL);
+        if (flag_enabled) {
+            current_flags = (vtfpp::VTF::Flags)(current_flags | flag_name.flag);
+        }
+    }
+
+    VtfExportSettings settings;
+    settings.minor_version = file_version;
+    settings.image_format = image_format;
+    settings.image_type = image_type;
+    settings.mipmap_filter = mipmap_filter;
+    settings.resize_method = resize_method;
+    settings.thumbnail_enabled = thumbnail_enabled != FALSE;
+    settings.recompute_reflectivity_enabled = recompute_reflectivity_enabled != FALSE;
+    settings.bumpmap_scale = bumpmap_scale;
+    settings.height_conversion = height_conversion;
+    settings.height_scale = height_scale;
+    settings.prefilter_enabled = prefilter_enabled != FALSE;
+    settings.prefilter_samples = prefilter_samples;
+    settings.flags = current_flags;
+
+    // Material sets and channel packing export named layers instead of one frame per layer
+    std::vector<VtfMaterialOutput> material_set;
+    std::string material_error;
+    bool material_parsed = true;
+    if (material_outputs && material_outputs[0] != '\0') {
+        material_parsed = vtf_material_parse_outputs(material_outputs, settings, material_set, material_error);
+    } else if (channel_pack && channel_pack[0] != '\0') {
+        // One output with no suffix, so it's written to the file being exported
+        VtfMaterialOutput packed_output;
+        packed_output.layer_name = channel_pack;
+        packed_output.settings = settings;
+        material_parsed = vtf_material_parse_channels(channel_pack, packed_output, material_error);
+        material_set.push_back(std::move(packed_output));
+    }
+    g_free(material_outputs);
+    g_free(channel_pack);
+
+    if (!material_parsed) {
+        g_set_error(error, GIMP_PLUG_IN_ERROR, 0, "%s", material_error.c_str());
+        return false;
+    }
+    if (!material_set.empty()) {
+        return export_material_set(file, orig_image, material_set, report_enabled, error);
+    }
 
     // Set images inside the VTF
-    // TODO: export multiple layers as multiple frames (& equivalent for faces)
+    // Layers become frames (standard) or faces (envmap/volumetric), see vtf_core_build()
     int layer_count = g_list_length(drawables);
 
-    // Depending on whether the image is a standard image or envmap/volumetric,
-    //  write the images either as frames or as faces
-    if (image_type == VTFImageType::TYPE_STANDARD) {
-        export_vtf.setFrameCount(layer_count);
-    } else {
-        export_vtf.setFaceCount(true, layer_count >= 7);
+    // Scratch memory for the whole export, freed in one go when this function returns
+    VtfScratchArena arena;
+    // Only looked at when writing a report, but cheap enough to always take
+    VtfStageTimings timings;
+
+    vtfpp::VTF export_vtf;
+    bool build_successful = vtf_core_build(
+        export_vtf,
+        settings,
+        width,
+        height,
+        layer_count,
+        [&](int layer_index, std::span<std::byte> rgba) {
+            GList *layer_at_nth = g_list_nth(drawables, layer_index);
+            GimpDrawable *drawable_for_this_layer = GIMP_DRAWABLE(layer_at_nth->data);
+            GeglBuffer *buffer_for_this_layer = gimp_drawable_get_buffer(drawable_for_this_layer);
+
+            // Take bytes from the GIMP drawable buffer and put them in the layer buffer.
+            // Always ask GEGL for RGBA8888 regardless of the layer's own format, since that's
+            //  what vtf_core_build() hands to vtfpp.
+            gegl_buffer_get(
+                buffer_for_this_layer,
+                GEGL_RECTANGLE(0, 0, width, height),
+                1.0,
+                babl_format_with_space(
+                    "R'G'B'A u8",
+                    gimp_drawable_get_format(drawable_for_this_layer)
+                ),
+                rgba.data(),
+                GEGL_AUTO_ROWSTRIDE,
+                GEGL_ABYSS_NONE
+            );
+            g_object_unref(buffer_for_this_layer);
+
+            return true;
+        },
+        &arena,
+        &timings
+    );
+
+    if (!build_successful) {
+        VTF_TRACE1(export_end, 0);
+        return false;
     }
 
-    for (int layer_index = 0; layer_index < layer_count; layer_index++) {
-        GList *layer_at_nth = g_list_nth(drawables, layer_index);
-        GimpDrawable *drawable_for_this_layer = GIMP_DRAWABLE(layer_at_nth->data);
-        GeglBuffer *buffer_for_this_layer = gimp_drawable_get_buffer(drawable_for_this_layer);
-
-        int bpp = vtfpp::ImageFormatDetails::bpp(vtfpp::ImageFormat::RGBA8888) / 8;
-        int file_bytes_count = width * height * bpp;
-        // Take bytes from the GIMP drawable buffer and put it in this vector
-        uint8_t *raw_bytes = g_new(uint8_t, file_bytes_count);
-        gegl_buffer_get(
-            buffer_for_this_layer,
-            GEGL_RECTANGLE(0, 0, width, height),
-            1.0,
-            gimp_drawable_get_format(drawable_for_this_layer),
-            raw_bytes,
-            GEGL_AUTO_ROWSTRIDE,
-            GEGL_ABYSS_NONE
-        );
-        g_object_unref(buffer_for_this_layer);
+    // Write VTF to file on disk
+    char *file_path = g_file_get_path(file);
+    bool export_successful;
+    {
+        VtfStageScope write_stage(&timings, TRACE_STAGE_WRITE);
+        export_successful = export_vtf.bake(file_path);
+    }
 
-        // The vtfpp library can't seem to interface with uint8_t directly, so we have to
-        //  move data to a vector
-        std::vector<std::byte> raw_bytes_vec;
-        for (int i = 0; i < file_bytes_count; i++) {
-            raw_bytes_vec.push_back((std::byte)raw_bytes[i]);
-        }
+    // <name>.vtf.json next to the VTF
+    if (export_successful && report_enabled) {
+        VtfExportReport report = vtf_report_collect(export_vtf, settings, file_path);
+        report.timings = timings;
 
-        // Depending on whether the image is a standard image or envmap/volumetric,
-        //  write the images either as frames or as faces
-        uint16_t frame_index = 0;
-        uint8_t face_index = 0;
-        if (image_type == VTFImageType::TYPE_STANDARD) {
-            frame_index = layer_index;
-        } else {
-            face_index = layer_index;
+        std::string report_path = std::string(file_path) + ".json";
+        if (!vtf_report_write_json(report, report_path)) {
+            g_warning("Could not write export report %s", report_path.c_str());
         }
+    }
+    g_free(file_path);
 
-        // Take the bytes from the vector and parse it as a VTF image layer
-        bool bytes_to_image_successful = export_vtf.setImage(
-            raw_bytes_vec,
-            // Because the raw_bytes_vec is stored using 4 bytes per pixel,
-            //  we *must* use RGBA8888 when we initially import from the GIMP layers to the VTF.
-            // However, the user's selected VTF format will still be respected once we write to disk.
-            vtfpp::ImageFormat::RGBA8888,
-            width,
-            height,
-            // This is specifically the resize method used when the user gives the image in GIMP
-            //  an invalid size. It is *not* used when generating mipmaps (as far as I'm aware).
-            // Might make this configurable to the user, but there is an argument to be made that
-            //  if the user wanted to resize the image, they could just do it in GIMP. So for now,
-            //  I won't add it.
-            vtfpp::ImageConversion::ResizeFilter::DEFAULT,
-            0,
-            frame_index,
-            face_index,
-            0
-        );
+    VTF_TRACE1(export_end, (int)export_successful);
 
-        if (!bytes_to_image_successful) {
-            g_warning("Could not successfully call vtf.setImage() for layer %d", layer_index);
-            //return false;
-        }
+    return export_successful;
+}
+
+// Reads the layer, layer group or channel called name, canvas-sized, in babl format format_name.
+// Anything outside the drawable comes out transparent (or black), the same as GIMP shows it.
+static gboolean fetch_named_drawable(
+    GimpImage *image,
+    const std::string &name,
+    const char *format_name,
+    int bytes_per_pixel,
+    std::vector<std::byte> &pixels,
+    GError **error
+) {
+    GimpDrawable *drawable = NULL;
+    if (GimpLayer *layer = gimp_image_get_layer_by_name(image, name.c_str())) {
+        drawable = GIMP_DRAWABLE(layer);
+    } else if (GimpChannel *channel = gimp_image_get_channel_by_name(image, name.c_str())) {
+        drawable = GIMP_DRAWABLE(channel);
+    }
+    if (!drawable) {
+        g_set_error(error, GIMP_PLUG_IN_ERROR, 0, "No layer, layer group or channel named \"%s\"", name.c_str());
+        return false;
     }
 
-    //
-    // Compute VTF settings
-    //
-    
-    // Set flags
-    bool flag_point_sample;
-    bool flag_trilinear;
-    bool flag_clamp_s;
-    bool flag_clamp_t;
-    bool flag_anisotropic;
-    bool flag_hint_dxt5;
-    bool flag_normal_map;
-    bool flag_min_mipmap;
-    bool flag_procedural;
-    bool flag_rt;
-    bool flag_depth_rt;
-    bool flag_no_debug_override;
-    bool flag_single_copy;
-    bool flag_premultiply_color;
-    bool flag_normal_to_dudv;
-    bool flag_alpha_test_mip_gen;
-    bool flag_no_depth_buffer;
-    bool flag_nice_filtered;
-    bool flag_clamp_u;
-    bool flag_vertex_texture;
-    bool flag_ssbump;
-    bool flag_load_most_mips;
-    bool flag_border;
-    g_object_get(
-        config,
-        "flag_point_sample",                &flag_point_sample,
-        "flag_trilinear",                   &flag_trilinear,
-        "flag_clamp_s",                     &flag_clamp_s,
-        "flag_clamp_t",                     &flag_clamp_t,
-        "flag_anisotropic",                 &flag_anisotropic,
-        "flag_hint_dxt5",                   &flag_hint_dxt5,
-        "flag_normal_map",                  &flag_normal_map,
-        "flag_min_mipmap",                  &flag_min_mipmap,
-        "flag_procedural",                  &flag_procedural,
-        "flag_rt",                          &flag_rt,
-        "flag_depth_rt",                    &flag_depth_rt,
-        "flag_no_debug_override",           &flag_no_debug_override,
-        "flag_single_copy",                 &flag_single_copy,
-        "flag_premultiply_color",           &flag_premultiply_color,
-        "flag_normal_to_dudv",              &flag_normal_to_dudv,
-        "flag_alpha_test_mip_gen",          &flag_alpha_test_mip_gen,
-        "flag_no_depth_buffer",             &flag_no_depth_buffer,
-        "flag_nice_filtered",               &flag_nice_filtered,
-        "flag_clamp_u",                     &flag_clamp_u,
-        "flag_vertex_texture",              &flag_vertex_texture,
-        "flag_ssbump",                      &flag_ssbump,
-        "flag_load_most_mips",              &flag_load_most_mips,
-        "flag_border",                      &flag_border,
-        NULL
+    int width = gimp_image_get_width(image);
+    int height = gimp_image_get_height(image);
+    int offset_x, offset_y;
+    gimp_drawable_get_offsets(drawable, &offset_x, &offset_y);
+
+    pixels.resize((size_t)width * height * bytes_per_pixel);
+    GeglBuffer *buffer = gimp_drawable_get_buffer(drawable);
+    gegl_buffer_get(
+        buffer,
+        GEGL_RECTANGLE(-offset_x, -offset_y, width, height),
+        1.0,
+        babl_format_with_space(format_name, gimp_drawable_get_format(drawable)),
+        pixels.data(),
+        GEGL_AUTO_ROWSTRIDE,
+        GEGL_ABYSS_NONE
     );
-    
-    // TODO: format this nicely
-    vtfpp::VTF::Flags flag_none = vtfpp::VTF::FLAG_NONE;
-    vtfpp::VTF::Flags current_flags = export_vtf.getFlags();
-    current_flags |= flag_point_sample ? vtfpp::VTF::FLAG_POINT_SAMPLE : flag_none;
-    current_flags |= flag_trilinear ? vtfpp::VTF::FLAG_TRILINEAR : flag_none;
-    current_flags |= flag_clamp_s ? vtfpp::VTF::FLAG_CLAMP_S : flag_none;
-    current_flags |= flag_clamp_t ? vtfpp::VTF::FLAG_CLAMP_T : flag_none;
-    current_flags |= flag_anisotropic ? vtfpp::VTF::FLAG_ANISOTROPIC : flag_none;
-    current_flags |= flag_hint_dxt5 ? vtfpp::VTF::FLAG_HINT_DXT5 : flag_none;
-    current_flags |= flag_normal_map ? vtfpp::VTF::FLAG_NORMAL : flag_none;
-    current_flags |= flag_min_mipmap ? vtfpp::VTF::FLAG_LOAD_ALL_MIPS : flag_none;
-    current_flags |= flag_procedural ? vtfpp::VTF::FLAG_PROCEDURAL : flag_none;
-    current_flags |= flag_rt ? vtfpp::VTF::FLAG_RENDERTARGET : flag_none;
-    current_flags |= flag_depth_rt ? vtfpp::VTF::FLAG_DEPTH_RENDERTARGET : flag_none;
-    current_flags |= flag_no_debug_override ? vtfpp::VTF::FLAG_NO_DEBUG_OVERRIDE : flag_none;
-    current_flags |= flag_single_copy ? vtfpp::VTF::FLAG_SINGLE_COPY : flag_none;
-    current_flags |= flag_premultiply_color ? vtfpp::VTF::FLAG_DEFAULT_POOL : flag_none;
-    current_flags |= flag_normal_to_dudv ? vtfpp::VTF::FLAG_COMBINED : flag_none;
-    current_flags |= flag_alpha_test_mip_gen ? vtfpp::VTF::FLAG_ASYNC_DOWNLOAD : flag_none;
-    current_flags |= flag_no_depth_buffer ? vtfpp::VTF::FLAG_NO_DEPTH_BUFFER : flag_none;
-    current_flags |= flag_nice_filtered ? vtfpp::VTF::FLAG_SKIP_INITIAL_DOWNLOAD : flag_none;
-    current_flags |= flag_clamp_u ? vtfpp::VTF::FLAG_CLAMP_U : flag_none;
-    current_flags |= flag_vertex_texture ? vtfpp::VTF::FLAG_VERTEX_TEXTURE : flag_none;
-    current_flags |= flag_ssbump ? vtfpp::VTF::FLAG_SSBUMP : flag_none;
-    current_flags |= flag_load_most_mips ? vtfpp::VTF::FLAG_LOAD_MOST_MIPS : flag_none;
-    current_flags |= flag_border ? vtfpp::VTF::FLAG_BORDER : flag_none;
-    export_vtf.setFlags(current_flags);
-
-    // TODO: set start frame here
-
-    export_vtf.setBumpMapScale(bumpmap_scale);
-
-    bool should_compute_mips = (mipmap_filter == -1) ? false : true;
-    if (should_compute_mips) {
-        export_vtf.setMipCount(vtfpp::ImageDimensions::getRecommendedMipCountForDims(image_format, width, height));
-        export_vtf.computeMips((vtfpp::ImageConversion::ResizeFilter)mipmap_filter);
-    } else {
-        export_vtf.setMipCount(1);
-    }
+    g_object_unref(buffer);
+    return true;
+}
 
-    if (thumbnail_enabled) {
-        export_vtf.computeThumbnail(vtfpp::ImageConversion::ResizeFilter::DEFAULT);
-    } else {
-        export_vtf.removeThumbnail();
-    }
+// Canvas-sized drawables read for an export, each only once however many outputs use it
+struct FetchedDrawables {
+    std::vector<std::string> keys;
+    std::vector<std::vector<std::byte>> pixels;
 
-    if (recompute_reflectivity_enabled) {
-        export_vtf.computeReflectivity();
+    // RGBA8888 for whole layers, one byte per pixel for channels that get packed
+    const std::vector<std::byte> *get(GimpImage *image, const std::string &name, bool grayscale, GError **error) {
+        std::string key = (grayscale ? "Y'|" : "RGBA|") + name;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) return &pixels[i];
+        }
+
+        std::vector<std::byte> fetched;
+        if (!fetch_named_drawable(image, name, grayscale ? "Y' u8" : "R'G'B'A u8", grayscale ? 1 : 4, fetched, error)) {
+            return NULL;
+        }
+        keys.push_back(key);
+        pixels.push_back(std::move(fetched));
+        return &pixels.back();
     }
+};
 
-    export_vtf.computeTransparencyFlags();
+// Points layer at the pixels for output, reading whatever drawables it needs
+static gboolean fetch_output_layer(
+    GimpImage *image,
+    const VtfMaterialOutput &output,
+    FetchedDrawables &fetched,
+    VtfMaterialLayer &layer,
+    GError **error
+) {
+    layer = VtfMaterialLayer();
+    layer.width = gimp_image_get_width(image);
+    layer.height = gimp_image_get_height(image);
+
+    if (!output.packed) {
+        const std::vector<std::byte> *rgba = fetched.get(image, output.layer_name, false, error);
+        if (!rgba) return false;
+        layer.rgba = *rgba;
+        return true;
+    }
 
-    export_vtf.setFormat(image_format, vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+    for (int channel = 0; channel < 4; channel++) {
+        if (output.channel_layers[channel].empty()) continue;
+        const std::vector<std::byte> *plane = fetched.get(image, output.channel_layers[channel], true, error);
+        if (!plane) return false;
+        layer.planes[channel] = plane->data();
+    }
+    return true;
+}
 
-    // TODO: set compression method here
-    
-    // TODO: set compression level here
+// Exports each material output (see vtf-material.h) from its layers in image. A single output
+//  with no suffix is a channel-packed export to file itself.
+// Drawables are read on this thread (GIMP calls aren't thread-safe), then the outputs are
+//  built and written concurrently.
+static gboolean export_material_set(
+    GFile *file,
+    GimpImage *image,
+    const std::vector<VtfMaterialOutput> &outputs,
+    gboolean report_enabled,
+    GError **error
+) {
+    // Every output is canvas-sized, whatever the size and offset of its layers.
+    // fetched only grows by push_back here, and the pointers into it stay valid since each
+    //  entry's pixels are separate allocations.
+    FetchedDrawables fetched;
+    std::vector<VtfMaterialLayer> layers(outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        if (!fetch_output_layer(image, outputs[i], fetched, layers[i], error)) {
+            return false;
+        }
+    }
 
-    // Write VTF to file on disk
-    bool export_successful = export_vtf.bake(g_file_get_path(file));
+    char *file_path = g_file_get_path(file);
+    std::string error_message;
+    bool export_successful = vtf_material_export(file_path, outputs, layers, report_enabled, error_message);
+    g_free(file_path);
 
+    if (!export_successful) {
+        g_set_error(error, GIMP_PLUG_IN_ERROR, 0, "%s", error_message.c_str());
+    }
     return export_successful;
 }
 
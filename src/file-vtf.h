@@ -16,7 +16,21 @@
 
 #include <libgimp/gimp.h>
 #include <libgimp/gimpui.h>
+#include "vtf-core.h"
+#include "vtf-material.h"
+#include "vtf-trace.h"
 
+static void mark_startup(
+    VtfStartupMark mark,
+    const char *description
+);
+static void add_threads_argument(
+    GimpProcedure *procedure
+);
+static void configure_thread_pool(
+    GimpProcedureConfig *config
+);
+static void log_thread_pool_stats();
 static GList *gimp_vtf_query_procedures(
     GimpPlugIn *plugin
 );
@@ -31,6 +45,11 @@ static GimpValueArray *gimp_vtf_load(
     GimpMetadataLoadFlags *flags,
     GimpProcedureConfig *config,
     gpointer run_data);
+static GimpValueArray *gimp_vtf_edit(
+    GimpProcedure *procedure,
+    GimpProcedureConfig *config,
+    gpointer run_data
+);
 static GimpImage *load_image(
     GFile *file,
     GError **error
@@ -60,9 +79,26 @@ static gboolean export_image(
     GimpRunMode run_mode,
     GError **error
 );
-
-enum VTFImageType : uint32_t {
-    TYPE_STANDARD           = 0,
-    TYPE_ENVIRONMENT_MAP    = 1,
-    TYPE_VOLUMETRIC_TEXTURE = 2
-};
+struct FetchedDrawables;
+static gboolean fetch_named_drawable(
+    GimpImage *image,
+    const std::string &name,
+    const char *format_name,
+    int bytes_per_pixel,
+    std::vector<std::byte> &pixels,
+    GError **error
+);
+static gboolean fetch_output_layer(
+    GimpImage *image,
+    const VtfMaterialOutput &output,
+    FetchedDrawables &fetched,
+    VtfMaterialLayer &layer,
+    GError **error
+);
+static gboolean export_material_set(
+    GFile *file,
+    GimpImage *image,
+    const std::vector<VtfMaterialOutput> &outputs,
+    gboolean report_enabled,
+    GError **error
+);
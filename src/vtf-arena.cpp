@@ -0,0 +1,83 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-arena.h"
+
+#include <bit>
+#include <new>
+
+// Blocks are aligned for SIMD loads/stores
+static constexpr std::align_val_t ARENA_ALIGNMENT { 64 };
+
+VtfScratchArena::~VtfScratchArena() {
+    for (std::byte *block : blocks_) {
+        ::operator delete[](block, ARENA_ALIGNMENT);
+    }
+}
+
+int VtfScratchArena::size_class(size_t size) {
+    if (size <= ((size_t)1 << MIN_CLASS_BITS)) {
+        return 0;
+    }
+    return std::bit_width(size - 1) - MIN_CLASS_BITS;
+}
+
+std::span<std::byte> VtfScratchArena::acquire(size_t size) {
+    if (size == 0) {
+        return {};
+    }
+
+    int class_index = size_class(size);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<std::byte *> &free_list = free_lists_[class_index];
+    if (!free_list.empty()) {
+        std::byte *block = free_list.back();
+        free_list.pop_back();
+        return { block, size };
+    }
+
+    size_t class_size = (size_t)1 << (class_index + MIN_CLASS_BITS);
+    std::byte *block = static_cast<std::byte *>(::operator new[](class_size, ARENA_ALIGNMENT));
+    blocks_.push_back(block);
+    bytes_reserved_ += class_size;
+
+    // Make room on the free list for every block of this class now, so releasing never has to allocate
+    class_block_counts_[class_index]++;
+    free_list.reserve(class_block_counts_[class_index]);
+
+    return { block, size };
+}
+
+void VtfScratchArena::release(std::span<std::byte> buffer) {
+    if (buffer.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_lists_[size_class(buffer.size())].push_back(buffer.data());
+}
+
+size_t VtfScratchArena::heap_allocations() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_.size();
+}
+
+size_t VtfScratchArena::bytes_reserved() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_reserved_;
+}
@@ -0,0 +1,81 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Scratch memory for a single load or export.
+//
+// Buffers come from power-of-two size classes. Releasing a buffer puts it back on its class'
+//  free list instead of freeing it, so the next frame/mip/tile of a similar size gets the same
+//  memory back. Nothing is returned to the heap until the arena itself is destroyed, at the end
+//  of the operation.
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <span>
+#include <vector>
+
+class VtfScratchArena {
+public:
+    VtfScratchArena() = default;
+    ~VtfScratchArena();
+
+    VtfScratchArena(const VtfScratchArena &) = delete;
+    VtfScratchArena &operator=(const VtfScratchArena &) = delete;
+
+    // Returns a buffer of exactly size bytes (with room for up to the next power of two).
+    // Safe to call from pool threads.
+    std::span<std::byte> acquire(size_t size);
+    // Hands a buffer from acquire() back for reuse.
+    void release(std::span<std::byte> buffer);
+
+    // How many times the arena had to allocate from the heap
+    size_t heap_allocations() const;
+    // Total bytes held by the arena, in use or not
+    size_t bytes_reserved() const;
+
+private:
+    // Smallest class is 4 KiB; anything smaller isn't worth pooling separately
+    static constexpr int MIN_CLASS_BITS = 12;
+    static constexpr int CLASS_COUNT = 64 - MIN_CLASS_BITS;
+
+    static int size_class(size_t size);
+
+    mutable std::mutex mutex_;
+    std::vector<std::byte *> free_lists_[CLASS_COUNT];
+    size_t class_block_counts_[CLASS_COUNT] = {};
+    std::vector<std::byte *> blocks_;
+    size_t bytes_reserved_ = 0;
+};
+
+// Holds an arena buffer for the current scope.
+class VtfScratchBuffer {
+public:
+    VtfScratchBuffer(VtfScratchArena &arena, size_t size)
+        : arena_(arena), buffer_(arena.acquire(size)) {}
+    ~VtfScratchBuffer() { arena_.release(buffer_); }
+
+    VtfScratchBuffer(const VtfScratchBuffer &) = delete;
+    VtfScratchBuffer &operator=(const VtfScratchBuffer &) = delete;
+
+    std::span<std::byte> span() const { return buffer_; }
+    std::byte *data() const { return buffer_.data(); }
+    size_t size() const { return buffer_.size(); }
+
+private:
+    VtfScratchArena &arena_;
+    std::span<std::byte> buffer_;
+};
@@ -0,0 +1,75 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-bump.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "vtf-kernels.h"
+#include "vtf-pool.h"
+
+void vtf_bump_from_height(
+    std::span<std::byte> rgba,
+    int width,
+    int height,
+    const VtfExportSettings &settings,
+    VtfScratchArena &arena
+) {
+    if (settings.height_conversion == VTF_HEIGHT_NONE || width <= 0 || height <= 0) {
+        return;
+    }
+
+    // The filter reads around each pixel, so the output can't overwrite the input as it goes.
+    // A one-byte height plane is a quarter of the layer, which beats copying the RGBA.
+    VtfScratchBuffer heights(arena, (size_t)width * height);
+    uint8_t *height_data = (uint8_t *)heights.data();
+    const uint8_t *rgba_data = (const uint8_t *)rgba.data();
+    int strip_count = (height + VTF_BUMP_STRIP_ROWS - 1) / VTF_BUMP_STRIP_ROWS;
+
+    vtf_pool_shared().parallel_for(strip_count, [&](int strip) {
+        size_t start = (size_t)strip * VTF_BUMP_STRIP_ROWS * width;
+        size_t end = (size_t)std::min((strip + 1) * VTF_BUMP_STRIP_ROWS, height) * width;
+        for (size_t i = start; i < end; i++) {
+            const uint8_t *pixel = rgba_data + i * 4;
+            // Grayscale layers come through with R = G = B, so this is only a guess for color ones
+            height_data[i] = (uint8_t)((pixel[0] + 2 * pixel[1] + pixel[2] + 2) / 4);
+        }
+    });
+
+    bool wrap_x = !(settings.flags & vtfpp::VTF::FLAG_CLAMP_S);
+    bool wrap_y = !(settings.flags & vtfpp::VTF::FLAG_CLAMP_T);
+    bool ssbump = settings.height_conversion == VTF_HEIGHT_SSBUMP;
+    float scale = (float)settings.height_scale;
+
+    vtf_pool_shared().parallel_for(strip_count, [&](int strip) {
+        int end = std::min((strip + 1) * VTF_BUMP_STRIP_ROWS, height);
+        for (int y = strip * VTF_BUMP_STRIP_ROWS; y < end; y++) {
+            int above = y > 0 ? y - 1 : (wrap_y ? height - 1 : 0);
+            int below = y < height - 1 ? y + 1 : (wrap_y ? 0 : height - 1);
+            vtf_kernel_height_to_bump_row(
+                height_data + (size_t)above * width,
+                height_data + (size_t)y * width,
+                height_data + (size_t)below * width,
+                width,
+                wrap_x,
+                scale,
+                ssbump,
+                rgba.data() + (size_t)y * width * 4
+            );
+        }
+    });
+}
@@ -0,0 +1,50 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Normal maps and SSBumps generated from a height map on export.
+//
+// The layer's brightness is the height (black low, white high). A Sobel filter gives the slope
+//  at each pixel, which becomes a tangent-space normal, and for SSBumps the normal is then
+//  projected onto Source's three bump basis vectors. The result replaces the layer's pixels in
+//  the buffer that goes to setImage(), so the export never needs a full-size normal map layer.
+//
+// Edges wrap like the texture does in game: left/right wrap unless FLAG_CLAMP_S is set, and
+//  top/bottom unless FLAG_CLAMP_T is.
+//
+// The SSBump is the basis projection of the normal only; there's no ray-traced self-shadowing
+//  like Valve's height2ssbump does, so it shades like the equivalent normal map.
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "vtf-arena.h"
+#include "vtf-core.h"
+
+// Rows per task. Every strip reads one row above and below it, so they can run in any order.
+#define VTF_BUMP_STRIP_ROWS 32
+
+// Replaces rgba (width * height RGBA8888) with the normal map or SSBump generated from it,
+//  as selected by settings.height_conversion and settings.height_scale.
+// Does nothing if settings.height_conversion is VTF_HEIGHT_NONE.
+void vtf_bump_from_height(
+    std::span<std::byte> rgba,
+    int width,
+    int height,
+    const VtfExportSettings &settings,
+    VtfScratchArena &arena
+);
@@ -0,0 +1,529 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-core.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "vtf-bump.h"
+#include "vtf-cubemap.h"
+#include "vtf-flags.h"
+#include "vtf-formats.h"
+#include "vtf-kernels.h"
+#include "vtf-pixels.h"
+#include "vtf-pool.h"
+#include "vtf-trace.h"
+
+static bool parse_bool(std::string_view value, bool *out) {
+    if (value == "true" || value == "1" || value == "yes") {
+        *out = true;
+        return true;
+    }
+    if (value == "false" || value == "0" || value == "no") {
+        *out = false;
+        return true;
+    }
+    return false;
+}
+
+bool vtf_core_set_option(VtfExportSettings &settings, std::string_view key, std::string_view value, std::string &error) {
+    // The lookup helpers take C strings
+    std::string value_string(value);
+    const char *nick = value_string.c_str();
+    bool bool_value;
+    int choice_value;
+
+    if (key == "version") {
+        // Choice nick (7_4) or how people write it (7.4)
+        if (value.size() == 3 && value[0] == '7' && (value[1] == '_' || value[1] == '.') && value[2] >= '0' && value[2] <= '6') {
+            settings.minor_version = value[2] - '0';
+            return true;
+        }
+    } else if (key == "image_format") {
+        if (vtf_format_from_nick(nick, &settings.image_format)) return true;
+    } else if (key == "image_type") {
+        if (vtf_choice_from_nick(VTF_IMAGE_TYPE_CHOICES, nick, &choice_value)) {
+            settings.image_type = (VTFImageType)choice_value;
+            return true;
+        }
+    } else if (key == "mipmap_filter") {
+        if (vtf_choice_from_nick(VTF_MIPMAP_FILTER_CHOICES, nick, &choice_value)) {
+            settings.mipmap_filter = choice_value;
+            return true;
+        }
+    } else if (key == "resize_method") {
+        if (vtf_choice_from_nick(VTF_RESIZE_METHOD_CHOICES, nick, &choice_value)) {
+            settings.resize_method = (vtfpp::ImageConversion::ResizeMethod)choice_value;
+            return true;
+        }
+    } else if (key == "thumbnail_enabled") {
+        if (parse_bool(value, &bool_value)) {
+            settings.thumbnail_enabled = bool_value;
+            return true;
+        }
+    } else if (key == "recompute_reflectivity_enabled") {
+        if (parse_bool(value, &bool_value)) {
+            settings.recompute_reflectivity_enabled = bool_value;
+            return true;
+        }
+    } else if (key == "bumpmap_scale") {
+        // Same range as the procedure argument
+        char *end;
+        double scale = strtod(nick, &end);
+        if (end != nick && *end == '\0' && scale >= 0.0 && scale <= 10.0) {
+            settings.bumpmap_scale = scale;
+            return true;
+        }
+    } else if (key == "height_conversion") {
+        if (vtf_choice_from_nick(VTF_HEIGHT_CONVERSION_CHOICES, nick, &choice_value)) {
+            settings.height_conversion = choice_value;
+            return true;
+        }
+    } else if (key == "height_scale") {
+        // Same range as the procedure argument
+        char *end;
+        double scale = strtod(nick, &end);
+        if (end != nick && *end == '\0' && scale >= 0.0 && scale <= 256.0) {
+            settings.height_scale = scale;
+            return true;
+        }
+    } else if (key == "prefilter_enabled") {
+        if (parse_bool(value, &bool_value)) {
+            settings.prefilter_enabled = bool_value;
+            return true;
+        }
+    } else if (key == "prefilter_samples") {
+        char *end;
+        long samples = strtol(nick, &end, 10);
+        if (end != nick && *end == '\0' && samples >= VTF_CUBEMAP_PREFILTER_MIN_SAMPLES && samples <= VTF_CUBEMAP_PREFILTER_MAX_SAMPLES) {
+            settings.prefilter_samples = (int)samples;
+            return true;
+        }
+    } else if (const VtfFlagName *flag_name = vtf_flag_from_name(std::string(key).c_str())) {
+        if (!flag_name->user_settable) {
+            error = std::string(key) + " is computed on export and can't be set";
+            return false;
+        }
+        if (parse_bool(value, &bool_value)) {
+            settings.flags = (vtfpp::VTF::Flags)(bool_value ? (settings.flags | flag_name->flag) : (settings.flags & ~flag_name->flag));
+            return true;
+        }
+    } else {
+        error = "Unknown option " + std::string(key);
+        return false;
+    }
+
+    error = "Invalid value \"" + value_string + "\" for " + std::string(key);
+    return false;
+}
+
+bool vtf_core_build_unencoded(
+    vtfpp::VTF &export_vtf,
+    const VtfExportSettings &settings,
+    int width,
+    int height,
+    int layer_count,
+    const VtfLayerFetch &fetch_layer,
+    VtfScratchArena *arena,
+    VtfStageTimings *timings
+) {
+    // A single 2:1 environment map layer is a panorama, which becomes six faces (see vtf-cubemap.h).
+    // Otherwise every layer is one image in the VTF.
+    bool from_panorama = vtf_cubemap_is_panorama(settings, width, height, layer_count);
+    int image_width = width;
+    int image_height = height;
+    int image_count = layer_count;
+    if (from_panorama) {
+        image_width = image_height = vtf_cubemap_face_size(width, height);
+        image_count = VTF_CUBEMAP_FACE_COUNT;
+    }
+
+    // Set up some basic information in the exported VTF
+    export_vtf.setVersion(7, settings.minor_version);
+    // SRGB flag (the standard color space GIMP uses). Normal maps and SSBumps generated from
+    //  height are vectors, not colors, so they're linear and get the flag for what they are instead.
+    if (settings.height_conversion == VTF_HEIGHT_NORMAL) {
+        export_vtf.setFlags(vtfpp::VTF::FLAG_NORMAL);
+    } else if (settings.height_conversion == VTF_HEIGHT_SSBUMP) {
+        export_vtf.setFlags(vtfpp::VTF::FLAG_SSBUMP);
+    } else {
+        export_vtf.setFlags(vtfpp::VTF::FLAG_PWL_CORRECTED);
+    }
+    export_vtf.setImageResizeMethods(settings.resize_method, settings.resize_method);
+    export_vtf.setSize(image_width, image_height, vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+
+    // Depending on whether the image is a standard image or envmap/volumetric,
+    //  write the images either as frames or as faces
+    // Six faces on their own still get a spheremap on versions that have one (see vtf-cubemap.h)
+    bool generate_spheremap = false;
+    if (settings.image_type == VTFImageType::TYPE_STANDARD) {
+        export_vtf.setFrameCount(image_count);
+    } else {
+        bool six_faces = settings.image_type == VTFImageType::TYPE_ENVIRONMENT_MAP
+            && image_count == VTF_CUBEMAP_FACE_COUNT
+            && image_width == image_height;
+        export_vtf.setFaceCount(true, image_count >= 7 || six_faces);
+        generate_spheremap = six_faces && export_vtf.getFaceCount() > VTF_CUBEMAP_SPHEREMAP_FACE;
+    }
+
+    // Because the layer bytes are stored using 4 bytes per pixel,
+    //  we *must* use RGBA8888 when we initially import from the layers to the VTF.
+    // However, the user's selected VTF format will still be respected once we write to disk.
+    // One buffer, reused for every layer. A spheremap is sampled from all six faces, so then the
+    //  faces are kept side by side in it instead, with the spheremap after them.
+    int bpp = vtfpp::ImageFormatDetails::bpp(vtfpp::ImageFormat::RGBA8888) / 8;
+    size_t image_size = (size_t)image_width * image_height * bpp;
+    VtfScratchArena local_arena;
+    VtfScratchArena &scratch_arena = arena ? *arena : local_arena;
+    VtfScratchBuffer layer_bytes(scratch_arena, image_size * (generate_spheremap ? VTF_CUBEMAP_SPHEREMAP_FACE + 1 : 1));
+    // The whole panorama, fetched once up front, that each face is sampled from
+    VtfScratchBuffer panorama_bytes(scratch_arena, from_panorama ? (size_t)width * height * bpp : 0);
+
+    {
+        VtfStageScope set_image_stage(timings, TRACE_STAGE_SET_IMAGE);
+        if (from_panorama) {
+            VtfStageScope fetch_stage(timings, TRACE_STAGE_FETCH);
+            if (!fetch_layer(0, panorama_bytes.span())) {
+                return false;
+            }
+        }
+
+        int set_image_count = generate_spheremap ? VTF_CUBEMAP_SPHEREMAP_FACE + 1 : image_count;
+        for (int layer_index = 0; layer_index < set_image_count; layer_index++) {
+            std::span<std::byte> image_bytes = generate_spheremap
+                ? layer_bytes.span().subspan(image_size * layer_index, image_size)
+                : layer_bytes.span();
+            bool spheremap = generate_spheremap && layer_index == VTF_CUBEMAP_SPHEREMAP_FACE;
+
+            bool fetch_successful = true;
+            {
+                VtfStageScope fetch_stage(timings, TRACE_STAGE_FETCH);
+                if (spheremap) {
+                    vtf_cubemap_spheremap_from_faces(layer_bytes.span().first(image_size * VTF_CUBEMAP_FACE_COUNT), image_width, image_bytes);
+                } else if (from_panorama) {
+                    vtf_cubemap_face_from_panorama(panorama_bytes.span(), width, height, layer_index, image_width, image_bytes);
+                } else {
+                    fetch_successful = fetch_layer(layer_index, image_bytes);
+                }
+            }
+            if (!fetch_successful) {
+                return false;
+            }
+
+            // Height map to normal map/SSBump, in place, if that's what was asked for.
+            //  A generated spheremap comes from faces that were already converted.
+            if (!spheremap) {
+                vtf_bump_from_height(image_bytes, image_width, image_height, settings, scratch_arena);
+            }
+
+            // Depending on whether the image is a standard image or envmap/volumetric,
+            //  write the images either as frames or as faces
+            uint16_t frame_index = 0;
+            uint8_t face_index = 0;
+            if (settings.image_type == VTFImageType::TYPE_STANDARD) {
+                frame_index = layer_index;
+            } else {
+                face_index = layer_index;
+            }
+
+            // Take the bytes and parse them as a VTF image layer. Still RGBA8888, so this is only
+            //  a copy; the encode itself happens in vtf_core_encode().
+            bool bytes_to_image_successful = export_vtf.setImage(
+                image_bytes,
+                vtfpp::ImageFormat::RGBA8888,
+                image_width,
+                image_height,
+                // This is specifically the resize method used when the user gives the image in GIMP
+                //  an invalid size. It is *not* used when generating mipmaps (as far as I'm aware).
+                // Might make this configurable to the user, but there is an argument to be made that
+                //  if the user wanted to resize the image, they could just do it in GIMP. So for now,
+                //  I won't add it.
+                vtfpp::ImageConversion::ResizeFilter::DEFAULT,
+                0,
+                frame_index,
+                face_index,
+                0
+            );
+
+            if (!bytes_to_image_successful) {
+                fprintf(stderr, "Could not successfully call vtf.setImage() for layer %d\n", layer_index);
+            }
+        }
+    }
+
+    export_vtf.setFlags((vtfpp::VTF::Flags)(export_vtf.getFlags() | settings.flags));
+
+    // TODO: set start frame here
+
+    export_vtf.setBumpMapScale(settings.bumpmap_scale);
+
+    {
+        VtfStageScope mips_stage(timings, TRACE_STAGE_MIPS);
+        if (settings.mipmap_filter != VTF_MIPMAP_FILTER_NONE) {
+            export_vtf.setMipCount(vtfpp::ImageDimensions::getRecommendedMipCountForDims(settings.image_format, image_width, image_height));
+            export_vtf.computeMips((vtfpp::ImageConversion::ResizeFilter)settings.mipmap_filter);
+            // Prefiltered from the plain mips just computed
+            if (settings.prefilter_enabled && settings.image_type == VTFImageType::TYPE_ENVIRONMENT_MAP) {
+                vtf_cubemap_prefilter_mips(export_vtf, settings.prefilter_samples, scratch_arena);
+            }
+        } else {
+            export_vtf.setMipCount(1);
+        }
+    }
+
+    {
+        VtfStageScope thumbnail_stage(timings, TRACE_STAGE_THUMBNAIL);
+        if (settings.thumbnail_enabled) {
+            export_vtf.computeThumbnail(vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+        } else {
+            export_vtf.removeThumbnail();
+        }
+    }
+
+    {
+        VtfStageScope reflectivity_stage(timings, TRACE_STAGE_REFLECTIVITY);
+        if (settings.recompute_reflectivity_enabled) {
+            export_vtf.computeReflectivity();
+        }
+    }
+
+    export_vtf.computeTransparencyFlags();
+
+    return true;
+}
+
+// Encodes export_vtf through the specialized pipeline for its format (vtf-pixels.h), one subimage
+//  at a time. The converted subimages go into a new VTF with the same header that's already in
+//  the target format, which vtfpp copies in as is (vtf-incremental relies on the same thing).
+// Returns false, leaving export_vtf untouched, if there's no pipeline for the format.
+static bool encode_with_pipeline(vtfpp::VTF &export_vtf, const VtfExportSettings &settings) {
+    vtfpp::ImageFormat format = settings.image_format;
+    if (export_vtf.getFormat() != vtfpp::ImageFormat::RGBA8888 || !vtf_pixels_has_pipeline(vtfpp::ImageFormat::RGBA8888, format)) {
+        return false;
+    }
+
+    vtfpp::VTF encoded;
+    encoded.setVersion(export_vtf.getMajorVersion(), export_vtf.getMinorVersion());
+    encoded.setFlags(export_vtf.getFlags());
+    encoded.setImageResizeMethods(settings.resize_method, settings.resize_method);
+    encoded.setSize(export_vtf.getWidth(), export_vtf.getHeight(), vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+    if (export_vtf.getFrameCount() > 1 && !encoded.setFrameCount(export_vtf.getFrameCount())) {
+        return false;
+    }
+    if (export_vtf.getFaceCount() > 1 && !encoded.setFaceCount(true, export_vtf.getFaceCount() > VTF_CUBEMAP_SPHEREMAP_FACE)) {
+        return false;
+    }
+    if (export_vtf.getSliceCount() > 1 && !encoded.setSliceCount(export_vtf.getSliceCount())) {
+        return false;
+    }
+    if (!encoded.setMipCount(export_vtf.getMipCount())) {
+        return false;
+    }
+    // Switching the format goes through setFormat() so the flags change the same way they would
+    //  for export_vtf, but there's no image data worth converting yet
+    encoded.setFormat(format, vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+    if (encoded.getFormat() != format) {
+        return false;
+    }
+
+    // One buffer, reused for every subimage (mip 0 is the biggest)
+    int bpp = vtfpp::ImageFormatDetails::bpp(format) / 8;
+    std::vector<std::byte> subimage((size_t)export_vtf.getWidth() * export_vtf.getHeight() * bpp);
+    for (int mip = 0; mip < export_vtf.getMipCount(); mip++) {
+        int mip_width = export_vtf.getWidth(mip);
+        int mip_height = export_vtf.getHeight(mip);
+        for (int frame = 0; frame < export_vtf.getFrameCount(); frame++) {
+            for (int face = 0; face < export_vtf.getFaceCount(); face++) {
+                for (int slice = 0; slice < export_vtf.getSliceCount(); slice++) {
+                    VTF_TRACE6(subimage_encode_start, (int)format, mip_width, mip_height, frame, face, mip);
+                    std::span<const std::byte> rgba = export_vtf.getImageDataRaw(mip, frame, face, slice);
+                    std::span<std::byte> converted = std::span(subimage).first((size_t)mip_width * mip_height * bpp);
+                    if (!vtf_pixels_convert(vtfpp::ImageFormat::RGBA8888, format, rgba, converted)) {
+                        return false;
+                    }
+                    if (!encoded.setImage(converted, format, mip_width, mip_height, vtfpp::ImageConversion::ResizeFilter::DEFAULT, mip, frame, face, slice)) {
+                        return false;
+                    }
+                    VTF_TRACE6(subimage_encode_end, (int)format, mip_width, mip_height, frame, face, mip);
+                }
+            }
+        }
+    }
+
+    encoded.setStartFrame(export_vtf.getStartFrame());
+    encoded.setBumpMapScale(export_vtf.getBumpMapScale());
+    encoded.setReflectivity(export_vtf.getReflectivity());
+    if (export_vtf.hasThumbnailData()) {
+        encoded.setThumbnail(
+            export_vtf.getThumbnailDataRaw(),
+            export_vtf.getThumbnailFormat(),
+            export_vtf.getThumbnailWidth(),
+            export_vtf.getThumbnailHeight()
+        );
+    } else {
+        encoded.removeThumbnail();
+    }
+
+    export_vtf = std::move(encoded);
+    return true;
+}
+
+void vtf_core_encode(vtfpp::VTF &export_vtf, const VtfExportSettings &settings, VtfStageTimings *timings) {
+    {
+        VtfStageScope encode_stage(timings, TRACE_STAGE_ENCODE);
+        if (!encode_with_pipeline(export_vtf, settings)) {
+            // vtfpp converts every mip/frame/face/slice to the target format here, all in one call,
+            //  so the probe covers the whole image (frame/face/mip are -1)
+            VTF_TRACE6(subimage_encode_start, (int)settings.image_format, export_vtf.getWidth(), export_vtf.getHeight(), -1, -1, -1);
+            export_vtf.setFormat(settings.image_format, vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+            VTF_TRACE6(subimage_encode_end, (int)settings.image_format, export_vtf.getWidth(), export_vtf.getHeight(), -1, -1, -1);
+        }
+    }
+
+    // TODO: set compression method here
+
+    // TODO: set compression level here
+}
+
+bool vtf_core_build(
+    vtfpp::VTF &export_vtf,
+    const VtfExportSettings &settings,
+    int width,
+    int height,
+    int layer_count,
+    const VtfLayerFetch &fetch_layer,
+    VtfScratchArena *arena,
+    VtfStageTimings *timings
+) {
+    if (!vtf_core_build_unencoded(export_vtf, settings, width, height, layer_count, fetch_layer, arena, timings)) {
+        return false;
+    }
+    vtf_core_encode(export_vtf, settings, timings);
+    return true;
+}
+
+bool vtf_core_decode_rgba8888_into(
+    const vtfpp::VTF &vtf,
+    int mip,
+    int frame,
+    int face,
+    int slice,
+    std::span<std::byte> out
+) {
+    // Only used by the tracepoints
+    [[maybe_unused]] int format = (int)vtf.getFormat();
+    [[maybe_unused]] int width = vtf.getWidth(mip);
+    [[maybe_unused]] int height = vtf.getHeight(mip);
+
+    bool decode_successful = false;
+
+    VTF_TRACE6(subimage_decode_start, format, width, height, frame, face, mip);
+    VtfSwizzle swizzle;
+    if (vtf.getFormat() == vtfpp::ImageFormat::RGBA8888) {
+        std::span<const std::byte> raw = vtf.getImageDataRaw(mip, frame, face, slice);
+        if (raw.size() == out.size()) {
+            memcpy(out.data(), raw.data(), raw.size());
+            decode_successful = true;
+        }
+    } else if (vtf_swizzle_to_rgba8888(vtf.getFormat(), &swizzle)) {
+        // Other 4-byte formats (BGRA8888, BGRX8888, ...) only need their channels reordered
+        std::span<const std::byte> raw = vtf.getImageDataRaw(mip, frame, face, slice);
+        if (raw.size() == out.size()) {
+            vtf_kernel_swizzle4(raw.data(), out.data(), out.size() / 4, swizzle);
+            decode_successful = true;
+        }
+    } else if (vtf_pixels_has_pipeline(vtf.getFormat(), vtfpp::ImageFormat::RGBA8888)) {
+        // RGB888, I8, IA88, ... have a specialized pipeline that writes straight into out
+        std::span<const std::byte> raw = vtf.getImageDataRaw(mip, frame, face, slice);
+        decode_successful = vtf_pixels_convert(vtf.getFormat(), vtfpp::ImageFormat::RGBA8888, raw, out);
+    } else {
+        // vtfpp only converts into a new vector, so other formats still cost one allocation here
+        std::vector<std::byte> converted = vtf.getImageDataAsRGBA8888(mip, frame, face, slice);
+        if (converted.size() == out.size()) {
+            memcpy(out.data(), converted.data(), converted.size());
+            decode_successful = true;
+        }
+    }
+    VTF_TRACE6(subimage_decode_end, format, width, height, frame, face, mip);
+
+    return decode_successful;
+}
+
+std::vector<std::byte> vtf_core_decode_rgba8888(
+    const vtfpp::VTF &vtf,
+    int mip,
+    int frame,
+    int face,
+    int slice
+) {
+    // Only used by the tracepoints
+    [[maybe_unused]] int format = (int)vtf.getFormat();
+    [[maybe_unused]] int width = vtf.getWidth(mip);
+    [[maybe_unused]] int height = vtf.getHeight(mip);
+
+    VTF_TRACE6(subimage_decode_start, format, width, height, frame, face, mip);
+    std::vector<std::byte> image_data_rgba = vtf.getImageDataAsRGBA8888(mip, frame, face, slice);
+    VTF_TRACE6(subimage_decode_end, format, width, height, frame, face, mip);
+
+    return image_data_rgba;
+}
+
+bool vtf_core_decode_frames_rgba8888(
+    const vtfpp::VTF &vtf,
+    VtfPool &pool,
+    VtfScratchArena &arena,
+    const VtfSubimageConsumer &consume
+) {
+    int face_count = vtf.getFaceCount();
+    int subimage_count = vtf.getFrameCount() * face_count;
+    if (subimage_count == 0) {
+        return true;
+    }
+    int batch_size = std::min(pool.thread_count(), subimage_count);
+
+    int bpp = vtfpp::ImageFormatDetails::bpp(vtfpp::ImageFormat::RGBA8888) / 8;
+    size_t image_size = (size_t)vtf.getWidth() * vtf.getHeight() * bpp;
+    VtfScratchBuffer batch_bytes(arena, image_size * batch_size);
+
+    // Made once rather than per batch: its captures don't fit in std::function's inline storage,
+    //  so building it in the loop would allocate for every batch
+    int batch_start = 0;
+    std::atomic<bool> all_decoded = true;
+    const std::function<void(int)> decode_subimage = [&](int batch_index) {
+        int subimage = batch_start + batch_index;
+        std::span<std::byte> decoded = batch_bytes.span().subspan(image_size * batch_index, image_size);
+        if (!vtf_core_decode_rgba8888_into(vtf, 0, subimage / face_count, subimage % face_count, 0, decoded)) {
+            // Transparent rather than garbage
+            memset(decoded.data(), 0, decoded.size());
+            all_decoded = false;
+        }
+    };
+
+    for (; batch_start < subimage_count; batch_start += batch_size) {
+        int batch_count = std::min(batch_size, subimage_count - batch_start);
+        pool.parallel_for(batch_count, decode_subimage);
+
+        for (int batch_index = 0; batch_index < batch_count; batch_index++) {
+            consume(batch_start + batch_index, batch_bytes.span().subspan(image_size * batch_index, image_size));
+        }
+    }
+
+    return all_decoded;
+}
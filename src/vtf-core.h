@@ -0,0 +1,138 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// The GIMP-independent part of loading and exporting.
+// The plugin does the GIMP side (reading config, fetching/creating layers) and calls into this,
+//  which lets the standalone tools and the training workload run the exact same VTF code.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-arena.h"
+#include "vtf-formats.h"
+#include "vtf-trace.h"
+
+class VtfPool;
+
+// Everything the export procedure arguments control. Defaults match the procedure's defaults.
+struct VtfExportSettings {
+    // This is specifically the VTF minor version. So 7.4 would be '4'
+    int minor_version = 4;
+    vtfpp::ImageFormat image_format = vtfpp::ImageFormat::DXT1;
+    VTFImageType image_type = TYPE_STANDARD;
+    // A vtfpp::ImageConversion::ResizeFilter, or VTF_MIPMAP_FILTER_NONE
+    int mipmap_filter = (int)vtfpp::ImageConversion::ResizeFilter::KAISER;
+    vtfpp::ImageConversion::ResizeMethod resize_method = vtfpp::ImageConversion::ResizeMethod::POWER_OF_TWO_BIGGER;
+    bool thumbnail_enabled = true;
+    bool recompute_reflectivity_enabled = true;
+    double bumpmap_scale = 1.0;
+    // A VtfHeightConversion. Conversions treat the layers as grayscale height maps.
+    int height_conversion = VTF_HEIGHT_NONE;
+    // How many pixels high white is over black, for height conversions
+    double height_scale = 4.0;
+    // Environment maps: GGX-prefiltered mips instead of plain ones (see vtf-cubemap.h), with
+    //  prefilter_samples samples per pixel
+    bool prefilter_enabled = false;
+    int prefilter_samples = 64;
+    // User-selected flags. Flags that are computed on export (SRGB, alpha, envmap) don't go here.
+    vtfpp::VTF::Flags flags = vtfpp::VTF::FLAG_NONE;
+};
+
+// Sets one export setting from its procedure argument name and choice nick (image_format=DXT5,
+//  mipmap_filter=kaiser, flag_clamp_s=true, ...). Returns false and fills error if the key or
+//  value isn't valid.
+bool vtf_core_set_option(VtfExportSettings &settings, std::string_view key, std::string_view value, std::string &error);
+
+// Fills one layer's pixels as RGBA8888 (width * height * 4 bytes). Returns false to abort the export.
+using VtfLayerFetch = std::function<bool(int layer_index, std::span<std::byte> rgba)>;
+
+// Builds export_vtf out of layer_count layers, which become frames or faces depending on the image type.
+// This is everything export_image() does after reading its config, short of writing the file.
+// Scratch buffers come from arena if given, so they can be shared with the rest of the export.
+// If timings is given, the time spent in each stage is added to it.
+// Returns false if a layer couldn't be fetched.
+bool vtf_core_build(
+    vtfpp::VTF &export_vtf,
+    const VtfExportSettings &settings,
+    int width,
+    int height,
+    int layer_count,
+    const VtfLayerFetch &fetch_layer,
+    VtfScratchArena *arena = nullptr,
+    VtfStageTimings *timings = nullptr
+);
+
+// vtf_core_build() in two halves, for callers that do the encoding themselves (see tools/vtf-incremental.h).
+// vtf_core_build_unencoded() does everything but the encode, leaving every subimage (mips included)
+//  as RGBA8888; vtf_core_encode() converts it to settings.image_format.
+bool vtf_core_build_unencoded(
+    vtfpp::VTF &export_vtf,
+    const VtfExportSettings &settings,
+    int width,
+    int height,
+    int layer_count,
+    const VtfLayerFetch &fetch_layer,
+    VtfScratchArena *arena = nullptr,
+    VtfStageTimings *timings = nullptr
+);
+void vtf_core_encode(vtfpp::VTF &export_vtf, const VtfExportSettings &settings, VtfStageTimings *timings = nullptr);
+
+// Decodes one subimage of a loaded VTF to RGBA8888, into out (width * height * 4 bytes of that mip).
+// RGBA8888 files are copied straight out of the file data, and other 4-byte formats are swizzled
+//  out of it (see vtf-kernels.h), without any intermediate allocation.
+bool vtf_core_decode_rgba8888_into(
+    const vtfpp::VTF &vtf,
+    int mip,
+    int frame,
+    int face,
+    int slice,
+    std::span<std::byte> out
+);
+
+// Called with each decoded subimage (subimage = frame * face count + face) and its RGBA8888 pixels,
+//  which are only valid for the duration of the call.
+using VtfSubimageConsumer = std::function<void(int subimage, std::span<const std::byte> rgba)>;
+
+// Decodes mip 0 of every frame and face of a loaded VTF to RGBA8888, in parallel on pool, a batch
+//  of one subimage per pool thread at a time (so only a handful are in memory at once). Each batch
+//  is then handed to consume on the calling thread, in order. This is load_image()'s decode loop.
+// The batch buffers are taken from arena once and reused for every batch. Subimages that don't
+//  decode are handed over as transparent black. Returns false if any didn't decode.
+bool vtf_core_decode_frames_rgba8888(
+    const vtfpp::VTF &vtf,
+    VtfPool &pool,
+    VtfScratchArena &arena,
+    const VtfSubimageConsumer &consume
+);
+
+// Decodes one subimage of a loaded VTF to RGBA8888.
+std::vector<std::byte> vtf_core_decode_rgba8888(
+    const vtfpp::VTF &vtf,
+    int mip,
+    int frame,
+    int face,
+    int slice
+);
@@ -0,0 +1,123 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-cpu.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#if defined(VTF_CPU_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static VtfSimdLevel detect_supported() {
+#if !defined(VTF_CPU_X86)
+    return VtfSimdLevel::SCALAR;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse2 = info[3] & (1 << 26);
+    bool ssse3 = info[2] & (1 << 9);
+    bool sse41 = info[2] & (1 << 19);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+
+    // The OS has to save the YMM/ZMM registers too, or using them is unsafe
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool os_ymm = (xcr0 & 0x6) == 0x6;
+    bool os_zmm = (xcr0 & 0xE6) == 0xE6;
+
+    bool avx2 = false;
+    bool avx512 = false;
+    if (max_leaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = avx && os_ymm && (info[1] & (1 << 5));
+        avx512 = os_zmm && (info[1] & (1 << 16)) && (info[1] & (1 << 30));
+    }
+
+    if (avx2 && avx512) return VtfSimdLevel::AVX512;
+    if (avx2) return VtfSimdLevel::AVX2;
+    if (sse41 && ssse3) return VtfSimdLevel::SSE41;
+    if (sse2) return VtfSimdLevel::SSE2;
+    return VtfSimdLevel::SCALAR;
+#else
+    // GCC/Clang also check OS support for the wider registers here
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx2")) {
+        return VtfSimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) return VtfSimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3")) return VtfSimdLevel::SSE41;
+    if (__builtin_cpu_supports("sse2")) return VtfSimdLevel::SSE2;
+    return VtfSimdLevel::SCALAR;
+#endif
+}
+
+static bool level_from_name(const char *name, VtfSimdLevel *level) {
+    for (int i = (int)VtfSimdLevel::SCALAR; i <= (int)VtfSimdLevel::AVX512; i++) {
+        if (std::string_view(vtf_simd_level_name((VtfSimdLevel)i)) == name) {
+            *level = (VtfSimdLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static VtfSimdLevel detect() {
+    VtfSimdLevel supported = vtf_simd_level_supported();
+
+    const char *forced_name = std::getenv("FILE_VTF_SIMD");
+    if (!forced_name || !*forced_name) {
+        return supported;
+    }
+
+    VtfSimdLevel forced;
+    if (!level_from_name(forced_name, &forced)) {
+        fprintf(stderr, "FILE_VTF_SIMD: unknown level \"%s\", using %s\n", forced_name, vtf_simd_level_name(supported));
+        return supported;
+    }
+    if (forced > supported) {
+        fprintf(stderr, "FILE_VTF_SIMD: this CPU doesn't support %s, using %s\n", forced_name, vtf_simd_level_name(supported));
+        return supported;
+    }
+    return forced;
+}
+
+VtfSimdLevel vtf_simd_level() {
+    static const VtfSimdLevel level = detect();
+    return level;
+}
+
+VtfSimdLevel vtf_simd_level_supported() {
+    static const VtfSimdLevel level = detect_supported();
+    return level;
+}
+
+const char *vtf_simd_level_name(VtfSimdLevel level) {
+    switch (level) {
+        case VtfSimdLevel::SCALAR:  return "scalar";
+        case VtfSimdLevel::SSE2:    return "sse2";
+        case VtfSimdLevel::SSE41:   return "sse4.1";
+        case VtfSimdLevel::AVX2:    return "avx2";
+        case VtfSimdLevel::AVX512:  return "avx512";
+    }
+    return "unknown";
+}
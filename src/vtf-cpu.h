@@ -0,0 +1,49 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// CPU feature detection for the pixel kernels (see vtf-kernels.h).
+//
+// Release builds target baseline x86-64, so SIMD kernel variants are compiled per-function for
+//  their instruction set and picked at runtime, once, from what the CPU supports.
+// Set FILE_VTF_SIMD=scalar|sse2|sse4.1|avx2|avx512 to force a lower level (e.g. to test the
+//  other variants on a newer machine). Levels the CPU doesn't have are clamped to what it does.
+
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VTF_CPU_X86 1
+#endif
+
+// Ordered: each level includes everything below it
+enum class VtfSimdLevel : int {
+    SCALAR  = 0,
+    SSE2    = 1,
+    // SSE4.1 and SSSE3 (pshufb)
+    SSE41   = 2,
+    AVX2    = 3,
+    // AVX-512 F and BW
+    AVX512  = 4,
+};
+
+// The level kernels use: what the CPU supports, lowered by FILE_VTF_SIMD if set.
+// Detected on first call; the result never changes afterwards.
+VtfSimdLevel vtf_simd_level();
+
+// What the CPU supports, ignoring FILE_VTF_SIMD
+VtfSimdLevel vtf_simd_level_supported();
+
+// "scalar", "sse2", "sse4.1", "avx2" or "avx512"
+const char *vtf_simd_level_name(VtfSimdLevel level);
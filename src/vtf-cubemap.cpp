@@ -0,0 +1,262 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-cubemap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "vtf-kernels.h"
+#include "vtf-pool.h"
+
+// Direction through each face's center, and the directions its right and down edges are in.
+//  These are Direct3D's cubemap faces (+X, -X, +Y, -Y, +Z, -Z), taken as Source world axes.
+static const float FACE_BASES[VTF_CUBEMAP_FACE_COUNT][3][3] = {
+    { {  1,  0,  0 }, {  0,  0, -1 }, {  0, -1,  0 } },
+    { { -1,  0,  0 }, {  0,  0,  1 }, {  0, -1,  0 } },
+    { {  0,  1,  0 }, {  1,  0,  0 }, {  0,  0,  1 } },
+    { {  0, -1,  0 }, {  1,  0,  0 }, {  0,  0, -1 } },
+    { {  0,  0,  1 }, {  1,  0,  0 }, {  0, -1,  0 } },
+    { {  0,  0, -1 }, { -1,  0,  0 }, {  0, -1,  0 } },
+};
+
+bool vtf_cubemap_is_panorama(const VtfExportSettings &settings, int width, int height, int layer_count) {
+    return settings.image_type == TYPE_ENVIRONMENT_MAP
+        && layer_count == 1
+        && height >= 2
+        && width == height * 2;
+}
+
+int vtf_cubemap_face_size(int panorama_width, int panorama_height) {
+    return std::max(std::min(panorama_width / 4, panorama_height / 2), 1);
+}
+
+void vtf_cubemap_face_from_panorama(
+    std::span<const std::byte> panorama,
+    int width,
+    int height,
+    int face,
+    int face_size,
+    std::span<std::byte> out
+) {
+    const float (*basis)[3] = FACE_BASES[face];
+    // Face pixel centers go from -1 + 1/size to 1 - 1/size across the face
+    float pixel_step = 2.0f / (float)face_size;
+    float step[3];
+    for (int axis = 0; axis < 3; axis++) {
+        step[axis] = basis[1][axis] * pixel_step;
+    }
+
+    int strip_count = (face_size + VTF_CUBEMAP_STRIP_ROWS - 1) / VTF_CUBEMAP_STRIP_ROWS;
+    vtf_pool_shared().parallel_for(strip_count, [&](int strip) {
+        int end = std::min((strip + 1) * VTF_CUBEMAP_STRIP_ROWS, face_size);
+        for (int y = strip * VTF_CUBEMAP_STRIP_ROWS; y < end; y++) {
+            float down = ((float)y + 0.5f) * pixel_step - 1.0f;
+            float left = 0.5f * pixel_step - 1.0f;
+            float start[3];
+            for (int axis = 0; axis < 3; axis++) {
+                start[axis] = basis[0][axis] + left * basis[1][axis] + down * basis[2][axis];
+            }
+            vtf_kernel_equirect_row(
+                panorama.data(),
+                width,
+                height,
+                start,
+                step,
+                face_size,
+                out.data() + (size_t)y * face_size * 4
+            );
+        }
+    });
+}
+
+void vtf_cubemap_spheremap_from_faces(std::span<const std::byte> faces, int face_size, std::span<std::byte> out) {
+    float pixel_step = 2.0f / (float)face_size;
+    float left = 0.5f * pixel_step - 1.0f;
+
+    int strip_count = (face_size + VTF_CUBEMAP_STRIP_ROWS - 1) / VTF_CUBEMAP_STRIP_ROWS;
+    vtf_pool_shared().parallel_for(strip_count, [&](int strip) {
+        int end = std::min((strip + 1) * VTF_CUBEMAP_STRIP_ROWS, face_size);
+        for (int y = strip * VTF_CUBEMAP_STRIP_ROWS; y < end; y++) {
+            float t = ((float)y + 0.5f) * pixel_step - 1.0f;
+            vtf_kernel_spheremap_row(faces.data(), face_size, t, left, pixel_step, face_size, out.data() + (size_t)y * face_size * 4);
+        }
+    });
+}
+
+// Van der Corput radical inverse, for the second coordinate of a Hammersley point set
+static float radical_inverse(uint32_t bits) {
+    bits = (bits << 16) | (bits >> 16);
+    bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+    bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+    bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+    bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+    return (float)bits * 2.3283064e-10f;
+}
+
+// GGX samples for one output mip. With the view and normal both along the output direction
+//  (the usual split-sum assumption), a sample's tangent-space direction, weight and footprint
+//  don't depend on which pixel it's for, so the table is shared by the whole mip.
+static std::vector<VtfPrefilterSample> prefilter_samples(float roughness, int sample_count, int mip, int mip_count, int base_size) {
+    float alpha2 = roughness * roughness * roughness * roughness;
+    // Solid angle of one mip 0 pixel (roughly; it's smaller toward the face corners)
+    float pixel_solid_angle = 4.0f * 3.14159265f / (6.0f * (float)base_size * (float)base_size);
+
+    std::vector<VtfPrefilterSample> samples;
+    float total_weight = 0.0f;
+    for (int i = 0; i < sample_count; i++) {
+        // Half vector from the GGX distribution
+        float phi = 2.0f * 3.14159265f * ((float)i + 0.5f) / (float)sample_count;
+        float xi = radical_inverse((uint32_t)i);
+        float cos_theta = std::sqrt((1.0f - xi) / (1.0f + (alpha2 - 1.0f) * xi));
+        float sin_theta = std::sqrt(std::max(1.0f - cos_theta * cos_theta, 0.0f));
+        float half_x = sin_theta * std::cos(phi);
+        float half_y = sin_theta * std::sin(phi);
+        float half_z = cos_theta;
+
+        // Reflected about it; the ones that end up below the surface don't count
+        VtfPrefilterSample sample;
+        sample.direction[0] = 2.0f * half_z * half_x;
+        sample.direction[1] = 2.0f * half_z * half_y;
+        sample.direction[2] = 2.0f * half_z * half_z - 1.0f;
+        sample.weight = sample.direction[2];
+        if (sample.weight <= 0.0f) continue;
+
+        // Read from the mip whose pixels are about the size of the sample's share of the lobe
+        //  (pdf = D / 4 here), one level blurrier to hide the gaps between samples. Never finer than
+        //  one level above the output mip, or narrow lobes on small mips would alias.
+        float denominator = cos_theta * cos_theta * (alpha2 - 1.0f) + 1.0f;
+        float distribution = alpha2 / (3.14159265f * denominator * denominator);
+        float sample_solid_angle = 1.0f / ((float)sample_count * distribution * 0.25f + 1e-6f);
+        float level = 0.5f * std::log2(sample_solid_angle / pixel_solid_angle) + 1.0f;
+        sample.mip = std::clamp((int)std::lround(level), std::max(mip - 1, 0), mip_count - 1);
+
+        total_weight += sample.weight;
+        samples.push_back(sample);
+    }
+    for (VtfPrefilterSample &sample : samples) {
+        sample.weight /= total_weight;
+    }
+    return samples;
+}
+
+bool vtf_cubemap_prefilter_mips(vtfpp::VTF &vtf, int sample_count, VtfScratchArena &arena) {
+    int mip_count = vtf.getMipCount();
+    int base_size = vtf.getWidth(0);
+    if (mip_count < 2
+        || vtf.getFaceCount() < VTF_CUBEMAP_FACE_COUNT
+        || vtf.getHeight(0) != base_size
+        || vtf.getFormat() != vtfpp::ImageFormat::RGBA8888) {
+        return false;
+    }
+    sample_count = std::clamp(sample_count, VTF_CUBEMAP_PREFILTER_MIN_SAMPLES, VTF_CUBEMAP_PREFILTER_MAX_SAMPLES);
+
+    // The plain chain everything is sampled from, copied out since the mips get replaced,
+    //  with each mip's six faces side by side; the prefiltered mips go in a second one
+    std::vector<size_t> offsets(mip_count);
+    std::vector<int> sizes(mip_count);
+    size_t chain_size = 0;
+    for (int mip = 0; mip < mip_count; mip++) {
+        offsets[mip] = chain_size;
+        sizes[mip] = vtf.getWidth(mip);
+        chain_size += (size_t)sizes[mip] * sizes[mip] * 4 * VTF_CUBEMAP_FACE_COUNT;
+    }
+    VtfScratchBuffer source(arena, chain_size);
+    VtfScratchBuffer filtered(arena, chain_size);
+
+    std::vector<VtfCubemapMip> source_mips(mip_count);
+    for (int mip = 0; mip < mip_count; mip++) {
+        size_t face_size = (size_t)sizes[mip] * sizes[mip] * 4;
+        for (int face = 0; face < VTF_CUBEMAP_FACE_COUNT; face++) {
+            std::span<const std::byte> raw = vtf.getImageDataRaw(mip, 0, face, 0);
+            if (raw.size() != face_size) {
+                return false;
+            }
+            memcpy(source.data() + offsets[mip] + face_size * face, raw.data(), face_size);
+        }
+        source_mips[mip] = { source.data() + offsets[mip], sizes[mip] };
+    }
+
+    // One task per strip of rows of every face of every mip, biggest mips first
+    struct Strip {
+        int mip;
+        int face;
+        int first_row;
+    };
+    std::vector<std::vector<VtfPrefilterSample>> mip_samples(mip_count);
+    std::vector<Strip> strips;
+    for (int mip = 1; mip < mip_count; mip++) {
+        float roughness = (float)mip / (float)(mip_count - 1);
+        mip_samples[mip] = prefilter_samples(roughness, sample_count, mip, mip_count, base_size);
+        for (int face = 0; face < VTF_CUBEMAP_FACE_COUNT; face++) {
+            for (int row = 0; row < sizes[mip]; row += VTF_CUBEMAP_STRIP_ROWS) {
+                strips.push_back({ mip, face, row });
+            }
+        }
+    }
+
+    vtf_pool_shared().parallel_for((int)strips.size(), [&](int strip_index) {
+        const Strip &strip = strips[strip_index];
+        int size = sizes[strip.mip];
+        const float (*basis)[3] = FACE_BASES[strip.face];
+        float pixel_step = 2.0f / (float)size;
+        float left = 0.5f * pixel_step - 1.0f;
+        float step[3];
+        for (int axis = 0; axis < 3; axis++) {
+            step[axis] = basis[1][axis] * pixel_step;
+        }
+
+        std::byte *face_pixels = filtered.data() + offsets[strip.mip] + (size_t)size * size * 4 * strip.face;
+        int end = std::min(strip.first_row + VTF_CUBEMAP_STRIP_ROWS, size);
+        for (int y = strip.first_row; y < end; y++) {
+            float down = ((float)y + 0.5f) * pixel_step - 1.0f;
+            float start[3];
+            for (int axis = 0; axis < 3; axis++) {
+                start[axis] = basis[0][axis] + left * basis[1][axis] + down * basis[2][axis];
+            }
+            const std::vector<VtfPrefilterSample> &samples = mip_samples[strip.mip];
+            vtf_kernel_prefilter_row(
+                source_mips.data(),
+                samples.data(),
+                (int)samples.size(),
+                start,
+                step,
+                size,
+                face_pixels + (size_t)y * size * 4
+            );
+        }
+    });
+
+    for (int mip = 1; mip < mip_count; mip++) {
+        size_t face_size = (size_t)sizes[mip] * sizes[mip] * 4;
+        for (int face = 0; face < VTF_CUBEMAP_FACE_COUNT; face++) {
+            vtf.setImage(
+                filtered.span().subspan(offsets[mip] + face_size * face, face_size),
+                vtfpp::ImageFormat::RGBA8888,
+                sizes[mip],
+                sizes[mip],
+                vtfpp::ImageConversion::ResizeFilter::DEFAULT,
+                mip,
+                0,
+                face,
+                0
+            );
+        }
+    }
+    return true;
+}
@@ -0,0 +1,83 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Environment maps exported from one equirectangular panorama.
+//
+// A single 2:1 layer exported as an environment map is taken to be a panorama (the middle looks
+//  forward, the top edge is straight up) and resampled into the six cubemap faces, each half
+//  the panorama's height. The panorama is fetched once and every face is sampled straight into
+//  the buffer that goes to setImage(), so six face layers never exist anywhere.
+//
+// Faces are laid out the way Source samples them: with world-space directions (X forward,
+//  Y left, Z up) in Direct3D's cubemap layout, in the VTF face order right (+X), left (-X),
+//  back (+Y), front (-Y), up (+Z), down (-Z).
+//
+// VTF 7.0-7.4 environment maps also have a seventh face, a spheremap for hardware without
+//  cubemap support. It's generated from the six faces here, unless the image has a seventh
+//  layer of its own.
+//
+// For PBR-style envmaps, the mips of the six faces can be prefiltered instead of plainly
+//  downsampled: mip m holds the environment as seen by a GGX lobe of roughness
+//  m / (mip count - 1), so mip 0 is a mirror and the last mip is fully rough. Each output pixel
+//  averages importance-sampled directions over the lobe, read from the plain mip chain at a level
+//  matching each sample's footprint (filtered importance sampling), so a few dozen samples are
+//  enough to avoid noise.
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "vtfpp/VTF.h"
+#include "vtf-arena.h"
+#include "vtf-core.h"
+
+// Rows per task when sampling a face
+#define VTF_CUBEMAP_STRIP_ROWS 32
+#define VTF_CUBEMAP_FACE_COUNT 6
+// Face index of the spheremap, when there is one
+#define VTF_CUBEMAP_SPHEREMAP_FACE 6
+// Range of the prefilter_samples setting (samples per output pixel)
+#define VTF_CUBEMAP_PREFILTER_MIN_SAMPLES 1
+#define VTF_CUBEMAP_PREFILTER_MAX_SAMPLES 1024
+
+// Whether an export of layer_count width x height layers is a panorama to turn into faces
+bool vtf_cubemap_is_panorama(const VtfExportSettings &settings, int width, int height, int layer_count);
+
+// Face size for a panorama: a quarter of its width, so the faces have the panorama's
+//  resolution at the horizon
+int vtf_cubemap_face_size(int panorama_width, int panorama_height);
+
+// Samples face (0-5, in VTF order) of a panorama (RGBA8888, width x height) into out
+//  (face_size * face_size RGBA8888), in parallel strips on the shared pool.
+void vtf_cubemap_face_from_panorama(
+    std::span<const std::byte> panorama,
+    int width,
+    int height,
+    int face,
+    int face_size,
+    std::span<std::byte> out
+);
+
+// Generates the spheremap face from faces (all six faces, each face_size * face_size RGBA8888,
+//  one after the other) into out (face_size * face_size RGBA8888), in parallel strips.
+void vtf_cubemap_spheremap_from_faces(std::span<const std::byte> faces, int face_size, std::span<std::byte> out);
+
+// Replaces mips 1 and up of the six faces of vtf (a cubemap whose mips have been computed, still
+//  RGBA8888) with GGX-prefiltered ones, sample_count samples per pixel. Every mip, face and strip
+//  of rows runs on the shared pool at once. The spheremap face, if any, is left as it was.
+// Returns false if vtf isn't a square RGBA8888 cubemap with mips.
+bool vtf_cubemap_prefilter_mips(vtfpp::VTF &vtf, int sample_count, VtfScratchArena &arena);
@@ -0,0 +1,455 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-edit.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtf-flags.h"
+#include "vtf-header.h"
+#include "vtf-pixels.h"
+
+// Every field edited here is in the first 64 bytes, which every version has
+#define EDIT_HEADER_BYTES 64
+
+static bool parse_bool(std::string_view value, bool *out) {
+    if (value == "true" || value == "1" || value == "yes") {
+        *out = true;
+        return true;
+    }
+    if (value == "false" || value == "0" || value == "no") {
+        *out = false;
+        return true;
+    }
+    return false;
+}
+
+static bool parse_float(const std::string &value, float min, float max, float *out) {
+    char *end;
+    double parsed = strtod(value.c_str(), &end);
+    if (end == value.c_str() || *end != '\0' || parsed < min || parsed > max) {
+        return false;
+    }
+    *out = (float)parsed;
+    return true;
+}
+
+bool vtf_edit_set_option(VtfHeaderEdit &edit, std::string_view key, std::string_view value, std::string &error) {
+    std::string value_string(value);
+    bool bool_value;
+
+    if (key == "version") {
+        // Same spellings as vtf-convert: 7_4 or 7.4
+        if (value.size() == 3 && value[0] == '7' && (value[1] == '_' || value[1] == '.') && value[2] >= '0' && value[2] <= '6') {
+            edit.minor_version = value[2] - '0';
+            return true;
+        }
+    } else if (key == "start_frame") {
+        char *end;
+        long frame = strtol(value_string.c_str(), &end, 10);
+        if (end != value_string.c_str() && *end == '\0' && frame >= 0 && frame <= 0xFFFF) {
+            edit.start_frame = (int)frame;
+            return true;
+        }
+    } else if (key == "bumpmap_scale") {
+        // Same range as the export procedure argument
+        if (parse_float(value_string, 0.0f, 10.0f, &edit.bumpmap_scale)) {
+            edit.bumpmap_scale_set = true;
+            return true;
+        }
+    } else if (key == "reflectivity") {
+        float reflectivity[3];
+        size_t start = 0;
+        int count = 0;
+        for (; count < 3 && start <= value_string.size(); count++) {
+            size_t end = value_string.find(',', start);
+            if (end == std::string::npos) end = value_string.size();
+            if (!parse_float(value_string.substr(start, end - start), 0.0f, 1.0f, &reflectivity[count])) break;
+            start = end + 1;
+        }
+        if (count == 3 && start == value_string.size() + 1) {
+            memcpy(edit.reflectivity, reflectivity, sizeof(reflectivity));
+            edit.reflectivity_set = true;
+            return true;
+        }
+    } else if (key == "recompute_reflectivity_enabled") {
+        if (parse_bool(value, &edit.recompute_reflectivity)) {
+            return true;
+        }
+    } else if (key == "thumbnail_enabled") {
+        if (parse_bool(value, &bool_value)) {
+            edit.thumbnail = bool_value ? VtfThumbnailEdit::REGENERATE : VtfThumbnailEdit::REMOVE;
+            return true;
+        }
+    } else if (const VtfFlagName *flag_name = vtf_flag_from_name(std::string(key).c_str())) {
+        // Computed flags describe the image data (alpha, envmap, mips), so changing them on their
+        //  own would make the header lie about it
+        if (!flag_name->user_settable) {
+            error = std::string(key) + " is computed from the image data and can't be changed";
+            return false;
+        }
+        if (parse_bool(value, &bool_value)) {
+            vtfpp::VTF::Flags &add_to = bool_value ? edit.set_flags : edit.clear_flags;
+            vtfpp::VTF::Flags &remove_from = bool_value ? edit.clear_flags : edit.set_flags;
+            add_to = (vtfpp::VTF::Flags)(add_to | flag_name->flag);
+            remove_from = (vtfpp::VTF::Flags)(remove_from & ~flag_name->flag);
+            return true;
+        }
+    } else {
+        error = "Unknown option " + std::string(key);
+        return false;
+    }
+
+    error = "Invalid value \"" + value_string + "\" for " + std::string(key);
+    return false;
+}
+
+bool vtf_edit_set_option(VtfHeaderEdit &edit, std::string_view option, std::string &error) {
+    size_t equals = option.find('=');
+    if (equals == std::string_view::npos) {
+        error = "Expected key=value, got \"" + std::string(option) + "\"";
+        return false;
+    }
+    return vtf_edit_set_option(edit, option.substr(0, equals), option.substr(equals + 1), error);
+}
+
+template<typename T>
+static void write_le(std::vector<std::byte> &data, size_t offset, T value) {
+    memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+// Versions with the same header layout: 7.0-7.1 (no depth), 7.2 (depth), 7.3+ (resources)
+static int layout_group(int minor_version) {
+    return minor_version <= 1 ? 0 : (minor_version == 2 ? 1 : 2);
+}
+
+struct EditImage {
+    std::vector<std::byte> pixels;
+    int width = 0;
+    int height = 0;
+};
+
+// Where recomputed metadata gets its pixels: straight from the file when the subimage can be
+//  located, otherwise (compressed 7.6 image data) through vtfpp, loaded on first use
+struct SubimageReader {
+    FILE *file;
+    const std::string &path;
+    const VtfHeaderInfo &info;
+    std::unique_ptr<vtfpp::VTF> vtf;
+
+    bool read(int mip, int frame, int face, int slice, EditImage &image) {
+        image.width = vtfpp::ImageDimensions::getMipDim(mip, info.width);
+        image.height = vtfpp::ImageDimensions::getMipDim(mip, info.height);
+        size_t rgba_length = (size_t)image.width * image.height * 4;
+
+        VtfFileRange range;
+        if (vtf_header_subimage_range(info, mip, frame, face, slice, range)) {
+            std::vector<std::byte> raw(range.length);
+            if (fseek(file, (long)range.offset, SEEK_SET) != 0 || fread(raw.data(), 1, raw.size(), file) != raw.size()) {
+                return false;
+            }
+            if (vtf_pixels_has_pipeline(info.format, vtfpp::ImageFormat::RGBA8888)) {
+                image.pixels.resize(rgba_length);
+                if (!vtf_pixels_convert(info.format, vtfpp::ImageFormat::RGBA8888, raw, image.pixels)) {
+                    return false;
+                }
+            } else {
+                image.pixels = vtfpp::ImageConversion::convertImageDataToFormat(raw, info.format, vtfpp::ImageFormat::RGBA8888, image.width, image.height);
+            }
+        } else {
+            // vtfpp has to inflate all of it, but still only this one subimage gets decoded
+            if (!vtf) {
+                vtf = std::make_unique<vtfpp::VTF>(path, false);
+            }
+            if (!*vtf) {
+                return false;
+            }
+            image.pixels = vtf->getImageDataAsRGBA8888(mip, frame, face, slice);
+        }
+        return image.pixels.size() == rgba_length;
+    }
+};
+
+// Average linear color of the largest mip no bigger than VTF_EDIT_REFLECTIVITY_SIZE, over every
+//  frame, face and slice
+static bool compute_reflectivity(SubimageReader &reader, float reflectivity[3]) {
+    static const std::array<float, 256> srgb_to_linear = [] {
+        std::array<float, 256> table;
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+
+    const VtfHeaderInfo &info = reader.info;
+    int mip = 0;
+    while (mip + 1 < info.mip_count
+        && std::max(vtfpp::ImageDimensions::getMipDim(mip, info.width), vtfpp::ImageDimensions::getMipDim(mip, info.height)) > VTF_EDIT_REFLECTIVITY_SIZE) {
+        mip++;
+    }
+
+    // The spheremap face (7.0-7.4 cubemaps) is made from the other six, so it's left out
+    int face_count = std::min(info.face_count, 6);
+    int slice_count = vtfpp::ImageDimensions::getMipDim(mip, info.slice_count);
+
+    double sums[3] = {};
+    uint64_t pixel_count = 0;
+    EditImage image;
+    for (int frame = 0; frame < info.frame_count; frame++) {
+        for (int face = 0; face < face_count; face++) {
+            for (int slice = 0; slice < slice_count; slice++) {
+                if (!reader.read(mip, frame, face, slice, image)) {
+                    return false;
+                }
+                const uint8_t *pixels = (const uint8_t *)image.pixels.data();
+                for (size_t i = 0; i < image.pixels.size(); i += 4) {
+                    sums[0] += srgb_to_linear[pixels[i]];
+                    sums[1] += srgb_to_linear[pixels[i + 1]];
+                    sums[2] += srgb_to_linear[pixels[i + 2]];
+                }
+                pixel_count += image.pixels.size() / 4;
+            }
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        reflectivity[i] = pixel_count ? (float)(sums[i] / pixel_count) : 0.0f;
+    }
+    return true;
+}
+
+// A 16x16 DXT1 thumbnail, box-filtered from the smallest mip of the first frame that's still at
+//  least that big
+static bool compute_thumbnail(SubimageReader &reader, std::vector<std::byte> &thumbnail) {
+    const VtfHeaderInfo &info = reader.info;
+    int mip = 0;
+    while (mip + 1 < info.mip_count
+        && std::min(vtfpp::ImageDimensions::getMipDim(mip + 1, info.width), vtfpp::ImageDimensions::getMipDim(mip + 1, info.height)) >= VTF_EDIT_THUMBNAIL_SIZE) {
+        mip++;
+    }
+
+    EditImage image;
+    if (!reader.read(mip, 0, 0, 0, image)) {
+        return false;
+    }
+
+    // Each thumbnail pixel averages the block of source pixels it covers (or repeats the nearest
+    //  one, for mips smaller than the thumbnail)
+    std::vector<std::byte> rgba(VTF_EDIT_THUMBNAIL_SIZE * VTF_EDIT_THUMBNAIL_SIZE * 4);
+    const uint8_t *src = (const uint8_t *)image.pixels.data();
+    for (int y = 0; y < VTF_EDIT_THUMBNAIL_SIZE; y++) {
+        int y0 = y * image.height / VTF_EDIT_THUMBNAIL_SIZE;
+        int y1 = std::max(y0 + 1, (y + 1) * image.height / VTF_EDIT_THUMBNAIL_SIZE);
+        for (int x = 0; x < VTF_EDIT_THUMBNAIL_SIZE; x++) {
+            int x0 = x * image.width / VTF_EDIT_THUMBNAIL_SIZE;
+            int x1 = std::max(x0 + 1, (x + 1) * image.width / VTF_EDIT_THUMBNAIL_SIZE);
+            uint32_t sums[4] = {};
+            for (int sy = y0; sy < y1; sy++) {
+                for (int sx = x0; sx < x1; sx++) {
+                    const uint8_t *pixel = src + ((size_t)sy * image.width + sx) * 4;
+                    for (int c = 0; c < 4; c++) sums[c] += pixel[c];
+                }
+            }
+            uint32_t count = (uint32_t)((y1 - y0) * (x1 - x0));
+            for (int c = 0; c < 4; c++) {
+                rgba[((size_t)y * VTF_EDIT_THUMBNAIL_SIZE + x) * 4 + c] = (std::byte)((sums[c] + count / 2) / count);
+            }
+        }
+    }
+
+    thumbnail = vtfpp::ImageConversion::convertImageDataToFormat(
+        rgba, vtfpp::ImageFormat::RGBA8888, vtfpp::ImageFormat::DXT1, VTF_EDIT_THUMBNAIL_SIZE, VTF_EDIT_THUMBNAIL_SIZE);
+    return thumbnail.size() == vtfpp::ImageFormatDetails::getDataLength(vtfpp::ImageFormat::DXT1, VTF_EDIT_THUMBNAIL_SIZE, VTF_EDIT_THUMBNAIL_SIZE);
+}
+
+// The whole file through vtfpp, for version changes that move data around
+static bool rewrite_file(const std::string &path, const VtfHeaderEdit &edit, std::span<const std::byte> thumbnail, std::string &error) {
+    vtfpp::VTF vtf(path, false);
+    if (!vtf) {
+        error = "vtfpp could not read " + path;
+        return false;
+    }
+
+    if (edit.minor_version >= 0) {
+        vtf.setVersion(7, edit.minor_version);
+    }
+    vtf.setFlags((vtfpp::VTF::Flags)((vtf.getFlags() | edit.set_flags) & ~edit.clear_flags));
+    if (edit.start_frame >= 0) {
+        int face_count = vtf.getFaceCount();
+        vtf.setStartFrame(edit.start_frame);
+        if (vtf.getFaceCount() != face_count) {
+            error = "That start frame would change the number of cubemap faces";
+            return false;
+        }
+    }
+    if (edit.bumpmap_scale_set) {
+        vtf.setBumpMapScale(edit.bumpmap_scale);
+    }
+    if (edit.reflectivity_set) {
+        vtf.setReflectivity({ edit.reflectivity[0], edit.reflectivity[1], edit.reflectivity[2] });
+    }
+    if (edit.thumbnail == VtfThumbnailEdit::REGENERATE) {
+        vtf.setThumbnail(thumbnail, vtfpp::ImageFormat::DXT1, VTF_EDIT_THUMBNAIL_SIZE, VTF_EDIT_THUMBNAIL_SIZE);
+    } else if (edit.thumbnail == VtfThumbnailEdit::REMOVE) {
+        vtf.removeThumbnail();
+    }
+
+    // Written next to it first, so a failed write doesn't leave half a file behind
+    std::string temp_path = path + ".tmp";
+    if (!vtf.bake(temp_path)) {
+        error = "Could not write " + temp_path;
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        std::filesystem::remove(temp_path, ec);
+        error = "Could not replace " + path;
+        return false;
+    }
+    return true;
+}
+
+bool vtf_edit_file(const std::string &path, const VtfHeaderEdit &edit, std::string &error, VtfEditMethod *method) {
+    FILE *file = fopen(path.c_str(), "r+b");
+    if (!file) {
+        error = "Could not open " + path;
+        return false;
+    }
+
+    std::vector<std::byte> header(VTF_HEADER_READ_SIZE);
+    header.resize(fread(header.data(), 1, header.size(), file));
+    VtfHeaderInfo info;
+    bool parsed = vtf_header_parse(header, info);
+    if (!parsed && header.size() >= 16) {
+        // Maybe just a long resource list; try again with the size the header says it has
+        uint32_t header_size;
+        memcpy(&header_size, header.data() + 12, sizeof(header_size));
+        if (header_size > header.size() && header_size <= (1u << 20)) {
+            header.resize(header_size);
+            fseek(file, 0, SEEK_SET);
+            header.resize(fread(header.data(), 1, header.size(), file));
+            parsed = vtf_header_parse(header, info);
+        }
+    }
+    if (!parsed) {
+        fclose(file);
+        error = path + " is not a VTF file";
+        return false;
+    }
+
+    VtfHeaderEdit resolved = edit;
+    std::vector<std::byte> thumbnail;
+    if (edit.recompute_reflectivity || edit.thumbnail == VtfThumbnailEdit::REGENERATE) {
+        SubimageReader reader { file, path, info, nullptr };
+        bool computed = true;
+        if (edit.recompute_reflectivity) {
+            computed = compute_reflectivity(reader, resolved.reflectivity);
+            resolved.reflectivity_set = true;
+        }
+        if (computed && edit.thumbnail == VtfThumbnailEdit::REGENERATE) {
+            computed = compute_thumbnail(reader, thumbnail);
+        }
+        if (!computed) {
+            fclose(file);
+            error = "Could not decode the image data of " + path;
+            return false;
+        }
+    }
+
+    int minor_version = resolved.minor_version >= 0 ? resolved.minor_version : (int)info.minor_version;
+    vtfpp::VTF::Flags flags = (vtfpp::VTF::Flags)((info.flags | resolved.set_flags) & ~resolved.clear_flags);
+
+    std::vector<std::byte> patched = header;
+    write_le<uint32_t>(patched, 8, (uint32_t)minor_version);
+    write_le<uint32_t>(patched, 20, (uint32_t)flags);
+    if (resolved.start_frame >= 0) {
+        write_le<uint16_t>(patched, 26, (uint16_t)resolved.start_frame);
+    }
+    if (resolved.reflectivity_set) {
+        for (int i = 0; i < 3; i++) {
+            write_le<float>(patched, 32 + i * 4, resolved.reflectivity[i]);
+        }
+    }
+    if (resolved.bumpmap_scale_set) {
+        write_le<float>(patched, 48, resolved.bumpmap_scale);
+    }
+
+    // In place only works if the patched header still describes the same bytes after it
+    VtfHeaderInfo patched_info;
+    bool same_layout = layout_group(minor_version) == layout_group(info.minor_version)
+        && vtf_header_parse(patched, patched_info)
+        && patched_info.face_count == info.face_count
+        && patched_info.thumbnail.offset == info.thumbnail.offset
+        && patched_info.image_data.offset == info.image_data.offset
+        && patched_info.image_data.length == info.image_data.length
+        // Compressed image data is 7.6 only
+        && !(info.image_data_compressed && minor_version < 6);
+
+    // A new thumbnail can go over the old one if that's the same size (16x16 DXT1 is all anything writes)
+    bool thumbnail_in_place = true;
+    if (edit.thumbnail == VtfThumbnailEdit::REGENERATE) {
+        thumbnail_in_place = info.thumbnail_present
+            && info.thumbnail_format == vtfpp::ImageFormat::DXT1
+            && info.thumbnail_width == VTF_EDIT_THUMBNAIL_SIZE
+            && info.thumbnail_height == VTF_EDIT_THUMBNAIL_SIZE
+            && info.thumbnail.offset >= info.header_size
+            && info.thumbnail.length == thumbnail.size();
+    } else if (edit.thumbnail == VtfThumbnailEdit::REMOVE) {
+        thumbnail_in_place = !info.thumbnail_present;
+    }
+
+    if (same_layout && thumbnail_in_place) {
+        bool written = fseek(file, 0, SEEK_SET) == 0
+            && fwrite(patched.data(), 1, EDIT_HEADER_BYTES, file) == EDIT_HEADER_BYTES;
+        if (written && edit.thumbnail == VtfThumbnailEdit::REGENERATE) {
+            written = fseek(file, (long)info.thumbnail.offset, SEEK_SET) == 0
+                && fwrite(thumbnail.data(), 1, thumbnail.size(), file) == thumbnail.size();
+        }
+        written = written && fflush(file) == 0;
+        fclose(file);
+        if (!written) {
+            error = "Could not write " + path;
+            return false;
+        }
+        if (method) *method = VtfEditMethod::IN_PLACE;
+        return true;
+    }
+    fclose(file);
+
+    if (!same_layout && minor_version == (int)info.minor_version) {
+        // Only a version change can move things around; anything else that does is a start frame
+        //  turning a cubemap's spheremap face on or off
+        error = "That start frame would change the number of cubemap faces";
+        return false;
+    }
+
+    if (!rewrite_file(path, resolved, thumbnail, error)) {
+        return false;
+    }
+    if (method) *method = VtfEditMethod::REWRITTEN;
+    return true;
+}
@@ -0,0 +1,84 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Header edits on existing VTF files (version, flags, start frame, bumpmap scale, reflectivity),
+//  without decoding or re-encoding any image data.
+//
+// Most edits are a few bytes written over the header. Version changes that move things around
+//  (7.2 -> 7.3 adds the resource list, 7.5 drops the cubemap spheremap face, ...) go through
+//  vtfpp instead, which copies the image data over as stored.
+//
+// Reflectivity and the thumbnail can also be recomputed. Unlike on export, that decodes only
+//  one small mip (not mip 0 of every frame): reflectivity averages the largest mip no bigger
+//  than VTF_EDIT_REFLECTIVITY_SIZE, and the thumbnail is shrunk from the smallest mip that's at
+//  least thumbnail-sized. Mips are already box-filtered averages of mip 0, so the results are
+//  close to a full recompute, and fixing metadata across a whole mod costs next to nothing.
+//
+// Edits use the export procedure's argument names: version=7_5, flag_clamp_s=true,
+//  recompute_reflectivity_enabled=true, thumbnail_enabled=true, ...
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "vtfpp/VTF.h"
+
+// Biggest mip size (in either dimension) recomputed reflectivity is averaged from
+#define VTF_EDIT_REFLECTIVITY_SIZE 64
+// Thumbnails are 16x16 DXT1, the same as vtfpp writes on export
+#define VTF_EDIT_THUMBNAIL_SIZE 16
+
+enum class VtfThumbnailEdit {
+    KEEP,
+    REGENERATE,
+    REMOVE,
+};
+
+struct VtfHeaderEdit {
+    // -1 keeps the current value
+    int minor_version = -1;
+    vtfpp::VTF::Flags set_flags = vtfpp::VTF::FLAG_NONE;
+    vtfpp::VTF::Flags clear_flags = vtfpp::VTF::FLAG_NONE;
+    // -1 keeps the current value
+    int start_frame = -1;
+    bool bumpmap_scale_set = false;
+    float bumpmap_scale = 1.0f;
+    bool reflectivity_set = false;
+    float reflectivity[3] = {};
+    // Recomputed from a small mip; overrides reflectivity above
+    bool recompute_reflectivity = false;
+    VtfThumbnailEdit thumbnail = VtfThumbnailEdit::KEEP;
+};
+
+enum class VtfEditMethod {
+    // Header bytes overwritten
+    IN_PLACE,
+    // Whole file written again by vtfpp (image data copied, not re-encoded)
+    REWRITTEN,
+};
+
+// Adds one edit. Keys: version, start_frame, bumpmap_scale, reflectivity (R,G,B),
+//  recompute_reflectivity_enabled, thumbnail_enabled (true regenerates it, false removes it) and
+//  the user-settable flag_* names. Returns false and fills error if the key or value isn't valid.
+bool vtf_edit_set_option(VtfHeaderEdit &edit, std::string_view key, std::string_view value, std::string &error);
+
+// Same, for "key=value"
+bool vtf_edit_set_option(VtfHeaderEdit &edit, std::string_view option, std::string &error);
+
+// Applies edit to the VTF at path. Returns false and fills error if the file can't be read or
+//  written, or the edit can't be made without re-encoding.
+bool vtf_edit_file(const std::string &path, const VtfHeaderEdit &edit, std::string &error, VtfEditMethod *method = nullptr);
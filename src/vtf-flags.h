@@ -0,0 +1,85 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Names for the VTF flags.
+// User-settable flags are named after their export procedure argument, so anything outside the
+//  plugin (reports, tools) talks about flags the same way the export dialog does.
+
+#pragma once
+
+#include <string_view>
+
+#include "vtfpp/VTF.h"
+
+struct VtfFlagName {
+    const char *name;
+    vtfpp::VTF::Flags flag;
+    // False for flags that are always computed on export (SRGB, alpha, envmap, ...)
+    bool user_settable;
+};
+
+// Some names don't match vtfpp's; the names here follow the Valve wiki, vtfpp follows the SDK
+static constexpr VtfFlagName VTF_FLAG_NAMES[] = {
+    { "flag_point_sample",          vtfpp::VTF::FLAG_POINT_SAMPLE,          true },
+    { "flag_trilinear",             vtfpp::VTF::FLAG_TRILINEAR,             true },
+    { "flag_clamp_s",               vtfpp::VTF::FLAG_CLAMP_S,               true },
+    { "flag_clamp_t",               vtfpp::VTF::FLAG_CLAMP_T,               true },
+    { "flag_anisotropic",           vtfpp::VTF::FLAG_ANISOTROPIC,           true },
+    { "flag_hint_dxt5",             vtfpp::VTF::FLAG_HINT_DXT5,             true },
+    { "flag_srgb",                  vtfpp::VTF::FLAG_PWL_CORRECTED,         false },
+    { "flag_normal_map",            vtfpp::VTF::FLAG_NORMAL,                true },
+    { "flag_no_mipmaps",            vtfpp::VTF::FLAG_NO_MIP,                false },
+    { "flag_no_lod",                vtfpp::VTF::FLAG_NO_LOD,                false },
+    { "flag_min_mipmap",            vtfpp::VTF::FLAG_LOAD_ALL_MIPS,         true },
+    { "flag_procedural",            vtfpp::VTF::FLAG_PROCEDURAL,            true },
+    { "flag_one_bit_alpha",         vtfpp::VTF::FLAG_ONE_BIT_ALPHA,         false },
+    { "flag_eight_bit_alpha",       vtfpp::VTF::FLAG_MULTI_BIT_ALPHA,       false },
+    { "flag_envmap",                vtfpp::VTF::FLAG_ENVMAP,                false },
+    { "flag_rt",                    vtfpp::VTF::FLAG_RENDERTARGET,          true },
+    { "flag_depth_rt",              vtfpp::VTF::FLAG_DEPTH_RENDERTARGET,    true },
+    { "flag_no_debug_override",     vtfpp::VTF::FLAG_NO_DEBUG_OVERRIDE,     true },
+    { "flag_single_copy",           vtfpp::VTF::FLAG_SINGLE_COPY,           true },
+    { "flag_premultiply_color",     vtfpp::VTF::FLAG_DEFAULT_POOL,          true },
+    { "flag_normal_to_dudv",        vtfpp::VTF::FLAG_COMBINED,              true },
+    { "flag_alpha_test_mip_gen",    vtfpp::VTF::FLAG_ASYNC_DOWNLOAD,        true },
+    { "flag_no_depth_buffer",       vtfpp::VTF::FLAG_NO_DEPTH_BUFFER,       true },
+    { "flag_nice_filtered",         vtfpp::VTF::FLAG_SKIP_INITIAL_DOWNLOAD, true },
+    { "flag_clamp_u",               vtfpp::VTF::FLAG_CLAMP_U,               true },
+    { "flag_vertex_texture",        vtfpp::VTF::FLAG_VERTEX_TEXTURE,        true },
+    { "flag_ssbump",                vtfpp::VTF::FLAG_SSBUMP,                true },
+    { "flag_load_most_mips",        vtfpp::VTF::FLAG_LOAD_MOST_MIPS,        true },
+    { "flag_border",                vtfpp::VTF::FLAG_BORDER,                true },
+};
+
+// Returns the name of a single flag, or nullptr if it doesn't have one.
+static inline const char *vtf_flag_name(vtfpp::VTF::Flags flag) {
+    for (const VtfFlagName &flag_name : VTF_FLAG_NAMES) {
+        if (flag_name.flag == flag) {
+            return flag_name.name;
+        }
+    }
+    return nullptr;
+}
+
+// Returns the entry for name, or nullptr if there isn't one.
+static inline const VtfFlagName *vtf_flag_from_name(const char *name) {
+    for (const VtfFlagName &flag_name : VTF_FLAG_NAMES) {
+        if (name && std::string_view(flag_name.name) == name) {
+            return &flag_name;
+        }
+    }
+    return nullptr;
+}
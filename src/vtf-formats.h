@@ -0,0 +1,204 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+
+// An image format that can be picked in the export dialog.
+// The nick is what's stored in the procedure config (and shown to the user).
+struct VtfFormatChoice {
+    const char *nick;
+    vtfpp::ImageFormat format;
+};
+
+// Every image format offered by the export procedure, in the order they're shown.
+// This is shared with the standalone tools, so they cover exactly what the plugin can write.
+static constexpr VtfFormatChoice VTF_EXPORT_FORMATS[] = {
+    { "RGBA8888",                       vtfpp::ImageFormat::RGBA8888 },
+    { "ABGR8888",                       vtfpp::ImageFormat::ABGR8888 },
+    { "RGB888",                         vtfpp::ImageFormat::RGB888 },
+    { "BGR888",                         vtfpp::ImageFormat::BGR888 },
+    { "RGB565",                         vtfpp::ImageFormat::RGB565 },
+    { "I8",                             vtfpp::ImageFormat::I8 },
+    { "IA88",                           vtfpp::ImageFormat::IA88 },
+    { "P8",                             vtfpp::ImageFormat::P8 },
+    { "A8",                             vtfpp::ImageFormat::A8 },
+    { "RGB888_BLUESCREEN",              vtfpp::ImageFormat::RGB888_BLUESCREEN },
+    { "BGR888_BLUESCREEN",              vtfpp::ImageFormat::BGR888_BLUESCREEN },
+    { "ARGB8888",                       vtfpp::ImageFormat::ARGB8888 },
+    { "BGRA8888",                       vtfpp::ImageFormat::BGRA8888 },
+    { "DXT1",                           vtfpp::ImageFormat::DXT1 },
+    { "DXT3",                           vtfpp::ImageFormat::DXT3 },
+    { "DXT5",                           vtfpp::ImageFormat::DXT5 },
+    { "BGRX8888",                       vtfpp::ImageFormat::BGRX8888 },
+    { "BGR565",                         vtfpp::ImageFormat::BGR565 },
+    { "BGRX5551",                       vtfpp::ImageFormat::BGRX5551 },
+    { "BGRA4444",                       vtfpp::ImageFormat::BGRA4444 },
+    { "DXT1_ONE_BIT_ALPHA",             vtfpp::ImageFormat::DXT1_ONE_BIT_ALPHA },
+    { "BGRA5551",                       vtfpp::ImageFormat::BGRA5551 },
+    { "UV88",                           vtfpp::ImageFormat::UV88 },
+    { "UVWQ8888",                       vtfpp::ImageFormat::UVWQ8888 },
+    { "RGBA16161616F",                  vtfpp::ImageFormat::RGBA16161616F },
+    { "RGBA16161616",                   vtfpp::ImageFormat::RGBA16161616 },
+    { "UVLX8888",                       vtfpp::ImageFormat::UVLX8888 },
+    { "R32F",                           vtfpp::ImageFormat::R32F },
+    { "RGB323232F",                     vtfpp::ImageFormat::RGB323232F },
+    { "RGBA32323232F",                  vtfpp::ImageFormat::RGBA32323232F },
+
+    { "RG1616F",                        vtfpp::ImageFormat::RG1616F },
+    { "RG3232F",                        vtfpp::ImageFormat::RG3232F },
+    { "RGBX8888",                       vtfpp::ImageFormat::RGBX8888 },
+    { "EMPTY",                          vtfpp::ImageFormat::EMPTY },
+    { "ATI2N",                          vtfpp::ImageFormat::ATI2N },
+    { "ATI1N",                          vtfpp::ImageFormat::ATI1N },
+    { "RGBA1010102",                    vtfpp::ImageFormat::RGBA1010102 },
+    { "BGRA1010102",                    vtfpp::ImageFormat::BGRA1010102 },
+    { "R16F",                           vtfpp::ImageFormat::R16F },
+
+    { "CONSOLE_BGRX8888_LINEAR",        vtfpp::ImageFormat::CONSOLE_BGRX8888_LINEAR },
+    { "CONSOLE_RGBA8888_LINEAR",        vtfpp::ImageFormat::CONSOLE_RGBA8888_LINEAR },
+    { "CONSOLE_ABGR8888_LINEAR",        vtfpp::ImageFormat::CONSOLE_ABGR8888_LINEAR },
+    { "CONSOLE_ARGB8888_LINEAR",        vtfpp::ImageFormat::CONSOLE_ARGB8888_LINEAR },
+    { "CONSOLE_BGRA8888_LINEAR",        vtfpp::ImageFormat::CONSOLE_BGRA8888_LINEAR },
+    { "CONSOLE_RGB888_LINEAR",          vtfpp::ImageFormat::CONSOLE_RGB888_LINEAR },
+    { "CONSOLE_BGR888_LINEAR",          vtfpp::ImageFormat::CONSOLE_BGR888_LINEAR },
+    { "CONSOLE_BGRX5551_LINEAR",        vtfpp::ImageFormat::CONSOLE_BGRX5551_LINEAR },
+    { "CONSOLE_I8_LINEAR",              vtfpp::ImageFormat::CONSOLE_I8_LINEAR },
+    { "CONSOLE_RGBA16161616_LINEAR",    vtfpp::ImageFormat::CONSOLE_RGBA16161616_LINEAR },
+    { "CONSOLE_BGRX8888_LE",            vtfpp::ImageFormat::CONSOLE_BGRX8888_LE },
+    { "CONSOLE_BGRA8888_LE",            vtfpp::ImageFormat::CONSOLE_BGRA8888_LE },
+
+    { "R8",                             vtfpp::ImageFormat::R8 },
+    { "BC7",                            vtfpp::ImageFormat::BC7 },
+    { "BC6H",                           vtfpp::ImageFormat::BC6H },
+};
+
+// Returns the nick of an export format, or nullptr if the plugin doesn't offer it.
+static inline const char *vtf_format_nick(vtfpp::ImageFormat format) {
+    for (const VtfFormatChoice &choice : VTF_EXPORT_FORMATS) {
+        if (choice.format == format) {
+            return choice.nick;
+        }
+    }
+    return nullptr;
+}
+
+// Returns the nick of format, or its number if the plugin doesn't offer it (P8, the console
+//  formats, ...), for printing formats read from files.
+static inline std::string vtf_format_label(vtfpp::ImageFormat format) {
+    const char *nick = vtf_format_nick(format);
+    return nick ? std::string(nick) : std::to_string((int)format);
+}
+
+// Returns true and sets format if nick names an export format.
+static inline bool vtf_format_from_nick(const char *nick, vtfpp::ImageFormat *format) {
+    for (const VtfFormatChoice &choice : VTF_EXPORT_FORMATS) {
+        if (nick && std::string_view(choice.nick) == nick) {
+            *format = choice.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+enum VTFImageType : uint32_t {
+    TYPE_STANDARD           = 0,
+    TYPE_ENVIRONMENT_MAP    = 1,
+    TYPE_VOLUMETRIC_TEXTURE = 2
+};
+
+// What the exported layers are turned into before they go into the VTF (see vtf-bump.h)
+enum VtfHeightConversion : int {
+    // Exported as they are
+    VTF_HEIGHT_NONE     = 0,
+    // Height map to tangent-space normal map
+    VTF_HEIGHT_NORMAL   = 1,
+    // Height map to self-shadowing bump map
+    VTF_HEIGHT_SSBUMP   = 2,
+};
+
+// Mipmap filter value meaning "don't generate mipmaps at all"
+#define VTF_MIPMAP_FILTER_NONE -1
+
+// Any of the other choice arguments of the export procedure: the nick stored in the config,
+//  the value it stands for, and the label shown in the dialog.
+struct VtfChoice {
+    const char *nick;
+    int value;
+    const char *label;
+};
+
+// Values are VTFImageType
+static constexpr VtfChoice VTF_IMAGE_TYPE_CHOICES[] = {
+    { "standard",   TYPE_STANDARD,              "Standard" },
+    { "envmap",     TYPE_ENVIRONMENT_MAP,       "Environment Map" },
+    { "volumetric", TYPE_VOLUMETRIC_TEXTURE,    "Volumetric Texture" },
+};
+
+// Values are vtfpp::ImageConversion::ResizeFilter, or VTF_MIPMAP_FILTER_NONE
+static constexpr VtfChoice VTF_MIPMAP_FILTER_CHOICES[] = {
+    { "none",       VTF_MIPMAP_FILTER_NONE,                                     "None (don't generate mipmaps)" },
+    { "default",    (int)vtfpp::ImageConversion::ResizeFilter::DEFAULT,         "Default" },
+    { "box",        (int)vtfpp::ImageConversion::ResizeFilter::BOX,             "Box" },
+    { "bilinear",   (int)vtfpp::ImageConversion::ResizeFilter::BILINEAR,        "Bilinear" },
+    { "cubic",      (int)vtfpp::ImageConversion::ResizeFilter::CUBIC_BSPLINE,   "Cubic" },
+    { "catmull",    (int)vtfpp::ImageConversion::ResizeFilter::CATMULL_ROM,     "Catmull/Catrom" },
+    { "mitchell",   (int)vtfpp::ImageConversion::ResizeFilter::MITCHELL,        "Mitchell" },
+    { "point",      (int)vtfpp::ImageConversion::ResizeFilter::POINT_SAMPLE,    "Point" },
+    { "kaiser",     (int)vtfpp::ImageConversion::ResizeFilter::KAISER,          "Kaiser" },
+};
+
+// Values are vtfpp::ImageConversion::ResizeMethod
+static constexpr VtfChoice VTF_RESIZE_METHOD_CHOICES[] = {
+    { "bigger",     (int)vtfpp::ImageConversion::ResizeMethod::POWER_OF_TWO_BIGGER,     "Power of two (bigger)" },
+    { "smaller",    (int)vtfpp::ImageConversion::ResizeMethod::POWER_OF_TWO_SMALLER,    "Power of two (smaller)" },
+    { "nearest",    (int)vtfpp::ImageConversion::ResizeMethod::POWER_OF_TWO_NEAREST,    "Power of two (nearest)" },
+};
+
+// Values are VtfHeightConversion
+static constexpr VtfChoice VTF_HEIGHT_CONVERSION_CHOICES[] = {
+    { "none",       VTF_HEIGHT_NONE,    "None" },
+    { "normal",     VTF_HEIGHT_NORMAL,  "Height to normal map" },
+    { "ssbump",     VTF_HEIGHT_SSBUMP,  "Height to SSBump" },
+};
+
+// Returns the nick for value, or nullptr if none of the choices has it.
+static inline const char *vtf_choice_nick(std::span<const VtfChoice> choices, int value) {
+    for (const VtfChoice &choice : choices) {
+        if (choice.value == value) {
+            return choice.nick;
+        }
+    }
+    return nullptr;
+}
+
+// Returns true and sets value if nick is one of the choices.
+static inline bool vtf_choice_from_nick(std::span<const VtfChoice> choices, const char *nick, int *value) {
+    for (const VtfChoice &choice : choices) {
+        if (nick && std::string_view(choice.nick) == nick) {
+            *value = choice.value;
+            return true;
+        }
+    }
+    return false;
+}
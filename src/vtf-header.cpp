@@ -0,0 +1,162 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-header.h"
+
+#include <algorithm>
+#include <cstring>
+
+// VTFs are little-endian, and so is everything GIMP runs on
+template<typename T>
+static T read_le(std::span<const std::byte> data, size_t offset) {
+    T value;
+    memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+// Size of one mip of every frame/face/slice
+static uint64_t mip_length(const VtfHeaderInfo &info, int mip) {
+    int mip_width = vtfpp::ImageDimensions::getMipDim(mip, info.width);
+    int mip_height = vtfpp::ImageDimensions::getMipDim(mip, info.height);
+    int mip_slices = vtfpp::ImageDimensions::getMipDim(mip, info.slice_count);
+    return (uint64_t)vtfpp::ImageFormatDetails::getDataLength(info.format, mip_width, mip_height, mip_slices)
+        * info.frame_count * info.face_count;
+}
+
+bool vtf_header_parse(std::span<const std::byte> data, VtfHeaderInfo &info) {
+    info = VtfHeaderInfo();
+
+    // 7.0/7.1 headers are 64 bytes (63 used)
+    if (data.size() < 64 || memcmp(data.data(), "VTF\0", 4) != 0) {
+        return false;
+    }
+
+    info.major_version = read_le<uint32_t>(data, 4);
+    info.minor_version = read_le<uint32_t>(data, 8);
+    info.header_size = read_le<uint32_t>(data, 12);
+    if (info.major_version != 7 || info.minor_version > 6 || info.header_size > data.size()) {
+        return false;
+    }
+
+    info.width = read_le<uint16_t>(data, 16);
+    info.height = read_le<uint16_t>(data, 18);
+    info.flags = (vtfpp::VTF::Flags)read_le<uint32_t>(data, 20);
+    info.frame_count = std::max<int>(read_le<uint16_t>(data, 24), 1);
+    info.first_frame = read_le<uint16_t>(data, 26);
+    for (int i = 0; i < 3; i++) {
+        info.reflectivity[i] = read_le<float>(data, 32 + i * 4);
+    }
+    info.bumpmap_scale = read_le<float>(data, 48);
+    info.format = (vtfpp::ImageFormat)read_le<int32_t>(data, 52);
+    info.mip_count = std::max<int>(read_le<uint8_t>(data, 56), 1);
+
+    int32_t thumbnail_format = read_le<int32_t>(data, 57);
+    info.thumbnail_present = thumbnail_format >= 0;
+    info.thumbnail_format = info.thumbnail_present ? (vtfpp::ImageFormat)thumbnail_format : vtfpp::ImageFormat::EMPTY;
+    info.thumbnail_width = read_le<uint8_t>(data, 61);
+    info.thumbnail_height = read_le<uint8_t>(data, 62);
+
+    if (info.minor_version >= 2) {
+        if (data.size() < 65) return false;
+        info.slice_count = std::max<int>(read_le<uint16_t>(data, 63), 1);
+    }
+
+    if (info.width == 0 || info.height == 0) {
+        return false;
+    }
+
+    // Cubemaps have an extra spheremap face before 7.5, unless first_frame says otherwise
+    if (info.flags & vtfpp::VTF::FLAG_ENVMAP) {
+        info.face_count = (info.minor_version < 5 && info.first_frame != 0xFFFF) ? 7 : 6;
+    }
+
+    uint64_t thumbnail_length = 0;
+    if (info.thumbnail_present && info.thumbnail_width > 0 && info.thumbnail_height > 0) {
+        thumbnail_length = vtfpp::ImageFormatDetails::getDataLength(info.thumbnail_format, info.thumbnail_width, info.thumbnail_height);
+    }
+
+    if (info.minor_version < 3) {
+        // Thumbnail, then image data, right after the header
+        info.thumbnail = { info.header_size, thumbnail_length };
+        info.image_data = { info.header_size + thumbnail_length, vtf_header_image_data_length(info) };
+        return true;
+    }
+
+    // 7.3+: both are resources
+    if (data.size() < 80) return false;
+    uint32_t resource_count = read_le<uint32_t>(data, 68);
+    if (80 + (uint64_t)resource_count * 8 > info.header_size) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < resource_count; i++) {
+        size_t entry = 80 + i * 8;
+        VtfHeaderResource resource;
+        resource.tag = (uint32_t)read_le<uint8_t>(data, entry)
+            | ((uint32_t)read_le<uint8_t>(data, entry + 1) << 8)
+            | ((uint32_t)read_le<uint8_t>(data, entry + 2) << 16);
+        resource.flags = read_le<uint8_t>(data, entry + 3);
+        resource.value = read_le<uint32_t>(data, entry + 4);
+        info.resources.push_back(resource);
+
+        if (resource.tag == VTF_RESOURCE_TAG_THUMBNAIL) {
+            info.thumbnail = { resource.value, thumbnail_length };
+        } else if (resource.tag == VTF_RESOURCE_TAG_IMAGE_DATA) {
+            info.image_data = { resource.value, vtf_header_image_data_length(info) };
+        } else if (resource.tag == VTF_RESOURCE_TAG_AUX_COMPRESSION) {
+            // The compression level lives in the resource's data; checking it would take another
+            //  read, so treat any AXC resource as compressed. vtfpp only writes one when compressing.
+            info.image_data_compressed = true;
+        }
+    }
+
+    return true;
+}
+
+bool vtf_header_subimage_range(const VtfHeaderInfo &info, int mip, int frame, int face, int slice, VtfFileRange &range) {
+    if (info.image_data_compressed || info.image_data.length == 0) {
+        return false;
+    }
+
+    int mip_slices = vtfpp::ImageDimensions::getMipDim(mip, info.slice_count);
+    if (mip < 0 || mip >= info.mip_count || frame < 0 || frame >= info.frame_count
+        || face < 0 || face >= info.face_count || slice < 0 || slice >= mip_slices) {
+        return false;
+    }
+
+    // Mips are stored smallest first
+    uint64_t offset = info.image_data.offset;
+    for (int smaller_mip = info.mip_count - 1; smaller_mip > mip; smaller_mip--) {
+        offset += mip_length(info, smaller_mip);
+    }
+
+    // Then frames, faces and slices within the mip
+    int mip_width = vtfpp::ImageDimensions::getMipDim(mip, info.width);
+    int mip_height = vtfpp::ImageDimensions::getMipDim(mip, info.height);
+    uint64_t slice_length = vtfpp::ImageFormatDetails::getDataLength(info.format, mip_width, mip_height);
+    offset += (((uint64_t)frame * info.face_count + face) * mip_slices + slice) * slice_length;
+
+    range = { offset, slice_length };
+    return true;
+}
+
+uint64_t vtf_header_image_data_length(const VtfHeaderInfo &info) {
+    uint64_t length = 0;
+    for (int mip = 0; mip < info.mip_count; mip++) {
+        length += mip_length(info, mip);
+    }
+    return length;
+}
@@ -0,0 +1,102 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// A minimal VTF header reader, for when only the header (and maybe one subimage) is needed.
+//
+// vtfpp always reads the whole file. Things that look at lots of files but only need a little
+//  of each (the thumbnailer, indexers) use this instead to find out where a subimage lives, then
+//  read just those bytes. Anything this doesn't understand (VTFX, compressed 7.6 image data)
+//  is reported as such, so callers can fall back to vtfpp.
+//
+// Layout reference: https://developer.valvesoftware.com/wiki/VTF_(Valve_Texture_Format)#VTF_layout
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+
+// Offset/size of a piece of the file
+struct VtfFileRange {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+struct VtfHeaderResource {
+    // The three tag bytes, as a little-endian number (so the image data tag, "\x30\0\0", is 0x30)
+    uint32_t tag = 0;
+    uint8_t flags = 0;
+    // File offset of the data, or the data itself for resources flagged as having no data chunk
+    uint32_t value = 0;
+};
+
+struct VtfHeaderInfo {
+    uint32_t major_version = 0;
+    uint32_t minor_version = 0;
+    uint32_t header_size = 0;
+
+    int width = 0;
+    int height = 0;
+    vtfpp::VTF::Flags flags = vtfpp::VTF::FLAG_NONE;
+    int frame_count = 0;
+    int first_frame = 0;
+    float reflectivity[3] = {};
+    float bumpmap_scale = 0.0f;
+    vtfpp::ImageFormat format = vtfpp::ImageFormat::EMPTY;
+    int mip_count = 0;
+    // thumbnail_present is false when the file says its thumbnail format is "none"
+    bool thumbnail_present = false;
+    vtfpp::ImageFormat thumbnail_format = vtfpp::ImageFormat::EMPTY;
+    int thumbnail_width = 0;
+    int thumbnail_height = 0;
+    int slice_count = 1;
+    // Not stored in the header, derived from the flags/version the same way vtfpp does
+    int face_count = 1;
+
+    // 7.3+ only
+    std::vector<VtfHeaderResource> resources;
+
+    VtfFileRange thumbnail;
+    VtfFileRange image_data;
+    // Image data is compressed (7.6 AXC resource with a compression level set), so subimages
+    //  can't be located without decompressing it first
+    bool image_data_compressed = false;
+};
+
+// Resource tags
+#define VTF_RESOURCE_TAG_THUMBNAIL          0x000001u
+#define VTF_RESOURCE_TAG_IMAGE_DATA         0x000030u
+#define VTF_RESOURCE_TAG_AUX_COMPRESSION    0x435841u  // "AXC"
+
+// How many bytes vtf_header_parse() needs to see at most: the fixed header plus the resource
+//  list of a file with a reasonable number of resources. If header_size is larger than what was
+//  given, parse again with header_size bytes.
+#define VTF_HEADER_READ_SIZE 1024
+
+// Parses the header at the start of data. data may be just the start of the file (at least
+//  header_size bytes). Returns false if it isn't a VTF this understands.
+bool vtf_header_parse(std::span<const std::byte> data, VtfHeaderInfo &info);
+
+// Where one subimage (one slice of one face of one frame of one mip) is in the file.
+// Returns false if it can't be located without vtfpp (compressed data, out of range).
+bool vtf_header_subimage_range(const VtfHeaderInfo &info, int mip, int frame, int face, int slice, VtfFileRange &range);
+
+// Size in bytes of all image data (every mip/frame/face/slice), as stored uncompressed.
+uint64_t vtf_header_image_data_length(const VtfHeaderInfo &info);
@@ -0,0 +1,1791 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-kernels.h"
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "vtf-cpu.h"
+
+#if defined(VTF_CPU_X86)
+#include <immintrin.h>
+#endif
+
+// Compiles one function for a given instruction set, whatever the rest of the file targets.
+// MSVC allows intrinsics anywhere, so it doesn't need (or have) an equivalent.
+#if defined(VTF_CPU_X86) && !defined(_MSC_VER)
+#define VTF_TARGET_SSE2     __attribute__((target("sse2")))
+#define VTF_TARGET_SSE41    __attribute__((target("sse2,ssse3,sse4.1")))
+#define VTF_TARGET_AVX2     __attribute__((target("sse2,ssse3,sse4.1,avx,avx2")))
+#define VTF_TARGET_AVX512   __attribute__((target("sse2,ssse3,sse4.1,avx,avx2,avx512f,avx512bw")))
+#else
+#define VTF_TARGET_SSE2
+#define VTF_TARGET_SSE41
+#define VTF_TARGET_AVX2
+#define VTF_TARGET_AVX512
+#endif
+
+bool vtf_swizzle_to_rgba8888(vtfpp::ImageFormat format, VtfSwizzle *swizzle) {
+    switch (format) {
+        case vtfpp::ImageFormat::RGBA8888:  *swizzle = { { 0, 1, 2, 3 }, false }; return true;
+        case vtfpp::ImageFormat::BGRA8888:  *swizzle = { { 2, 1, 0, 3 }, false }; return true;
+        case vtfpp::ImageFormat::ABGR8888:  *swizzle = { { 3, 2, 1, 0 }, false }; return true;
+        case vtfpp::ImageFormat::ARGB8888:  *swizzle = { { 1, 2, 3, 0 }, false }; return true;
+        case vtfpp::ImageFormat::BGRX8888:  *swizzle = { { 2, 1, 0, 3 }, true };  return true;
+        case vtfpp::ImageFormat::RGBX8888:  *swizzle = { { 0, 1, 2, 3 }, true };  return true;
+        default:                            return false;
+    }
+}
+
+//
+// Swizzle
+//
+
+static void swizzle4_scalar(const std::byte *src, std::byte *dst, size_t pixel_count, const VtfSwizzle &swizzle) {
+    for (size_t i = 0; i < pixel_count; i++) {
+        const std::byte *in = src + i * 4;
+        std::byte *out = dst + i * 4;
+        out[0] = in[swizzle.order[0]];
+        out[1] = in[swizzle.order[1]];
+        out[2] = in[swizzle.order[2]];
+        out[3] = swizzle.opaque ? (std::byte)0xFF : in[swizzle.order[3]];
+    }
+}
+
+#if defined(VTF_CPU_X86)
+// pshufb mask for 4 pixels; alpha lanes get zeroed (high bit set) when it's forced opaque
+static void swizzle4_shuffle_mask(const VtfSwizzle &swizzle, uint8_t mask[16]) {
+    for (int pixel = 0; pixel < 4; pixel++) {
+        for (int channel = 0; channel < 4; channel++) {
+            bool zeroed = swizzle.opaque && channel == 3;
+            mask[pixel * 4 + channel] = zeroed ? 0x80 : (uint8_t)(pixel * 4 + swizzle.order[channel]);
+        }
+    }
+}
+
+// No byte shuffle in SSE2, so move each channel with 32-bit shifts instead
+VTF_TARGET_SSE2
+static void swizzle4_sse2(const std::byte *src, std::byte *dst, size_t pixel_count, const VtfSwizzle &swizzle) {
+    const __m128i low_byte = _mm_set1_epi32(0xFF);
+    const __m128i alpha = _mm_set1_epi32(swizzle.opaque ? (int)0xFF000000 : 0);
+    __m128i shift_in[4];
+    __m128i shift_out[4];
+    for (int channel = 0; channel < 4; channel++) {
+        shift_in[channel] = _mm_cvtsi32_si128(swizzle.order[channel] * 8);
+        shift_out[channel] = _mm_cvtsi32_si128(channel * 8);
+    }
+    int channel_count = swizzle.opaque ? 3 : 4;
+
+    size_t i = 0;
+    for (; i + 4 <= pixel_count; i += 4) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(src + i * 4));
+        __m128i out = alpha;
+        for (int channel = 0; channel < channel_count; channel++) {
+            __m128i value = _mm_and_si128(_mm_srl_epi32(in, shift_in[channel]), low_byte);
+            out = _mm_or_si128(out, _mm_sll_epi32(value, shift_out[channel]));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i * 4), out);
+    }
+    swizzle4_scalar(src + i * 4, dst + i * 4, pixel_count - i, swizzle);
+}
+
+VTF_TARGET_SSE41
+static void swizzle4_sse41(const std::byte *src, std::byte *dst, size_t pixel_count, const VtfSwizzle &swizzle) {
+    uint8_t mask_bytes[16];
+    swizzle4_shuffle_mask(swizzle, mask_bytes);
+    const __m128i mask = _mm_loadu_si128((const __m128i *)mask_bytes);
+    const __m128i alpha = _mm_set1_epi32(swizzle.opaque ? (int)0xFF000000 : 0);
+
+    size_t i = 0;
+    for (; i + 4 <= pixel_count; i += 4) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(src + i * 4));
+        _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(in, mask), alpha));
+    }
+    swizzle4_scalar(src + i * 4, dst + i * 4, pixel_count - i, swizzle);
+}
+
+VTF_TARGET_AVX2
+static void swizzle4_avx2(const std::byte *src, std::byte *dst, size_t pixel_count, const VtfSwizzle &swizzle) {
+    uint8_t mask_bytes[16];
+    swizzle4_shuffle_mask(swizzle, mask_bytes);
+    // vpshufb works within each 128-bit lane, so the same mask goes in both
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)mask_bytes));
+    const __m256i alpha = _mm256_set1_epi32(swizzle.opaque ? (int)0xFF000000 : 0);
+
+    size_t i = 0;
+    for (; i + 8 <= pixel_count; i += 8) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+        _mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(in, mask), alpha));
+    }
+    swizzle4_scalar(src + i * 4, dst + i * 4, pixel_count - i, swizzle);
+}
+
+VTF_TARGET_AVX512
+static void swizzle4_avx512(const std::byte *src, std::byte *dst, size_t pixel_count, const VtfSwizzle &swizzle) {
+    uint8_t mask_bytes[16];
+    swizzle4_shuffle_mask(swizzle, mask_bytes);
+    const __m512i mask = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)mask_bytes));
+    const __m512i alpha = _mm512_set1_epi32(swizzle.opaque ? (int)0xFF000000 : 0);
+
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        __m512i in = _mm512_loadu_si512((const void *)(src + i * 4));
+        _mm512_storeu_si512((void *)(dst + i * 4), _mm512_or_si512(_mm512_shuffle_epi8(in, mask), alpha));
+    }
+    swizzle4_scalar(src + i * 4, dst + i * 4, pixel_count - i, swizzle);
+}
+#endif
+
+using Swizzle4Kernel = void (*)(const std::byte *, std::byte *, size_t, const VtfSwizzle &);
+
+static Swizzle4Kernel resolve_swizzle4() {
+#if defined(VTF_CPU_X86)
+    switch (vtf_simd_level()) {
+        case VtfSimdLevel::AVX512:  return swizzle4_avx512;
+        case VtfSimdLevel::AVX2:    return swizzle4_avx2;
+        case VtfSimdLevel::SSE41:   return swizzle4_sse41;
+        case VtfSimdLevel::SSE2:    return swizzle4_sse2;
+        case VtfSimdLevel::SCALAR:  break;
+    }
+#endif
+    return swizzle4_scalar;
+}
+
+void vtf_kernel_swizzle4(const std::byte *src, std::byte *dst, size_t pixel_count, const VtfSwizzle &swizzle) {
+    static const Swizzle4Kernel kernel = resolve_swizzle4();
+    kernel(src, dst, pixel_count, swizzle);
+}
+
+//
+// Diff
+//
+
+// The SIMD variants add squared errors up in 32-bit lanes, and fold them into the 64-bit totals
+//  at least this often (in pixels), well before 255^2 per pixel could overflow a lane
+#define DIFF_FLUSH_PIXELS 16384
+
+static void diff_rgba8888_scalar(const std::byte *a, const std::byte *b, size_t pixel_count, VtfDiffMetrics &metrics) {
+    for (size_t i = 0; i < pixel_count; i++) {
+        bool differs = false;
+        for (int channel = 0; channel < 4; channel++) {
+            int error = std::abs((int)a[i * 4 + channel] - (int)b[i * 4 + channel]);
+            metrics.squared_error[channel] += (uint64_t)(error * error);
+            metrics.max_error[channel] = std::max(metrics.max_error[channel], (uint8_t)error);
+            differs |= error != 0;
+        }
+        metrics.differing_pixels += differs;
+    }
+    metrics.pixel_count += pixel_count;
+}
+
+#if defined(VTF_CPU_X86)
+// Vector lanes hold pixels' channels in RGBA order, so lane % 4 is the channel
+static void diff_fold_squared(const uint32_t *lanes, int lane_count, VtfDiffMetrics &metrics) {
+    for (int lane = 0; lane < lane_count; lane++) {
+        metrics.squared_error[lane % 4] += lanes[lane];
+    }
+}
+
+static void diff_fold_max(const uint8_t *lanes, int lane_count, VtfDiffMetrics &metrics) {
+    for (int lane = 0; lane < lane_count; lane++) {
+        metrics.max_error[lane % 4] = std::max(metrics.max_error[lane % 4], lanes[lane]);
+    }
+}
+
+VTF_TARGET_SSE2
+static void diff_rgba8888_sse2(const std::byte *a, const std::byte *b, size_t pixel_count, VtfDiffMetrics &metrics) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i max = zero;
+    size_t i = 0;
+
+    while (i + 4 <= pixel_count) {
+        size_t chunk_end = std::min(pixel_count, i + DIFF_FLUSH_PIXELS);
+        __m128i squared = zero;
+        for (; i + 4 <= chunk_end; i += 4) {
+            __m128i va = _mm_loadu_si128((const __m128i *)(a + i * 4));
+            __m128i vb = _mm_loadu_si128((const __m128i *)(b + i * 4));
+            __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            max = _mm_max_epu8(max, diff);
+
+            int equal_pixels = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(va, vb)));
+            metrics.differing_pixels += 4 - std::popcount((unsigned)equal_pixels);
+
+            // 255^2 still fits an unsigned 16-bit lane; widen to 32 bits to add up
+            __m128i diff_low = _mm_unpacklo_epi8(diff, zero);
+            __m128i diff_high = _mm_unpackhi_epi8(diff, zero);
+            __m128i square_low = _mm_mullo_epi16(diff_low, diff_low);
+            __m128i square_high = _mm_mullo_epi16(diff_high, diff_high);
+            squared = _mm_add_epi32(squared, _mm_unpacklo_epi16(square_low, zero));
+            squared = _mm_add_epi32(squared, _mm_unpackhi_epi16(square_low, zero));
+            squared = _mm_add_epi32(squared, _mm_unpacklo_epi16(square_high, zero));
+            squared = _mm_add_epi32(squared, _mm_unpackhi_epi16(square_high, zero));
+        }
+
+        uint32_t squared_lanes[4];
+        _mm_storeu_si128((__m128i *)squared_lanes, squared);
+        diff_fold_squared(squared_lanes, 4, metrics);
+    }
+
+    uint8_t max_lanes[16];
+    _mm_storeu_si128((__m128i *)max_lanes, max);
+    diff_fold_max(max_lanes, 16, metrics);
+
+    metrics.pixel_count += i;
+    diff_rgba8888_scalar(a + i * 4, b + i * 4, pixel_count - i, metrics);
+}
+
+VTF_TARGET_AVX2
+static void diff_rgba8888_avx2(const std::byte *a, const std::byte *b, size_t pixel_count, VtfDiffMetrics &metrics) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i max = zero;
+    size_t i = 0;
+
+    while (i + 8 <= pixel_count) {
+        size_t chunk_end = std::min(pixel_count, i + DIFF_FLUSH_PIXELS);
+        __m256i squared = zero;
+        for (; i + 8 <= chunk_end; i += 8) {
+            __m256i va = _mm256_loadu_si256((const __m256i *)(a + i * 4));
+            __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i * 4));
+            __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+            max = _mm256_max_epu8(max, diff);
+
+            int equal_pixels = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, vb)));
+            metrics.differing_pixels += 8 - std::popcount((unsigned)equal_pixels);
+
+            // Unpacks work per 128-bit lane, but every 32-bit lane still holds one channel, in RGBA order
+            __m256i diff_low = _mm256_unpacklo_epi8(diff, zero);
+            __m256i diff_high = _mm256_unpackhi_epi8(diff, zero);
+            __m256i square_low = _mm256_mullo_epi16(diff_low, diff_low);
+            __m256i square_high = _mm256_mullo_epi16(diff_high, diff_high);
+            squared = _mm256_add_epi32(squared, _mm256_unpacklo_epi16(square_low, zero));
+            squared = _mm256_add_epi32(squared, _mm256_unpackhi_epi16(square_low, zero));
+            squared = _mm256_add_epi32(squared, _mm256_unpacklo_epi16(square_high, zero));
+            squared = _mm256_add_epi32(squared, _mm256_unpackhi_epi16(square_high, zero));
+        }
+
+        uint32_t squared_lanes[8];
+        _mm256_storeu_si256((__m256i *)squared_lanes, squared);
+        diff_fold_squared(squared_lanes, 8, metrics);
+    }
+
+    uint8_t max_lanes[32];
+    _mm256_storeu_si256((__m256i *)max_lanes, max);
+    diff_fold_max(max_lanes, 32, metrics);
+
+    metrics.pixel_count += i;
+    diff_rgba8888_scalar(a + i * 4, b + i * 4, pixel_count - i, metrics);
+}
+#endif
+
+using DiffRgba8888Kernel = void (*)(const std::byte *, const std::byte *, size_t, VtfDiffMetrics &);
+
+static DiffRgba8888Kernel resolve_diff_rgba8888() {
+#if defined(VTF_CPU_X86)
+    // Nothing in SSE4.1 or AVX-512 helps enough here to be worth another variant
+    switch (vtf_simd_level()) {
+        case VtfSimdLevel::AVX512:
+        case VtfSimdLevel::AVX2:    return diff_rgba8888_avx2;
+        case VtfSimdLevel::SSE41:
+        case VtfSimdLevel::SSE2:    return diff_rgba8888_sse2;
+        case VtfSimdLevel::SCALAR:  break;
+    }
+#endif
+    return diff_rgba8888_scalar;
+}
+
+void vtf_kernel_diff_rgba8888(const std::byte *a, const std::byte *b, size_t pixel_count, VtfDiffMetrics &metrics) {
+    static const DiffRgba8888Kernel kernel = resolve_diff_rgba8888();
+    kernel(a, b, pixel_count, metrics);
+}
+
+//
+// Channel packing
+//
+
+static void pack_channels_scalar(const std::byte *const planes[4], const uint8_t fill[4], std::byte *dst, size_t pixel_count) {
+    for (int channel = 0; channel < 4; channel++) {
+        const std::byte *plane = planes[channel];
+        std::byte *out = dst + channel;
+        if (plane) {
+            for (size_t i = 0; i < pixel_count; i++) out[i * 4] = plane[i];
+        } else {
+            for (size_t i = 0; i < pixel_count; i++) out[i * 4] = (std::byte)fill[channel];
+        }
+    }
+}
+
+// The pixels after the last full SIMD block, starting at start
+static void pack_channels_tail(const std::byte *const planes[4], const uint8_t fill[4], std::byte *dst, size_t start, size_t pixel_count) {
+    const std::byte *offset_planes[4];
+    for (int channel = 0; channel < 4; channel++) {
+        offset_planes[channel] = planes[channel] ? planes[channel] + start : nullptr;
+    }
+    pack_channels_scalar(offset_planes, fill, dst + start * 4, pixel_count - start);
+}
+
+#if defined(VTF_CPU_X86)
+// 16 pixels: bytes to RG/BA pairs, then pairs to whole pixels
+VTF_TARGET_SSE2
+static void pack_channels_sse2(const std::byte *const planes[4], const uint8_t fill[4], std::byte *dst, size_t pixel_count) {
+    __m128i fills[4];
+    for (int channel = 0; channel < 4; channel++) {
+        fills[channel] = _mm_set1_epi8((char)fill[channel]);
+    }
+
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        __m128i in[4];
+        for (int channel = 0; channel < 4; channel++) {
+            in[channel] = planes[channel] ? _mm_loadu_si128((const __m128i *)(planes[channel] + i)) : fills[channel];
+        }
+        __m128i rg_low = _mm_unpacklo_epi8(in[0], in[1]);
+        __m128i rg_high = _mm_unpackhi_epi8(in[0], in[1]);
+        __m128i ba_low = _mm_unpacklo_epi8(in[2], in[3]);
+        __m128i ba_high = _mm_unpackhi_epi8(in[2], in[3]);
+
+        __m128i *out = (__m128i *)(dst + i * 4);
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(rg_low, ba_low));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rg_low, ba_low));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rg_high, ba_high));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rg_high, ba_high));
+    }
+    pack_channels_tail(planes, fill, dst, i, pixel_count);
+}
+
+// 32 pixels. The unpacks work within 128-bit lanes, so the low lanes hold pixels 0-15 and the
+//  high lanes 16-31; the final permutes put them back in order.
+VTF_TARGET_AVX2
+static void pack_channels_avx2(const std::byte *const planes[4], const uint8_t fill[4], std::byte *dst, size_t pixel_count) {
+    __m256i fills[4];
+    for (int channel = 0; channel < 4; channel++) {
+        fills[channel] = _mm256_set1_epi8((char)fill[channel]);
+    }
+
+    size_t i = 0;
+    for (; i + 32 <= pixel_count; i += 32) {
+        __m256i in[4];
+        for (int channel = 0; channel < 4; channel++) {
+            in[channel] = planes[channel] ? _mm256_loadu_si256((const __m256i *)(planes[channel] + i)) : fills[channel];
+        }
+        __m256i rg_low = _mm256_unpacklo_epi8(in[0], in[1]);
+        __m256i rg_high = _mm256_unpackhi_epi8(in[0], in[1]);
+        __m256i ba_low = _mm256_unpacklo_epi8(in[2], in[3]);
+        __m256i ba_high = _mm256_unpackhi_epi8(in[2], in[3]);
+
+        // Pixels 0-3 + 16-19, 4-7 + 20-23, 8-11 + 24-27, 12-15 + 28-31
+        __m256i pixels0 = _mm256_unpacklo_epi16(rg_low, ba_low);
+        __m256i pixels1 = _mm256_unpackhi_epi16(rg_low, ba_low);
+        __m256i pixels2 = _mm256_unpacklo_epi16(rg_high, ba_high);
+        __m256i pixels3 = _mm256_unpackhi_epi16(rg_high, ba_high);
+
+        __m256i *out = (__m256i *)(dst + i * 4);
+        _mm256_storeu_si256(out, _mm256_permute2x128_si256(pixels0, pixels1, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(pixels2, pixels3, 0x20));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(pixels0, pixels1, 0x31));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(pixels2, pixels3, 0x31));
+    }
+    pack_channels_tail(planes, fill, dst, i, pixel_count);
+}
+#endif
+
+using PackChannelsKernel = void (*)(const std::byte *const[4], const uint8_t[4], std::byte *, size_t);
+
+static PackChannelsKernel resolve_pack_channels() {
+#if defined(VTF_CPU_X86)
+    // Plain unpacks; SSE4.1 and AVX-512 add nothing that helps here
+    switch (vtf_simd_level()) {
+        case VtfSimdLevel::AVX512:
+        case VtfSimdLevel::AVX2:    return pack_channels_avx2;
+        case VtfSimdLevel::SSE41:
+        case VtfSimdLevel::SSE2:    return pack_channels_sse2;
+        case VtfSimdLevel::SCALAR:  break;
+    }
+#endif
+    return pack_channels_scalar;
+}
+
+void vtf_kernel_pack_channels(const std::byte *const planes[4], const uint8_t fill[4], std::byte *dst, size_t pixel_count) {
+    static const PackChannelsKernel kernel = resolve_pack_channels();
+    kernel(planes, fill, dst, pixel_count);
+}
+
+//
+// Height to normal/SSBump
+//
+
+// Source's bump basis, in tangent space (see Valve's "Bump map" and "Self-shadowing bump map" pages)
+#define BUMP_BASIS_X0   0.81649658f     // sqrt(2/3)
+#define BUMP_BASIS_X12  -0.40824829f    // -1/sqrt(6)
+#define BUMP_BASIS_Y12  0.70710678f     // 1/sqrt(2)
+#define BUMP_BASIS_Z    0.57735027f     // 1/sqrt(3)
+
+// Sobel sums are 8x the slope, in 0-255 height units
+static inline float bump_slope_scale(float scale) {
+    return scale / (8.0f * 255.0f);
+}
+
+static inline uint8_t bump_unorm(float value) {
+    return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+static void height_to_bump_scalar_range(
+    const uint8_t *above,
+    const uint8_t *row,
+    const uint8_t *below,
+    int width,
+    bool wrap,
+    float scale,
+    bool ssbump,
+    std::byte *out,
+    int x_start,
+    int x_end
+) {
+    float slope_scale = bump_slope_scale(scale);
+    for (int x = x_start; x < x_end; x++) {
+        int left = x > 0 ? x - 1 : (wrap ? width - 1 : 0);
+        int right = x < width - 1 ? x + 1 : (wrap ? 0 : width - 1);
+
+        float dx = (above[right] + 2.0f * row[right] + below[right]) - (above[left] + 2.0f * row[left] + below[left]);
+        float dy = (below[left] + 2.0f * below[x] + below[right]) - (above[left] + 2.0f * above[x] + above[right]);
+        float nx = -dx * slope_scale;
+        float ny = -dy * slope_scale;
+        float length = 1.0f / std::sqrt(nx * nx + ny * ny + 1.0f);
+        nx *= length;
+        ny *= length;
+        float nz = length;
+
+        uint8_t *pixel = (uint8_t *)out + (size_t)x * 4;
+        if (ssbump) {
+            pixel[0] = bump_unorm(nx * BUMP_BASIS_X0 + nz * BUMP_BASIS_Z);
+            pixel[1] = bump_unorm(nx * BUMP_BASIS_X12 + ny * BUMP_BASIS_Y12 + nz * BUMP_BASIS_Z);
+            pixel[2] = bump_unorm(nx * BUMP_BASIS_X12 - ny * BUMP_BASIS_Y12 + nz * BUMP_BASIS_Z);
+        } else {
+            pixel[0] = bump_unorm(nx * 0.5f + 0.5f);
+            pixel[1] = bump_unorm(ny * 0.5f + 0.5f);
+            pixel[2] = bump_unorm(nz * 0.5f + 0.5f);
+        }
+        pixel[3] = 0xFF;
+    }
+}
+
+static void height_to_bump_row_scalar(
+    const uint8_t *above,
+    const uint8_t *row,
+    const uint8_t *below,
+    int width,
+    bool wrap,
+    float scale,
+    bool ssbump,
+    std::byte *out
+) {
+    height_to_bump_scalar_range(above, row, below, width, wrap, scale, ssbump, out, 0, width);
+}
+
+#if defined(VTF_CPU_X86)
+// 4 bytes to 4 floats
+VTF_TARGET_SSE2
+static inline __m128 bump_load4(const uint8_t *bytes) {
+    int32_t word;
+    memcpy(&word, bytes, sizeof(word));
+    __m128i zero = _mm_setzero_si128();
+    __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(word), zero);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+}
+
+// Clamped to 0-1, scaled to 0-255 and rounded, as 32-bit lanes
+VTF_TARGET_SSE2
+static inline __m128i bump_unorm4(__m128 value) {
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+// Interior pixels (both neighbors in the row), 4 at a time; the edges go through the scalar version
+VTF_TARGET_SSE2
+static void height_to_bump_row_sse2(
+    const uint8_t *above,
+    const uint8_t *row,
+    const uint8_t *below,
+    int width,
+    bool wrap,
+    float scale,
+    bool ssbump,
+    std::byte *out
+) {
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 slope_scale = _mm_set1_ps(-bump_slope_scale(scale));
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+    int x = 1;
+    for (; x + 4 <= width - 1; x += 4) {
+        __m128 above_left = bump_load4(above + x - 1);
+        __m128 above_center = bump_load4(above + x);
+        __m128 above_right = bump_load4(above + x + 1);
+        __m128 row_left = bump_load4(row + x - 1);
+        __m128 row_right = bump_load4(row + x + 1);
+        __m128 below_left = bump_load4(below + x - 1);
+        __m128 below_center = bump_load4(below + x);
+        __m128 below_right = bump_load4(below + x + 1);
+
+        __m128 dx = _mm_sub_ps(
+            _mm_add_ps(_mm_add_ps(above_right, _mm_mul_ps(two, row_right)), below_right),
+            _mm_add_ps(_mm_add_ps(above_left, _mm_mul_ps(two, row_left)), below_left)
+        );
+        __m128 dy = _mm_sub_ps(
+            _mm_add_ps(_mm_add_ps(below_left, _mm_mul_ps(two, below_center)), below_right),
+            _mm_add_ps(_mm_add_ps(above_left, _mm_mul_ps(two, above_center)), above_right)
+        );
+        __m128 nx = _mm_mul_ps(dx, slope_scale);
+        __m128 ny = _mm_mul_ps(dy, slope_scale);
+        __m128 length = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), one)));
+        nx = _mm_mul_ps(nx, length);
+        ny = _mm_mul_ps(ny, length);
+        __m128 nz = length;
+
+        __m128 red, green, blue;
+        if (ssbump) {
+            __m128 z = _mm_mul_ps(nz, _mm_set1_ps(BUMP_BASIS_Z));
+            __m128 x12 = _mm_mul_ps(nx, _mm_set1_ps(BUMP_BASIS_X12));
+            __m128 y12 = _mm_mul_ps(ny, _mm_set1_ps(BUMP_BASIS_Y12));
+            red = _mm_add_ps(_mm_mul_ps(nx, _mm_set1_ps(BUMP_BASIS_X0)), z);
+            green = _mm_add_ps(_mm_add_ps(x12, y12), z);
+            blue = _mm_add_ps(_mm_sub_ps(x12, y12), z);
+        } else {
+            red = _mm_add_ps(_mm_mul_ps(nx, half), half);
+            green = _mm_add_ps(_mm_mul_ps(ny, half), half);
+            blue = _mm_add_ps(_mm_mul_ps(nz, half), half);
+        }
+
+        __m128i pixels = _mm_or_si128(
+            _mm_or_si128(bump_unorm4(red), _mm_slli_epi32(bump_unorm4(green), 8)),
+            _mm_or_si128(_mm_slli_epi32(bump_unorm4(blue), 16), alpha)
+        );
+        _mm_storeu_si128((__m128i *)(out + (size_t)x * 4), pixels);
+    }
+
+    height_to_bump_scalar_range(above, row, below, width, wrap, scale, ssbump, out, 0, std::min(1, width));
+    height_to_bump_scalar_range(above, row, below, width, wrap, scale, ssbump, out, std::max(x, 1), width);
+}
+
+// 8 bytes to 8 floats
+VTF_TARGET_AVX2
+static inline __m256 bump_load8(const uint8_t *bytes) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)bytes)));
+}
+
+VTF_TARGET_AVX2
+static inline __m256i bump_unorm8(__m256 value) {
+    value = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+    return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+}
+
+// Same as the SSE2 version, 8 pixels at a time
+VTF_TARGET_AVX2
+static void height_to_bump_row_avx2(
+    const uint8_t *above,
+    const uint8_t *row,
+    const uint8_t *below,
+    int width,
+    bool wrap,
+    float scale,
+    bool ssbump,
+    std::byte *out
+) {
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 slope_scale = _mm256_set1_ps(-bump_slope_scale(scale));
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+    int x = 1;
+    for (; x + 8 <= width - 1; x += 8) {
+        __m256 above_left = bump_load8(above + x - 1);
+        __m256 above_center = bump_load8(above + x);
+        __m256 above_right = bump_load8(above + x + 1);
+        __m256 row_left = bump_load8(row + x - 1);
+        __m256 row_right = bump_load8(row + x + 1);
+        __m256 below_left = bump_load8(below + x - 1);
+        __m256 below_center = bump_load8(below + x);
+        __m256 below_right = bump_load8(below + x + 1);
+
+        __m256 dx = _mm256_sub_ps(
+            _mm256_add_ps(_mm256_add_ps(above_right, _mm256_mul_ps(two, row_right)), below_right),
+            _mm256_add_ps(_mm256_add_ps(above_left, _mm256_mul_ps(two, row_left)), below_left)
+        );
+        __m256 dy = _mm256_sub_ps(
+            _mm256_add_ps(_mm256_add_ps(below_left, _mm256_mul_ps(two, below_center)), below_right),
+            _mm256_add_ps(_mm256_add_ps(above_left, _mm256_mul_ps(two, above_center)), above_right)
+        );
+        __m256 nx = _mm256_mul_ps(dx, slope_scale);
+        __m256 ny = _mm256_mul_ps(dy, slope_scale);
+        __m256 length = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)), one)));
+        nx = _mm256_mul_ps(nx, length);
+        ny = _mm256_mul_ps(ny, length);
+        __m256 nz = length;
+
+        __m256 red, green, blue;
+        if (ssbump) {
+            __m256 z = _mm256_mul_ps(nz, _mm256_set1_ps(BUMP_BASIS_Z));
+            __m256 x12 = _mm256_mul_ps(nx, _mm256_set1_ps(BUMP_BASIS_X12));
+            __m256 y12 = _mm256_mul_ps(ny, _mm256_set1_ps(BUMP_BASIS_Y12));
+            red = _mm256_add_ps(_mm256_mul_ps(nx, _mm256_set1_ps(BUMP_BASIS_X0)), z);
+            green = _mm256_add_ps(_mm256_add_ps(x12, y12), z);
+            blue = _mm256_add_ps(_mm256_sub_ps(x12, y12), z);
+        } else {
+            red = _mm256_add_ps(_mm256_mul_ps(nx, half), half);
+            green = _mm256_add_ps(_mm256_mul_ps(ny, half), half);
+            blue = _mm256_add_ps(_mm256_mul_ps(nz, half), half);
+        }
+
+        __m256i pixels = _mm256_or_si256(
+            _mm256_or_si256(bump_unorm8(red), _mm256_slli_epi32(bump_unorm8(green), 8)),
+            _mm256_or_si256(_mm256_slli_epi32(bump_unorm8(blue), 16), alpha)
+        );
+        _mm256_storeu_si256((__m256i *)(out + (size_t)x * 4), pixels);
+    }
+
+    height_to_bump_scalar_range(above, row, below, width, wrap, scale, ssbump, out, 0, std::min(1, width));
+    height_to_bump_scalar_range(above, row, below, width, wrap, scale, ssbump, out, std::max(x, 1), width);
+}
+#endif
+
+using HeightToBumpRowKernel = void (*)(const uint8_t *, const uint8_t *, const uint8_t *, int, bool, float, bool, std::byte *);
+
+static HeightToBumpRowKernel resolve_height_to_bump_row() {
+#if defined(VTF_CPU_X86)
+    switch (vtf_simd_level()) {
+        case VtfSimdLevel::AVX512:
+        case VtfSimdLevel::AVX2:    return height_to_bump_row_avx2;
+        case VtfSimdLevel::SSE41:
+        case VtfSimdLevel::SSE2:    return height_to_bump_row_sse2;
+        case VtfSimdLevel::SCALAR:  break;
+    }
+#endif
+    return height_to_bump_row_scalar;
+}
+
+void vtf_kernel_height_to_bump_row(
+    const uint8_t *above,
+    const uint8_t *row,
+    const uint8_t *below,
+    int width,
+    bool wrap,
+    float scale,
+    bool ssbump,
+    std::byte *out
+) {
+    static const HeightToBumpRowKernel kernel = resolve_height_to_bump_row();
+    kernel(above, row, below, width, wrap, scale, ssbump, out);
+}
+
+//
+// Equirectangular panorama sampling
+//
+
+#define EQUIRECT_PI         3.14159265f
+#define EQUIRECT_INV_PI     0.31830989f
+#define EQUIRECT_INV_2PI    0.15915494f
+
+// Minimax atan() on [-1, 1], good to about 1e-5 radians (well under a hundredth of a pixel on a
+//  16K panorama). Every variant uses the same polynomial so they sample the same spots.
+#define EQUIRECT_ATAN_A1    0.99997726f
+#define EQUIRECT_ATAN_A3    -0.33262347f
+#define EQUIRECT_ATAN_A5    0.19354346f
+#define EQUIRECT_ATAN_A7    -0.11643287f
+#define EQUIRECT_ATAN_A9    0.05265332f
+#define EQUIRECT_ATAN_A11   -0.01172120f
+
+static inline float equirect_atan2(float y, float x) {
+    float abs_x = std::fabs(x);
+    float abs_y = std::fabs(y);
+    float ratio = std::min(abs_x, abs_y) / std::max(std::max(abs_x, abs_y), FLT_MIN);
+    float ratio2 = ratio * ratio;
+    float angle = ratio * (EQUIRECT_ATAN_A1 + ratio2 * (EQUIRECT_ATAN_A3 + ratio2 * (EQUIRECT_ATAN_A5
+        + ratio2 * (EQUIRECT_ATAN_A7 + ratio2 * (EQUIRECT_ATAN_A9 + ratio2 * EQUIRECT_ATAN_A11)))));
+    if (abs_y > abs_x) angle = EQUIRECT_PI * 0.5f - angle;
+    if (x < 0.0f) angle = EQUIRECT_PI - angle;
+    return std::copysign(angle, y);
+}
+
+// Panorama pixel coordinates (pixel centers at .5) of a direction
+static inline void equirect_coords(float x, float y, float z, int width, int height, float *u, float *v) {
+    float longitude = equirect_atan2(y, x);
+    float latitude = equirect_atan2(z, std::sqrt(x * x + y * y));
+    *u = (0.5f - longitude * EQUIRECT_INV_2PI) * (float)width - 0.5f;
+    *v = (0.5f - latitude * EQUIRECT_INV_PI) * (float)height - 0.5f;
+}
+
+static void equirect_sample_scalar(
+    const std::byte *panorama,
+    int width,
+    int height,
+    const float start[3],
+    const float step[3],
+    int index,
+    std::byte *out
+) {
+    float u, v;
+    equirect_coords(
+        start[0] + (float)index * step[0],
+        start[1] + (float)index * step[1],
+        start[2] + (float)index * step[2],
+        width,
+        height,
+        &u,
+        &v
+    );
+
+    float floor_u = std::floor(u);
+    float floor_v = std::floor(v);
+    float fraction_u = u - floor_u;
+    float fraction_v = v - floor_v;
+    // Wraps around horizontally, clamps at the poles
+    int x0 = (int)floor_u;
+    if (x0 < 0) x0 += width;
+    if (x0 >= width) x0 -= width;
+    int x1 = x0 + 1 < width ? x0 + 1 : 0;
+    int y0 = std::min(std::max((int)floor_v, 0), height - 1);
+    int y1 = std::min(std::max((int)floor_v + 1, 0), height - 1);
+
+    const uint8_t *pixels = (const uint8_t *)panorama;
+    const uint8_t *p00 = pixels + ((size_t)y0 * width + x0) * 4;
+    const uint8_t *p10 = pixels + ((size_t)y0 * width + x1) * 4;
+    const uint8_t *p01 = pixels + ((size_t)y1 * width + x0) * 4;
+    const uint8_t *p11 = pixels + ((size_t)y1 * width + x1) * 4;
+    uint8_t *pixel = (uint8_t *)out + (size_t)index * 4;
+    for (int channel = 0; channel < 4; channel++) {
+        float top = p00[channel] + (p10[channel] - p00[channel]) * fraction_u;
+        float bottom = p01[channel] + (p11[channel] - p01[channel]) * fraction_u;
+        pixel[channel] = (uint8_t)(top + (bottom - top) * fraction_v + 0.5f);
+    }
+}
+
+static void equirect_row_scalar(
+    const std::byte *panorama,
+    int width,
+    int height,
+    const float start[3],
+    const float step[3],
+    int count,
+    std::byte *out
+) {
+    for (int i = 0; i < count; i++) {
+        equirect_sample_scalar(panorama, width, height, start, step, i, out);
+    }
+}
+
+#if defined(VTF_CPU_X86)
+VTF_TARGET_SSE2
+static inline __m128 equirect_atan2_sse2(__m128 y, __m128 x) {
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    __m128 abs_x = _mm_andnot_ps(sign_mask, x);
+    __m128 abs_y = _mm_andnot_ps(sign_mask, y);
+    __m128 ratio = _mm_div_ps(_mm_min_ps(abs_x, abs_y), _mm_max_ps(_mm_max_ps(abs_x, abs_y), _mm_set1_ps(FLT_MIN)));
+    __m128 ratio2 = _mm_mul_ps(ratio, ratio);
+    __m128 angle = _mm_add_ps(_mm_set1_ps(EQUIRECT_ATAN_A9), _mm_mul_ps(ratio2, _mm_set1_ps(EQUIRECT_ATAN_A11)));
+    angle = _mm_add_ps(_mm_set1_ps(EQUIRECT_ATAN_A7), _mm_mul_ps(ratio2, angle));
+    angle = _mm_add_ps(_mm_set1_ps(EQUIRECT_ATAN_A5), _mm_mul_ps(ratio2, angle));
+    angle = _mm_add_ps(_mm_set1_ps(EQUIRECT_ATAN_A3), _mm_mul_ps(ratio2, angle));
+    angle = _mm_add_ps(_mm_set1_ps(EQUIRECT_ATAN_A1), _mm_mul_ps(ratio2, angle));
+    angle = _mm_mul_ps(ratio, angle);
+
+    __m128 steep = _mm_cmpgt_ps(abs_y, abs_x);
+    angle = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(_mm_set1_ps(EQUIRECT_PI * 0.5f), angle)), _mm_andnot_ps(steep, angle));
+    __m128 behind = _mm_cmplt_ps(x, _mm_setzero_ps());
+    angle = _mm_or_ps(_mm_and_ps(behind, _mm_sub_ps(_mm_set1_ps(EQUIRECT_PI), angle)), _mm_andnot_ps(behind, angle));
+    return _mm_or_ps(angle, _mm_and_ps(sign_mask, y));
+}
+
+// One channel of 4 gathered pixels, as floats
+VTF_TARGET_SSE2
+static inline __m128 rgba_channel_sse2(__m128i pixels, int shift) {
+    return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, shift), _mm_set1_epi32(0xFF)));
+}
+
+// 4 RGBA8888 pixels at the given pixel indices
+VTF_TARGET_SSE2
+static inline __m128i rgba_gather_sse2(const std::byte *image, __m128i indices) {
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128((__m128i *)lanes, indices);
+    int32_t pixels[4];
+    for (int lane = 0; lane < 4; lane++) {
+        memcpy(&pixels[lane], image + (size_t)lanes[lane] * 4, 4);
+    }
+    return _mm_loadu_si128((const __m128i *)pixels);
+}
+
+// Bilinear blend of 4 pixels' taps, rounded back to RGBA8888
+VTF_TARGET_SSE2
+static inline __m128i rgba_bilinear_sse2(__m128i p00, __m128i p10, __m128i p01, __m128i p11, __m128 fraction_u, __m128 fraction_v) {
+    __m128i result = _mm_setzero_si128();
+    for (int shift = 0; shift < 32; shift += 8) {
+        __m128 c00 = rgba_channel_sse2(p00, shift);
+        __m128 c01 = rgba_channel_sse2(p01, shift);
+        __m128 top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(rgba_channel_sse2(p10, shift), c00), fraction_u));
+        __m128 bottom = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(rgba_channel_sse2(p11, shift), c01), fraction_u));
+        __m128 value = _mm_add_ps(_mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fraction_v)), _mm_set1_ps(0.5f));
+        result = _mm_or_si128(result, _mm_sll_epi32(_mm_cvttps_epi32(value), _mm_cvtsi32_si128(shift)));
+    }
+    return result;
+}
+
+// a if mask, b otherwise
+VTF_TARGET_SSE2
+static inline __m128i select_epi32_sse2(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// 32-bit multiply without SSE4.1's _mm_mullo_epi32: even and odd lanes through _mm_mul_epu32
+VTF_TARGET_SSE2
+static inline __m128i mullo_epi32_sse2(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// floor() without SSE4.1: truncate, then step down where that rounded up
+VTF_TARGET_SSE2
+static inline __m128i floor_epi32_sse2(__m128 value) {
+    __m128i truncated = _mm_cvttps_epi32(value);
+    return _mm_add_epi32(truncated, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), value)));
+}
+
+// 4 directions at a time; the bilinear taps are gathered one by one, blended 4-wide
+VTF_TARGET_SSE2
+static void equirect_row_sse2(
+    const std::byte *panorama,
+    int width,
+    int height,
+    const float start[3],
+    const float step[3],
+    int count,
+    std::byte *out
+) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i width_vector = _mm_set1_epi32(width);
+    const __m128i last_row = _mm_set1_epi32(height - 1);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 index = _mm_add_ps(_mm_set1_ps((float)i), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+        __m128 x = _mm_add_ps(_mm_set1_ps(start[0]), _mm_mul_ps(index, _mm_set1_ps(step[0])));
+        __m128 y = _mm_add_ps(_mm_set1_ps(start[1]), _mm_mul_ps(index, _mm_set1_ps(step[1])));
+        __m128 z = _mm_add_ps(_mm_set1_ps(start[2]), _mm_mul_ps(index, _mm_set1_ps(step[2])));
+
+        __m128 longitude = equirect_atan2_sse2(y, x);
+        __m128 latitude = equirect_atan2_sse2(z, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y))));
+        __m128 u = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(half, _mm_mul_ps(longitude, _mm_set1_ps(EQUIRECT_INV_2PI))), _mm_set1_ps((float)width)), half);
+        __m128 v = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(half, _mm_mul_ps(latitude, _mm_set1_ps(EQUIRECT_INV_PI))), _mm_set1_ps((float)height)), half);
+
+        __m128i x0 = floor_epi32_sse2(u);
+        __m128i y0 = floor_epi32_sse2(v);
+        __m128 fraction_u = _mm_sub_ps(u, _mm_cvtepi32_ps(x0));
+        __m128 fraction_v = _mm_sub_ps(v, _mm_cvtepi32_ps(y0));
+
+        x0 = _mm_add_epi32(x0, _mm_and_si128(_mm_cmplt_epi32(x0, zero), width_vector));
+        x0 = _mm_sub_epi32(x0, _mm_andnot_si128(_mm_cmplt_epi32(x0, width_vector), width_vector));
+        __m128i x1 = _mm_add_epi32(x0, one);
+        x1 = _mm_andnot_si128(_mm_cmpeq_epi32(x1, width_vector), x1);
+        __m128i y1 = _mm_add_epi32(y0, one);
+        y0 = select_epi32_sse2(_mm_cmplt_epi32(y0, zero), zero, y0);
+        y0 = select_epi32_sse2(_mm_cmpgt_epi32(y0, last_row), last_row, y0);
+        y1 = select_epi32_sse2(_mm_cmplt_epi32(y1, zero), zero, y1);
+        y1 = select_epi32_sse2(_mm_cmpgt_epi32(y1, last_row), last_row, y1);
+
+        __m128i row0 = mullo_epi32_sse2(y0, width_vector);
+        __m128i row1 = mullo_epi32_sse2(y1, width_vector);
+        __m128i p00 = rgba_gather_sse2(panorama, _mm_add_epi32(row0, x0));
+        __m128i p10 = rgba_gather_sse2(panorama, _mm_add_epi32(row0, x1));
+        __m128i p01 = rgba_gather_sse2(panorama, _mm_add_epi32(row1, x0));
+        __m128i p11 = rgba_gather_sse2(panorama, _mm_add_epi32(row1, x1));
+
+        _mm_storeu_si128((__m128i *)(out + (size_t)i * 4), rgba_bilinear_sse2(p00, p10, p01, p11, fraction_u, fraction_v));
+    }
+
+    for (; i < count; i++) {
+        equirect_sample_scalar(panorama, width, height, start, step, i, out);
+    }
+}
+
+VTF_TARGET_AVX2
+static inline __m256 equirect_atan2_avx2(__m256 y, __m256 x) {
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    __m256 abs_x = _mm256_andnot_ps(sign_mask, x);
+    __m256 abs_y = _mm256_andnot_ps(sign_mask, y);
+    __m256 ratio = _mm256_div_ps(_mm256_min_ps(abs_x, abs_y), _mm256_max_ps(_mm256_max_ps(abs_x, abs_y), _mm256_set1_ps(FLT_MIN)));
+    __m256 ratio2 = _mm256_mul_ps(ratio, ratio);
+    __m256 angle = _mm256_add_ps(_mm256_set1_ps(EQUIRECT_ATAN_A9), _mm256_mul_ps(ratio2, _mm256_set1_ps(EQUIRECT_ATAN_A11)));
+    angle = _mm256_add_ps(_mm256_set1_ps(EQUIRECT_ATAN_A7), _mm256_mul_ps(ratio2, angle));
+    angle = _mm256_add_ps(_mm256_set1_ps(EQUIRECT_ATAN_A5), _mm256_mul_ps(ratio2, angle));
+    angle = _mm256_add_ps(_mm256_set1_ps(EQUIRECT_ATAN_A3), _mm256_mul_ps(ratio2, angle));
+    angle = _mm256_add_ps(_mm256_set1_ps(EQUIRECT_ATAN_A1), _mm256_mul_ps(ratio2, angle));
+    angle = _mm256_mul_ps(ratio, angle);
+
+    angle = _mm256_blendv_ps(angle, _mm256_sub_ps(_mm256_set1_ps(EQUIRECT_PI * 0.5f), angle), _mm256_cmp_ps(abs_y, abs_x, _CMP_GT_OQ));
+    angle = _mm256_blendv_ps(angle, _mm256_sub_ps(_mm256_set1_ps(EQUIRECT_PI), angle), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+    return _mm256_or_ps(angle, _mm256_and_ps(sign_mask, y));
+}
+
+VTF_TARGET_AVX2
+static inline __m256 rgba_channel_avx2(__m256i pixels, int shift) {
+    return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, shift), _mm256_set1_epi32(0xFF)));
+}
+
+VTF_TARGET_AVX2
+static inline __m256i rgba_bilinear_avx2(__m256i p00, __m256i p10, __m256i p01, __m256i p11, __m256 fraction_u, __m256 fraction_v) {
+    __m256i result = _mm256_setzero_si256();
+    for (int shift = 0; shift < 32; shift += 8) {
+        __m256 c00 = rgba_channel_avx2(p00, shift);
+        __m256 c01 = rgba_channel_avx2(p01, shift);
+        __m256 top = _mm256_add_ps(c00, _mm256_mul_ps(_mm256_sub_ps(rgba_channel_avx2(p10, shift), c00), fraction_u));
+        __m256 bottom = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_sub_ps(rgba_channel_avx2(p11, shift), c01), fraction_u));
+        __m256 value = _mm256_add_ps(_mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), fraction_v)), _mm256_set1_ps(0.5f));
+        result = _mm256_or_si256(result, _mm256_sll_epi32(_mm256_cvttps_epi32(value), _mm_cvtsi32_si128(shift)));
+    }
+    return result;
+}
+
+// Same as the SSE2 version, 8 directions at a time with hardware gathers
+VTF_TARGET_AVX2
+static void equirect_row_avx2(
+    const std::byte *panorama,
+    int width,
+    int height,
+    const float start[3],
+    const float step[3],
+    int count,
+    std::byte *out
+) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i width_vector = _mm256_set1_epi32(width);
+    const __m256i last_row = _mm256_set1_epi32(height - 1);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const int *pixels = (const int *)panorama;
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 index = _mm256_add_ps(_mm256_set1_ps((float)i), _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f));
+        __m256 x = _mm256_add_ps(_mm256_set1_ps(start[0]), _mm256_mul_ps(index, _mm256_set1_ps(step[0])));
+        __m256 y = _mm256_add_ps(_mm256_set1_ps(start[1]), _mm256_mul_ps(index, _mm256_set1_ps(step[1])));
+        __m256 z = _mm256_add_ps(_mm256_set1_ps(start[2]), _mm256_mul_ps(index, _mm256_set1_ps(step[2])));
+
+        __m256 longitude = equirect_atan2_avx2(y, x);
+        __m256 latitude = equirect_atan2_avx2(z, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y))));
+        __m256 u = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(half, _mm256_mul_ps(longitude, _mm256_set1_ps(EQUIRECT_INV_2PI))), _mm256_set1_ps((float)width)), half);
+        __m256 v = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(half, _mm256_mul_ps(latitude, _mm256_set1_ps(EQUIRECT_INV_PI))), _mm256_set1_ps((float)height)), half);
+
+        __m256 floor_u = _mm256_floor_ps(u);
+        __m256 floor_v = _mm256_floor_ps(v);
+        __m256 fraction_u = _mm256_sub_ps(u, floor_u);
+        __m256 fraction_v = _mm256_sub_ps(v, floor_v);
+        __m256i x0 = _mm256_cvttps_epi32(floor_u);
+        __m256i y0 = _mm256_cvttps_epi32(floor_v);
+
+        x0 = _mm256_add_epi32(x0, _mm256_and_si256(_mm256_cmpgt_epi32(zero, x0), width_vector));
+        x0 = _mm256_sub_epi32(x0, _mm256_andnot_si256(_mm256_cmpgt_epi32(width_vector, x0), width_vector));
+        __m256i x1 = _mm256_add_epi32(x0, one);
+        x1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(x1, width_vector), x1);
+        __m256i y1 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(y0, one), zero), last_row);
+        y0 = _mm256_min_epi32(_mm256_max_epi32(y0, zero), last_row);
+
+        __m256i row0 = _mm256_mullo_epi32(y0, width_vector);
+        __m256i row1 = _mm256_mullo_epi32(y1, width_vector);
+        __m256i p00 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row0, x0), 4);
+        __m256i p10 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row0, x1), 4);
+        __m256i p01 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row1, x0), 4);
+        __m256i p11 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row1, x1), 4);
+
+        _mm256_storeu_si256((__m256i *)(out + (size_t)i * 4), rgba_bilinear_avx2(p00, p10, p01, p11, fraction_u, fraction_v));
+    }
+
+    for (; i < count; i++) {
+        equirect_sample_scalar(panorama, width, height, start, step, i, out);
+    }
+}
+#endif
+
+using EquirectRowKernel = void (*)(const std::byte *, int, int, const float *, const float *, int, std::byte *);
+
+static EquirectRowKernel resolve_equirect_row() {
+#if defined(VTF_CPU_X86)
+    switch (vtf_simd_level()) {
+        case VtfSimdLevel::AVX512:
+        case VtfSimdLevel::AVX2:    return equirect_row_avx2;
+        case VtfSimdLevel::SSE41:
+        case VtfSimdLevel::SSE2:    return equirect_row_sse2;
+        case VtfSimdLevel::SCALAR:  break;
+    }
+#endif
+    return equirect_row_scalar;
+}
+
+void vtf_kernel_equirect_row(
+    const std::byte *panorama,
+    int width,
+    int height,
+    const float start[3],
+    const float step[3],
+    int count,
+    std::byte *out
+) {
+    static const EquirectRowKernel kernel = resolve_equirect_row();
+    kernel(panorama, width, height, start, step, count, out);
+}
+
+//
+// Spheremap from cubemap faces
+//
+
+// Direct3D's cubemap face selection: the face a direction points at (biggest axis), and where
+//  on it, in pixel coordinates with centers at .5
+static inline void cube_coords_scalar(float x, float y, float z, int face_size, int *face, float *u, float *v) {
+    float abs_x = std::fabs(x);
+    float abs_y = std::fabs(y);
+    float abs_z = std::fabs(z);
+    float major, face_s, face_t;
+    if (abs_x >= abs_y && abs_x >= abs_z) {
+        *face = std::signbit(x) ? 1 : 0;
+        major = abs_x;
+        face_s = std::signbit(x) ? z : -z;
+        face_t = -y;
+    } else if (abs_y >= abs_z) {
+        *face = std::signbit(y) ? 3 : 2;
+        major = abs_y;
+        face_s = x;
+        face_t = std::signbit(y) ? -z : z;
+    } else {
+        *face = std::signbit(z) ? 5 : 4;
+        major = abs_z;
+        face_s = std::signbit(z) ? -x : x;
+        face_t = -y;
+    }
+    *u = (face_s / major * 0.5f + 0.5f) * (float)face_size - 0.5f;
+    *v = (face_t / major * 0.5f + 0.5f) * (float)face_size - 0.5f;
+}
+
+static void spheremap_sample_scalar(
+    const std::byte *faces,
+    int face_size,
+    float t,
+    float s_start,
+    float s_step,
+    int index,
+    std::byte *out
+) {
+    // Mirror ball normal, pointing up at the viewer (rim pixels for anything past the edge)
+    float s = s_start + (float)index * s_step;
+    float radius2 = s * s + t * t;
+    float edge_scale = radius2 > 1.0f ? 1.0f / std::sqrt(radius2) : 1.0f;
+    float normal_s = s * edge_scale;
+    float normal_t = t * edge_scale;
+    float normal_z = std::sqrt(std::max(1.0f - (normal_s * normal_s + normal_t * normal_t), 0.0f));
+
+    // The view ray (straight down) reflected off it; image right is +X, image down is -Y
+    float x = 2.0f * normal_z * normal_s;
+    float y = -2.0f * normal_z * normal_t;
+    float z = 2.0f * normal_z * normal_z - 1.0f;
+
+    int face;
+    float u, v;
+    cube_coords_scalar(x, y, z, face_size, &face, &u, &v);
+
+    // Bilinear, clamped to the face's own edges
+    float floor_u = std::floor(u);
+    float floor_v = std::floor(v);
+    float fraction_u = u - floor_u;
+    float fraction_v = v - floor_v;
+    int last = face_size - 1;
+    int x0 = std::min(std::max((int)floor_u, 0), last);
+    int x1 = std::min(std::max((int)floor_u + 1, 0), last);
+    int y0 = std::min(std::max((int)floor_v, 0), last);
+    int y1 = std::min(std::max((int)floor_v + 1, 0), last);
+
+    const uint8_t *pixels = (const uint8_t *)faces + (size_t)face * face_size * face_size * 4;
+    const uint8_t *p00 = pixels + ((size_t)y0 * face_size + x0) * 4;
+    const uint8_t *p10 = pixels + ((size_t)y0 * face_size + x1) * 4;
+    const uint8_t *p01 = pixels + ((size_t)y1 * face_size + x0) * 4;
+    const uint8_t *p11 = pixels + ((size_t)y1 * face_size + x1) * 4;
+    uint8_t *pixel = (uint8_t *)out + (size_t)index * 4;
+    for (int channel = 0; channel < 4; channel++) {
+        float top = p00[channel] + (p10[channel] - p00[channel]) * fraction_u;
+        float bottom = p01[channel] + (p11[channel] - p01[channel]) * fraction_u;
+        pixel[channel] = (uint8_t)(top + (bottom - top) * fraction_v + 0.5f);
+    }
+}
+
+static void spheremap_row_scalar(
+    const std::byte *faces,
+    int face_size,
+    float t,
+    float s_start,
+    float s_step,
+    int count,
+    std::byte *out
+) {
+    for (int i = 0; i < count; i++) {
+        spheremap_sample_scalar(faces, face_size, t, s_start, s_step, i, out);
+    }
+}
+
+#if defined(VTF_CPU_X86)
+// cube_coords_scalar(), 4 directions at a time. Face selection is done with masks, so every
+//  lane takes every branch.
+VTF_TARGET_SSE2
+static inline void cube_coords_sse2(__m128 x, __m128 y, __m128 z, __m128 size, __m128i *face_out, __m128 *u_out, __m128 *v_out) {
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 abs_x = _mm_andnot_ps(sign_mask, x);
+    __m128 abs_y = _mm_andnot_ps(sign_mask, y);
+    __m128 abs_z = _mm_andnot_ps(sign_mask, z);
+    __m128 major_x = _mm_and_ps(_mm_cmpge_ps(abs_x, abs_y), _mm_cmpge_ps(abs_x, abs_z));
+    __m128 major_y = _mm_andnot_ps(major_x, _mm_cmpge_ps(abs_y, abs_z));
+    __m128 major_z = _mm_andnot_ps(_mm_or_ps(major_x, major_y), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+    __m128 sign_x = _mm_and_ps(sign_mask, x);
+    __m128 sign_y = _mm_and_ps(sign_mask, y);
+    __m128 sign_z = _mm_and_ps(sign_mask, z);
+
+    __m128 major = _mm_or_ps(_mm_or_ps(_mm_and_ps(major_x, abs_x), _mm_and_ps(major_y, abs_y)), _mm_and_ps(major_z, abs_z));
+    __m128 face_s = _mm_or_ps(
+        _mm_or_ps(_mm_and_ps(major_x, _mm_xor_ps(_mm_xor_ps(z, sign_mask), sign_x)), _mm_and_ps(major_y, x)),
+        _mm_and_ps(major_z, _mm_xor_ps(x, sign_z))
+    );
+    __m128 face_t = _mm_or_ps(
+        _mm_and_ps(major_y, _mm_xor_ps(z, sign_y)),
+        _mm_andnot_ps(major_y, _mm_xor_ps(y, sign_mask))
+    );
+    *face_out = _mm_or_si128(
+        _mm_or_si128(
+            _mm_and_si128(_mm_castps_si128(major_x), _mm_srli_epi32(_mm_castps_si128(sign_x), 31)),
+            _mm_and_si128(_mm_castps_si128(major_y), _mm_add_epi32(_mm_set1_epi32(2), _mm_srli_epi32(_mm_castps_si128(sign_y), 31)))
+        ),
+        _mm_and_si128(_mm_castps_si128(major_z), _mm_add_epi32(_mm_set1_epi32(4), _mm_srli_epi32(_mm_castps_si128(sign_z), 31)))
+    );
+
+    *u_out = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_div_ps(face_s, major), half), half), size), half);
+    *v_out = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_div_ps(face_t, major), half), half), size), half);
+}
+
+// 4 pixels at a time
+VTF_TARGET_SSE2
+static void spheremap_row_sse2(
+    const std::byte *faces,
+    int face_size,
+    float t,
+    float s_start,
+    float s_step,
+    int count,
+    std::byte *out
+) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 size = _mm_set1_ps((float)face_size);
+    const __m128 t_vector = _mm_set1_ps(t);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i last = _mm_set1_epi32(face_size - 1);
+    const __m128i size_vector = _mm_set1_epi32(face_size);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 index = _mm_add_ps(_mm_set1_ps((float)i), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+        __m128 s = _mm_add_ps(_mm_set1_ps(s_start), _mm_mul_ps(index, _mm_set1_ps(s_step)));
+        __m128 radius2 = _mm_add_ps(_mm_mul_ps(s, s), _mm_mul_ps(t_vector, t_vector));
+        __m128 outside = _mm_cmpgt_ps(radius2, one);
+        __m128 edge_scale = _mm_or_ps(_mm_and_ps(outside, _mm_div_ps(one, _mm_sqrt_ps(radius2))), _mm_andnot_ps(outside, one));
+        __m128 normal_s = _mm_mul_ps(s, edge_scale);
+        __m128 normal_t = _mm_mul_ps(t_vector, edge_scale);
+        __m128 normal_z = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_add_ps(_mm_mul_ps(normal_s, normal_s), _mm_mul_ps(normal_t, normal_t))), _mm_setzero_ps()));
+
+        __m128 x = _mm_mul_ps(_mm_mul_ps(two, normal_z), normal_s);
+        __m128 y = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(-2.0f), normal_z), normal_t);
+        __m128 z = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(two, normal_z), normal_z), one);
+
+        __m128i face;
+        __m128 u, v;
+        cube_coords_sse2(x, y, z, size, &face, &u, &v);
+        __m128i x0 = floor_epi32_sse2(u);
+        __m128i y0 = floor_epi32_sse2(v);
+        __m128 fraction_u = _mm_sub_ps(u, _mm_cvtepi32_ps(x0));
+        __m128 fraction_v = _mm_sub_ps(v, _mm_cvtepi32_ps(y0));
+        __m128i x1 = _mm_add_epi32(x0, _mm_set1_epi32(1));
+        __m128i y1 = _mm_add_epi32(y0, _mm_set1_epi32(1));
+        x0 = select_epi32_sse2(_mm_cmplt_epi32(x0, zero), zero, select_epi32_sse2(_mm_cmpgt_epi32(x0, last), last, x0));
+        x1 = select_epi32_sse2(_mm_cmplt_epi32(x1, zero), zero, select_epi32_sse2(_mm_cmpgt_epi32(x1, last), last, x1));
+        y0 = select_epi32_sse2(_mm_cmplt_epi32(y0, zero), zero, select_epi32_sse2(_mm_cmpgt_epi32(y0, last), last, y0));
+        y1 = select_epi32_sse2(_mm_cmplt_epi32(y1, zero), zero, select_epi32_sse2(_mm_cmpgt_epi32(y1, last), last, y1));
+
+        __m128i face_base = mullo_epi32_sse2(mullo_epi32_sse2(face, size_vector), size_vector);
+        __m128i row0 = _mm_add_epi32(face_base, mullo_epi32_sse2(y0, size_vector));
+        __m128i row1 = _mm_add_epi32(face_base, mullo_epi32_sse2(y1, size_vector));
+        __m128i p00 = rgba_gather_sse2(faces, _mm_add_epi32(row0, x0));
+        __m128i p10 = rgba_gather_sse2(faces, _mm_add_epi32(row0, x1));
+        __m128i p01 = rgba_gather_sse2(faces, _mm_add_epi32(row1, x0));
+        __m128i p11 = rgba_gather_sse2(faces, _mm_add_epi32(row1, x1));
+        _mm_storeu_si128((__m128i *)(out + (size_t)i * 4), rgba_bilinear_sse2(p00, p10, p01, p11, fraction_u, fraction_v));
+    }
+
+    for (; i < count; i++) {
+        spheremap_sample_scalar(faces, face_size, t, s_start, s_step, i, out);
+    }
+}
+
+VTF_TARGET_AVX2
+static inline void cube_coords_avx2(__m256 x, __m256 y, __m256 z, __m256 size, __m256i *face_out, __m256 *u_out, __m256 *v_out) {
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    __m256 abs_x = _mm256_andnot_ps(sign_mask, x);
+    __m256 abs_y = _mm256_andnot_ps(sign_mask, y);
+    __m256 abs_z = _mm256_andnot_ps(sign_mask, z);
+    __m256 major_x = _mm256_and_ps(_mm256_cmp_ps(abs_x, abs_y, _CMP_GE_OQ), _mm256_cmp_ps(abs_x, abs_z, _CMP_GE_OQ));
+    __m256 major_y = _mm256_andnot_ps(major_x, _mm256_cmp_ps(abs_y, abs_z, _CMP_GE_OQ));
+    __m256 sign_x = _mm256_and_ps(sign_mask, x);
+    __m256 sign_y = _mm256_and_ps(sign_mask, y);
+    __m256 sign_z = _mm256_and_ps(sign_mask, z);
+
+    __m256 major = _mm256_blendv_ps(_mm256_blendv_ps(abs_z, abs_y, major_y), abs_x, major_x);
+    __m256 face_s = _mm256_blendv_ps(
+        _mm256_blendv_ps(_mm256_xor_ps(x, sign_z), x, major_y),
+        _mm256_xor_ps(_mm256_xor_ps(z, sign_mask), sign_x),
+        major_x
+    );
+    __m256 face_t = _mm256_blendv_ps(_mm256_xor_ps(y, sign_mask), _mm256_xor_ps(z, sign_y), major_y);
+    *face_out = _mm256_blendv_epi8(
+        _mm256_blendv_epi8(
+            _mm256_add_epi32(_mm256_set1_epi32(4), _mm256_srli_epi32(_mm256_castps_si256(sign_z), 31)),
+            _mm256_add_epi32(_mm256_set1_epi32(2), _mm256_srli_epi32(_mm256_castps_si256(sign_y), 31)),
+            _mm256_castps_si256(major_y)
+        ),
+        _mm256_srli_epi32(_mm256_castps_si256(sign_x), 31),
+        _mm256_castps_si256(major_x)
+    );
+
+    *u_out = _mm256_sub_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(face_s, major), half), half), size), half);
+    *v_out = _mm256_sub_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(face_t, major), half), half), size), half);
+}
+
+// Same as the SSE2 version, 8 pixels at a time with hardware gathers
+VTF_TARGET_AVX2
+static void spheremap_row_avx2(
+    const std::byte *faces,
+    int face_size,
+    float t,
+    float s_start,
+    float s_step,
+    int count,
+    std::byte *out
+) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 size = _mm256_set1_ps((float)face_size);
+    const __m256 t_vector = _mm256_set1_ps(t);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i last = _mm256_set1_epi32(face_size - 1);
+    const __m256i size_vector = _mm256_set1_epi32(face_size);
+    const int *pixels = (const int *)faces;
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 index = _mm256_add_ps(_mm256_set1_ps((float)i), _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f));
+        __m256 s = _mm256_add_ps(_mm256_set1_ps(s_start), _mm256_mul_ps(index, _mm256_set1_ps(s_step)));
+        __m256 radius2 = _mm256_add_ps(_mm256_mul_ps(s, s), _mm256_mul_ps(t_vector, t_vector));
+        __m256 edge_scale = _mm256_blendv_ps(one, _mm256_div_ps(one, _mm256_sqrt_ps(radius2)), _mm256_cmp_ps(radius2, one, _CMP_GT_OQ));
+        __m256 normal_s = _mm256_mul_ps(s, edge_scale);
+        __m256 normal_t = _mm256_mul_ps(t_vector, edge_scale);
+        __m256 normal_z = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(one, _mm256_add_ps(_mm256_mul_ps(normal_s, normal_s), _mm256_mul_ps(normal_t, normal_t))), _mm256_setzero_ps()));
+
+        __m256 x = _mm256_mul_ps(_mm256_mul_ps(two, normal_z), normal_s);
+        __m256 y = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(-2.0f), normal_z), normal_t);
+        __m256 z = _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(two, normal_z), normal_z), one);
+
+        __m256i face;
+        __m256 u, v;
+        cube_coords_avx2(x, y, z, size, &face, &u, &v);
+        __m256 floor_u = _mm256_floor_ps(u);
+        __m256 floor_v = _mm256_floor_ps(v);
+        __m256 fraction_u = _mm256_sub_ps(u, floor_u);
+        __m256 fraction_v = _mm256_sub_ps(v, floor_v);
+        __m256i x0 = _mm256_cvttps_epi32(floor_u);
+        __m256i y0 = _mm256_cvttps_epi32(floor_v);
+        __m256i x1 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(x0, _mm256_set1_epi32(1)), zero), last);
+        __m256i y1 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(y0, _mm256_set1_epi32(1)), zero), last);
+        x0 = _mm256_min_epi32(_mm256_max_epi32(x0, zero), last);
+        y0 = _mm256_min_epi32(_mm256_max_epi32(y0, zero), last);
+
+        __m256i face_base = _mm256_mullo_epi32(_mm256_mullo_epi32(face, size_vector), size_vector);
+        __m256i row0 = _mm256_add_epi32(face_base, _mm256_mullo_epi32(y0, size_vector));
+        __m256i row1 = _mm256_add_epi32(face_base, _mm256_mullo_epi32(y1, size_vector));
+        __m256i p00 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row0, x0), 4);
+        __m256i p10 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row0, x1), 4);
+        __m256i p01 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row1, x0), 4);
+        __m256i p11 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row1, x1), 4);
+        _mm256_storeu_si256((__m256i *)(out + (size_t)i * 4), rgba_bilinear_avx2(p00, p10, p01, p11, fraction_u, fraction_v));
+    }
+
+    for (; i < count; i++) {
+        spheremap_sample_scalar(faces, face_size, t, s_start, s_step, i, out);
+    }
+}
+#endif
+
+using SpheremapRowKernel = void (*)(const std::byte *, int, float, float, float, int, std::byte *);
+
+static SpheremapRowKernel resolve_spheremap_row() {
+#if defined(VTF_CPU_X86)
+    switch (vtf_simd_level()) {
+        case VtfSimdLevel::AVX512:
+        case VtfSimdLevel::AVX2:    return spheremap_row_avx2;
+        case VtfSimdLevel::SSE41:
+        case VtfSimdLevel::SSE2:    return spheremap_row_sse2;
+        case VtfSimdLevel::SCALAR:  break;
+    }
+#endif
+    return spheremap_row_scalar;
+}
+
+void vtf_kernel_spheremap_row(
+    const std::byte *faces,
+    int face_size,
+    float t,
+    float s_start,
+    float s_step,
+    int count,
+    std::byte *out
+) {
+    static const SpheremapRowKernel kernel = resolve_spheremap_row();
+    kernel(faces, face_size, t, s_start, s_step, count, out);
+}
+
+//
+// Cubemap prefiltering
+//
+
+// sRGB <-> linear light. Linear values are looked up in PREFILTER_LINEAR_STEPS steps, which is
+//  finer than 8-bit sRGB everywhere but the very darkest values.
+#define PREFILTER_LINEAR_STEPS 4096
+
+struct PrefilterTables {
+    float srgb_to_linear[256];
+    // int32, not uint8_t, so AVX2 can gather from it
+    int32_t linear_to_srgb[PREFILTER_LINEAR_STEPS + 1];
+
+    PrefilterTables() {
+        for (int i = 0; i < 256; i++) {
+            float value = (float)i / 255.0f;
+            srgb_to_linear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i <= PREFILTER_LINEAR_STEPS; i++) {
+            float value = (float)i / (float)PREFILTER_LINEAR_STEPS;
+            float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+            linear_to_srgb[i] = (int32_t)(srgb * 255.0f + 0.5f);
+        }
+    }
+};
+
+static const PrefilterTables &prefilter_tables() {
+    static const PrefilterTables tables;
+    return tables;
+}
+
+static inline uint8_t prefilter_to_srgb(const PrefilterTables &tables, float linear) {
+    float clamped = std::min(std::max(linear, 0.0f), 1.0f);
+    return (uint8_t)tables.linear_to_srgb[(int)(clamped * (float)PREFILTER_LINEAR_STEPS + 0.5f)];
+}
+
+static void prefilter_pixel_scalar(
+    const PrefilterTables &tables,
+    const VtfCubemapMip *mips,
+    const VtfPrefilterSample *samples,
+    int sample_count,
+    const float start[3],
+    const float step[3],
+    int index,
+    std::byte *out
+) {
+    // Normal, and a tangent frame around it (any will do, the lobe is round)
+    float normal_x = start[0] + (float)index * step[0];
+    float normal_y = start[1] + (float)index * step[1];
+    float normal_z = start[2] + (float)index * step[2];
+    float normal_scale = 1.0f / std::sqrt(normal_x * normal_x + normal_y * normal_y + normal_z * normal_z);
+    normal_x *= normal_scale;
+    normal_y *= normal_scale;
+    normal_z *= normal_scale;
+    // up x normal, with up = +Z unless the normal is too close to it, then +X
+    bool near_pole = std::fabs(normal_z) >= 0.999f;
+    float tangent_x = near_pole ? 0.0f : -normal_y;
+    float tangent_y = near_pole ? -normal_z : normal_x;
+    float tangent_z = near_pole ? normal_y : 0.0f;
+    float tangent_scale = 1.0f / std::sqrt(tangent_x * tangent_x + tangent_y * tangent_y + tangent_z * tangent_z);
+    tangent_x *= tangent_scale;
+    tangent_y *= tangent_scale;
+    tangent_z *= tangent_scale;
+    float bitangent_x = normal_y * tangent_z - normal_z * tangent_y;
+    float bitangent_y = normal_z * tangent_x - normal_x * tangent_z;
+    float bitangent_z = normal_x * tangent_y - normal_y * tangent_x;
+
+    float sum[4] = {};
+    for (int sample_index = 0; sample_index < sample_count; sample_index++) {
+        const VtfPrefilterSample &sample = samples[sample_index];
+        const VtfCubemapMip &mip = mips[sample.mip];
+        float x = sample.direction[0] * tangent_x + sample.direction[1] * bitangent_x + sample.direction[2] * normal_x;
+        float y = sample.direction[0] * tangent_y + sample.direction[1] * bitangent_y + sample.direction[2] * normal_y;
+        float z = sample.direction[0] * tangent_z + sample.direction[1] * bitangent_z + sample.direction[2] * normal_z;
+
+        int face;
+        float u, v;
+        cube_coords_scalar(x, y, z, mip.size, &face, &u, &v);
+        float floor_u = std::floor(u);
+        float floor_v = std::floor(v);
+        float fraction_u = u - floor_u;
+        float fraction_v = v - floor_v;
+        int last = mip.size - 1;
+        int x0 = std::min(std::max((int)floor_u, 0), last);
+        int x1 = std::min(std::max((int)floor_u + 1, 0), last);
+        int y0 = std::min(std::max((int)floor_v, 0), last);
+        int y1 = std::min(std::max((int)floor_v + 1, 0), last);
+
+        const uint8_t *pixels = (const uint8_t *)mip.faces + (size_t)face * mip.size * mip.size * 4;
+        const uint8_t *p00 = pixels + ((size_t)y0 * mip.size + x0) * 4;
+        const uint8_t *p10 = pixels + ((size_t)y0 * mip.size + x1) * 4;
+        const uint8_t *p01 = pixels + ((size_t)y1 * mip.size + x0) * 4;
+        const uint8_t *p11 = pixels + ((size_t)y1 * mip.size + x1) * 4;
+        for (int channel = 0; channel < 4; channel++) {
+            float c00, c10, c01, c11;
+            if (channel < 3) {
+                c00 = tables.srgb_to_linear[p00[channel]];
+                c10 = tables.srgb_to_linear[p10[channel]];
+                c01 = tables.srgb_to_linear[p01[channel]];
+                c11 = tables.srgb_to_linear[p11[channel]];
+            } else {
+                c00 = (float)p00[channel] * (1.0f / 255.0f);
+                c10 = (float)p10[channel] * (1.0f / 255.0f);
+                c01 = (float)p01[channel] * (1.0f / 255.0f);
+                c11 = (float)p11[channel] * (1.0f / 255.0f);
+            }
+            float top = c00 + (c10 - c00) * fraction_u;
+            float bottom = c01 + (c11 - c01) * fraction_u;
+            sum[channel] += (top + (bottom - top) * fraction_v) * sample.weight;
+        }
+    }
+
+    uint8_t *pixel = (uint8_t *)out + (size_t)index * 4;
+    pixel[0] = prefilter_to_srgb(tables, sum[0]);
+    pixel[1] = prefilter_to_srgb(tables, sum[1]);
+    pixel[2] = prefilter_to_srgb(tables, sum[2]);
+    pixel[3] = (uint8_t)(std::min(std::max(sum[3], 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+static void prefilter_row_scalar(
+    const VtfCubemapMip *mips,
+    const VtfPrefilterSample *samples,
+    int sample_count,
+    const float start[3],
+    const float step[3],
+    int count,
+    std::byte *out
+) {
+    const PrefilterTables &tables = prefilter_tables();
+    for (int i = 0; i < count; i++) {
+        prefilter_pixel_scalar(tables, mips, samples, sample_count, start, step, i, out);
+    }
+}
+
+#if defined(VTF_CPU_X86)
+// One channel of 4 gathered pixels, through the sRGB to linear table
+VTF_TARGET_SSE2
+static inline __m128 prefilter_linear_sse2(const PrefilterTables &tables, __m128i pixels, int shift) {
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128((__m128i *)lanes, _mm_and_si128(_mm_srli_epi32(pixels, shift), _mm_set1_epi32(0xFF)));
+    return _mm_setr_ps(
+        tables.srgb_to_linear[lanes[0]],
+        tables.srgb_to_linear[lanes[1]],
+        tables.srgb_to_linear[lanes[2]],
+        tables.srgb_to_linear[lanes[3]]
+    );
+}
+
+// 4 output pixels at a time, every sample shared across the lanes (each lane has its own
+//  tangent frame, but the samples' tangent-space directions, weights and mips are the same)
+VTF_TARGET_SSE2
+static void prefilter_row_sse2(
+    const VtfCubemapMip *mips,
+    const VtfPrefilterSample *samples,
+    int sample_count,
+    const float start[3],
+    const float step[3],
+    int count,
+    std::byte *out
+) {
+    const PrefilterTables &tables = prefilter_tables();
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero_float = _mm_setzero_ps();
+    const __m128i zero = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 index = _mm_add_ps(_mm_set1_ps((float)i), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+        __m128 normal_x = _mm_add_ps(_mm_set1_ps(start[0]), _mm_mul_ps(index, _mm_set1_ps(step[0])));
+        __m128 normal_y = _mm_add_ps(_mm_set1_ps(start[1]), _mm_mul_ps(index, _mm_set1_ps(step[1])));
+        __m128 normal_z = _mm_add_ps(_mm_set1_ps(start[2]), _mm_mul_ps(index, _mm_set1_ps(step[2])));
+        __m128 normal_scale = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normal_x, normal_x), _mm_mul_ps(normal_y, normal_y)), _mm_mul_ps(normal_z, normal_z))));
+        normal_x = _mm_mul_ps(normal_x, normal_scale);
+        normal_y = _mm_mul_ps(normal_y, normal_scale);
+        normal_z = _mm_mul_ps(normal_z, normal_scale);
+
+        __m128 near_pole = _mm_cmpge_ps(_mm_andnot_ps(sign_mask, normal_z), _mm_set1_ps(0.999f));
+        __m128 tangent_x = _mm_andnot_ps(near_pole, _mm_xor_ps(normal_y, sign_mask));
+        __m128 tangent_y = _mm_or_ps(_mm_and_ps(near_pole, _mm_xor_ps(normal_z, sign_mask)), _mm_andnot_ps(near_pole, normal_x));
+        __m128 tangent_z = _mm_and_ps(near_pole, normal_y);
+        __m128 tangent_scale = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tangent_x, tangent_x), _mm_mul_ps(tangent_y, tangent_y)), _mm_mul_ps(tangent_z, tangent_z))));
+        tangent_x = _mm_mul_ps(tangent_x, tangent_scale);
+        tangent_y = _mm_mul_ps(tangent_y, tangent_scale);
+        tangent_z = _mm_mul_ps(tangent_z, tangent_scale);
+        __m128 bitangent_x = _mm_sub_ps(_mm_mul_ps(normal_y, tangent_z), _mm_mul_ps(normal_z, tangent_y));
+        __m128 bitangent_y = _mm_sub_ps(_mm_mul_ps(normal_z, tangent_x), _mm_mul_ps(normal_x, tangent_z));
+        __m128 bitangent_z = _mm_sub_ps(_mm_mul_ps(normal_x, tangent_y), _mm_mul_ps(normal_y, tangent_x));
+
+        __m128 sum[4] = { zero_float, zero_float, zero_float, zero_float };
+        for (int sample_index = 0; sample_index < sample_count; sample_index++) {
+            const VtfPrefilterSample &sample = samples[sample_index];
+            const VtfCubemapMip &mip = mips[sample.mip];
+            __m128 direction_t = _mm_set1_ps(sample.direction[0]);
+            __m128 direction_b = _mm_set1_ps(sample.direction[1]);
+            __m128 direction_n = _mm_set1_ps(sample.direction[2]);
+            __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(direction_t, tangent_x), _mm_mul_ps(direction_b, bitangent_x)), _mm_mul_ps(direction_n, normal_x));
+            __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(direction_t, tangent_y), _mm_mul_ps(direction_b, bitangent_y)), _mm_mul_ps(direction_n, normal_y));
+            __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(direction_t, tangent_z), _mm_mul_ps(direction_b, bitangent_z)), _mm_mul_ps(direction_n, normal_z));
+
+            __m128i face;
+            __m128 u, v;
+            cube_coords_sse2(x, y, z, _mm_set1_ps((float)mip.size), &face, &u, &v);
+            __m128i x0 = floor_epi32_sse2(u);
+            __m128i y0 = floor_epi32_sse2(v);
+            __m128 fraction_u = _mm_sub_ps(u, _mm_cvtepi32_ps(x0));
+            __m128 fraction_v = _mm_sub_ps(v, _mm_cvtepi32_ps(y0));
+            __m128i last = _mm_set1_epi32(mip.size - 1);
+            __m128i x1 = _mm_add_epi32(x0, _mm_set1_epi32(1));
+            __m128i y1 = _mm_add_epi32(y0, _mm_set1_epi32(1));
+            x0 = select_epi32_sse2(_mm_cmplt_epi32(x0, zero), zero, select_epi32_sse2(_mm_cmpgt_epi32(x0, last), last, x0));
+            x1 = select_epi32_sse2(_mm_cmplt_epi32(x1, zero), zero, select_epi32_sse2(_mm_cmpgt_epi32(x1, last), last, x1));
+            y0 = select_epi32_sse2(_mm_cmplt_epi32(y0, zero), zero, select_epi32_sse2(_mm_cmpgt_epi32(y0, last), last, y0));
+            y1 = select_epi32_sse2(_mm_cmplt_epi32(y1, zero), zero, select_epi32_sse2(_mm_cmpgt_epi32(y1, last), last, y1));
+
+            __m128i size_vector = _mm_set1_epi32(mip.size);
+            __m128i face_base = mullo_epi32_sse2(mullo_epi32_sse2(face, size_vector), size_vector);
+            __m128i row0 = _mm_add_epi32(face_base, mullo_epi32_sse2(y0, size_vector));
+            __m128i row1 = _mm_add_epi32(face_base, mullo_epi32_sse2(y1, size_vector));
+            __m128i p00 = rgba_gather_sse2(mip.faces, _mm_add_epi32(row0, x0));
+            __m128i p10 = rgba_gather_sse2(mip.faces, _mm_add_epi32(row0, x1));
+            __m128i p01 = rgba_gather_sse2(mip.faces, _mm_add_epi32(row1, x0));
+            __m128i p11 = rgba_gather_sse2(mip.faces, _mm_add_epi32(row1, x1));
+
+            __m128 weight = _mm_set1_ps(sample.weight);
+            for (int channel = 0; channel < 4; channel++) {
+                int shift = channel * 8;
+                __m128 c00, c10, c01, c11;
+                if (channel < 3) {
+                    c00 = prefilter_linear_sse2(tables, p00, shift);
+                    c10 = prefilter_linear_sse2(tables, p10, shift);
+                    c01 = prefilter_linear_sse2(tables, p01, shift);
+                    c11 = prefilter_linear_sse2(tables, p11, shift);
+                } else {
+                    __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+                    c00 = _mm_mul_ps(rgba_channel_sse2(p00, shift), scale);
+                    c10 = _mm_mul_ps(rgba_channel_sse2(p10, shift), scale);
+                    c01 = _mm_mul_ps(rgba_channel_sse2(p01, shift), scale);
+                    c11 = _mm_mul_ps(rgba_channel_sse2(p11, shift), scale);
+                }
+                __m128 top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), fraction_u));
+                __m128 bottom = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), fraction_u));
+                sum[channel] = _mm_add_ps(sum[channel], _mm_mul_ps(_mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fraction_v)), weight));
+            }
+        }
+
+        alignas(16) float channels[4][4];
+        for (int channel = 0; channel < 4; channel++) {
+            _mm_store_ps(channels[channel], sum[channel]);
+        }
+        for (int lane = 0; lane < 4; lane++) {
+            uint8_t *pixel = (uint8_t *)out + (size_t)(i + lane) * 4;
+            pixel[0] = prefilter_to_srgb(tables, channels[0][lane]);
+            pixel[1] = prefilter_to_srgb(tables, channels[1][lane]);
+            pixel[2] = prefilter_to_srgb(tables, channels[2][lane]);
+            pixel[3] = (uint8_t)(std::min(std::max(channels[3][lane], 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+
+    for (; i < count; i++) {
+        prefilter_pixel_scalar(tables, mips, samples, sample_count, start, step, i, out);
+    }
+}
+
+// Same as the SSE2 version, 8 pixels at a time with hardware gathers for the taps and tables
+VTF_TARGET_AVX2
+static void prefilter_row_avx2(
+    const VtfCubemapMip *mips,
+    const VtfPrefilterSample *samples,
+    int sample_count,
+    const float start[3],
+    const float step[3],
+    int count,
+    std::byte *out
+) {
+    const PrefilterTables &tables = prefilter_tables();
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero_float = _mm256_setzero_ps();
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 index = _mm256_add_ps(_mm256_set1_ps((float)i), _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f));
+        __m256 normal_x = _mm256_add_ps(_mm256_set1_ps(start[0]), _mm256_mul_ps(index, _mm256_set1_ps(step[0])));
+        __m256 normal_y = _mm256_add_ps(_mm256_set1_ps(start[1]), _mm256_mul_ps(index, _mm256_set1_ps(step[1])));
+        __m256 normal_z = _mm256_add_ps(_mm256_set1_ps(start[2]), _mm256_mul_ps(index, _mm256_set1_ps(step[2])));
+        __m256 normal_scale = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normal_x, normal_x), _mm256_mul_ps(normal_y, normal_y)), _mm256_mul_ps(normal_z, normal_z))));
+        normal_x = _mm256_mul_ps(normal_x, normal_scale);
+        normal_y = _mm256_mul_ps(normal_y, normal_scale);
+        normal_z = _mm256_mul_ps(normal_z, normal_scale);
+
+        __m256 near_pole = _mm256_cmp_ps(_mm256_andnot_ps(sign_mask, normal_z), _mm256_set1_ps(0.999f), _CMP_GE_OQ);
+        __m256 tangent_x = _mm256_andnot_ps(near_pole, _mm256_xor_ps(normal_y, sign_mask));
+        __m256 tangent_y = _mm256_blendv_ps(normal_x, _mm256_xor_ps(normal_z, sign_mask), near_pole);
+        __m256 tangent_z = _mm256_and_ps(near_pole, normal_y);
+        __m256 tangent_scale = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tangent_x, tangent_x), _mm256_mul_ps(tangent_y, tangent_y)), _mm256_mul_ps(tangent_z, tangent_z))));
+        tangent_x = _mm256_mul_ps(tangent_x, tangent_scale);
+        tangent_y = _mm256_mul_ps(tangent_y, tangent_scale);
+        tangent_z = _mm256_mul_ps(tangent_z, tangent_scale);
+        __m256 bitangent_x = _mm256_sub_ps(_mm256_mul_ps(normal_y, tangent_z), _mm256_mul_ps(normal_z, tangent_y));
+        __m256 bitangent_y = _mm256_sub_ps(_mm256_mul_ps(normal_z, tangent_x), _mm256_mul_ps(normal_x, tangent_z));
+        __m256 bitangent_z = _mm256_sub_ps(_mm256_mul_ps(normal_x, tangent_y), _mm256_mul_ps(normal_y, tangent_x));
+
+        __m256 sum[4] = { zero_float, zero_float, zero_float, zero_float };
+        for (int sample_index = 0; sample_index < sample_count; sample_index++) {
+            const VtfPrefilterSample &sample = samples[sample_index];
+            const VtfCubemapMip &mip = mips[sample.mip];
+            __m256 direction_t = _mm256_set1_ps(sample.direction[0]);
+            __m256 direction_b = _mm256_set1_ps(sample.direction[1]);
+            __m256 direction_n = _mm256_set1_ps(sample.direction[2]);
+            __m256 x = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(direction_t, tangent_x), _mm256_mul_ps(direction_b, bitangent_x)), _mm256_mul_ps(direction_n, normal_x));
+            __m256 y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(direction_t, tangent_y), _mm256_mul_ps(direction_b, bitangent_y)), _mm256_mul_ps(direction_n, normal_y));
+            __m256 z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(direction_t, tangent_z), _mm256_mul_ps(direction_b, bitangent_z)), _mm256_mul_ps(direction_n, normal_z));
+
+            __m256i face;
+            __m256 u, v;
+            cube_coords_avx2(x, y, z, _mm256_set1_ps((float)mip.size), &face, &u, &v);
+            __m256 floor_u = _mm256_floor_ps(u);
+            __m256 floor_v = _mm256_floor_ps(v);
+            __m256 fraction_u = _mm256_sub_ps(u, floor_u);
+            __m256 fraction_v = _mm256_sub_ps(v, floor_v);
+            __m256i last = _mm256_set1_epi32(mip.size - 1);
+            __m256i x0 = _mm256_cvttps_epi32(floor_u);
+            __m256i y0 = _mm256_cvttps_epi32(floor_v);
+            __m256i x1 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(x0, _mm256_set1_epi32(1)), zero), last);
+            __m256i y1 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(y0, _mm256_set1_epi32(1)), zero), last);
+            x0 = _mm256_min_epi32(_mm256_max_epi32(x0, zero), last);
+            y0 = _mm256_min_epi32(_mm256_max_epi32(y0, zero), last);
+
+            __m256i size_vector = _mm256_set1_epi32(mip.size);
+            __m256i face_base = _mm256_mullo_epi32(_mm256_mullo_epi32(face, size_vector), size_vector);
+            __m256i row0 = _mm256_add_epi32(face_base, _mm256_mullo_epi32(y0, size_vector));
+            __m256i row1 = _mm256_add_epi32(face_base, _mm256_mullo_epi32(y1, size_vector));
+            const int *pixels = (const int *)mip.faces;
+            __m256i p00 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row0, x0), 4);
+            __m256i p10 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row0, x1), 4);
+            __m256i p01 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row1, x0), 4);
+            __m256i p11 = _mm256_i32gather_epi32(pixels, _mm256_add_epi32(row1, x1), 4);
+
+            __m256 weight = _mm256_set1_ps(sample.weight);
+            for (int channel = 0; channel < 4; channel++) {
+                int shift = channel * 8;
+                __m256 c00, c10, c01, c11;
+                if (channel < 3) {
+                    c00 = _mm256_i32gather_ps(tables.srgb_to_linear, _mm256_and_si256(_mm256_srli_epi32(p00, shift), byte_mask), 4);
+                    c10 = _mm256_i32gather_ps(tables.srgb_to_linear, _mm256_and_si256(_mm256_srli_epi32(p10, shift), byte_mask), 4);
+                    c01 = _mm256_i32gather_ps(tables.srgb_to_linear, _mm256_and_si256(_mm256_srli_epi32(p01, shift), byte_mask), 4);
+                    c11 = _mm256_i32gather_ps(tables.srgb_to_linear, _mm256_and_si256(_mm256_srli_epi32(p11, shift), byte_mask), 4);
+                } else {
+                    __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+                    c00 = _mm256_mul_ps(rgba_channel_avx2(p00, shift), scale);
+                    c10 = _mm256_mul_ps(rgba_channel_avx2(p10, shift), scale);
+                    c01 = _mm256_mul_ps(rgba_channel_avx2(p01, shift), scale);
+                    c11 = _mm256_mul_ps(rgba_channel_avx2(p11, shift), scale);
+                }
+                __m256 top = _mm256_add_ps(c00, _mm256_mul_ps(_mm256_sub_ps(c10, c00), fraction_u));
+                __m256 bottom = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_sub_ps(c11, c01), fraction_u));
+                sum[channel] = _mm256_add_ps(sum[channel], _mm256_mul_ps(_mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), fraction_v)), weight));
+            }
+        }
+
+        // Back to sRGB through the table, 8 lanes at once
+        __m256 steps = _mm256_set1_ps((float)PREFILTER_LINEAR_STEPS);
+        __m256i result = _mm256_setzero_si256();
+        for (int channel = 0; channel < 4; channel++) {
+            __m256 clamped = _mm256_min_ps(_mm256_max_ps(sum[channel], zero_float), one);
+            __m256i value;
+            if (channel < 3) {
+                __m256i table_index = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, steps), _mm256_set1_ps(0.5f)));
+                value = _mm256_i32gather_epi32(tables.linear_to_srgb, table_index, 4);
+            } else {
+                value = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+            }
+            result = _mm256_or_si256(result, _mm256_sll_epi32(value, _mm_cvtsi32_si128(channel * 8)));
+        }
+        _mm256_storeu_si256((__m256i *)(out + (size_t)i * 4), result);
+    }
+
+    for (; i < count; i++) {
+        prefilter_pixel_scalar(tables, mips, samples, sample_count, start, step, i, out);
+    }
+}
+#endif
+
+using PrefilterRowKernel = void (*)(const VtfCubemapMip *, const VtfPrefilterSample *, int, const float *, const float *, int, std::byte *);
+
+static PrefilterRowKernel resolve_prefilter_row() {
+#if defined(VTF_CPU_X86)
+    switch (vtf_simd_level()) {
+        case VtfSimdLevel::AVX512:
+        case VtfSimdLevel::AVX2:    return prefilter_row_avx2;
+        case VtfSimdLevel::SSE41:
+        case VtfSimdLevel::SSE2:    return prefilter_row_sse2;
+        case VtfSimdLevel::SCALAR:  break;
+    }
+#endif
+    return prefilter_row_scalar;
+}
+
+void vtf_kernel_prefilter_row(
+    const VtfCubemapMip *mips,
+    const VtfPrefilterSample *samples,
+    int sample_count,
+    const float start[3],
+    const float step[3],
+    int count,
+    std::byte *out
+) {
+    static const PrefilterRowKernel kernel = resolve_prefilter_row();
+    kernel(mips, samples, sample_count, start, step, count, out);
+}
@@ -0,0 +1,136 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Pixel kernels with SIMD variants.
+//
+// Each kernel has a scalar version plus one per VtfSimdLevel it benefits from, and the public
+//  function forwards to whichever vtf_simd_level() picks (resolved on first call).
+// To add one: write the variants in vtf-kernels.cpp with VTF_TARGET_*, add a resolve_*()
+//  switch next to the others, and declare the public function here.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vtfpp/ImageFormats.h"
+
+// A 4-byte-per-pixel channel reorder: out[i] = in[order[i]], with alpha forced to 255 if opaque
+struct VtfSwizzle {
+    uint8_t order[4];
+    bool opaque;
+};
+
+// The swizzle that turns format into RGBA8888, if it's a 4-byte format that only needs one.
+bool vtf_swizzle_to_rgba8888(vtfpp::ImageFormat format, VtfSwizzle *swizzle);
+
+// Reorders pixel_count 4-byte pixels from src into dst. src and dst may not overlap.
+void vtf_kernel_swizzle4(const std::byte *src, std::byte *dst, size_t pixel_count, const VtfSwizzle &swizzle);
+
+// Differences between two RGBA8888 images, per channel (R, G, B, A)
+struct VtfDiffMetrics {
+    uint64_t squared_error[4] = {};
+    uint8_t max_error[4] = {};
+    // Pixels where any channel differs
+    uint64_t differing_pixels = 0;
+    uint64_t pixel_count = 0;
+};
+
+// Compares pixel_count RGBA8888 pixels of a and b, adding the result to metrics (so one
+//  VtfDiffMetrics can collect a whole mip over several calls).
+void vtf_kernel_diff_rgba8888(const std::byte *a, const std::byte *b, size_t pixel_count, VtfDiffMetrics &metrics);
+
+// Interleaves up to four single-channel planes (pixel_count bytes each) into RGBA8888, so
+//  dst pixel i is (planes[0][i], planes[1][i], planes[2][i], planes[3][i]).
+// A null plane fills its channel with fill[channel] instead.
+void vtf_kernel_pack_channels(const std::byte *const planes[4], const uint8_t fill[4], std::byte *dst, size_t pixel_count);
+
+// One row of a tangent-space normal map, or of an SSBump, from a height map (0 low, 255 high)
+//  with a Sobel filter. above and below are the rows around row; the caller picks them at the top
+//  and bottom edges. The left and right edges wrap if wrap is set, and clamp otherwise.
+// scale is how many pixels high 255 is over 0. Normals point +Y down the image, like Source's.
+// out is width RGBA8888 pixels: the normal as (n * 0.5 + 0.5), or for SSBumps, the normal's
+//  projection onto each of the three bump basis vectors.
+void vtf_kernel_height_to_bump_row(
+    const uint8_t *above,
+    const uint8_t *row,
+    const uint8_t *below,
+    int width,
+    bool wrap,
+    float scale,
+    bool ssbump,
+    std::byte *out
+);
+
+// count RGBA8888 pixels bilinearly sampled from an equirectangular panorama (RGBA8888,
+//  width x height) along directions start, start + step, start + 2 * step, ...
+// Directions are in Source's axes (X forward, Y left, Z up) and don't need to be normalized.
+//  The middle of the panorama looks down +X, its top edge is straight up, and it wraps
+//  around horizontally.
+void vtf_kernel_equirect_row(
+    const std::byte *panorama,
+    int width,
+    int height,
+    const float start[3],
+    const float step[3],
+    int count,
+    std::byte *out
+);
+
+// count RGBA8888 pixels of one spheremap row, sampled from the six faces of a cubemap (each
+//  face_size x face_size RGBA8888, one after the other in VTF face order).
+// The row is at t (-1 top to 1 bottom), and pixel i is at s_start + i * s_step (-1 left to
+//  1 right); pixels outside the circle repeat its rim. The spheremap is of a mirror ball seen from
+//  straight above, with +X to the right and +Y up, like the cubemap's up face.
+void vtf_kernel_spheremap_row(
+    const std::byte *faces,
+    int face_size,
+    float t,
+    float s_start,
+    float s_step,
+    int count,
+    std::byte *out
+);
+
+// One mip of a cubemap to prefilter from: its six faces (size x size RGBA8888 each, in VTF
+//  face order) one after the other
+struct VtfCubemapMip {
+    const std::byte *faces;
+    int size;
+};
+
+// One importance sample of a prefilter lobe, around the output direction
+struct VtfPrefilterSample {
+    // Light direction in tangent space (z along the output direction)
+    float direction[3];
+    // How much it counts (N.L); the weights of all samples add up to 1
+    float weight;
+    // Index of the VtfCubemapMip it reads from
+    int mip;
+};
+
+// count RGBA8888 pixels of a prefiltered cubemap row, each the weighted average of samples
+//  around directions start, start + step, ... (in the cubemap's own axes, not normalized).
+// Color is averaged in linear light and stored as sRGB again; alpha is averaged as is.
+void vtf_kernel_prefilter_row(
+    const VtfCubemapMip *mips,
+    const VtfPrefilterSample *samples,
+    int sample_count,
+    const float start[3],
+    const float step[3],
+    int count,
+    std::byte *out
+);
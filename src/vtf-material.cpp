@@ -0,0 +1,228 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-material.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "vtfpp/VTF.h"
+#include "vtf-arena.h"
+#include "vtf-kernels.h"
+#include "vtf-pool.h"
+#include "vtf-report.h"
+#include "vtf-trace.h"
+
+const uint8_t VTF_MATERIAL_PACK_FILL[4] = { 0, 0, 0, 255 };
+
+static std::string_view trim(std::string_view text) {
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos) {
+        return {};
+    }
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(start, end - start + 1);
+}
+
+bool vtf_material_parse_channels(std::string_view channels, VtfMaterialOutput &output, std::string &error) {
+    int channel_count = 0;
+    bool any_channel = false;
+    while (true) {
+        size_t bar = channels.find('|');
+        std::string_view channel = trim(channels.substr(0, bar));
+        if (channel_count == 4) {
+            error = "At most four channels can be packed";
+            return false;
+        }
+        output.channel_layers[channel_count].clear();
+        if (!channel.empty() && channel != "-") {
+            output.channel_layers[channel_count] = std::string(channel);
+            any_channel = true;
+        }
+        channel_count++;
+        if (bar == std::string_view::npos) break;
+        channels = channels.substr(bar + 1);
+    }
+    if (!any_channel) {
+        error = "No channels to pack";
+        return false;
+    }
+    output.packed = true;
+    return true;
+}
+
+static bool parse_output(std::string_view spec, const VtfExportSettings &defaults, VtfMaterialOutput &output, std::string &error) {
+    size_t equals = spec.find('=');
+    if (equals == std::string_view::npos) {
+        error = "Expected SUFFIX=LAYER, got \"" + std::string(spec) + "\"";
+        return false;
+    }
+
+    output.suffix = std::string(trim(spec.substr(0, equals)));
+    std::string_view rest = spec.substr(equals + 1);
+    size_t colon = rest.find(':');
+    output.layer_name = std::string(trim(rest.substr(0, colon)));
+    output.settings = defaults;
+    if (output.suffix.empty() || output.layer_name.empty()) {
+        error = "Expected SUFFIX=LAYER, got \"" + std::string(spec) + "\"";
+        return false;
+    }
+
+    // AO|Roughness|-|Height: one layer per channel
+    if (output.layer_name.find('|') != std::string::npos && !vtf_material_parse_channels(output.layer_name, output, error)) {
+        error = output.suffix + ": " + error;
+        return false;
+    }
+
+    if (colon == std::string_view::npos) {
+        return true;
+    }
+    std::string_view options = rest.substr(colon + 1);
+    while (!options.empty()) {
+        size_t comma = options.find(',');
+        std::string_view option = trim(options.substr(0, comma));
+        options = comma == std::string_view::npos ? std::string_view() : options.substr(comma + 1);
+        if (option.empty()) continue;
+
+        size_t option_equals = option.find('=');
+        if (option_equals == std::string_view::npos) {
+            error = output.suffix + ": expected key=value, got \"" + std::string(option) + "\"";
+            return false;
+        }
+        if (!vtf_core_set_option(output.settings, option.substr(0, option_equals), option.substr(option_equals + 1), error)) {
+            error = output.suffix + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool vtf_material_parse_outputs(
+    std::string_view list,
+    const VtfExportSettings &defaults,
+    std::vector<VtfMaterialOutput> &outputs,
+    std::string &error
+) {
+    outputs.clear();
+    while (!list.empty()) {
+        size_t end = list.find_first_of(";\n");
+        std::string_view spec = trim(list.substr(0, end));
+        list = end == std::string_view::npos ? std::string_view() : list.substr(end + 1);
+        if (spec.empty()) continue;
+
+        VtfMaterialOutput output;
+        if (!parse_output(spec, defaults, output, error)) {
+            return false;
+        }
+        for (const VtfMaterialOutput &other : outputs) {
+            if (other.suffix == output.suffix) {
+                error = "Suffix " + output.suffix + " is used more than once";
+                return false;
+            }
+        }
+        outputs.push_back(std::move(output));
+    }
+    return true;
+}
+
+std::string vtf_material_output_path(std::string_view path, std::string_view suffix) {
+    size_t slash = path.find_last_of("/\\");
+    size_t dot = path.rfind('.');
+    // No extension (or only a dot in a folder name): just append
+    if (dot == std::string_view::npos || (slash != std::string_view::npos && dot < slash)) {
+        dot = path.size();
+    }
+    return std::string(path.substr(0, dot)) + std::string(suffix) + std::string(path.substr(dot));
+}
+
+bool vtf_material_export(
+    const std::string &path,
+    std::span<const VtfMaterialOutput> outputs,
+    std::span<const VtfMaterialLayer> layers,
+    bool report_enabled,
+    std::string &error
+) {
+    if (outputs.size() != layers.size()) {
+        error = "Every material output needs a layer";
+        return false;
+    }
+
+    // Shared by every output; acquire()/release() are thread-safe
+    VtfScratchArena arena;
+    std::vector<std::string> errors(outputs.size());
+
+    // One task per output. Each one's own mip generation and encoding nests inside this
+    //  parallel_for, so small outputs finishing early leave their threads to the big ones.
+    vtf_pool_shared().parallel_for((int)outputs.size(), [&](int index) {
+        const VtfMaterialOutput &output = outputs[index];
+        const VtfMaterialLayer &layer = layers[index];
+        std::string output_path = vtf_material_output_path(path, output.suffix);
+
+        VtfStageTimings timings;
+        vtfpp::VTF export_vtf;
+        bool build_successful = vtf_core_build(
+            export_vtf,
+            output.settings,
+            layer.width,
+            layer.height,
+            1,
+            [&](int, std::span<std::byte> rgba) {
+                // Packed straight into the buffer that goes to setImage()
+                if (output.packed) {
+                    vtf_kernel_pack_channels(layer.planes, VTF_MATERIAL_PACK_FILL, rgba.data(), rgba.size() / 4);
+                    return true;
+                }
+                if (layer.rgba.size() != rgba.size()) {
+                    return false;
+                }
+                memcpy(rgba.data(), layer.rgba.data(), rgba.size());
+                return true;
+            },
+            &arena,
+            &timings
+        );
+        if (!build_successful) {
+            errors[index] = output_path + ": could not build from layer " + output.layer_name;
+            return;
+        }
+
+        bool write_successful;
+        {
+            VtfStageScope write_stage(&timings, TRACE_STAGE_WRITE);
+            write_successful = export_vtf.bake(output_path);
+        }
+        if (!write_successful) {
+            errors[index] = output_path + ": could not write";
+            return;
+        }
+
+        if (report_enabled) {
+            VtfExportReport report = vtf_report_collect(export_vtf, output.settings, output_path);
+            report.timings = timings;
+            if (!vtf_report_write_json(report, output_path + ".json")) {
+                fprintf(stderr, "Could not write export report %s.json\n", output_path.c_str());
+            }
+        }
+    });
+
+    error.clear();
+    for (const std::string &output_error : errors) {
+        if (output_error.empty()) continue;
+        error += error.empty() ? "" : "\n";
+        error += output_error;
+    }
+    return error.empty();
+}
@@ -0,0 +1,98 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Material sets: several VTFs (color, normal, mask, ...) exported from named layers or layer
+//  groups of one image in a single export.
+//
+// Each output is written next to the exported file with its suffix added to the name, so
+//  exporting brick.vtf with "_normal=Normal" writes brick_normal.vtf from the "Normal" layer.
+//  The outputs are described as
+//
+//      SUFFIX=LAYER[:KEY=VALUE,...]; SUFFIX=LAYER[:KEY=VALUE,...]; ...
+//
+//  where the KEY=VALUE options use the export procedure's argument names and override the
+//  export's own settings for that output, e.g.
+//
+//      _basecolor=Color; _normal=Normal:image_format=RGBA8888,flag_normal_map=true; _mask=Roughness
+//
+// LAYER can also be up to four grayscale layers or channels separated by |, which get packed
+//  into the output's R, G, B and A (- skips one): "_mask=AO|Roughness|Metalness" packs three
+//  masks into one texture. Skipped color channels are 0 and a skipped alpha is opaque.
+//
+// The caller fetches each layer once, then every output is built, encoded and written on the
+//  thread pool at the same time.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vtf-core.h"
+
+struct VtfMaterialOutput {
+    // Added to the exported file's name, before the extension
+    std::string suffix;
+    // Layer or layer group the output comes from (as written, for packed outputs)
+    std::string layer_name;
+    // Packed outputs: the layer for each of R, G, B and A, empty for skipped channels
+    bool packed = false;
+    std::string channel_layers[4];
+    VtfExportSettings settings;
+};
+
+// One output's pixels
+struct VtfMaterialLayer {
+    // RGBA8888, for outputs that aren't packed
+    std::span<const std::byte> rgba;
+    // Packed outputs: width * height bytes per channel, null for skipped channels
+    const std::byte *planes[4] = {};
+    int width = 0;
+    int height = 0;
+};
+
+// What skipped channels of a packed output are filled with
+extern const uint8_t VTF_MATERIAL_PACK_FILL[4];
+
+// Parses a list of outputs (see above). Every output starts from defaults.
+// Returns false and fills error if an output or option isn't valid, or a suffix is used twice.
+bool vtf_material_parse_outputs(
+    std::string_view list,
+    const VtfExportSettings &defaults,
+    std::vector<VtfMaterialOutput> &outputs,
+    std::string &error
+);
+
+// Sets output up as packed from "R|G|B|A" layer names (fewer is fine, - skips one).
+// Returns false and fills error if there are more than four, or none at all.
+bool vtf_material_parse_channels(std::string_view channels, VtfMaterialOutput &output, std::string &error);
+
+// path with suffix added before its extension: brick.vtf + _normal = brick_normal.vtf
+std::string vtf_material_output_path(std::string_view path, std::string_view suffix);
+
+// Builds and writes outputs[i] from layers[i], all of them concurrently on the shared pool.
+// If report_enabled, each output also gets its report (see vtf-report.h).
+// Returns false if any output failed, with error naming each one that did.
+bool vtf_material_export(
+    const std::string &path,
+    std::span<const VtfMaterialOutput> outputs,
+    std::span<const VtfMaterialLayer> layers,
+    bool report_enabled,
+    std::string &error
+);
@@ -0,0 +1,86 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-pixels.h"
+
+struct VtfPixelPipeline {
+    vtfpp::ImageFormat src_format;
+    vtfpp::ImageFormat dst_format;
+    int src_bytes;
+    int dst_bytes;
+    void (*convert)(const std::byte *src, std::byte *dst, size_t count);
+};
+
+template<typename Src, typename Dst>
+static constexpr VtfPixelPipeline pipeline() {
+    return { Src::FORMAT, Dst::FORMAT, Src::BYTES, Dst::BYTES, vtf_convert_pixels<Src, Dst> };
+}
+
+using namespace vtf_pixel_formats;
+
+// Every pair that gets compiled: loading (anything -> RGBA8888) for imports and the thumbnailer,
+//  and storing (RGBA8888 -> anything) for exports (see vtf_core_encode()). 4-byte swizzles
+//  (BGRA8888, ...) have their own SIMD kernel in vtf-kernels.h instead.
+static constexpr VtfPixelPipeline VTF_PIXEL_PIPELINES[] = {
+    pipeline<RGB888,    RGBA8888>(),
+    pipeline<BGR888,    RGBA8888>(),
+    pipeline<I8,        RGBA8888>(),
+    pipeline<IA88,      RGBA8888>(),
+    pipeline<A8,        RGBA8888>(),
+    pipeline<UV88,      RGBA8888>(),
+    pipeline<UVWQ8888,  RGBA8888>(),
+    pipeline<UVLX8888,  RGBA8888>(),
+
+    pipeline<RGBA8888,  RGB888>(),
+    pipeline<RGBA8888,  BGR888>(),
+    pipeline<RGBA8888,  I8>(),
+    pipeline<RGBA8888,  IA88>(),
+    pipeline<RGBA8888,  A8>(),
+    pipeline<RGBA8888,  UV88>(),
+};
+
+static const VtfPixelPipeline *find_pipeline(vtfpp::ImageFormat src_format, vtfpp::ImageFormat dst_format) {
+    for (const VtfPixelPipeline &pipeline : VTF_PIXEL_PIPELINES) {
+        if (pipeline.src_format == src_format && pipeline.dst_format == dst_format) {
+            return &pipeline;
+        }
+    }
+    return nullptr;
+}
+
+bool vtf_pixels_has_pipeline(vtfpp::ImageFormat src_format, vtfpp::ImageFormat dst_format) {
+    return find_pipeline(src_format, dst_format) != nullptr;
+}
+
+bool vtf_pixels_convert(
+    vtfpp::ImageFormat src_format,
+    vtfpp::ImageFormat dst_format,
+    std::span<const std::byte> src,
+    std::span<std::byte> dst
+) {
+    const VtfPixelPipeline *pipeline = find_pipeline(src_format, dst_format);
+    if (!pipeline || src.size() % pipeline->src_bytes != 0) {
+        return false;
+    }
+
+    size_t pixel_count = src.size() / pipeline->src_bytes;
+    if (dst.size() != pixel_count * pipeline->dst_bytes) {
+        return false;
+    }
+
+    pipeline->convert(src.data(), dst.data(), pixel_count);
+    return true;
+}
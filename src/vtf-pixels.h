@@ -0,0 +1,129 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Pixel format conversions specialized at compile time.
+//
+// Every format worth specializing has a traits struct below saying how to load a pixel as RGBA8888
+//  and how to store one back. vtf_convert_pixels<Src, Dst>() is then a plain loop
+//  with no format checks in it, which the compiler inlines and vectorizes. The pairs that actually
+//  get compiled are listed in vtf-pixels.cpp; vtf_pixels_convert() picks one at runtime (once per
+//  call, not per pixel) and returns false for any other pair, so callers fall back to vtfpp's
+//  generic conversion.
+//
+// Only formats whose conversion is exact are here, so results match vtfpp byte for byte
+//  (test-pixels checks every pair against vtfpp).
+//  Block-compressed formats are encoded/decoded by vtfpp (Compressonator), and packed 16-bit
+//  formats round differently depending on who converts them, so both stay with vtfpp.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "vtfpp/ImageFormats.h"
+
+struct VtfRgba8 {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+};
+
+namespace vtf_pixel_formats {
+
+struct RGBA8888 {
+    static constexpr vtfpp::ImageFormat FORMAT = vtfpp::ImageFormat::RGBA8888;
+    static constexpr int BYTES = 4;
+    static VtfRgba8 load(const uint8_t *p) { return { p[0], p[1], p[2], p[3] }; }
+    static void store(uint8_t *p, VtfRgba8 c) { p[0] = c.r; p[1] = c.g; p[2] = c.b; p[3] = c.a; }
+};
+
+struct RGB888 {
+    static constexpr vtfpp::ImageFormat FORMAT = vtfpp::ImageFormat::RGB888;
+    static constexpr int BYTES = 3;
+    static VtfRgba8 load(const uint8_t *p) { return { p[0], p[1], p[2], 0xFF }; }
+    static void store(uint8_t *p, VtfRgba8 c) { p[0] = c.r; p[1] = c.g; p[2] = c.b; }
+};
+
+struct BGR888 {
+    static constexpr vtfpp::ImageFormat FORMAT = vtfpp::ImageFormat::BGR888;
+    static constexpr int BYTES = 3;
+    static VtfRgba8 load(const uint8_t *p) { return { p[2], p[1], p[0], 0xFF }; }
+    static void store(uint8_t *p, VtfRgba8 c) { p[0] = c.b; p[1] = c.g; p[2] = c.r; }
+};
+
+// Luminance is stored from the red channel, not weighted, the same as vtfpp does it
+struct I8 {
+    static constexpr vtfpp::ImageFormat FORMAT = vtfpp::ImageFormat::I8;
+    static constexpr int BYTES = 1;
+    static VtfRgba8 load(const uint8_t *p) { return { p[0], p[0], p[0], 0xFF }; }
+    static void store(uint8_t *p, VtfRgba8 c) { p[0] = c.r; }
+};
+
+struct IA88 {
+    static constexpr vtfpp::ImageFormat FORMAT = vtfpp::ImageFormat::IA88;
+    static constexpr int BYTES = 2;
+    static VtfRgba8 load(const uint8_t *p) { return { p[0], p[0], p[0], p[1] }; }
+    static void store(uint8_t *p, VtfRgba8 c) { p[0] = c.r; p[1] = c.a; }
+};
+
+struct A8 {
+    static constexpr vtfpp::ImageFormat FORMAT = vtfpp::ImageFormat::A8;
+    static constexpr int BYTES = 1;
+    static VtfRgba8 load(const uint8_t *p) { return { 0, 0, 0, p[0] }; }
+    static void store(uint8_t *p, VtfRgba8 c) { p[0] = c.a; }
+};
+
+struct UV88 {
+    static constexpr vtfpp::ImageFormat FORMAT = vtfpp::ImageFormat::UV88;
+    static constexpr int BYTES = 2;
+    static VtfRgba8 load(const uint8_t *p) { return { p[0], p[1], 0, 0xFF }; }
+    static void store(uint8_t *p, VtfRgba8 c) { p[0] = c.r; p[1] = c.g; }
+};
+
+// Bump map formats, stored in RGBA order
+struct UVWQ8888 : RGBA8888 {
+    static constexpr vtfpp::ImageFormat FORMAT = vtfpp::ImageFormat::UVWQ8888;
+};
+
+struct UVLX8888 : RGBA8888 {
+    static constexpr vtfpp::ImageFormat FORMAT = vtfpp::ImageFormat::UVLX8888;
+};
+
+}
+
+// Converts count pixels from Src to Dst. src and dst may not overlap.
+template<typename Src, typename Dst>
+inline void vtf_convert_pixels(const std::byte *src, std::byte *dst, size_t count) {
+    const uint8_t *in = (const uint8_t *)src;
+    uint8_t *out = (uint8_t *)dst;
+    for (size_t i = 0; i < count; i++) {
+        Dst::store(out + i * Dst::BYTES, Src::load(in + i * Src::BYTES));
+    }
+}
+
+// True if src_format -> dst_format has a specialized pipeline.
+bool vtf_pixels_has_pipeline(vtfpp::ImageFormat src_format, vtfpp::ImageFormat dst_format);
+
+// Converts src (in src_format) into dst (in dst_format) with a specialized pipeline.
+// Returns false, without touching dst, if there isn't one for the pair or the sizes don't match.
+bool vtf_pixels_convert(
+    vtfpp::ImageFormat src_format,
+    vtfpp::ImageFormat dst_format,
+    std::span<const std::byte> src,
+    std::span<std::byte> dst
+);
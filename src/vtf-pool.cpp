@@ -0,0 +1,332 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include <vector>
+
+struct VtfPool::Group {
+    std::atomic<int> pending;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+struct VtfPool::Task {
+    const std::function<void(int)> *body;
+    int index;
+    Group *group;
+};
+
+// A worker's task deque. std::deque allocates and frees a node every few dozen pushes, even when
+//  the number of queued tasks stays the same; this only allocates when it has to grow past its
+//  largest size so far, so a steady stream of same-sized batches doesn't touch the heap.
+class VtfPool::TaskRing {
+public:
+    bool empty() const { return size_ == 0; }
+
+    void push_back(const Task &task) {
+        if (size_ == slots_.size()) {
+            grow();
+        }
+        slots_[(head_ + size_) & (slots_.size() - 1)] = task;
+        size_++;
+    }
+
+    const Task &back() const { return slots_[(head_ + size_ - 1) & (slots_.size() - 1)]; }
+    const Task &front() const { return slots_[head_]; }
+
+    void pop_back() { size_--; }
+
+    void pop_front() {
+        head_ = (head_ + 1) & (slots_.size() - 1);
+        size_--;
+    }
+
+private:
+    void grow() {
+        // Sizes stay powers of two so wrapping around is a mask
+        std::vector<Task> grown(slots_.empty() ? 64 : slots_.size() * 2);
+        for (size_t i = 0; i < size_; i++) {
+            grown[i] = slots_[(head_ + i) & (slots_.size() - 1)];
+        }
+        slots_ = std::move(grown);
+        head_ = 0;
+    }
+
+    std::vector<Task> slots_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+};
+
+struct VtfPool::Worker {
+    std::mutex mutex;
+    TaskRing tasks;
+    std::thread thread;
+
+    std::atomic<uint64_t> tasks_run = 0;
+    std::atomic<uint64_t> tasks_stolen = 0;
+    std::atomic<uint64_t> busy_ns = 0;
+};
+
+// Which pool (if any) the current thread is a worker of, and its slot in that pool
+static thread_local const VtfPool *tls_pool = nullptr;
+static thread_local int tls_slot = -1;
+
+// hardware_concurrency() is allowed to return 0 when it can't tell; a pool always has at
+//  least the calling thread
+static int hardware_thread_count() {
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+VtfPool::VtfPool()
+    : thread_count_(hardware_thread_count()) {}
+
+VtfPool::~VtfPool() {
+    stop_workers();
+}
+
+void VtfPool::configure(int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = hardware_thread_count();
+    }
+    if (thread_count == thread_count_) {
+        return;
+    }
+
+    // Threads are started again by the next parallel_for() that needs them
+    stop_workers();
+    workers_.clear();
+    started_ = false;
+    thread_count_ = thread_count;
+}
+
+int VtfPool::thread_count() const {
+    return thread_count_;
+}
+
+void VtfPool::ensure_started() {
+    if (started_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(start_mutex_);
+    if (!started_.load(std::memory_order_relaxed)) {
+        start_workers(thread_count_ - 1);
+        started_.store(true, std::memory_order_release);
+    }
+}
+
+void VtfPool::start_workers(int worker_count) {
+    if (worker_count < 0) {
+        worker_count = 0;
+    }
+
+    stopping_ = false;
+    workers_.clear();
+    for (int i = 0; i < worker_count + 1; i++) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < worker_count; i++) {
+        workers_[i]->thread = std::thread(&VtfPool::worker_main, this, i);
+    }
+}
+
+void VtfPool::stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    sleep_cv_.notify_all();
+
+    for (auto &worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+int VtfPool::current_slot() const {
+    if (tls_pool == this) {
+        return tls_slot;
+    }
+    return (int)workers_.size() - 1;
+}
+
+void VtfPool::push(int slot, Task &&task) {
+    {
+        std::lock_guard<std::mutex> lock(workers_[slot]->mutex);
+        workers_[slot]->tasks.push_back(task);
+    }
+    queued_++;
+
+    // Only take the sleep lock when somebody could actually be sleeping on it
+    if (workers_.size() > 1) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+}
+
+bool VtfPool::try_take(int slot, Task &task, bool &stolen) {
+    // Own deque first, newest task (the one most likely to still be in cache)
+    {
+        Worker &own = *workers_[slot];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            queued_--;
+            stolen = false;
+            return true;
+        }
+    }
+
+    // Then steal the oldest task (usually the biggest remaining chunk) from someone else
+    int count = (int)workers_.size();
+    for (int offset = 1; offset < count; offset++) {
+        Worker &victim = *workers_[(slot + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            queued_--;
+            stolen = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void VtfPool::run(int slot, Task &task, bool stolen) {
+    auto start = std::chrono::steady_clock::now();
+
+    try {
+        (*task.body)(task.index);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(task.group->error_mutex);
+        if (!task.group->error) {
+            task.group->error = std::current_exception();
+        }
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    Worker &worker = *workers_[slot];
+    worker.busy_ns += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    worker.tasks_run++;
+    if (stolen) {
+        worker.tasks_stolen++;
+    }
+
+    task.group->pending--;
+}
+
+void VtfPool::worker_main(int worker_index) {
+    tls_pool = this;
+    tls_slot = worker_index;
+
+    while (true) {
+        Task task;
+        bool stolen;
+        if (try_take(worker_index, task, stolen)) {
+            run(worker_index, task, stolen);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+        if (stopping_) {
+            return;
+        }
+    }
+}
+
+void VtfPool::parallel_for(int count, const std::function<void(int index)> &body) {
+    if (count <= 0) {
+        return;
+    }
+    if (count == 1 || thread_count_ <= 1) {
+        for (int i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+
+    ensure_started();
+
+    // Outside threads share one slot, so only one of them can be feeding the pool at a time.
+    // While it is, it counts as part of the pool, so nested calls from tasks it runs don't lock again.
+    std::unique_lock<std::mutex> external_lock;
+    const VtfPool *previous_pool = tls_pool;
+    int previous_slot = tls_slot;
+    if (tls_pool != this) {
+        external_lock = std::unique_lock<std::mutex>(external_mutex_);
+        tls_pool = this;
+        tls_slot = (int)workers_.size() - 1;
+    }
+
+    int slot = current_slot();
+    Group group;
+    group.pending = count;
+
+    // Pushed in reverse so that the caller, popping from the back, starts at index 0
+    for (int i = count - 1; i >= 0; i--) {
+        push(slot, Task { &body, i, &group });
+    }
+
+    // Help out until our group is done. This may run tasks from other groups too,
+    //  which is fine, and is what keeps nested parallel_for() calls from deadlocking.
+    while (group.pending > 0) {
+        Task task;
+        bool stolen;
+        if (try_take(slot, task, stolen)) {
+            run(slot, task, stolen);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    tls_pool = previous_pool;
+    tls_slot = previous_slot;
+
+    if (group.error) {
+        std::rethrow_exception(group.error);
+    }
+}
+
+std::vector<VtfPoolWorkerStats> VtfPool::stats() const {
+    std::vector<VtfPoolWorkerStats> result;
+    for (const auto &worker : workers_) {
+        result.push_back({ worker->tasks_run, worker->tasks_stolen, worker->busy_ns });
+    }
+    return result;
+}
+
+void VtfPool::reset_stats() {
+    for (auto &worker : workers_) {
+        worker->tasks_run = 0;
+        worker->tasks_stolen = 0;
+        worker->busy_ns = 0;
+    }
+}
+
+VtfPool &vtf_pool_shared() {
+    static VtfPool pool;
+    return pool;
+}
@@ -0,0 +1,100 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// The one thread pool used for all parallel work during load and export.
+//
+// Anything that wants to run in parallel (frames, faces, mips, tiles) goes through
+//  vtf_pool_shared().parallel_for(), so the total thread count never goes above what the user
+//  set in GIMP (or passed as the "threads" argument), no matter how deeply calls are nested.
+//
+// Each worker has its own task deque. Workers pop their own newest tasks and steal the oldest
+//  tasks of others when they run dry. A thread waiting in parallel_for() runs queued tasks
+//  instead of blocking, which is what makes nesting safe.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Utilization counters for one worker. The last entry is for threads outside the pool
+//  (usually the plug-in's main thread) that called parallel_for().
+struct VtfPoolWorkerStats {
+    uint64_t tasks_run;
+    // Of tasks_run, how many were taken from another worker's deque
+    uint64_t tasks_stolen;
+    // Time spent running tasks
+    uint64_t busy_ns;
+};
+
+class VtfPool {
+public:
+    VtfPool();
+    ~VtfPool();
+
+    VtfPool(const VtfPool &) = delete;
+    VtfPool &operator=(const VtfPool &) = delete;
+
+    // Sets the total number of threads doing work, including the caller of parallel_for().
+    // thread_count <= 0 means one per hardware thread. Must not be called while work is running.
+    // No threads are started until a parallel_for() actually has more than one thing to run,
+    //  so loads/exports that never go parallel don't pay for them.
+    void configure(int thread_count);
+    int thread_count() const;
+
+    // Runs body(0) ... body(count - 1), in parallel where possible, and returns once all are done.
+    // Can be called from inside another parallel_for() body.
+    // If a body throws, the first exception is rethrown here after the rest have finished.
+    void parallel_for(int count, const std::function<void(int index)> &body);
+
+    // Empty if the pool hasn't been started yet
+    std::vector<VtfPoolWorkerStats> stats() const;
+    void reset_stats();
+
+private:
+    struct Group;
+    struct Task;
+    class TaskRing;
+    struct Worker;
+
+    void ensure_started();
+    void start_workers(int worker_count);
+    void stop_workers();
+    void worker_main(int worker_index);
+    int current_slot() const;
+    void push(int slot, Task &&task);
+    bool try_take(int slot, Task &task, bool &stolen);
+    void run(int slot, Task &task, bool stolen);
+
+    int thread_count_;
+    std::atomic<bool> started_ = false;
+    std::mutex start_mutex_;
+    // Once started: workers_.size() - 1 pool threads, plus one slot shared by outside threads
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<int> queued_ = 0;
+    std::atomic<bool> stopping_ = false;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    // Serializes outside threads using the shared slot
+    std::mutex external_mutex_;
+};
+
+// The process-wide pool. Uses one thread per hardware thread until configured.
+VtfPool &vtf_pool_shared();
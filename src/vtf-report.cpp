@@ -0,0 +1,221 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-report.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "vtf-cpu.h"
+#include "vtf-flags.h"
+#include "vtf-formats.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+VtfExportReport vtf_report_collect(
+    const vtfpp::VTF &vtf,
+    const VtfExportSettings &settings,
+    const std::string &output_path
+) {
+    VtfExportReport report;
+    report.settings = settings;
+
+    report.width = vtf.getWidth();
+    report.height = vtf.getHeight();
+    report.mip_count = vtf.getMipCount();
+    report.frame_count = vtf.getFrameCount();
+    report.face_count = vtf.getFaceCount();
+    report.slice_count = vtf.getSliceCount();
+    report.flags = vtf.getFlags();
+
+    sourcepp::math::Vec3f reflectivity = vtf.getReflectivity();
+    for (int i = 0; i < 3; i++) {
+        report.reflectivity[i] = reflectivity[i];
+    }
+
+    for (int mip = 0; mip < report.mip_count; mip++) {
+        uint64_t rgba8888_subimage_bytes = (uint64_t)vtf.getWidth(mip) * vtf.getHeight(mip) * 4;
+        for (int frame = 0; frame < report.frame_count; frame++) {
+            for (int face = 0; face < report.face_count; face++) {
+                for (int slice = 0; slice < report.slice_count; slice++) {
+                    report.image_data_bytes += vtf.getImageDataRaw(mip, frame, face, slice).size();
+                    report.rgba8888_bytes += rgba8888_subimage_bytes;
+                }
+            }
+        }
+    }
+
+    std::error_code error;
+    uintmax_t output_bytes = std::filesystem::file_size(output_path, error);
+    report.output_bytes = error ? 0 : output_bytes;
+
+    report.peak_memory_bytes = vtf_report_peak_memory_bytes();
+
+    return report;
+}
+
+uint64_t vtf_report_peak_memory_bytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    // Bytes on macOS...
+    return (uint64_t)usage.ru_maxrss;
+#else
+    // ...KiB everywhere else
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+static std::string json_string(const char *value) {
+    std::string out = "\"";
+    for (const char *c = value ? value : ""; *c; c++) {
+        switch (*c) {
+            case '"':   out += "\\\""; break;
+            case '\\':  out += "\\\\"; break;
+            case '\n':  out += "\\n"; break;
+            case '\t':  out += "\\t"; break;
+            default:
+                if ((unsigned char)*c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+                    out += escaped;
+                } else {
+                    out += *c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+static std::string json_number(double value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.6g", value);
+    return buffer;
+}
+
+static std::string json_flag_names(vtfpp::VTF::Flags flags, bool user_settable) {
+    std::string out = "[";
+    bool first = true;
+    for (const VtfFlagName &flag_name : VTF_FLAG_NAMES) {
+        if (flag_name.user_settable != user_settable || !(flags & flag_name.flag)) continue;
+        out += first ? "" : ", ";
+        out += json_string(flag_name.name);
+        first = false;
+    }
+    return out + "]";
+}
+
+std::string vtf_report_to_json(const VtfExportReport &report) {
+    const VtfExportSettings &settings = report.settings;
+    char version[8];
+    snprintf(version, sizeof(version), "7.%d", settings.minor_version);
+
+    double total_seconds = 0.0;
+    for (int stage = 0; stage < TRACE_STAGE_COUNT; stage++) {
+        // Fetch happens inside set_image, don't count it twice
+        if (stage != TRACE_STAGE_FETCH) {
+            total_seconds += report.timings.seconds[stage];
+        }
+    }
+
+    // Ratio of the RGBA8888 size to the encoded size, so DXT1 comes out at 8
+    double compression_ratio = report.image_data_bytes > 0
+        ? (double)report.rgba8888_bytes / (double)report.image_data_bytes
+        : 0.0;
+
+    std::string json = "{\n";
+
+    json += "  \"settings\": {\n";
+    json += "    \"version\": " + json_string(version) + ",\n";
+    json += "    \"image_format\": " + json_string(vtf_format_nick(settings.image_format)) + ",\n";
+    json += "    \"image_type\": " + json_string(vtf_choice_nick(VTF_IMAGE_TYPE_CHOICES, settings.image_type)) + ",\n";
+    json += "    \"mipmap_filter\": " + json_string(vtf_choice_nick(VTF_MIPMAP_FILTER_CHOICES, settings.mipmap_filter)) + ",\n";
+    json += "    \"resize_method\": " + json_string(vtf_choice_nick(VTF_RESIZE_METHOD_CHOICES, (int)settings.resize_method)) + ",\n";
+    json += "    \"thumbnail_enabled\": " + std::string(settings.thumbnail_enabled ? "true" : "false") + ",\n";
+    json += "    \"recompute_reflectivity_enabled\": " + std::string(settings.recompute_reflectivity_enabled ? "true" : "false") + ",\n";
+    json += "    \"bumpmap_scale\": " + json_number(settings.bumpmap_scale) + ",\n";
+    json += "    \"height_conversion\": " + json_string(vtf_choice_nick(VTF_HEIGHT_CONVERSION_CHOICES, settings.height_conversion)) + ",\n";
+    json += "    \"height_scale\": " + json_number(settings.height_scale) + ",\n";
+    json += "    \"prefilter_enabled\": " + std::string(settings.prefilter_enabled ? "true" : "false") + ",\n";
+    json += "    \"prefilter_samples\": " + std::to_string(settings.prefilter_samples) + "\n";
+    json += "  },\n";
+
+    json += "  \"image\": {\n";
+    json += "    \"width\": " + std::to_string(report.width) + ",\n";
+    json += "    \"height\": " + std::to_string(report.height) + ",\n";
+    json += "    \"mip_count\": " + std::to_string(report.mip_count) + ",\n";
+    json += "    \"frame_count\": " + std::to_string(report.frame_count) + ",\n";
+    json += "    \"face_count\": " + std::to_string(report.face_count) + ",\n";
+    json += "    \"slice_count\": " + std::to_string(report.slice_count) + "\n";
+    json += "  },\n";
+
+    json += "  \"flags\": {\n";
+    json += "    \"value\": " + std::to_string((uint32_t)report.flags) + ",\n";
+    json += "    \"user\": " + json_flag_names(report.flags, true) + ",\n";
+    // SRGB, alpha (from computeTransparencyFlags), envmap, no mipmaps, etc.
+    json += "    \"computed\": " + json_flag_names(report.flags, false) + "\n";
+    json += "  },\n";
+
+    json += "  \"reflectivity\": [" + json_number(report.reflectivity[0]) + ", "
+        + json_number(report.reflectivity[1]) + ", "
+        + json_number(report.reflectivity[2]) + "],\n";
+
+    json += "  \"timings_ms\": {\n";
+    for (int stage = 0; stage < TRACE_STAGE_COUNT; stage++) {
+        // Load-only stages
+        if (stage == TRACE_STAGE_PARSE || stage == TRACE_STAGE_DECODE) continue;
+        json += "    " + json_string(vtf_trace_stage_name((VtfTraceStage)stage)) + ": "
+            + json_number(report.timings.seconds[stage] * 1000.0) + ",\n";
+    }
+    json += "    \"total\": " + json_number(total_seconds * 1000.0) + "\n";
+    json += "  },\n";
+
+    json += "  \"simd_level\": " + json_string(vtf_simd_level_name(vtf_simd_level())) + ",\n";
+    json += "  \"peak_memory_bytes\": " + std::to_string(report.peak_memory_bytes) + ",\n";
+    json += "  \"output_bytes\": " + std::to_string(report.output_bytes) + ",\n";
+    json += "  \"image_data_bytes\": " + std::to_string(report.image_data_bytes) + ",\n";
+    json += "  \"rgba8888_bytes\": " + std::to_string(report.rgba8888_bytes) + ",\n";
+    json += "  \"compression_ratio\": " + json_number(compression_ratio) + "\n";
+
+    json += "}\n";
+
+    return json;
+}
+
+bool vtf_report_write_json(const VtfExportReport &report, const std::string &path) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    file << vtf_report_to_json(report);
+    return (bool)file;
+}
@@ -0,0 +1,68 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Export reports: a <name>.vtf.json written next to an exported VTF, describing what went into it
+//  (settings, flags, reflectivity) and what it cost (stage timings, memory, size), so asset
+//  pipelines can track textures without parsing the VTFs themselves.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "vtfpp/VTF.h"
+#include "vtf-core.h"
+#include "vtf-trace.h"
+
+struct VtfExportReport {
+    VtfExportSettings settings;
+
+    // What ended up in the file
+    int width = 0;
+    int height = 0;
+    int mip_count = 0;
+    int frame_count = 0;
+    int face_count = 0;
+    int slice_count = 0;
+    vtfpp::VTF::Flags flags = vtfpp::VTF::FLAG_NONE;
+    float reflectivity[3] = {};
+
+    VtfStageTimings timings;
+    // Peak resident memory of the whole process so far; 0 if the platform can't tell
+    uint64_t peak_memory_bytes = 0;
+
+    // Size of the .vtf on disk
+    uint64_t output_bytes = 0;
+    // Size of all the image data (every mip/frame/face/slice) in the chosen format
+    uint64_t image_data_bytes = 0;
+    // The same image data as RGBA8888
+    uint64_t rgba8888_bytes = 0;
+};
+
+// Fills in everything but the timings from a finished export.
+VtfExportReport vtf_report_collect(
+    const vtfpp::VTF &vtf,
+    const VtfExportSettings &settings,
+    const std::string &output_path
+);
+
+// Peak resident set size of this process, in bytes
+uint64_t vtf_report_peak_memory_bytes();
+
+std::string vtf_report_to_json(const VtfExportReport &report);
+
+// Writes the report as JSON to path. Returns false if the file couldn't be written.
+bool vtf_report_write_json(const VtfExportReport &report, const std::string &path);
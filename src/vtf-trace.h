@@ -0,0 +1,135 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Static user-space tracepoints (USDT) for the load and export paths.
+//
+// Built in when <sys/sdt.h> is available (systemtap-sdt-dev / systemtap-sdt-devel) and
+//  FILE_VTF_TRACEPOINTS is on. Each probe is a single nop in the instruction stream until
+//  a tracer attaches to it, so they can stay in release builds. List them with:
+//      perf list sdt_file_vtf:*      (after perf buildid-cache --add file-vtf)
+//      bpftrace -l 'usdt:/path/to/file-vtf:file_vtf:*'
+// Example:
+//      bpftrace -e 'usdt:./file-vtf:file_vtf:stage_start { @s[arg0] = nsecs; }
+//                   usdt:./file-vtf:file_vtf:stage_end { @ns[arg0] = hist(nsecs - @s[arg0]); }'
+//
+// Probes (provider "file_vtf"):
+//  load_start, load_end(ok)                            - whole of load_image()
+//  export_start, export_end(ok)                        - whole of export_image()
+//  stage_start(stage), stage_end(stage)                - one VtfTraceStage
+//  subimage_decode_start/end(format, w, h, frame, face, mip)
+//  subimage_encode_start/end(format, w, h, frame, face, mip)
+//                                                      - conversion to the export format,
+//                                                        -1s if the whole VTF is done at once
+//  startup(mark)                                       - one VtfStartupMark
+//
+// Startup, from exec to the plug-in answering its first PDB call:
+//      bpftrace -e 'tracepoint:sched:sched_process_exec /comm == "file-vtf"/ { @exec[pid] = nsecs; }
+//                   usdt:./file-vtf:file_vtf:startup { printf("%d %d us\n", arg0, (nsecs - @exec[pid]) / 1000); }'
+//
+// VtfStageScope fires the stage probes and can also time the stage, for the export report.
+
+#pragma once
+
+#include <chrono>
+
+// Numeric stage IDs passed to stage_start/stage_end. Keep these stable, trace scripts depend on them.
+enum VtfTraceStage : int {
+    TRACE_STAGE_PARSE           = 0,
+    TRACE_STAGE_DECODE          = 1,
+    TRACE_STAGE_FETCH           = 2,
+    TRACE_STAGE_SET_IMAGE       = 3,
+    TRACE_STAGE_MIPS            = 4,
+    TRACE_STAGE_THUMBNAIL       = 5,
+    TRACE_STAGE_REFLECTIVITY    = 6,
+    TRACE_STAGE_ENCODE          = 7,
+    TRACE_STAGE_WRITE           = 8,
+
+    TRACE_STAGE_COUNT
+};
+
+// Numeric IDs passed to the startup probe, in the order they happen
+enum VtfStartupMark : int {
+    STARTUP_QUERY_PROCEDURES    = 0,
+    STARTUP_CREATE_PROCEDURE    = 1,
+    STARTUP_RUN                 = 2,
+    STARTUP_RESPONSE            = 3,
+};
+
+// Short names for the stages, as used in export reports
+static inline const char *vtf_trace_stage_name(VtfTraceStage stage) {
+    switch (stage) {
+        case TRACE_STAGE_PARSE:         return "parse";
+        case TRACE_STAGE_DECODE:        return "decode";
+        case TRACE_STAGE_FETCH:         return "fetch";
+        case TRACE_STAGE_SET_IMAGE:     return "set_image";
+        case TRACE_STAGE_MIPS:          return "mips";
+        case TRACE_STAGE_THUMBNAIL:     return "thumbnail";
+        case TRACE_STAGE_REFLECTIVITY:  return "reflectivity";
+        case TRACE_STAGE_ENCODE:        return "encode";
+        case TRACE_STAGE_WRITE:         return "write";
+        case TRACE_STAGE_COUNT:         break;
+    }
+    return "unknown";
+}
+
+#if defined(FILE_VTF_HAVE_SDT)
+#include <sys/sdt.h>
+
+#define VTF_TRACE(probe) DTRACE_PROBE(file_vtf, probe)
+#define VTF_TRACE1(probe, a) DTRACE_PROBE1(file_vtf, probe, a)
+#define VTF_TRACE6(probe, a, b, c, d, e, f) DTRACE_PROBE6(file_vtf, probe, a, b, c, d, e, f)
+#else
+#define VTF_TRACE(probe) ((void)0)
+#define VTF_TRACE1(probe, a) ((void)0)
+#define VTF_TRACE6(probe, a, b, c, d, e, f) ((void)0)
+#endif
+
+#define VTF_TRACE_STAGE_START(stage) VTF_TRACE1(stage_start, (int)(stage))
+#define VTF_TRACE_STAGE_END(stage) VTF_TRACE1(stage_end, (int)(stage))
+
+// Wall-clock seconds spent in each stage. Nested stages (fetch happens inside set_image) are
+//  counted in both.
+struct VtfStageTimings {
+    double seconds[TRACE_STAGE_COUNT] = {};
+};
+
+// Marks a stage for the lifetime of the scope. Timings are only taken if timings isn't null.
+class VtfStageScope {
+public:
+    VtfStageScope(VtfStageTimings *timings, VtfTraceStage stage)
+        : timings_(timings), stage_(stage) {
+        VTF_TRACE_STAGE_START(stage_);
+        if (timings_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~VtfStageScope() {
+        if (timings_) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+            timings_->seconds[stage_] += elapsed.count();
+        }
+        VTF_TRACE_STAGE_END(stage_);
+    }
+
+    VtfStageScope(const VtfStageScope &) = delete;
+    VtfStageScope &operator=(const VtfStageScope &) = delete;
+
+private:
+    VtfStageTimings *timings_;
+    VtfTraceStage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
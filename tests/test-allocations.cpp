@@ -0,0 +1,298 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Counts heap allocations (by replacing malloc() and friends for the whole process, vtfpp
+//  included) while loading and exporting N and N+1 frames, and fails if the extra frame costs
+//  more allocations than it's allowed to. Catches per-frame allocation churn coming back.
+//
+// Loading: decoded by vtf_core_decode_frames_rgba8888(), load_image()'s own decode loop (arena
+//  buffers, batches on the pool). Formats with their own decode path (vtf-kernels.h,
+//  vtf-pixels.h) must not allocate at all per frame; formats vtfpp decodes get vtfpp's own
+//  per-frame cost and nothing else.
+// Exporting: vtfpp allocates for every subimage it converts or resizes, so the extra frame may
+//  cost a fixed amount (bare export), or at least no more than it did for a short animation
+//  (export with mips and compression, where vtfpp's cost depends on the mip count).
+//
+// glibc only: the replacements forward to glibc's __libc_* functions.
+//
+// Usage: test-allocations
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-arena.h"
+#include "vtf-core.h"
+#include "vtf-formats.h"
+#include "vtf-pool.h"
+#include "vtf-synth.h"
+
+// Frame counts compared: N and N+1
+#define FRAMES_N 8
+#define IMAGE_SIZE 64
+// Fixed so the batch size (and so the number of arena buffers) is the same for N and N+1
+#define POOL_THREADS 4
+
+// Allowed extra allocations for one more frame, per case
+// vtfpp's conversions allocate their output and sometimes a temporary or two (Compressonator's
+//  decoders a few more); anything much past that is churn
+#define VTFPP_DECODE_ALLOCATIONS 16
+// Bare export: setImage() copies the frame in, nothing else runs per frame
+#define BARE_EXPORT_ALLOCATIONS 4
+// Export with mips/encoding: the N-th frame may cost this much more than the 2nd one did
+#define EXPORT_SLACK_ALLOCATIONS 4
+
+// Replacements for the allocation functions
+
+static std::atomic<uint64_t> allocation_count = 0;
+
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *pointer);
+
+void *malloc(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void *pointer = __libc_memalign(alignment, size);
+    if (!pointer) {
+        return 12; // ENOMEM
+    }
+    *out = pointer;
+    return 0;
+}
+
+void free(void *pointer) {
+    __libc_free(pointer);
+}
+
+}
+
+// The cases
+
+struct LoadCase {
+    vtfpp::ImageFormat format;
+    // Allowed extra allocations for the extra frame
+    uint64_t frame_allocations;
+};
+
+static const LoadCase LOAD_CASES[] = {
+    // Own decode paths: nothing per frame
+    { vtfpp::ImageFormat::RGBA8888,     0 },
+    { vtfpp::ImageFormat::BGRA8888,     0 },
+    { vtfpp::ImageFormat::BGRX8888,     0 },
+    { vtfpp::ImageFormat::RGB888,       0 },
+    { vtfpp::ImageFormat::BGR888,       0 },
+    { vtfpp::ImageFormat::I8,           0 },
+    { vtfpp::ImageFormat::IA88,         0 },
+    { vtfpp::ImageFormat::UV88,         0 },
+
+    // Decoded by vtfpp
+    { vtfpp::ImageFormat::BGR565,       VTFPP_DECODE_ALLOCATIONS },
+    { vtfpp::ImageFormat::DXT1,         VTFPP_DECODE_ALLOCATIONS },
+    { vtfpp::ImageFormat::DXT5,         VTFPP_DECODE_ALLOCATIONS },
+    { vtfpp::ImageFormat::BC7,          VTFPP_DECODE_ALLOCATIONS },
+};
+
+static std::vector<std::byte> source_layer;
+
+static bool build_vtf(vtfpp::VTF &vtf, const VtfExportSettings &settings, int frame_count, VtfScratchArena *arena) {
+    return vtf_core_build(
+        vtf,
+        settings,
+        IMAGE_SIZE,
+        IMAGE_SIZE,
+        frame_count,
+        [](int, std::span<std::byte> rgba) {
+            std::copy(source_layer.begin(), source_layer.end(), rgba.begin());
+            return true;
+        },
+        arena
+    );
+}
+
+// Allocations made decoding every frame of vtf with load_image()'s decode loop
+static uint64_t count_load_allocations(VtfPool &pool, const vtfpp::VTF &vtf, bool &decode_successful) {
+    uint64_t start = allocation_count.load();
+    {
+        VtfScratchArena arena;
+        decode_successful = vtf_core_decode_frames_rgba8888(vtf, pool, arena, [](int, std::span<const std::byte>) {});
+    }
+    return allocation_count.load() - start;
+}
+
+static bool check_load(VtfPool &pool, const LoadCase &load_case) {
+    const char *format_nick = vtf_format_nick(load_case.format);
+
+    VtfExportSettings settings;
+    settings.image_format = load_case.format;
+    settings.mipmap_filter = VTF_MIPMAP_FILTER_NONE;
+
+    uint64_t allocations[2];
+    for (int extra = 0; extra <= 1; extra++) {
+        // Parsed from bytes like a file on disk, not the VTF the export built
+        vtfpp::VTF built;
+        if (!build_vtf(built, settings, FRAMES_N + extra, nullptr)) {
+            fprintf(stderr, "  load %s: export failed\n", format_nick);
+            return false;
+        }
+        vtfpp::VTF loaded(built.bake(), false);
+
+        bool decode_successful;
+        // Once to get anything lazily set up out of the way, then for real
+        count_load_allocations(pool, loaded, decode_successful);
+        allocations[extra] = count_load_allocations(pool, loaded, decode_successful);
+        if (!decode_successful) {
+            fprintf(stderr, "  load %s: decode failed\n", format_nick);
+            return false;
+        }
+    }
+
+    if (allocations[1] > allocations[0] + load_case.frame_allocations) {
+        fprintf(
+            stderr, "  load %s: %d frames took %llu allocations, %d took %llu (allowed %llu more)\n",
+            format_nick,
+            FRAMES_N, (unsigned long long)allocations[0],
+            FRAMES_N + 1, (unsigned long long)allocations[1],
+            (unsigned long long)load_case.frame_allocations
+        );
+        return false;
+    }
+    return true;
+}
+
+// Allocations made by one more frame than frame_count
+static int64_t count_frame_export_allocations(const VtfExportSettings &settings, int frame_count, bool &build_successful) {
+    uint64_t allocations[2];
+    build_successful = true;
+    for (int extra = 0; extra <= 1; extra++) {
+        VtfScratchArena arena;
+        uint64_t start = allocation_count.load();
+        {
+            vtfpp::VTF vtf;
+            build_successful &= build_vtf(vtf, settings, frame_count + extra, &arena);
+        }
+        allocations[extra] = allocation_count.load() - start;
+    }
+    return (int64_t)allocations[1] - (int64_t)allocations[0];
+}
+
+static bool check_bare_export() {
+    VtfExportSettings settings;
+    settings.image_format = vtfpp::ImageFormat::RGBA8888;
+    settings.mipmap_filter = VTF_MIPMAP_FILTER_NONE;
+    settings.thumbnail_enabled = false;
+    settings.recompute_reflectivity_enabled = false;
+
+    bool build_successful;
+    int64_t frame_allocations = count_frame_export_allocations(settings, FRAMES_N, build_successful);
+    if (!build_successful) {
+        fprintf(stderr, "  bare export: export failed\n");
+        return false;
+    }
+    if (frame_allocations > BARE_EXPORT_ALLOCATIONS) {
+        fprintf(
+            stderr, "  bare export: frame %d took %lld allocations (allowed %d)\n",
+            FRAMES_N + 1, (long long)frame_allocations, BARE_EXPORT_ALLOCATIONS
+        );
+        return false;
+    }
+    return true;
+}
+
+static bool check_export(vtfpp::ImageFormat format) {
+    const char *format_nick = vtf_format_nick(format);
+
+    VtfExportSettings settings;
+    settings.image_format = format;
+    settings.mipmap_filter = (int)vtfpp::ImageConversion::ResizeFilter::DEFAULT;
+
+    bool first_successful;
+    bool nth_successful;
+    int64_t first_frame_allocations = count_frame_export_allocations(settings, 1, first_successful);
+    int64_t nth_frame_allocations = count_frame_export_allocations(settings, FRAMES_N, nth_successful);
+    if (!first_successful || !nth_successful) {
+        fprintf(stderr, "  export %s: export failed\n", format_nick);
+        return false;
+    }
+    if (nth_frame_allocations > first_frame_allocations + EXPORT_SLACK_ALLOCATIONS) {
+        fprintf(
+            stderr, "  export %s: frame 2 took %lld allocations, frame %d took %lld\n",
+            format_nick, (long long)first_frame_allocations, FRAMES_N + 1, (long long)nth_frame_allocations
+        );
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    source_layer = vtf_synth_rgba8888(IMAGE_SIZE, IMAGE_SIZE, SynthContent::PHOTO, 1);
+
+    VtfPool pool;
+    pool.configure(POOL_THREADS);
+
+    int runs = 0;
+    int failures = 0;
+
+    for (const LoadCase &load_case : LOAD_CASES) {
+        runs++;
+        failures += !check_load(pool, load_case);
+    }
+
+    runs++;
+    failures += !check_bare_export();
+
+    for (vtfpp::ImageFormat format : { vtfpp::ImageFormat::RGBA8888, vtfpp::ImageFormat::DXT1, vtfpp::ImageFormat::DXT5 }) {
+        runs++;
+        failures += !check_export(format);
+    }
+
+    printf("%d of %d allocation checks passed\n", runs - failures, runs);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Checks that vtf_incremental_build() writes the same file a full vtf_core_build() would.
+//
+// For each block-compressed format, a two-frame image is exported once (a full export that fills
+//  the cache), then edited a few times and exported again incrementally. Every edit is compared
+//  byte for byte against a full export of the same pixels. The edits straddle block edges and
+//  change alpha, and every edit reaches the smallest mips, which are partial 4x4 blocks.
+//
+// Usage: test-incremental
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-core.h"
+#include "vtf-formats.h"
+#include "vtf-incremental.h"
+#include "vtf-synth.h"
+
+// Not square, so the mips run out of width and height at different points
+#define IMAGE_WIDTH 64
+#define IMAGE_HEIGHT 32
+#define LAYER_COUNT 2
+
+static const vtfpp::ImageFormat FORMATS[] = {
+    vtfpp::ImageFormat::DXT1,
+    vtfpp::ImageFormat::DXT3,
+    vtfpp::ImageFormat::DXT5,
+    vtfpp::ImageFormat::ATI2N,
+    vtfpp::ImageFormat::BC7,
+};
+
+// A rectangle of one layer, overwritten with a solid colour
+struct Edit {
+    int layer;
+    int x, y, width, height;
+    uint8_t rgba[4];
+};
+
+// Each round is applied on top of the previous ones
+static const Edit EDITS[][2] = {
+    // Inside one block, then across four blocks
+    { { 0, 1, 1, 2, 2, { 255, 0, 0, 255 } },       { 1, 6, 2, 5, 7, { 0, 255, 0, 255 } } },
+    // Partly transparent, across a block row edge, then one whole block
+    { { 0, 20, 14, 9, 3, { 255, 0, 0, 40 } },      { 1, 30, 6, 4, 4, { 0, 0, 255, 128 } } },
+    // The last block column and row
+    { { 1, 59, 27, 5, 5, { 10, 20, 30, 0 } },      { 0, 0, 30, 64, 2, { 200, 200, 200, 255 } } },
+};
+
+static void apply_edit(std::vector<std::vector<std::byte>> &layers, const Edit &edit) {
+    for (int y = edit.y; y < edit.y + edit.height; y++) {
+        for (int x = edit.x; x < edit.x + edit.width; x++) {
+            std::byte *pixel = layers[edit.layer].data() + ((size_t)y * IMAGE_WIDTH + x) * 4;
+            for (int channel = 0; channel < 4; channel++) {
+                pixel[channel] = (std::byte)edit.rgba[channel];
+            }
+        }
+    }
+}
+
+static bool check_format(vtfpp::ImageFormat format) {
+    const char *format_nick = vtf_format_nick(format);
+
+    std::vector<std::vector<std::byte>> layers;
+    for (int layer_index = 0; layer_index < LAYER_COUNT; layer_index++) {
+        layers.push_back(vtf_synth_rgba8888(IMAGE_WIDTH, IMAGE_HEIGHT, SynthContent::ALPHA_HEAVY, vtf_synth_seed(format_nick, layer_index)));
+    }
+    VtfLayerFetch fetch_layer = [&](int layer_index, std::span<std::byte> rgba) {
+        std::copy(layers[layer_index].begin(), layers[layer_index].end(), rgba.begin());
+        return true;
+    };
+
+    VtfExportSettings settings;
+    settings.image_format = format;
+    settings.mipmap_filter = (int)vtfpp::ImageConversion::ResizeFilter::DEFAULT;
+
+    VtfIncrementalCache cache;
+    VtfIncrementalStats stats;
+    if (!vtf_incremental_build(cache, settings, IMAGE_WIDTH, IMAGE_HEIGHT, LAYER_COUNT, fetch_layer, nullptr, nullptr, &stats) || !stats.full_export) {
+        fprintf(stderr, "  %s: first export wasn't a full export\n", format_nick);
+        return false;
+    }
+
+    for (size_t round = 0; round < std::size(EDITS); round++) {
+        for (const Edit &edit : EDITS[round]) {
+            apply_edit(layers, edit);
+        }
+
+        if (!vtf_incremental_build(cache, settings, IMAGE_WIDTH, IMAGE_HEIGHT, LAYER_COUNT, fetch_layer, nullptr, nullptr, &stats)) {
+            fprintf(stderr, "  %s round %zu: vtf_incremental_build() failed\n", format_nick, round);
+            return false;
+        }
+        if (stats.full_export || stats.blocks_encoded == 0 || stats.blocks_encoded >= stats.blocks_total) {
+            fprintf(
+                stderr, "  %s round %zu: expected a partial re-encode, got %s with %llu of %llu blocks\n",
+                format_nick, round, stats.full_export ? "a full export" : "an incremental one",
+                (unsigned long long)stats.blocks_encoded, (unsigned long long)stats.blocks_total
+            );
+            return false;
+        }
+
+        vtfpp::VTF full_vtf;
+        if (!vtf_core_build(full_vtf, settings, IMAGE_WIDTH, IMAGE_HEIGHT, LAYER_COUNT, fetch_layer)) {
+            fprintf(stderr, "  %s round %zu: vtf_core_build() failed\n", format_nick, round);
+            return false;
+        }
+
+        std::vector<std::byte> incremental_bytes = cache.encoded.bake();
+        std::vector<std::byte> full_bytes = full_vtf.bake();
+        if (incremental_bytes != full_bytes) {
+            size_t mismatch = 0;
+            while (mismatch < std::min(incremental_bytes.size(), full_bytes.size()) && incremental_bytes[mismatch] == full_bytes[mismatch]) {
+                mismatch++;
+            }
+            fprintf(
+                stderr, "  %s round %zu: differs from a full export at byte %zu (%zu vs %zu bytes)\n",
+                format_nick, round, mismatch, incremental_bytes.size(), full_bytes.size()
+            );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    int failures = 0;
+    for (vtfpp::ImageFormat format : FORMATS) {
+        if (!check_format(format)) {
+            failures++;
+        }
+    }
+
+    printf("%zu of %zu formats matched a full export\n", std::size(FORMATS) - failures, std::size(FORMATS));
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,678 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Checks that every SIMD variant of the pixel kernels (vtf-kernels.h) gives exactly what the
+//  scalar variant does.
+//
+// Kernels pick their variant once per process (from FILE_VTF_SIMD), so this runs itself again
+//  with --dump once per level the CPU has, and compares what each level wrote against the scalar
+//  run. Pixel counts and widths aren't multiples of any vector width, so the scalar tails after
+//  the last full vector get checked too.
+// Kernels that approximate something (like the panorama sampling's atan()) are also checked
+//  against a double-precision version, at every level, and prefiltered envmap exports against
+//  what prefiltering must leave alone or average out.
+//
+// The runs are fork()ed, so Linux/macOS only.
+//
+// Usage: test-kernels
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "vtfpp/VTF.h"
+#include "vtf-core.h"
+#include "vtf-cpu.h"
+#include "vtf-cubemap.h"
+#include "vtf-kernels.h"
+#include "vtf-synth.h"
+
+// One named output of a kernel, as written by --dump
+struct KernelOutput {
+    std::string name;
+    std::vector<std::byte> bytes;
+};
+
+// Starts a new output and returns its bytes to fill in (valid until the next add_output())
+static std::vector<std::byte> &add_output(std::vector<KernelOutput> &outputs, std::string name) {
+    outputs.push_back({ std::move(name), {} });
+    return outputs.back().bytes;
+}
+
+static void append_bytes(std::vector<std::byte> &bytes, const void *data, size_t size) {
+    const std::byte *begin = (const std::byte *)data;
+    bytes.insert(bytes.end(), begin, begin + size);
+}
+
+// count RGBA8888 pixels of noise
+static std::vector<std::byte> noise_pixels(size_t count, const char *key) {
+    return vtf_synth_rgba8888((int)count, 1, SynthContent::NOISE, vtf_synth_seed(key, count));
+}
+
+//
+// Image diff
+//
+
+// Less than one vector, odd tails, and enough pixels of 255 errors to overflow a 32-bit lane sum
+//  if it weren't folded every DIFF_FLUSH_PIXELS
+static const size_t DIFF_COUNTS[] = { 1, 3, 17, 33, 255, 270001 };
+
+static void append_diff_metrics(std::vector<std::byte> &bytes, const VtfDiffMetrics &metrics) {
+    append_bytes(bytes, metrics.squared_error, sizeof(metrics.squared_error));
+    append_bytes(bytes, metrics.max_error, sizeof(metrics.max_error));
+    append_bytes(bytes, &metrics.differing_pixels, sizeof(metrics.differing_pixels));
+    append_bytes(bytes, &metrics.pixel_count, sizeof(metrics.pixel_count));
+}
+
+static void run_diff(std::vector<KernelOutput> &outputs) {
+    for (size_t count : DIFF_COUNTS) {
+        std::vector<std::byte> a = noise_pixels(count, "diff a");
+        std::vector<std::byte> b = noise_pixels(count, "diff b");
+        // Some pixels the same, and some with only a few channels changed
+        for (size_t i = 0; i < b.size(); i++) {
+            if ((i / 4) % 5 == 0 || i % 3 == 0) b[i] = a[i];
+        }
+
+        VtfDiffMetrics metrics;
+        vtf_kernel_diff_rgba8888(a.data(), b.data(), count, metrics);
+        append_diff_metrics(add_output(outputs, "diff " + std::to_string(count)), metrics);
+
+        // Adding up over two calls, split at an odd pixel
+        size_t first_count = count / 2 | 1;
+        VtfDiffMetrics split_metrics;
+        vtf_kernel_diff_rgba8888(a.data(), b.data(), first_count, split_metrics);
+        vtf_kernel_diff_rgba8888(a.data() + first_count * 4, b.data() + first_count * 4, count - first_count, split_metrics);
+        append_diff_metrics(add_output(outputs, "diff " + std::to_string(count) + " split"), split_metrics);
+
+        // Every channel off by 255, the most the lane sums ever hold
+        std::vector<std::byte> black(count * 4, (std::byte)0x00);
+        std::vector<std::byte> white(count * 4, (std::byte)0xFF);
+        VtfDiffMetrics extreme_metrics;
+        vtf_kernel_diff_rgba8888(black.data(), white.data(), count, extreme_metrics);
+        append_diff_metrics(add_output(outputs, "diff " + std::to_string(count) + " extreme"), extreme_metrics);
+    }
+}
+
+//
+// Channel packing
+//
+
+// Under one 16-pixel SSE2 block, just over one 32-pixel AVX2 block, and odd tails
+static const size_t PACK_COUNTS[] = { 1, 15, 17, 33, 63, 1001 };
+
+// Which of the R, G, B, A planes are there; the rest are filled
+static const bool PACK_PLANES[][4] = {
+    { true, true, true, true },
+    { true, true, true, false },
+    { true, false, true, false },
+    { false, true, false, false },
+    { false, false, false, false },
+};
+
+static void run_pack_channels(std::vector<KernelOutput> &outputs) {
+    const uint8_t fill[4] = { 12, 34, 56, 255 };
+    for (size_t count : PACK_COUNTS) {
+        std::vector<std::byte> plane_bytes = noise_pixels(count, "pack planes");
+        for (const auto &present : PACK_PLANES) {
+            const std::byte *planes[4];
+            std::string name = "pack " + std::to_string(count) + " ";
+            for (int channel = 0; channel < 4; channel++) {
+                // Each channel a different quarter of the noise
+                planes[channel] = present[channel] ? plane_bytes.data() + count * channel : nullptr;
+                name += present[channel] ? "RGBA"[channel] : '-';
+            }
+
+            // Poisoned, so pixels the kernel doesn't write show up
+            std::vector<std::byte> &packed = add_output(outputs, name);
+            packed.assign(count * 4, (std::byte)0xCD);
+            vtf_kernel_pack_channels(planes, fill, packed.data(), count);
+        }
+    }
+}
+
+//
+// Height to normal map / SSBump
+//
+
+// Down to 1 (where left and right are the pixel itself), around one and two vectors of
+//  interior pixels, and odd tails
+static const int BUMP_WIDTHS[] = { 1, 2, 3, 5, 6, 9, 10, 11, 17, 18, 33, 101 };
+// Flat-ish, typical and steep enough to push the normals near horizontal
+static const float BUMP_SCALES[] = { 0.5f, 4.0f, 100.0f };
+
+static void run_height_to_bump(std::vector<KernelOutput> &outputs) {
+    for (int width : BUMP_WIDTHS) {
+        // Three rows: above, row, below
+        std::vector<std::byte> noise = noise_pixels((size_t)width * 3, "bump heights");
+        const uint8_t *heights = (const uint8_t *)noise.data();
+        for (float scale : BUMP_SCALES) {
+            for (int wrap = 0; wrap <= 1; wrap++) {
+                for (int ssbump = 0; ssbump <= 1; ssbump++) {
+                    char name[64];
+                    snprintf(name, sizeof(name), "bump %d scale %g%s%s", width, scale, wrap ? " wrap" : "", ssbump ? " ssbump" : "");
+                    std::vector<std::byte> &bump = add_output(outputs, name);
+                    bump.assign((size_t)width * 4, (std::byte)0xCD);
+                    vtf_kernel_height_to_bump_row(heights, heights + width, heights + width * 2, width, wrap, scale, ssbump, bump.data());
+                }
+            }
+        }
+    }
+}
+
+//
+// Equirectangular panorama sampling
+//
+
+// Pixels per row: one, a few short of and past each vector width, and a face's worth
+static const int SAMPLE_COUNTS[] = { 1, 3, 7, 9, 17, 33, 256 };
+
+// A row of directions, from start to end (Source's axes: X forward, Y left, Z up)
+struct DirectionRow {
+    const char *name;
+    float start[3];
+    float end[3];
+};
+
+static const DirectionRow EQUIRECT_ROWS[] = {
+    // Across the front, just above the horizon
+    { "front",  { 1.0f, 1.0f, 0.3f },   { 1.0f, -1.0f, 0.3f } },
+    // Across the back, over the seam where the panorama wraps around
+    { "seam",   { -1.0f, -1.0f, -0.2f }, { -1.0f, 1.0f, -0.2f } },
+    // Straight through the top and bottom poles
+    { "up",     { -0.5f, 0.25f, 1.0f },  { 0.5f, 0.25f, 1.0f } },
+    { "down",   { 0.3f, -0.7f, -1.0f },  { -0.3f, 0.7f, -1.0f } },
+};
+
+static void row_step(const DirectionRow &row, int count, float step[3]) {
+    for (int axis = 0; axis < 3; axis++) {
+        step[axis] = (row.end[axis] - row.start[axis]) / (float)count;
+    }
+}
+
+// Cheap stand-in for noise on panoramas too big for vtf_synth_rgba8888() to fill quickly
+static std::vector<std::byte> hash_pixels(int width, int height) {
+    std::vector<std::byte> pixels((size_t)width * height * 4);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        uint32_t hash = (uint32_t)i * 2654435761u;
+        pixels[i] = (std::byte)(hash >> 24);
+    }
+    return pixels;
+}
+
+static void run_equirect(std::vector<KernelOutput> &outputs) {
+    const int width = 130;
+    const int height = 65;
+    std::vector<std::byte> panorama = vtf_synth_rgba8888(width, height, SynthContent::NOISE, vtf_synth_seed("equirect", 0));
+    for (int count : SAMPLE_COUNTS) {
+        for (const DirectionRow &row : EQUIRECT_ROWS) {
+            float step[3];
+            row_step(row, count, step);
+            std::vector<std::byte> &samples = add_output(outputs, "equirect " + std::to_string(count) + " " + row.name);
+            samples.assign((size_t)count * 4, (std::byte)0xCD);
+            vtf_kernel_equirect_row(panorama.data(), width, height, row.start, step, count, samples.data());
+        }
+    }
+
+    // Over 2^24 pixels, so the bottom rows start past where float pixel offsets stop being exact
+    const int big_width = 8191;
+    const int big_height = 2100;
+    std::vector<std::byte> big_panorama = hash_pixels(big_width, big_height);
+    for (const DirectionRow &row : EQUIRECT_ROWS) {
+        float step[3];
+        row_step(row, 257, step);
+        std::vector<std::byte> &samples = add_output(outputs, std::string("equirect big ") + row.name);
+        samples.assign(257 * 4, (std::byte)0xCD);
+        vtf_kernel_equirect_row(big_panorama.data(), big_width, big_height, row.start, step, 257, samples.data());
+    }
+}
+
+//
+// Spheremap from cubemap faces
+//
+
+// Rows from the top edge to the bottom one, through the middle, where the faces meet
+static const float SPHEREMAP_ROWS[] = { -1.0f, -0.71f, -0.2f, 0.0f, 0.45f, 0.93f, 1.0f };
+
+// Six faces, each a flat colour of its own with noise on top, so sampling the wrong face shows
+static std::vector<std::byte> spheremap_faces(int face_size) {
+    static const uint8_t FACE_COLORS[6][4] = {
+        { 255, 0, 0, 255 }, { 0, 255, 0, 255 }, { 0, 0, 255, 255 },
+        { 255, 255, 0, 128 }, { 0, 255, 255, 64 }, { 255, 0, 255, 0 },
+    };
+    size_t face_pixels = (size_t)face_size * face_size;
+    std::vector<std::byte> faces = vtf_synth_rgba8888(face_size, face_size * 6, SynthContent::NOISE, vtf_synth_seed("spheremap", face_size));
+    for (size_t i = 0; i < faces.size(); i++) {
+        const uint8_t *color = FACE_COLORS[i / 4 / face_pixels];
+        faces[i] = (std::byte)((color[i % 4] * 3 + (int)faces[i]) / 4);
+    }
+    return faces;
+}
+
+static void run_spheremap(std::vector<KernelOutput> &outputs) {
+    const int face_sizes[] = { 1, 5, 33, 64 };
+    for (int face_size : face_sizes) {
+        std::vector<std::byte> faces = spheremap_faces(face_size);
+        for (int count : SAMPLE_COUNTS) {
+            for (float t : SPHEREMAP_ROWS) {
+                char name[64];
+                snprintf(name, sizeof(name), "spheremap %d %d t %g", face_size, count, t);
+                std::vector<std::byte> &samples = add_output(outputs, name);
+                samples.assign((size_t)count * 4, (std::byte)0xCD);
+                // A little past the circle on both sides, where the rim repeats
+                vtf_kernel_spheremap_row(faces.data(), face_size, t, -1.1f, 2.2f / (float)count, count, samples.data());
+            }
+        }
+    }
+
+    // Six faces of over 2^24 pixels in all, so pixel offsets into the down face (the rim) don't
+    //  fit in a float exactly
+    const int big_face_size = 1677;
+    std::vector<std::byte> big_faces = hash_pixels(big_face_size, big_face_size * 6);
+    for (float t : SPHEREMAP_ROWS) {
+        char name[64];
+        snprintf(name, sizeof(name), "spheremap big t %g", t);
+        std::vector<std::byte> &samples = add_output(outputs, name);
+        samples.assign(257 * 4, (std::byte)0xCD);
+        vtf_kernel_spheremap_row(big_faces.data(), big_face_size, t, -1.1f, 2.2f / 257.0f, 257, samples.data());
+    }
+}
+
+//
+// Cubemap prefiltering
+//
+
+// Normals right at the poles, where the kernel picks another tangent frame, and a row that
+//  crosses into them partway
+static const DirectionRow PREFILTER_POLE_ROWS[] = {
+    { "pole",       { -0.02f, 0.01f, 1.0f },    { 0.02f, 0.01f, 1.0f } },
+    { "near pole",  { -0.1f, 0.0f, -1.0f },     { 0.1f, 0.0f, -1.0f } },
+};
+
+#define PREFILTER_MIP_COUNT 6
+#define PREFILTER_SAMPLE_COUNT 37
+
+static void run_prefilter(std::vector<KernelOutput> &outputs) {
+    // A 33x33 cubemap and its mips, down to 1x1
+    std::vector<std::vector<std::byte>> mip_faces;
+    VtfCubemapMip mips[PREFILTER_MIP_COUNT];
+    for (int mip = 0, size = 33; mip < PREFILTER_MIP_COUNT; mip++, size /= 2) {
+        mip_faces.push_back(vtf_synth_rgba8888(size, size * 6, SynthContent::NOISE, vtf_synth_seed("prefilter mips", mip)));
+        mips[mip] = { mip_faces.back().data(), size };
+    }
+
+    // A lobe spread over the hemisphere, reading from every mip
+    VtfPrefilterSample samples[PREFILTER_SAMPLE_COUNT];
+    float total_weight = 0.0f;
+    for (int i = 0; i < PREFILTER_SAMPLE_COUNT; i++) {
+        float phi = 2.0f * (float)M_PI * ((float)i + 0.5f) / PREFILTER_SAMPLE_COUNT;
+        float cos_theta = 1.0f - 0.95f * ((float)i + 0.5f) / PREFILTER_SAMPLE_COUNT;
+        float sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
+        samples[i] = { { sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta }, cos_theta, i % PREFILTER_MIP_COUNT };
+        total_weight += cos_theta;
+    }
+    for (VtfPrefilterSample &sample : samples) {
+        sample.weight /= total_weight;
+    }
+
+    for (int count : SAMPLE_COUNTS) {
+        auto run_row = [&](const DirectionRow &row) {
+            float step[3];
+            row_step(row, count, step);
+            std::vector<std::byte> &filtered = add_output(outputs, "prefilter " + std::to_string(count) + " " + row.name);
+            filtered.assign((size_t)count * 4, (std::byte)0xCD);
+            vtf_kernel_prefilter_row(mips, samples, PREFILTER_SAMPLE_COUNT, row.start, step, count, filtered.data());
+        };
+        for (const DirectionRow &row : EQUIRECT_ROWS) run_row(row);
+        for (const DirectionRow &row : PREFILTER_POLE_ROWS) run_row(row);
+    }
+}
+
+// Environment map exports, through vtf_core_build() like the plugin's, so with the spheremap
+//  face it generates and vtf_cubemap_prefilter_mips() running all of it on the pool
+#define ENVMAP_SIZE 32
+
+enum class EnvmapContent {
+    // Every pixel the same
+    CONSTANT,
+    // A pixel checkerboard of two colours, which is one flat colour from mip 1 on
+    CHECKER,
+    PHOTO,
+};
+
+static const uint8_t ENVMAP_CONSTANT[4] = { 200, 120, 40, 255 };
+static const uint8_t ENVMAP_CHECKER[2][4] = { { 230, 230, 230, 255 }, { 20, 60, 100, 255 } };
+
+static bool build_envmap(EnvmapContent content, bool prefilter, vtfpp::VTF &vtf) {
+    VtfExportSettings settings;
+    // 7.4, so it has a spheremap face
+    settings.minor_version = 4;
+    settings.image_format = vtfpp::ImageFormat::RGBA8888;
+    settings.image_type = TYPE_ENVIRONMENT_MAP;
+    // Box, so every plain mip of the checkerboard is exactly its average, edges included
+    settings.mipmap_filter = (int)vtfpp::ImageConversion::ResizeFilter::BOX;
+    settings.thumbnail_enabled = false;
+    settings.recompute_reflectivity_enabled = false;
+    settings.prefilter_enabled = prefilter;
+
+    VtfLayerFetch fetch_layer = [&](int layer_index, std::span<std::byte> rgba) {
+        if (content == EnvmapContent::PHOTO) {
+            vtf_synth_fill_rgba8888(rgba, ENVMAP_SIZE, ENVMAP_SIZE, SynthContent::PHOTO, vtf_synth_seed("envmap", layer_index));
+            return true;
+        }
+        for (size_t i = 0; i < rgba.size(); i++) {
+            size_t pixel = i / 4;
+            const uint8_t *color = content == EnvmapContent::CONSTANT
+                ? ENVMAP_CONSTANT
+                : ENVMAP_CHECKER[(pixel % ENVMAP_SIZE + pixel / ENVMAP_SIZE) % 2];
+            rgba[i] = (std::byte)color[i % 4];
+        }
+        return true;
+    };
+    return vtf_core_build(vtf, settings, ENVMAP_SIZE, ENVMAP_SIZE, VTF_CUBEMAP_FACE_COUNT, fetch_layer);
+}
+
+// Every mip of every face, for comparing levels
+static void run_prefilter_export(std::vector<KernelOutput> &outputs) {
+    const std::pair<EnvmapContent, const char *> contents[] = {
+        { EnvmapContent::CONSTANT, "constant" },
+        { EnvmapContent::CHECKER, "checker" },
+        { EnvmapContent::PHOTO, "photo" },
+    };
+    for (const auto &[content, content_name] : contents) {
+        std::vector<std::byte> &bytes = add_output(outputs, std::string("prefilter export ") + content_name);
+        vtfpp::VTF vtf;
+        if (!build_envmap(content, true, vtf)) continue;
+        for (int mip = 0; mip < vtf.getMipCount(); mip++) {
+            for (int face = 0; face < vtf.getFaceCount(); face++) {
+                std::span<const std::byte> raw = vtf.getImageDataRaw(mip, 0, face, 0);
+                bytes.insert(bytes.end(), raw.begin(), raw.end());
+            }
+        }
+    }
+}
+
+// At every level: mip 0 and the spheremap face come out the same as without prefiltering, a
+//  constant environment stays that colour in every mip, and the smallest mip of the checkerboard
+//  is one even colour between its two. Returns the number of failed checks.
+static int check_prefilter_export() {
+    const char *level_name = vtf_simd_level_name(vtf_simd_level());
+    int failures = 0;
+    for (EnvmapContent content : { EnvmapContent::CONSTANT, EnvmapContent::CHECKER }) {
+        const char *content_name = content == EnvmapContent::CONSTANT ? "constant" : "checker";
+        vtfpp::VTF plain;
+        vtfpp::VTF filtered;
+        if (!build_envmap(content, false, plain) || !build_envmap(content, true, filtered)) {
+            fprintf(stderr, "  %s: envmap export (%s) failed\n", level_name, content_name);
+            failures++;
+            continue;
+        }
+        int mip_count = filtered.getMipCount();
+        if (mip_count < 2 || filtered.getFaceCount() != VTF_CUBEMAP_SPHEREMAP_FACE + 1) {
+            fprintf(stderr, "  %s: envmap (%s) has %d mips and %d faces\n", level_name, content_name, mip_count, filtered.getFaceCount());
+            failures++;
+            continue;
+        }
+
+        for (int mip = 0; mip < mip_count; mip++) {
+            for (int face = 0; face <= VTF_CUBEMAP_SPHEREMAP_FACE; face++) {
+                if (mip != 0 && face != VTF_CUBEMAP_SPHEREMAP_FACE) continue;
+                std::span<const std::byte> expected = plain.getImageDataRaw(mip, 0, face, 0);
+                std::span<const std::byte> actual = filtered.getImageDataRaw(mip, 0, face, 0);
+                if (!std::equal(actual.begin(), actual.end(), expected.begin(), expected.end())) {
+                    fprintf(stderr, "  %s: prefiltering (%s) changed mip %d of face %d\n", level_name, content_name, mip, face);
+                    failures++;
+                }
+            }
+        }
+
+        // Per channel, the lowest and highest value in the prefiltered faces of each mip
+        for (int mip = 1; mip < mip_count; mip++) {
+            if (content == EnvmapContent::CHECKER && mip != mip_count - 1) continue;
+            uint8_t low[4] = { 255, 255, 255, 255 };
+            uint8_t high[4] = {};
+            for (int face = 0; face < VTF_CUBEMAP_FACE_COUNT; face++) {
+                std::span<const std::byte> pixels = filtered.getImageDataRaw(mip, 0, face, 0);
+                for (size_t i = 0; i < pixels.size(); i++) {
+                    low[i % 4] = std::min(low[i % 4], (uint8_t)pixels[i]);
+                    high[i % 4] = std::max(high[i % 4], (uint8_t)pixels[i]);
+                }
+            }
+
+            for (int channel = 0; channel < 4; channel++) {
+                bool even;
+                if (content == EnvmapContent::CONSTANT) {
+                    even = std::abs(low[channel] - ENVMAP_CONSTANT[channel]) <= 1 && std::abs(high[channel] - ENVMAP_CONSTANT[channel]) <= 1;
+                } else {
+                    uint8_t darker = std::min(ENVMAP_CHECKER[0][channel], ENVMAP_CHECKER[1][channel]);
+                    uint8_t lighter = std::max(ENVMAP_CHECKER[0][channel], ENVMAP_CHECKER[1][channel]);
+                    even = high[channel] - low[channel] <= 2 && (darker == lighter || (low[channel] > darker && high[channel] < lighter));
+                }
+                if (!even) {
+                    fprintf(
+                        stderr, "  %s: prefiltered mip %d (%s) channel %d ranges from %d to %d\n",
+                        level_name, mip, content_name, channel, low[channel], high[channel]
+                    );
+                    failures++;
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+// A smooth panorama (so small differences in where it's sampled don't matter), sampled at every
+//  level and compared against the same bilinear lookup done in double precision with std::atan2().
+// Returns the number of failed rows.
+static int check_equirect_reference() {
+    const int width = 512;
+    const int height = 256;
+    std::vector<std::byte> panorama((size_t)width * height * 4);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            double longitude = 2.0 * M_PI * (x + 0.5) / width;
+            double latitude = M_PI * (y + 0.5) / height;
+            std::byte *pixel = panorama.data() + ((size_t)y * width + x) * 4;
+            pixel[0] = (std::byte)(int)std::lround(128.0 + 100.0 * std::sin(longitude));
+            pixel[1] = (std::byte)(int)std::lround(128.0 + 100.0 * std::cos(latitude));
+            pixel[2] = (std::byte)(int)std::lround(128.0 + 60.0 * std::sin(2.0 * longitude) * std::sin(latitude));
+            pixel[3] = (std::byte)(int)std::lround(255.0 * y / (height - 1));
+        }
+    }
+
+    int failures = 0;
+    for (const DirectionRow &row : EQUIRECT_ROWS) {
+        const int count = 101;
+        float step[3];
+        row_step(row, count, step);
+        std::vector<std::byte> samples((size_t)count * 4);
+        vtf_kernel_equirect_row(panorama.data(), width, height, row.start, step, count, samples.data());
+
+        bool row_matched = true;
+        for (int i = 0; i < count && row_matched; i++) {
+            // The same direction the kernel computes, then all in doubles
+            double x = row.start[0] + (float)i * step[0];
+            double y = row.start[1] + (float)i * step[1];
+            double z = row.start[2] + (float)i * step[2];
+            double u = (0.5 - std::atan2(y, x) / (2.0 * M_PI)) * width - 0.5;
+            double v = (0.5 - std::atan2(z, std::sqrt(x * x + y * y)) / M_PI) * height - 0.5;
+            double floor_u = std::floor(u);
+            double floor_v = std::floor(v);
+            int x0 = ((int)floor_u % width + width) % width;
+            int x1 = (x0 + 1) % width;
+            int y0 = std::clamp((int)floor_v, 0, height - 1);
+            int y1 = std::clamp((int)floor_v + 1, 0, height - 1);
+
+            for (int channel = 0; channel < 4 && row_matched; channel++) {
+                auto texel = [&](int texel_x, int texel_y) {
+                    return (double)panorama[((size_t)texel_y * width + texel_x) * 4 + channel];
+                };
+                double top = texel(x0, y0) + (texel(x1, y0) - texel(x0, y0)) * (u - floor_u);
+                double bottom = texel(x0, y1) + (texel(x1, y1) - texel(x0, y1)) * (u - floor_u);
+                double expected = top + (bottom - top) * (v - floor_v);
+                int sampled = (int)samples[(size_t)i * 4 + channel];
+                if (std::fabs(sampled - expected) > 1.0) {
+                    fprintf(
+                        stderr, "  %s: equirect %s pixel %d channel %d is %d, double precision gives %.2f\n",
+                        vtf_simd_level_name(vtf_simd_level()), row.name, i, channel, sampled, expected
+                    );
+                    row_matched = false;
+                }
+            }
+        }
+        if (!row_matched) failures++;
+    }
+    return failures;
+}
+
+//
+// Running each level
+//
+
+// Runs every kernel at the level this process got, and writes the outputs to stdout
+static int dump_outputs() {
+    std::vector<KernelOutput> outputs;
+    run_diff(outputs);
+    run_pack_channels(outputs);
+    run_height_to_bump(outputs);
+    run_equirect(outputs);
+    run_spheremap(outputs);
+    run_prefilter(outputs);
+    run_prefilter_export(outputs);
+
+    // Kernels that also have a reference of their own
+    int failures = 0;
+    failures += check_equirect_reference();
+    failures += check_prefilter_export();
+
+    for (const KernelOutput &output : outputs) {
+        fprintf(stdout, "%s\n%zu\n", output.name.c_str(), output.bytes.size());
+        fwrite(output.bytes.data(), 1, output.bytes.size(), stdout);
+    }
+    return failures == 0 && fflush(stdout) == 0 ? 0 : 1;
+}
+
+static bool read_outputs(FILE *in, std::vector<KernelOutput> &outputs) {
+    char name[256];
+    while (fgets(name, sizeof(name), in)) {
+        size_t size;
+        if (fscanf(in, "%zu", &size) != 1 || fgetc(in) != '\n') return false;
+
+        std::vector<std::byte> &bytes = add_output(outputs, std::string(name, strcspn(name, "\n")));
+        bytes.resize(size);
+        if (fread(bytes.data(), 1, size, in) != size) return false;
+    }
+    return true;
+}
+
+// Runs this executable with --dump at level, and reads back what it wrote
+static bool run_level(const char *self, VtfSimdLevel level, std::vector<KernelOutput> &outputs) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        setenv("FILE_VTF_SIMD", vtf_simd_level_name(level), 1);
+        execlp(self, self, "--dump", (char *)nullptr);
+        _exit(127);
+    }
+
+    close(fds[1]);
+    FILE *in = fdopen(fds[0], "rb");
+    bool read = in && read_outputs(in, outputs);
+    if (in) {
+        fclose(in);
+    } else {
+        close(fds[0]);
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid) return false;
+    return read && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool compare_outputs(const char *level_name, const std::vector<KernelOutput> &scalar, const std::vector<KernelOutput> &outputs) {
+    if (outputs.size() != scalar.size()) {
+        fprintf(stderr, "  %s: wrote %zu outputs, scalar wrote %zu\n", level_name, outputs.size(), scalar.size());
+        return false;
+    }
+
+    bool matched = true;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const KernelOutput &output = outputs[i];
+        const KernelOutput &expected = scalar[i];
+        if (output.name != expected.name) {
+            fprintf(stderr, "  %s: output %zu is %s, scalar's is %s\n", level_name, i, output.name.c_str(), expected.name.c_str());
+            return false;
+        }
+        if (output.bytes != expected.bytes) {
+            size_t mismatch = 0;
+            while (mismatch < std::min(output.bytes.size(), expected.bytes.size()) && output.bytes[mismatch] == expected.bytes[mismatch]) {
+                mismatch++;
+            }
+            fprintf(
+                stderr, "  %s: %s differs from scalar at byte %zu (%zu vs %zu bytes)\n",
+                level_name, output.name.c_str(), mismatch, output.bytes.size(), expected.bytes.size()
+            );
+            matched = false;
+        }
+    }
+    return matched;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "--dump") == 0) {
+        return dump_outputs();
+    }
+
+    std::vector<KernelOutput> scalar;
+    if (!run_level(argv[0], VtfSimdLevel::SCALAR, scalar) || scalar.empty()) {
+        fprintf(stderr, "The scalar run failed\n");
+        return 1;
+    }
+
+    int levels = 0;
+    int failures = 0;
+    for (int level = (int)VtfSimdLevel::SSE2; level <= (int)vtf_simd_level_supported(); level++) {
+        const char *level_name = vtf_simd_level_name((VtfSimdLevel)level);
+        levels++;
+
+        std::vector<KernelOutput> outputs;
+        if (!run_level(argv[0], (VtfSimdLevel)level, outputs)) {
+            fprintf(stderr, "  %s: run failed\n", level_name);
+            failures++;
+        } else if (!compare_outputs(level_name, scalar, outputs)) {
+            failures++;
+        }
+    }
+
+    printf("%d of %d SIMD levels matched scalar on %zu outputs\n", levels - failures, levels, scalar.size());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Checks that every specialized pixel pipeline (vtf-pixels.h) converts byte for byte the same as
+//  vtfpp's generic conversion, which is what callers fall back to without one.
+//
+// Every pair of export formats that has a pipeline is converted from noise (every byte pattern is
+//  a valid pixel in these formats), at a few sizes that aren't multiples of any vector width.
+// Formats exported through a pipeline also get a whole VTF (mips, frames or faces, thumbnail)
+//  encoded by vtf_core_encode(), which has to bake to the same file as vtfpp's setFormat().
+//
+// Usage: test-pixels
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-core.h"
+#include "vtf-formats.h"
+#include "vtf-pixels.h"
+#include "vtf-synth.h"
+
+// width x height; 1 pixel, odd sizes, and one big enough for the vectorized loops to matter
+static const int SIZES[][2] = {
+    { 1, 1 },
+    { 7, 3 },
+    { 33, 5 },
+    { 257, 129 },
+};
+
+// The whole-VTF check's image, small but with a few mips
+#define VTF_SIZE 64
+#define VTF_FRAMES 2
+
+// A mipmapped RGBA8888 VTF of noise, like vtf_core_build_unencoded() makes: frames, or a cubemap
+static vtfpp::VTF make_rgba8888_vtf(bool cubemap) {
+    vtfpp::VTF vtf;
+    vtf.setVersion(7, 5);
+    vtf.setFlags(vtfpp::VTF::FLAG_PWL_CORRECTED);
+    vtf.setSize(VTF_SIZE, VTF_SIZE, vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+    if (cubemap) {
+        vtf.setFaceCount(true);
+    } else {
+        vtf.setFrameCount(VTF_FRAMES);
+    }
+    for (int frame = 0; frame < vtf.getFrameCount(); frame++) {
+        for (int face = 0; face < vtf.getFaceCount(); face++) {
+            std::vector<std::byte> image = vtf_synth_rgba8888(VTF_SIZE, VTF_SIZE, SynthContent::NOISE, frame * 8 + face);
+            vtf.setImage(image, vtfpp::ImageFormat::RGBA8888, VTF_SIZE, VTF_SIZE, vtfpp::ImageConversion::ResizeFilter::DEFAULT, 0, frame, face);
+        }
+    }
+    vtf.setRecommendedMipCount();
+    vtf.computeMips();
+    vtf.computeThumbnail();
+    vtf.computeReflectivity();
+    vtf.computeTransparencyFlags();
+    return vtf;
+}
+
+static bool check_encode(vtfpp::ImageFormat format, bool cubemap) {
+    VtfExportSettings settings;
+    settings.image_format = format;
+
+    vtfpp::VTF encoded = make_rgba8888_vtf(cubemap);
+    vtf_core_encode(encoded, settings);
+    vtfpp::VTF expected = make_rgba8888_vtf(cubemap);
+    expected.setFormat(format);
+
+    if (encoded.bake() != expected.bake()) {
+        fprintf(stderr, "  encode %s (%s): differs from setFormat()\n", vtf_format_nick(format), cubemap ? "cubemap" : "frames");
+        return false;
+    }
+    return true;
+}
+
+static bool check_pair(vtfpp::ImageFormat src_format, vtfpp::ImageFormat dst_format, int width, int height) {
+    size_t src_size = vtfpp::ImageFormatDetails::getDataLength(src_format, width, height);
+    size_t dst_size = vtfpp::ImageFormatDetails::getDataLength(dst_format, width, height);
+
+    // Noise, cut down to the source's size
+    std::vector<std::byte> src = vtf_synth_rgba8888(width, height, SynthContent::NOISE, vtf_synth_seed(vtf_format_nick(src_format), width));
+    src.resize(src_size);
+
+    std::vector<std::byte> expected = vtfpp::ImageConversion::convertImageDataToFormat(src, src_format, dst_format, width, height);
+    // Poisoned, so bytes the pipeline doesn't write show up
+    std::vector<std::byte> converted(dst_size, (std::byte)0xCD);
+    if (!vtf_pixels_convert(src_format, dst_format, src, converted)) {
+        fprintf(stderr, "  %s -> %s %dx%d: vtf_pixels_convert() failed\n", vtf_format_nick(src_format), vtf_format_nick(dst_format), width, height);
+        return false;
+    }
+
+    if (converted != expected) {
+        size_t mismatch = 0;
+        while (mismatch < std::min(converted.size(), expected.size()) && converted[mismatch] == expected[mismatch]) {
+            mismatch++;
+        }
+        fprintf(
+            stderr, "  %s -> %s %dx%d: differs from vtfpp at byte %zu (%zu vs %zu bytes)\n",
+            vtf_format_nick(src_format), vtf_format_nick(dst_format), width, height,
+            mismatch, converted.size(), expected.size()
+        );
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    int pairs = 0;
+    int failures = 0;
+
+    for (const VtfFormatChoice &src : VTF_EXPORT_FORMATS) {
+        for (const VtfFormatChoice &dst : VTF_EXPORT_FORMATS) {
+            if (!vtf_pixels_has_pipeline(src.format, dst.format)) continue;
+
+            pairs++;
+            for (const auto &size : SIZES) {
+                if (!check_pair(src.format, dst.format, size[0], size[1])) {
+                    failures++;
+                    break;
+                }
+            }
+        }
+    }
+
+    int encodes = 0;
+    int encode_failures = 0;
+    for (const VtfFormatChoice &choice : VTF_EXPORT_FORMATS) {
+        if (!vtf_pixels_has_pipeline(vtfpp::ImageFormat::RGBA8888, choice.format)) continue;
+
+        encodes++;
+        if (!check_encode(choice.format, false) || !check_encode(choice.format, true)) {
+            encode_failures++;
+        }
+    }
+
+    // A pipeline table that somehow came up empty shouldn't pass
+    if (pairs == 0) {
+        fprintf(stderr, "No pixel pipelines found\n");
+        return 1;
+    }
+
+    printf("%d of %d pixel pipelines matched vtfpp\n", pairs - failures, pairs);
+    printf("%d of %d pipeline encodes matched setFormat()\n", encodes - encode_failures, encodes);
+    return failures == 0 && encode_failures == 0 ? 0 : 1;
+}
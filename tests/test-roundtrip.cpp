@@ -0,0 +1,276 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Exports synthetic images through vtf_core_build() (what export_image() uses) for every export
+//  format, VTF version and image type, loads them back through vtf_core_decode_rgba8888_into()
+//  (what load_image() uses), and checks the pixel error against per-format bounds.
+//
+// Usage: test-roundtrip [FORMAT...]    (default: every export format)
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-core.h"
+#include "vtf-formats.h"
+#include "vtf-synth.h"
+
+enum Channels : uint32_t {
+    CH_R = 1 << 0,
+    CH_G = 1 << 1,
+    CH_B = 1 << 2,
+    CH_A = 1 << 3,
+    CH_RGB = CH_R | CH_G | CH_B,
+    CH_RGBA = CH_RGB | CH_A,
+};
+
+enum InputKind {
+    // Colour with varying alpha
+    INPUT_COLOR,
+    // Colour, fully opaque (for formats without alpha, or where alpha means something else)
+    INPUT_OPAQUE,
+    // R = G = B, so luminance formats round-trip regardless of the weights used
+    INPUT_GRAY,
+};
+
+// What a format is expected to preserve
+struct RoundTripExpectation {
+    vtfpp::ImageFormat format;
+    // Channels compared. Anything else is ignored.
+    uint32_t channels;
+    InputKind input;
+    // Largest allowed difference of any compared channel of any pixel, out of 255
+    int max_error;
+    // Largest allowed mean difference over all compared channels
+    double mean_error;
+};
+
+static const RoundTripExpectation EXPECTATIONS[] = {
+    // Lossless 8-bit
+    { vtfpp::ImageFormat::RGBA8888,                     CH_RGBA,    INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::ABGR8888,                     CH_RGBA,    INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::ARGB8888,                     CH_RGBA,    INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::BGRA8888,                     CH_RGBA,    INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::UVWQ8888,                     CH_RGBA,    INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::RGB888,                       CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::BGR888,                       CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::BGRX8888,                     CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::RGBX8888,                     CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::UVLX8888,                     CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::RGB888_BLUESCREEN,            CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::BGR888_BLUESCREEN,            CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::UV88,                         CH_R | CH_G,INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::R8,                           CH_R,       INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::A8,                           CH_A,       INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::I8,                           CH_RGB,     INPUT_GRAY,     1,  0.5 },
+    { vtfpp::ImageFormat::IA88,                         CH_RGBA,    INPUT_GRAY,     1,  0.5 },
+
+    // Fewer bits per channel; the bound is half a quantization step plus rounding
+    { vtfpp::ImageFormat::RGB565,                       CH_RGB,     INPUT_OPAQUE,   5,  2.5 },
+    { vtfpp::ImageFormat::BGR565,                       CH_RGB,     INPUT_OPAQUE,   5,  2.5 },
+    { vtfpp::ImageFormat::BGRX5551,                     CH_RGB,     INPUT_OPAQUE,   5,  2.5 },
+    { vtfpp::ImageFormat::BGRA5551,                     CH_RGB,     INPUT_OPAQUE,   5,  2.5 },
+    { vtfpp::ImageFormat::BGRA4444,                     CH_RGBA,    INPUT_COLOR,    9,  4.5 },
+    { vtfpp::ImageFormat::RGBA1010102,                  CH_RGB,     INPUT_OPAQUE,   1,  0.5 },
+    { vtfpp::ImageFormat::BGRA1010102,                  CH_RGB,     INPUT_OPAQUE,   1,  0.5 },
+
+    // 16-bit and float formats only lose the 8-bit rounding on the way back
+    { vtfpp::ImageFormat::RGBA16161616,                 CH_RGBA,    INPUT_COLOR,    1,  0.5 },
+    { vtfpp::ImageFormat::RGBA16161616F,                CH_RGBA,    INPUT_COLOR,    1,  0.5 },
+    { vtfpp::ImageFormat::RGBA32323232F,                CH_RGBA,    INPUT_COLOR,    1,  0.5 },
+    { vtfpp::ImageFormat::RGB323232F,                   CH_RGB,     INPUT_OPAQUE,   1,  0.5 },
+    { vtfpp::ImageFormat::RG1616F,                      CH_R | CH_G,INPUT_COLOR,    1,  0.5 },
+    { vtfpp::ImageFormat::RG3232F,                      CH_R | CH_G,INPUT_COLOR,    1,  0.5 },
+    { vtfpp::ImageFormat::R16F,                         CH_R,       INPUT_COLOR,    1,  0.5 },
+    { vtfpp::ImageFormat::R32F,                         CH_R,       INPUT_COLOR,    1,  0.5 },
+
+    // Block compression; bounds are loose on purpose, they're there to catch broken encoders
+    //  (swapped channels, wrong block order), not to grade compression quality
+    { vtfpp::ImageFormat::DXT1,                         CH_RGB,     INPUT_OPAQUE,   96, 6.0 },
+    { vtfpp::ImageFormat::DXT1_ONE_BIT_ALPHA,           CH_RGB,     INPUT_OPAQUE,   96, 6.0 },
+    { vtfpp::ImageFormat::DXT3,                         CH_RGBA,    INPUT_COLOR,    96, 6.0 },
+    { vtfpp::ImageFormat::DXT5,                         CH_RGBA,    INPUT_COLOR,    96, 6.0 },
+    { vtfpp::ImageFormat::BC7,                          CH_RGBA,    INPUT_COLOR,    64, 3.0 },
+    { vtfpp::ImageFormat::BC6H,                         CH_RGB,     INPUT_OPAQUE,   64, 4.0 },
+    { vtfpp::ImageFormat::ATI1N,                        CH_R,       INPUT_COLOR,    32, 2.0 },
+    { vtfpp::ImageFormat::ATI2N,                        CH_R | CH_G,INPUT_COLOR,    32, 2.0 },
+
+    // Console formats are stored like their PC counterparts
+    { vtfpp::ImageFormat::CONSOLE_RGBA8888_LINEAR,      CH_RGBA,    INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::CONSOLE_ABGR8888_LINEAR,      CH_RGBA,    INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::CONSOLE_ARGB8888_LINEAR,      CH_RGBA,    INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::CONSOLE_BGRA8888_LINEAR,      CH_RGBA,    INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::CONSOLE_BGRA8888_LE,          CH_RGBA,    INPUT_COLOR,    0,  0.0 },
+    { vtfpp::ImageFormat::CONSOLE_BGRX8888_LINEAR,      CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::CONSOLE_BGRX8888_LE,          CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::CONSOLE_RGB888_LINEAR,        CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::CONSOLE_BGR888_LINEAR,        CH_RGB,     INPUT_OPAQUE,   0,  0.0 },
+    { vtfpp::ImageFormat::CONSOLE_BGRX5551_LINEAR,      CH_RGB,     INPUT_OPAQUE,   5,  2.5 },
+    { vtfpp::ImageFormat::CONSOLE_I8_LINEAR,            CH_RGB,     INPUT_GRAY,     1,  0.5 },
+    { vtfpp::ImageFormat::CONSOLE_RGBA16161616_LINEAR,  CH_RGBA,    INPUT_COLOR,    1,  0.5 },
+
+    // Not checked: P8 (vtfpp can't build a palette) and EMPTY (no image data at all)
+};
+
+static const VTFImageType IMAGE_TYPES[] = {
+    TYPE_STANDARD,
+    TYPE_ENVIRONMENT_MAP,
+    TYPE_VOLUMETRIC_TEXTURE,
+};
+
+static const char *image_type_name(VTFImageType image_type) {
+    switch (image_type) {
+        case TYPE_STANDARD:             return "standard";
+        case TYPE_ENVIRONMENT_MAP:      return "envmap";
+        case TYPE_VOLUMETRIC_TEXTURE:   return "volumetric";
+    }
+    return "unknown";
+}
+
+static std::vector<std::byte> make_input(InputKind input, int width, int height, uint64_t seed) {
+    std::vector<std::byte> rgba = vtf_synth_rgba8888(width, height, SynthContent::PHOTO, seed);
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        if (input == INPUT_GRAY) {
+            rgba[i + 1] = rgba[i];
+            rgba[i + 2] = rgba[i];
+        }
+        if (input != INPUT_COLOR) {
+            rgba[i + 3] = (std::byte)255;
+        } else {
+            // Cover the whole alpha range, not just PHOTO's opaque alpha
+            rgba[i + 3] = (std::byte)(uint8_t)(i / 4 * 7);
+        }
+    }
+
+    // Pure blue would read back as transparent in the bluescreen formats
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        if (rgba[i] == (std::byte)0 && rgba[i + 1] == (std::byte)0 && rgba[i + 2] == (std::byte)255) {
+            rgba[i] = (std::byte)1;
+        }
+    }
+
+    return rgba;
+}
+
+static bool round_trip(const RoundTripExpectation &expect, int minor_version, VTFImageType image_type) {
+    const int width = 64;
+    const int height = 64;
+    const int layer_count = (image_type == TYPE_STANDARD) ? 2 : 6;
+    const char *format_nick = vtf_format_nick(expect.format);
+
+    std::vector<std::vector<std::byte>> layers;
+    for (int layer_index = 0; layer_index < layer_count; layer_index++) {
+        layers.push_back(make_input(expect.input, width, height, vtf_synth_seed(format_nick, layer_index)));
+    }
+
+    VtfExportSettings settings;
+    settings.minor_version = minor_version;
+    settings.image_format = expect.format;
+    settings.image_type = image_type;
+    settings.mipmap_filter = (int)vtfpp::ImageConversion::ResizeFilter::DEFAULT;
+
+    vtfpp::VTF export_vtf;
+    bool build_successful = vtf_core_build(
+        export_vtf,
+        settings,
+        width,
+        height,
+        layer_count,
+        [&](int layer_index, std::span<std::byte> rgba) {
+            std::copy(layers[layer_index].begin(), layers[layer_index].end(), rgba.begin());
+            return true;
+        }
+    );
+    if (!build_successful) {
+        fprintf(stderr, "  %s 7.%d %s: vtf_core_build() failed\n", format_nick, minor_version, image_type_name(image_type));
+        return false;
+    }
+
+    vtfpp::VTF loaded_vtf(export_vtf.bake(), false);
+    if (!loaded_vtf || loaded_vtf.getFormat() != expect.format || loaded_vtf.getMinorVersion() != (uint32_t)minor_version) {
+        fprintf(stderr, "  %s 7.%d %s: baked file didn't parse back\n", format_nick, minor_version, image_type_name(image_type));
+        return false;
+    }
+
+    std::vector<std::byte> decoded((size_t)width * height * 4);
+    int max_error = 0;
+    double error_sum = 0.0;
+    size_t error_count = 0;
+
+    for (int layer_index = 0; layer_index < layer_count; layer_index++) {
+        int frame = (image_type == TYPE_STANDARD) ? layer_index : 0;
+        int face = (image_type == TYPE_STANDARD) ? 0 : layer_index;
+        if (!vtf_core_decode_rgba8888_into(loaded_vtf, 0, frame, face, 0, decoded)) {
+            fprintf(stderr, "  %s 7.%d %s: layer %d didn't decode\n", format_nick, minor_version, image_type_name(image_type), layer_index);
+            return false;
+        }
+
+        const std::vector<std::byte> &source = layers[layer_index];
+        for (size_t i = 0; i < decoded.size(); i++) {
+            if (!(expect.channels & (1u << (i % 4)))) continue;
+            int error = std::abs((int)source[i] - (int)decoded[i]);
+            max_error = std::max(max_error, error);
+            error_sum += error;
+            error_count++;
+        }
+    }
+
+    double mean_error = error_sum / std::max<size_t>(error_count, 1);
+    if (max_error > expect.max_error || mean_error > expect.mean_error) {
+        fprintf(
+            stderr, "  %s 7.%d %s: error too high (max %d, allowed %d; mean %.3f, allowed %.3f)\n",
+            format_nick, minor_version, image_type_name(image_type),
+            max_error, expect.max_error, mean_error, expect.mean_error
+        );
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int runs = 0;
+    int failures = 0;
+
+    for (const RoundTripExpectation &expect : EXPECTATIONS) {
+        if (argc > 1) {
+            bool selected = false;
+            for (int i = 1; i < argc; i++) {
+                selected |= (std::string(argv[i]) == vtf_format_nick(expect.format));
+            }
+            if (!selected) continue;
+        }
+
+        for (int minor_version = 0; minor_version <= 6; minor_version++) {
+            for (VTFImageType image_type : IMAGE_TYPES) {
+                runs++;
+                if (!round_trip(expect, minor_version, image_type)) {
+                    failures++;
+                }
+            }
+        }
+    }
+
+    printf("%d of %d round trips passed\n", runs - failures, runs);
+
+    return failures == 0 ? 0 : 1;
+}
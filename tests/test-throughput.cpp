@@ -0,0 +1,265 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Times export (vtf_core_build + bake) and load (parse + decode) for a few common formats,
+//  and fails if any of them got slower than the committed baseline by more than the tolerance.
+//
+// Raw timings depend on the machine, so every result is divided by the time of a fixed
+//  calibration workload (synthetic image generation, which doesn't touch vtfpp) run on the same
+//  machine. The baseline stores those ratios.
+//
+// Usage: test-throughput --baseline FILE [--tolerance 0.25] [--write-baseline FILE]
+//  FILE_VTF_PERF_TOLERANCE overrides the tolerance, e.g. for noisy CI machines.
+//  A baseline without any entries skips the check (exit code 77); one that's missing some of the
+//  cases fails it.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-core.h"
+#include "vtf-cpu.h"
+#include "vtf-formats.h"
+#include "vtf-synth.h"
+
+// Exit code for "skipped" (ctest's SKIP_RETURN_CODE for this test): the baseline has no entries
+//  yet, so there's nothing to compare against
+#define SKIP_EXIT_CODE 77
+
+// Each measurement is the fastest of this many runs, which is much more stable than the average
+static constexpr int RUNS = 5;
+
+struct ThroughputCase {
+    vtfpp::ImageFormat format;
+    int size;
+};
+
+static const ThroughputCase CASES[] = {
+    { vtfpp::ImageFormat::RGBA8888,     512 },
+    { vtfpp::ImageFormat::BGRA8888,     512 },
+    { vtfpp::ImageFormat::BGR888,       512 },
+    { vtfpp::ImageFormat::DXT1,         512 },
+    { vtfpp::ImageFormat::DXT5,         512 },
+    { vtfpp::ImageFormat::BC7,          128 },
+    { vtfpp::ImageFormat::RGBA16161616F, 256 },
+};
+
+template<typename Function>
+static double fastest_seconds(Function &&function) {
+    double best = 1e30;
+    for (int run = 0; run < RUNS; run++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+static double calibration_seconds() {
+    std::vector<std::byte> rgba((size_t)512 * 512 * 4);
+    return fastest_seconds([&] {
+        vtf_synth_fill_rgba8888(rgba, 512, 512, SynthContent::PHOTO, 1);
+    });
+}
+
+// Returns name -> seconds. Cases that couldn't be built or loaded are added to failures instead.
+static std::map<std::string, double> measure(std::vector<std::string> &failures) {
+    std::map<std::string, double> results;
+
+    for (const ThroughputCase &test_case : CASES) {
+        std::string name = vtf_format_nick(test_case.format);
+        std::vector<std::byte> rgba = vtf_synth_rgba8888(test_case.size, test_case.size, SynthContent::PHOTO, vtf_synth_seed(name, 0));
+
+        VtfExportSettings settings;
+        settings.image_format = test_case.format;
+
+        std::vector<std::byte> baked;
+        bool build_successful = true;
+        double export_seconds = fastest_seconds([&] {
+            vtfpp::VTF export_vtf;
+            bool built = vtf_core_build(
+                export_vtf,
+                settings,
+                test_case.size,
+                test_case.size,
+                1,
+                [&](int, std::span<std::byte> layer) {
+                    std::copy(rgba.begin(), rgba.end(), layer.begin());
+                    return true;
+                }
+            );
+            if (!built) {
+                build_successful = false;
+                return;
+            }
+            baked = export_vtf.bake();
+        });
+        // A failed build is fast for the wrong reason, and there's nothing to load
+        if (!build_successful || baked.empty()) {
+            failures.push_back("export-" + name);
+            continue;
+        }
+        results["export-" + name] = export_seconds;
+
+        std::vector<std::byte> decoded(rgba.size());
+        bool decode_successful = true;
+        double load_seconds = fastest_seconds([&] {
+            vtfpp::VTF loaded_vtf(baked, false);
+            if (!vtf_core_decode_rgba8888_into(loaded_vtf, 0, 0, 0, 0, decoded)) {
+                decode_successful = false;
+            }
+        });
+        if (!decode_successful) {
+            failures.push_back("load-" + name);
+            continue;
+        }
+        results["load-" + name] = load_seconds;
+    }
+
+    return results;
+}
+
+// Returns false if the file can't be read
+static bool read_baseline(const std::string &path, std::map<std::string, double> &baseline) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name;
+        double ratio;
+        if (fields >> name >> ratio) {
+            baseline[name] = ratio;
+        }
+    }
+    return true;
+}
+
+static bool write_baseline(const std::string &path, const std::map<std::string, double> &ratios) {
+    std::ofstream file(path);
+    if (!file) return false;
+
+    file << "# Throughput baseline for test-throughput.\n";
+    file << "# <case> <time relative to the calibration workload>; lower is faster.\n";
+    file << "# Regenerate with: test-throughput --write-baseline tests/throughput-baseline.txt\n";
+    file << "# Measured with SIMD level " << vtf_simd_level_name(vtf_simd_level()) << "\n";
+    for (const auto &[name, ratio] : ratios) {
+        file << name << " " << ratio << "\n";
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::string baseline_path;
+    std::string write_path;
+    double tolerance = 0.25;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--baseline" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (arg == "--write-baseline" && i + 1 < argc) {
+            write_path = argv[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = std::atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s --baseline FILE [--tolerance 0.25] [--write-baseline FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (const char *env_tolerance = std::getenv("FILE_VTF_PERF_TOLERANCE")) {
+        tolerance = std::atof(env_tolerance);
+    }
+
+    // Read before measuring, so a check with nothing to check against doesn't take the time
+    std::map<std::string, double> baseline;
+    if (write_path.empty()) {
+        if (baseline_path.empty() || !read_baseline(baseline_path, baseline)) {
+            fprintf(stderr, "Could not read baseline %s\n", baseline_path.empty() ? "(none given)" : baseline_path.c_str());
+            return 1;
+        }
+        if (baseline.empty()) {
+            printf("No entries in baseline %s; generate them with --write-baseline. Skipping.\n", baseline_path.c_str());
+            return SKIP_EXIT_CODE;
+        }
+    }
+
+    // Results depend on which kernel variants ran, so say which
+    printf("SIMD level: %s\n", vtf_simd_level_name(vtf_simd_level()));
+
+    double calibration = calibration_seconds();
+    std::vector<std::string> build_failures;
+    std::map<std::string, double> ratios;
+    for (const auto &[name, seconds] : measure(build_failures)) {
+        ratios[name] = seconds / calibration;
+    }
+    for (const std::string &name : build_failures) {
+        fprintf(stderr, "%s: failed\n", name.c_str());
+    }
+    if (!build_failures.empty()) {
+        return 1;
+    }
+
+    if (!write_path.empty()) {
+        if (!write_baseline(write_path, ratios)) {
+            fprintf(stderr, "Could not write %s\n", write_path.c_str());
+            return 1;
+        }
+        printf("Wrote %zu baseline entries to %s\n", ratios.size(), write_path.c_str());
+        return 0;
+    }
+
+    int regressions = 0;
+    int missing = 0;
+
+    printf("%-28s %10s %10s %8s\n", "case", "ratio", "baseline", "change");
+    for (const auto &[name, ratio] : ratios) {
+        auto found = baseline.find(name);
+        if (found == baseline.end()) {
+            // Unchecked cases would let a regression through, so they fail too
+            printf("%-28s %10.3f %10s %8s  NO BASELINE\n", name.c_str(), ratio, "-", "-");
+            missing++;
+            continue;
+        }
+
+        double change = ratio / found->second - 1.0;
+        bool regressed = change > tolerance;
+        printf(
+            "%-28s %10.3f %10.3f %+7.1f%%%s\n",
+            name.c_str(), ratio, found->second, change * 100.0, regressed ? "  REGRESSED" : ""
+        );
+        if (regressed) regressions++;
+    }
+
+    if (missing > 0) {
+        printf("%d case(s) have no baseline; regenerate it with --write-baseline\n", missing);
+    }
+    if (regressions > 0) {
+        printf("%d case(s) regressed by more than %.0f%%\n", regressions, tolerance * 100.0);
+    }
+    return missing == 0 && regressions == 0 ? 0 : 1;
+}
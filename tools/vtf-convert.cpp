@@ -0,0 +1,1119 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// vtf-convert: headless image -> VTF conversion, with the export procedure's options.
+//
+// For big batches of small textures, starting a process per file costs more than the conversion
+//  itself. --serve keeps one process around on a Unix socket (thread pool started, scratch
+//  memory reused between jobs), and --socket sends it jobs and prints results as they finish.
+//
+// Usage:
+//  vtf-convert [-o KEY=VALUE]... [--threads N] [--jobs FILE] [INPUT OUTPUT]...
+//  vtf-convert --serve SOCKET [--threads N]
+//  vtf-convert --socket SOCKET [-o KEY=VALUE]... [--jobs FILE] [INPUT OUTPUT]...
+//  vtf-convert --socket SOCKET --stop
+//  vtf-convert --watch DIR [--out DIR] [-o KEY=VALUE]... [--threads N]
+//  vtf-convert --manifest FILE [--state FILE] [--force] [-o KEY=VALUE]... [--threads N]
+//
+// Options are export procedure arguments, e.g. -o image_format=DXT5 -o flag_clamp_s=true
+//  (see vtf-job.h). A jobs file (- for stdin) has one job per line: INPUT<tab>OUTPUT, then
+//  optionally more <tab>KEY=VALUE options, which override the -o ones.
+//
+// --manifest takes a jobs file and only converts jobs whose source content or settings changed
+//  since the last run (recorded in --state, FILE.state by default), largest sources first.
+//
+// --watch (Linux only) converts every image under DIR whenever it's saved, to a .vtf next to it
+//  or under --out. A vtf-convert.conf in a folder holds KEY=VALUE lines for that folder and the
+//  ones below it. Saves in quick succession are converted once, and the last export of each file
+//  is kept so that small edits only re-encode the blocks they touched (see vtf-incremental.h).
+//
+// Protocol: one request per line, tab-separated.
+//  convert<tab>INPUT<tab>OUTPUT[<tab>KEY=VALUE]...  ->  ok<tab>ID<tab>OUTPUT<tab>MILLISECONDS
+//                                                   or error<tab>ID<tab>OUTPUT<tab>MESSAGE
+//  stop                                             ->  ok<tab>stop
+// ID is the index of the request on its connection. Jobs run concurrently, so replies come back
+//  in whatever order they finish.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#include "vtf-arena.h"
+#include "vtf-hash.h"
+#include "vtf-job.h"
+#include "vtf-pool.h"
+
+// macOS doesn't have MSG_NOSIGNAL; SIGPIPE is ignored in main() there instead
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+// How long the daemon's loops wait before checking whether they've been asked to stop
+#define STOP_POLL_MS 200
+
+struct JobSpec {
+    std::string input_path;
+    std::string output_path;
+    // KEY=VALUE, applied in order
+    std::vector<std::string> options;
+};
+
+static std::vector<std::string> split_fields(const std::string &line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab - start));
+        if (tab == std::string::npos) break;
+        start = tab + 1;
+    }
+    return fields;
+}
+
+// Replies are tab-separated lines, so messages can't have either in them
+static std::string protocol_safe(std::string text) {
+    for (char &c : text) {
+        if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+    }
+    return text;
+}
+
+static bool make_job(const JobSpec &spec, VtfConvertJob &job, std::string &error) {
+    job.input_path = spec.input_path;
+    job.output_path = spec.output_path;
+    for (const std::string &option : spec.options) {
+        if (!vtf_job_set_option(job, option, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool run_spec(const JobSpec &spec, VtfScratchArena &arena, std::string &error) {
+    VtfConvertJob job;
+    return make_job(spec, job, error) && vtf_job_run(job, &arena, error);
+}
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool read_jobs_file(const std::string &path, const std::vector<std::string> &options, std::vector<JobSpec> &specs) {
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) return false;
+    }
+    std::istream &in = (path == "-") ? std::cin : file;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        std::vector<std::string> fields = split_fields(line);
+        if (fields.size() < 2) {
+            fprintf(stderr, "%s: expected INPUT<tab>OUTPUT, got \"%s\"\n", path.c_str(), line.c_str());
+            return false;
+        }
+        JobSpec spec { fields[0], fields[1], options };
+        spec.options.insert(spec.options.end(), fields.begin() + 2, fields.end());
+        specs.push_back(std::move(spec));
+    }
+    return true;
+}
+
+//
+// Local (no daemon)
+//
+
+static int run_local(const std::vector<JobSpec> &specs) {
+    VtfScratchArena arena;
+    std::atomic<int> failed = 0;
+    std::mutex print_mutex;
+
+    vtf_pool_shared().parallel_for((int)specs.size(), [&](int index) {
+        auto start = std::chrono::steady_clock::now();
+        std::string error;
+        bool converted = run_spec(specs[index], arena, error);
+
+        std::lock_guard lock(print_mutex);
+        if (converted) {
+            printf("ok: %s (%.1f ms)\n", specs[index].output_path.c_str(), milliseconds_since(start));
+        } else {
+            fprintf(stderr, "error: %s: %s\n", specs[index].output_path.c_str(), error.c_str());
+            failed++;
+        }
+    });
+
+    return failed > 0 ? 1 : 0;
+}
+
+//
+// Sockets
+//
+
+static bool make_address(const std::string &path, sockaddr_un &address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path.c_str());
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+static int connect_socket(const std::string &path) {
+    sockaddr_un address;
+    if (!make_address(path, address)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool send_all(int fd, const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t result = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) return false;
+        sent += result;
+    }
+    return true;
+}
+
+// Reads one line (without the newline) into line. buffer holds whatever was read past it.
+static bool read_line(int fd, std::string &buffer, std::string &line) {
+    while (true) {
+        size_t newline = buffer.find('\n');
+        if (newline != std::string::npos) {
+            line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            return true;
+        }
+
+        char chunk[4096];
+        ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        buffer.append(chunk, received);
+    }
+}
+
+//
+// Daemon
+//
+
+// Set by SIGINT/SIGTERM or a stop request. Lock-free, so it's fine to set from a signal handler.
+static std::atomic<bool> stop_requested = false;
+
+static void handle_stop_signal(int) {
+    stop_requested = true;
+}
+
+struct Connection {
+    int fd;
+    std::mutex write_mutex;
+
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { close(fd); }
+
+    // A client that went away just doesn't get its replies
+    void reply(const std::string &line) {
+        std::lock_guard lock(write_mutex);
+        send_all(fd, line + "\n");
+    }
+};
+
+struct QueuedJob {
+    // Keeps the socket open until every job sent on it has replied
+    std::shared_ptr<Connection> connection;
+    uint64_t id;
+    JobSpec spec;
+};
+
+struct JobQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<QueuedJob> jobs;
+};
+
+static void connection_main(std::shared_ptr<Connection> connection, JobQueue &queue) {
+    std::string buffer;
+    std::string line;
+    uint64_t next_id = 0;
+
+    while (read_line(connection->fd, buffer, line)) {
+        uint64_t id = next_id++;
+        std::vector<std::string> fields = split_fields(line);
+
+        if (fields[0] == "convert" && fields.size() >= 3) {
+            JobSpec spec { fields[1], fields[2], std::vector<std::string>(fields.begin() + 3, fields.end()) };
+            {
+                std::lock_guard lock(queue.mutex);
+                queue.jobs.push_back({ connection, id, std::move(spec) });
+            }
+            queue.cv.notify_one();
+        } else if (fields[0] == "stop") {
+            connection->reply("ok\tstop");
+            stop_requested = true;
+            queue.cv.notify_all();
+        } else {
+            connection->reply("error\t" + std::to_string(id) + "\t\tUnknown request " + protocol_safe(fields[0]));
+        }
+    }
+}
+
+// One client's reader thread
+struct ConnectionThread {
+    std::thread thread;
+    std::weak_ptr<Connection> connection;
+    // Set by the thread as it finishes, so it can be joined without blocking
+    std::shared_ptr<std::atomic<bool>> done;
+};
+
+static void accept_main(int listen_fd, JobQueue &queue) {
+    std::vector<ConnectionThread> threads;
+
+    while (!stop_requested) {
+        // Join readers whose clients went away, so a long-running daemon doesn't keep every
+        //  finished thread (and its stack) around until it stops
+        for (size_t i = 0; i < threads.size();) {
+            if (*threads[i].done) {
+                threads[i].thread.join();
+                threads[i] = std::move(threads.back());
+                threads.pop_back();
+            } else {
+                i++;
+            }
+        }
+
+        pollfd poll_fd = { listen_fd, POLLIN, 0 };
+        if (poll(&poll_fd, 1, STOP_POLL_MS) <= 0) continue;
+
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        auto connection = std::make_shared<Connection>(fd);
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        std::thread thread([connection, done, &queue] {
+            connection_main(connection, queue);
+            *done = true;
+        });
+        threads.push_back({ std::move(thread), connection, done });
+    }
+
+    // Unblock the readers so they can be joined
+    for (ConnectionThread &connection_thread : threads) {
+        if (std::shared_ptr<Connection> connection = connection_thread.connection.lock()) {
+            shutdown(connection->fd, SHUT_RD);
+        }
+    }
+    for (ConnectionThread &connection_thread : threads) {
+        connection_thread.thread.join();
+    }
+}
+
+static int listen_socket(const std::string &path) {
+    sockaddr_un address;
+    if (!make_address(path, address)) return -1;
+
+    // A socket file nobody is listening on is left over from a daemon that didn't exit cleanly
+    int existing = connect_socket(path);
+    if (existing >= 0) {
+        close(existing);
+        fprintf(stderr, "A daemon is already listening on %s\n", path.c_str());
+        return -1;
+    }
+    unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        fprintf(stderr, "Could not listen on %s: %s\n", path.c_str(), strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int run_daemon(const std::string &socket_path) {
+    int listen_fd = listen_socket(socket_path);
+    if (listen_fd < 0) return 1;
+
+    signal(SIGINT, handle_stop_signal);
+    signal(SIGTERM, handle_stop_signal);
+
+    VtfPool &pool = vtf_pool_shared();
+    // Reused by every job, so steady-state conversions don't go back to the heap for layer buffers
+    VtfScratchArena arena;
+    JobQueue queue;
+    uint64_t jobs_done = 0;
+    uint64_t jobs_failed = 0;
+
+    fprintf(stderr, "Listening on %s with %d threads\n", socket_path.c_str(), pool.thread_count());
+    std::thread accept_thread(accept_main, listen_fd, std::ref(queue));
+
+    while (true) {
+        // Take a few jobs per thread at a time, so one slow job doesn't hold up a huge batch
+        std::vector<QueuedJob> batch;
+        {
+            std::unique_lock lock(queue.mutex);
+            queue.cv.wait_for(lock, std::chrono::milliseconds(STOP_POLL_MS), [&] { return !queue.jobs.empty() || stop_requested; });
+            size_t batch_limit = (size_t)pool.thread_count() * 2;
+            while (!queue.jobs.empty() && batch.size() < batch_limit) {
+                batch.push_back(std::move(queue.jobs.front()));
+                queue.jobs.pop_front();
+            }
+        }
+        // Jobs already queued still get done after a stop
+        if (batch.empty()) {
+            if (stop_requested) break;
+            continue;
+        }
+
+        std::atomic<int> batch_failed = 0;
+        pool.parallel_for((int)batch.size(), [&](int index) {
+            QueuedJob &queued = batch[index];
+            auto start = std::chrono::steady_clock::now();
+            std::string error;
+            std::string id_and_output = std::to_string(queued.id) + "\t" + protocol_safe(queued.spec.output_path);
+
+            if (run_spec(queued.spec, arena, error)) {
+                char milliseconds[32];
+                snprintf(milliseconds, sizeof(milliseconds), "%.1f", milliseconds_since(start));
+                queued.connection->reply("ok\t" + id_and_output + "\t" + milliseconds);
+            } else {
+                queued.connection->reply("error\t" + id_and_output + "\t" + protocol_safe(error));
+                batch_failed++;
+            }
+            // Drop the connection here rather than when the batch ends, so it closes as soon as it's done
+            queued.connection.reset();
+        });
+        jobs_done += batch.size();
+        jobs_failed += batch_failed;
+    }
+
+    accept_thread.join();
+    close(listen_fd);
+    unlink(socket_path.c_str());
+
+    fprintf(
+        stderr,
+        "Stopped after %llu jobs (%llu failed), %zu KiB of scratch memory\n",
+        (unsigned long long)jobs_done,
+        (unsigned long long)jobs_failed,
+        arena.bytes_reserved() / 1024
+    );
+    return 0;
+}
+
+//
+// Client
+//
+
+static int run_client(const std::string &socket_path, const std::vector<JobSpec> &specs, bool stop) {
+    int fd = connect_socket(socket_path);
+    if (fd < 0) {
+        fprintf(stderr, "Could not connect to %s; is vtf-convert --serve running?\n", socket_path.c_str());
+        return 1;
+    }
+
+    // The daemon has its own working directory
+    std::vector<std::string> requests;
+    for (const JobSpec &spec : specs) {
+        std::string request = "convert\t" + std::filesystem::absolute(spec.input_path).string()
+            + "\t" + std::filesystem::absolute(spec.output_path).string();
+        for (const std::string &option : spec.options) {
+            request += "\t" + option;
+        }
+        if (request.find('\n') != std::string::npos) {
+            fprintf(stderr, "Paths and options can't contain newlines: %s\n", spec.input_path.c_str());
+            close(fd);
+            return 1;
+        }
+        requests.push_back(request + "\n");
+    }
+    if (stop) {
+        requests.push_back("stop\n");
+    }
+
+    // Send from another thread, so replies are printed while later jobs are still being sent
+    std::thread sender([&] {
+        for (const std::string &request : requests) {
+            if (!send_all(fd, request)) break;
+        }
+        shutdown(fd, SHUT_WR);
+    });
+
+    std::string buffer;
+    std::string line;
+    size_t replies = 0;
+    int failed = 0;
+    while (replies < requests.size() && read_line(fd, buffer, line)) {
+        replies++;
+        std::vector<std::string> fields = split_fields(line);
+        if (fields[0] == "ok" && fields.size() >= 4) {
+            printf("ok: %s (%s ms)\n", fields[2].c_str(), fields[3].c_str());
+        } else if (fields[0] == "error" && fields.size() >= 4) {
+            fprintf(stderr, "error: %s: %s\n", fields[2].c_str(), fields[3].c_str());
+            failed++;
+        } else if (line != "ok\tstop") {
+            fprintf(stderr, "Unexpected reply: %s\n", line.c_str());
+            failed++;
+        }
+    }
+    fflush(stdout);
+
+    sender.join();
+    close(fd);
+
+    if (replies < requests.size()) {
+        fprintf(stderr, "Daemon went away after %zu of %zu replies\n", replies, requests.size());
+        return 1;
+    }
+    return failed > 0 ? 1 : 0;
+}
+
+//
+// Manifest (make-style rebuilds)
+//
+
+// First line of a state file. Bump the number when a change to the conversion itself should
+//  rebuild everything; older state files are then ignored.
+#define MANIFEST_STATE_HEADER "# vtf-convert manifest state 1"
+
+// What a job's output was last built from
+struct ManifestRecord {
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    uint64_t content_hash = 0;
+    uint64_t settings_hash = 0;
+};
+
+struct ManifestJob {
+    JobSpec spec;
+    VtfConvertJob job;
+    ManifestRecord record;
+    bool valid = false;
+    bool up_to_date = false;
+    bool converted = false;
+    std::string error;
+};
+
+// State file: the header, then OUTPUT<tab>SIZE<tab>MTIME<tab>CONTENT_HASH<tab>SETTINGS_HASH per line
+static void read_manifest_state(const std::string &path, std::map<std::string, ManifestRecord> &records) {
+    std::ifstream file(path);
+    std::string line;
+    if (!std::getline(file, line) || line != MANIFEST_STATE_HEADER) {
+        return;
+    }
+
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields = split_fields(line);
+        if (fields.size() != 5) continue;
+
+        ManifestRecord record;
+        record.source_size = strtoull(fields[1].c_str(), nullptr, 10);
+        record.source_mtime = strtoll(fields[2].c_str(), nullptr, 10);
+        record.content_hash = strtoull(fields[3].c_str(), nullptr, 16);
+        record.settings_hash = strtoull(fields[4].c_str(), nullptr, 16);
+        records[fields[0]] = record;
+    }
+}
+
+static bool write_manifest_state(const std::string &path, const std::map<std::string, ManifestRecord> &records) {
+    // Written next to it and renamed over it, so an interrupted run can't leave half a file
+    std::string temporary_path = path + ".tmp";
+    FILE *file = fopen(temporary_path.c_str(), "w");
+    if (!file) return false;
+
+    fprintf(file, "%s\n", MANIFEST_STATE_HEADER);
+    for (const auto &[output, record] : records) {
+        fprintf(
+            file,
+            "%s\t%llu\t%lld\t%016llx\t%016llx\n",
+            output.c_str(),
+            (unsigned long long)record.source_size,
+            (long long)record.source_mtime,
+            (unsigned long long)record.content_hash,
+            (unsigned long long)record.settings_hash
+        );
+    }
+    bool written = fclose(file) == 0;
+    return written && rename(temporary_path.c_str(), path.c_str()) == 0;
+}
+
+static bool hash_file(const std::string &path, uint64_t *hash) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    VtfHash64 hasher;
+    std::vector<std::byte> chunk(1 << 20);
+    size_t read_size;
+    while ((read_size = fread(chunk.data(), 1, chunk.size(), file)) > 0) {
+        hasher.update(std::span<const std::byte>(chunk.data(), read_size));
+    }
+    bool read_error = ferror(file);
+    fclose(file);
+
+    *hash = hasher.digest();
+    return !read_error;
+}
+
+// Fills in job.record and decides whether the output needs rebuilding
+static void check_manifest_job(ManifestJob &job, const std::map<std::string, ManifestRecord> &previous) {
+    job.valid = make_job(job.spec, job.job, job.error);
+    if (!job.valid) return;
+
+    VtfHash64 settings_hash;
+    settings_hash.update(vtf_job_settings_key(job.job));
+    job.record.settings_hash = settings_hash.digest();
+
+    std::error_code error;
+    job.record.source_size = std::filesystem::file_size(job.spec.input_path, error);
+    if (!error) {
+        job.record.source_mtime = std::filesystem::last_write_time(job.spec.input_path, error).time_since_epoch().count();
+    }
+    if (error) {
+        job.valid = false;
+        job.error = "Could not read " + job.spec.input_path;
+        return;
+    }
+
+    auto found = previous.find(job.spec.output_path);
+    const ManifestRecord *last = found != previous.end() ? &found->second : nullptr;
+
+    // Like make, trust an unchanged size and modification time; only read sources that look touched.
+    // A touched source with the same content (a fresh checkout, say) still isn't rebuilt.
+    if (last && last->source_size == job.record.source_size && last->source_mtime == job.record.source_mtime) {
+        job.record.content_hash = last->content_hash;
+    } else if (!hash_file(job.spec.input_path, &job.record.content_hash)) {
+        job.valid = false;
+        job.error = "Could not read " + job.spec.input_path;
+        return;
+    }
+
+    job.up_to_date = last
+        && last->content_hash == job.record.content_hash
+        && last->settings_hash == job.record.settings_hash
+        && std::filesystem::exists(job.spec.output_path, error);
+}
+
+static int run_manifest(const std::string &manifest_path, std::string state_path, const std::vector<std::string> &options, bool force) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<JobSpec> specs;
+    if (!read_jobs_file(manifest_path, options, specs)) {
+        fprintf(stderr, "Could not read manifest %s\n", manifest_path.c_str());
+        return 1;
+    }
+    if (state_path.empty()) {
+        state_path = manifest_path + ".state";
+    }
+
+    std::map<std::string, ManifestRecord> previous;
+    if (!force) {
+        read_manifest_state(state_path, previous);
+    }
+
+    VtfPool &pool = vtf_pool_shared();
+
+    // Checking is mostly stat() calls, but with tens of thousands of jobs it's worth spreading out too
+    std::vector<ManifestJob> jobs(specs.size());
+    pool.parallel_for((int)jobs.size(), [&](int index) {
+        jobs[index].spec = std::move(specs[index]);
+        check_manifest_job(jobs[index], previous);
+    });
+
+    // Largest first, so the big ones aren't what's left running at the end with the other threads idle.
+    // Source size stands in for cost.
+    std::vector<size_t> order;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (jobs[i].valid && !jobs[i].up_to_date) order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return jobs[a].record.source_size > jobs[b].record.source_size;
+    });
+
+    // Each task claims the next job in order instead of using its own index: the pool runs its own
+    //  tasks in index order but other threads steal from the far end, which would start the smallest first
+    VtfScratchArena arena;
+    std::atomic<size_t> next_job = 0;
+    std::mutex print_mutex;
+    pool.parallel_for((int)order.size(), [&](int) {
+        ManifestJob &job = jobs[order[next_job++]];
+        auto job_start = std::chrono::steady_clock::now();
+        job.converted = vtf_job_run(job.job, &arena, job.error);
+
+        std::lock_guard lock(print_mutex);
+        if (job.converted) {
+            printf("ok: %s (%.1f ms)\n", job.spec.output_path.c_str(), milliseconds_since(job_start));
+        }
+    });
+
+    std::map<std::string, ManifestRecord> records;
+    size_t up_to_date = 0;
+    size_t converted = 0;
+    size_t failed = 0;
+    for (const ManifestJob &job : jobs) {
+        if (job.up_to_date || job.converted) {
+            records[job.spec.output_path] = job.record;
+            (job.up_to_date ? up_to_date : converted)++;
+        } else {
+            fprintf(stderr, "error: %s: %s\n", job.spec.output_path.c_str(), job.error.c_str());
+            failed++;
+        }
+    }
+
+    if (!write_manifest_state(state_path, records)) {
+        fprintf(stderr, "Could not write %s\n", state_path.c_str());
+        failed++;
+    }
+
+    printf(
+        "%zu up to date, %zu converted, %zu failed in %.2f s\n",
+        up_to_date,
+        converted,
+        failed,
+        milliseconds_since(start) / 1000.0
+    );
+    return failed > 0 ? 1 : 0;
+}
+
+//
+// Watch mode
+//
+
+#if defined(__linux__)
+
+// Per-folder settings: KEY=VALUE lines, on top of the parent folder's (and the -o options)
+#define WATCH_SETTINGS_FILE "vtf-convert.conf"
+// Editors often write a file several times per save, so wait this long after the last change
+#define WATCH_QUIET_MS 300
+// Cached exports kept for incremental re-encoding; the least recently converted ones go first
+#define WATCH_CACHE_LIMIT 64
+
+struct WatchCacheEntry {
+    VtfIncrementalCache cache;
+    std::chrono::steady_clock::time_point last_used;
+};
+
+struct WatchState {
+    std::filesystem::path root;
+    std::filesystem::path out_root;
+    std::vector<std::string> options;
+    int inotify_fd = -1;
+    std::map<int, std::filesystem::path> watched_dirs;
+    // Source -> when it's been quiet for long enough to convert
+    std::map<std::filesystem::path, std::chrono::steady_clock::time_point> pending;
+    std::map<std::filesystem::path, WatchCacheEntry> caches;
+    VtfScratchArena arena;
+};
+
+// Everything vtfpp can read (and XCF, to say it can't)
+static bool is_watch_source(const std::filesystem::path &path, bool *is_xcf) {
+    static const char *EXTENSIONS[] = {
+        ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".gif", ".psd", ".hdr", ".exr", ".qoi", ".webp",
+    };
+    std::string extension = path.extension().string();
+    for (char &c : extension) c = (char)tolower((unsigned char)c);
+
+    *is_xcf = extension == ".xcf";
+    for (const char *source_extension : EXTENSIONS) {
+        if (extension == source_extension) return true;
+    }
+    return false;
+}
+
+static std::vector<std::string> watch_folder_options(const WatchState &state, const std::filesystem::path &dir) {
+    std::vector<std::string> options = state.options;
+
+    // Root first, so deeper folders override
+    std::vector<std::filesystem::path> dirs;
+    std::filesystem::path relative = std::filesystem::relative(dir, state.root);
+    std::filesystem::path current = state.root;
+    dirs.push_back(current);
+    for (const std::filesystem::path &part : relative) {
+        if (part == ".") continue;
+        current /= part;
+        dirs.push_back(current);
+    }
+
+    for (const std::filesystem::path &settings_dir : dirs) {
+        std::ifstream file(settings_dir / WATCH_SETTINGS_FILE);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            options.push_back(line);
+        }
+    }
+    return options;
+}
+
+static std::filesystem::path watch_output_path(const WatchState &state, const std::filesystem::path &source) {
+    std::filesystem::path output = state.out_root.empty()
+        ? source
+        : state.out_root / std::filesystem::relative(source, state.root);
+    output.replace_extension(".vtf");
+    return output;
+}
+
+static void watch_queue(WatchState &state, const std::filesystem::path &path, std::chrono::steady_clock::time_point when) {
+    bool is_xcf;
+    if (is_watch_source(path, &is_xcf)) {
+        state.pending[path] = when;
+    } else if (is_xcf) {
+        fprintf(stderr, "skipped: %s: XCF can only be read by GIMP; export it as PNG next to it instead\n", path.c_str());
+    }
+}
+
+// Queues every source under dir; with only_stale, just the ones whose VTF is missing or older
+static void watch_queue_tree(WatchState &state, const std::filesystem::path &dir, bool only_stale) {
+    std::error_code error;
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = std::filesystem::recursive_directory_iterator(dir, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        bool is_xcf;
+        if (!it->is_regular_file() || !is_watch_source(it->path(), &is_xcf)) continue;
+
+        if (only_stale) {
+            std::error_code time_error;
+            auto output_time = std::filesystem::last_write_time(watch_output_path(state, it->path()), time_error);
+            if (!time_error && output_time >= it->last_write_time()) continue;
+        }
+        state.pending[it->path()] = now;
+    }
+}
+
+static void watch_add_tree(WatchState &state, const std::filesystem::path &dir) {
+    int wd = inotify_add_watch(state.inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR);
+    if (wd < 0) {
+        fprintf(stderr, "Could not watch %s: %s\n", dir.c_str(), strerror(errno));
+        return;
+    }
+    state.watched_dirs[wd] = dir;
+
+    std::error_code error;
+    for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(dir, error)) {
+        if (entry.is_directory() && !entry.is_symlink()) {
+            watch_add_tree(state, entry.path());
+        }
+    }
+}
+
+static void watch_read_events(WatchState &state) {
+    // Enough for a burst of events; the rest are picked up on the next read
+    alignas(inotify_event) char buffer[64 * 1024];
+    ssize_t length = read(state.inotify_fd, buffer, sizeof(buffer));
+    auto quiet_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(WATCH_QUIET_MS);
+
+    for (ssize_t offset = 0; offset < length;) {
+        const inotify_event *event = (const inotify_event *)(buffer + offset);
+        offset += sizeof(inotify_event) + event->len;
+
+        if (event->mask & IN_IGNORED) {
+            state.watched_dirs.erase(event->wd);
+            continue;
+        }
+        auto dir = state.watched_dirs.find(event->wd);
+        if (dir == state.watched_dirs.end() || event->len == 0) continue;
+
+        std::filesystem::path path = dir->second / event->name;
+        if (event->mask & IN_ISDIR) {
+            // New folders (or ones moved in) might already have files in them
+            watch_add_tree(state, path);
+            watch_queue_tree(state, path, false);
+        } else if (path.filename() == WATCH_SETTINGS_FILE) {
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                watch_queue_tree(state, dir->second, false);
+            }
+        } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+            watch_queue(state, path, quiet_at);
+        }
+    }
+}
+
+static void watch_convert(WatchState &state, const std::vector<std::filesystem::path> &sources) {
+    auto now = std::chrono::steady_clock::now();
+
+    // Set up everything the jobs touch here, so the pool threads only use their own entries
+    std::vector<JobSpec> specs;
+    std::vector<VtfIncrementalCache *> caches;
+    for (const std::filesystem::path &source : sources) {
+        std::filesystem::path output = watch_output_path(state, source);
+        std::error_code error;
+        std::filesystem::create_directories(output.parent_path(), error);
+
+        specs.push_back({ source.string(), output.string(), watch_folder_options(state, source.parent_path()) });
+        WatchCacheEntry &entry = state.caches[source];
+        entry.last_used = now;
+        caches.push_back(&entry.cache);
+    }
+
+    std::mutex print_mutex;
+    vtf_pool_shared().parallel_for((int)specs.size(), [&](int index) {
+        auto start = std::chrono::steady_clock::now();
+        VtfConvertJob job;
+        VtfIncrementalStats stats;
+        std::string error;
+        bool converted = make_job(specs[index], job, error) && vtf_job_run_incremental(job, *caches[index], &state.arena, error, &stats);
+
+        std::lock_guard lock(print_mutex);
+        if (!converted) {
+            fprintf(stderr, "error: %s: %s\n", specs[index].output_path.c_str(), error.c_str());
+        } else if (stats.full_export) {
+            printf("ok: %s (%.1f ms, full export)\n", specs[index].output_path.c_str(), milliseconds_since(start));
+        } else {
+            printf(
+                "ok: %s (%.1f ms, %llu of %llu blocks re-encoded)\n",
+                specs[index].output_path.c_str(),
+                milliseconds_since(start),
+                (unsigned long long)stats.blocks_encoded,
+                (unsigned long long)stats.blocks_total
+            );
+        }
+        fflush(stdout);
+    });
+
+    while (state.caches.size() > WATCH_CACHE_LIMIT) {
+        auto oldest = std::min_element(state.caches.begin(), state.caches.end(), [](const auto &a, const auto &b) {
+            return a.second.last_used < b.second.last_used;
+        });
+        state.caches.erase(oldest);
+    }
+}
+
+static int run_watch(const std::string &root, const std::string &out_root, const std::vector<std::string> &options) {
+    WatchState state;
+    std::error_code error;
+    state.root = std::filesystem::canonical(root, error);
+    if (error || !std::filesystem::is_directory(state.root)) {
+        fprintf(stderr, "Not a directory: %s\n", root.c_str());
+        return 1;
+    }
+    if (!out_root.empty()) {
+        state.out_root = std::filesystem::absolute(out_root);
+    }
+    state.options = options;
+
+    state.inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (state.inotify_fd < 0) {
+        fprintf(stderr, "inotify_init1 failed: %s\n", strerror(errno));
+        return 1;
+    }
+    watch_add_tree(state, state.root);
+
+    signal(SIGINT, handle_stop_signal);
+    signal(SIGTERM, handle_stop_signal);
+
+    // Catch up on anything saved while nobody was watching
+    watch_queue_tree(state, state.root, true);
+    fprintf(stderr, "Watching %s (%zu folders)\n", state.root.c_str(), state.watched_dirs.size());
+
+    while (!stop_requested) {
+        auto now = std::chrono::steady_clock::now();
+        int timeout_ms = STOP_POLL_MS;
+        for (const auto &[source, when] : state.pending) {
+            int until_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(when - now).count();
+            timeout_ms = std::clamp(until_ms, 0, timeout_ms);
+        }
+
+        pollfd poll_fd = { state.inotify_fd, POLLIN, 0 };
+        if (poll(&poll_fd, 1, timeout_ms) > 0) {
+            watch_read_events(state);
+        }
+
+        now = std::chrono::steady_clock::now();
+        std::vector<std::filesystem::path> due;
+        for (auto it = state.pending.begin(); it != state.pending.end();) {
+            if (it->second <= now) {
+                due.push_back(it->first);
+                it = state.pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (!due.empty()) {
+            watch_convert(state, due);
+        }
+    }
+
+    close(state.inotify_fd);
+    return 0;
+}
+
+#else
+
+static int run_watch(const std::string &, const std::string &, const std::vector<std::string> &) {
+    fprintf(stderr, "--watch needs inotify, which is only available on Linux\n");
+    return 1;
+}
+
+#endif
+
+int main(int argc, char **argv) {
+    std::string serve_path;
+    std::string socket_path;
+    std::string jobs_path;
+    std::string watch_path;
+    std::string out_path;
+    std::string manifest_path;
+    std::string state_path;
+    std::vector<std::string> options;
+    std::vector<std::string> paths;
+    int threads = 0;
+    bool stop = false;
+    bool force = false;
+    bool usage_error = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            options.push_back(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            jobs_path = argv[++i];
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serve_path = argv[++i];
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (arg == "--watch" && i + 1 < argc) {
+            watch_path = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            manifest_path = argv[++i];
+        } else if (arg == "--state" && i + 1 < argc) {
+            state_path = argv[++i];
+        } else if (arg == "--force") {
+            force = true;
+        } else if (arg == "--stop") {
+            stop = true;
+        } else if (arg.rfind("-", 0) == 0 && arg != "-") {
+            usage_error = true;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() % 2 != 0 || (stop && socket_path.empty())) {
+        usage_error = true;
+    }
+    if (!serve_path.empty() && (!socket_path.empty() || !paths.empty() || !jobs_path.empty() || !options.empty())) {
+        usage_error = true;
+    }
+    if (!watch_path.empty() && (!serve_path.empty() || !socket_path.empty() || !paths.empty() || !jobs_path.empty())) {
+        usage_error = true;
+    }
+    if (!out_path.empty() && watch_path.empty()) {
+        usage_error = true;
+    }
+    if (!manifest_path.empty() && (!serve_path.empty() || !socket_path.empty() || !watch_path.empty() || !paths.empty() || !jobs_path.empty())) {
+        usage_error = true;
+    }
+    if ((!state_path.empty() || force) && manifest_path.empty()) {
+        usage_error = true;
+    }
+
+    if (usage_error) {
+        fprintf(
+            stderr,
+            "Usage: %s [-o KEY=VALUE]... [--threads N] [--jobs FILE] [INPUT OUTPUT]...\n"
+            "       %s --serve SOCKET [--threads N]\n"
+            "       %s --socket SOCKET [-o KEY=VALUE]... [--jobs FILE] [INPUT OUTPUT]...\n"
+            "       %s --socket SOCKET --stop\n"
+            "       %s --watch DIR [--out DIR] [-o KEY=VALUE]... [--threads N]\n"
+            "       %s --manifest FILE [--state FILE] [--force] [-o KEY=VALUE]... [--threads N]\n",
+            argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]
+        );
+        return 2;
+    }
+
+    // Catch bad options here rather than once per job
+    VtfConvertJob check_job;
+    for (const std::string &option : options) {
+        std::string error;
+        if (!vtf_job_set_option(check_job, option, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+    }
+
+    vtf_pool_shared().configure(threads);
+    // A client disconnecting (or the daemon going away) shows up as a failed send instead
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!serve_path.empty()) {
+        return run_daemon(serve_path);
+    }
+    if (!watch_path.empty()) {
+        return run_watch(watch_path, out_path, options);
+    }
+    if (!manifest_path.empty()) {
+        return run_manifest(manifest_path, state_path, options, force);
+    }
+
+    std::vector<JobSpec> specs;
+    for (size_t i = 0; i < paths.size(); i += 2) {
+        specs.push_back({ paths[i], paths[i + 1], options });
+    }
+    if (!jobs_path.empty() && !read_jobs_file(jobs_path, options, specs)) {
+        fprintf(stderr, "Could not read jobs from %s\n", jobs_path.c_str());
+        return 1;
+    }
+
+    if (!socket_path.empty()) {
+        return run_client(socket_path, specs, stop);
+    }
+    if (specs.empty()) {
+        fprintf(stderr, "Nothing to convert\n");
+        return 2;
+    }
+    return run_local(specs);
+}
@@ -0,0 +1,337 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// vtf-corpus: writes a deterministic set of synthetic VTF files.
+//
+// Every format from the export dialog is covered. Instead of the full cross product
+//  (which would be millions of files), each format gets a base case, and then each
+//  axis (content, size, frames, faces, depth, version, resources) is varied on its own.
+//
+// Usage: vtf-corpus [--out DIR] [--seed N] [--formats DXT1,DXT5,...] [--quick] [--large]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-formats.h"
+#include "vtf-synth.h"
+
+// Optional resources to attach to a case (only stored in VTF 7.3 and up)
+enum CorpusResources : uint32_t {
+    RES_NONE            = 0,
+    RES_THUMBNAIL       = 1 << 0,
+    RES_CRC             = 1 << 1,
+    RES_LOD             = 1 << 2,
+    RES_KEYVALUES       = 1 << 3,
+    RES_EXTENDED_FLAGS  = 1 << 4,
+};
+
+struct CorpusCase {
+    vtfpp::ImageFormat format;
+    const char *format_nick;
+    SynthContent content;
+    int width;
+    int height;
+    int frames;
+    // 1, 6 (cubemap) or 7 (cubemap + spheremap)
+    int faces;
+    // Slice count; anything above 1 is a volumetric texture
+    int depth;
+    int minor_version;
+    uint32_t resources;
+};
+
+struct CorpusSize {
+    int width;
+    int height;
+    bool large;
+};
+
+// Includes non-power-of-two and non-multiple-of-4 sizes, which are the interesting ones for block formats
+static const CorpusSize CORPUS_SIZES[] = {
+    { 1,    1,      false },
+    { 4,    4,      false },
+    { 16,   16,     false },
+    { 17,   9,      false },
+    { 64,   64,     false },
+    { 100,  60,     false },
+    { 256,  128,    false },
+    { 300,  300,    false },
+    { 512,  512,    true },
+    { 1024, 1024,   true },
+    { 2048, 1024,   true },
+};
+
+static const uint32_t CORPUS_RESOURCE_SETS[] = {
+    RES_NONE,
+    RES_THUMBNAIL,
+    RES_THUMBNAIL | RES_CRC,
+    RES_THUMBNAIL | RES_LOD,
+    RES_THUMBNAIL | RES_KEYVALUES,
+    RES_THUMBNAIL | RES_CRC | RES_LOD | RES_KEYVALUES | RES_EXTENDED_FLAGS,
+};
+
+static std::string corpus_case_name(const CorpusCase &c) {
+    char name[256];
+    snprintf(
+        name, sizeof(name),
+        "%s/%s_%dx%d_v7%d_fr%d_fa%d_d%d_r%02x.vtf",
+        c.format_nick,
+        vtf_synth_content_name(c.content),
+        c.width, c.height,
+        c.minor_version,
+        c.frames, c.faces, c.depth,
+        c.resources
+    );
+    return name;
+}
+
+static std::vector<CorpusCase> corpus_plan(const std::vector<VtfFormatChoice> &formats, bool quick, bool large) {
+    std::vector<CorpusCase> plan;
+
+    for (const VtfFormatChoice &format_choice : formats) {
+        const CorpusCase base = {
+            format_choice.format, format_choice.nick, SynthContent::PHOTO,
+            64, 64, 1, 1, 1, 4, RES_THUMBNAIL
+        };
+        plan.push_back(base);
+
+        for (SynthContent content : SYNTH_CONTENTS) {
+            if (content == base.content) continue;
+            CorpusCase c = base;
+            c.content = content;
+            plan.push_back(c);
+        }
+
+        for (const CorpusSize &size : CORPUS_SIZES) {
+            if (size.large && !large) continue;
+            if (quick && (size.width > 64 || size.height > 64)) continue;
+            if (size.width == base.width && size.height == base.height) continue;
+            CorpusCase c = base;
+            c.width = size.width;
+            c.height = size.height;
+            plan.push_back(c);
+        }
+
+        for (int frames : { 2, 8 }) {
+            CorpusCase c = base;
+            c.frames = frames;
+            plan.push_back(c);
+        }
+
+        // Cubemap, and cubemap with a spheremap (which only exists before 7.5)
+        for (int faces : { 6, 7 }) {
+            CorpusCase c = base;
+            c.faces = faces;
+            c.minor_version = (faces == 7) ? 3 : base.minor_version;
+            plan.push_back(c);
+        }
+
+        // Volumetric textures need 7.2 or later
+        for (int depth : { 4, 16 }) {
+            if (quick && depth > 4) continue;
+            CorpusCase c = base;
+            c.depth = depth;
+            c.width = c.height = 32;
+            plan.push_back(c);
+        }
+
+        for (int minor_version = 0; minor_version <= 6; minor_version++) {
+            if (minor_version == base.minor_version) continue;
+            CorpusCase c = base;
+            c.minor_version = minor_version;
+            plan.push_back(c);
+        }
+
+        for (uint32_t resources : CORPUS_RESOURCE_SETS) {
+            if (resources == base.resources) continue;
+            if (quick && resources != RES_NONE) continue;
+            CorpusCase c = base;
+            c.resources = resources;
+            plan.push_back(c);
+        }
+    }
+
+    return plan;
+}
+
+static bool corpus_write_case(const CorpusCase &c, const std::filesystem::path &path, uint64_t seed) {
+    vtfpp::VTF vtf;
+    vtf.setVersion(7, c.minor_version);
+    // Keep non-power-of-two sizes as they are, that's the point of having them in the corpus
+    vtf.setImageResizeMethods(
+        vtfpp::ImageConversion::ResizeMethod::NONE,
+        vtfpp::ImageConversion::ResizeMethod::NONE
+    );
+    vtf.setFlags(vtfpp::VTF::FLAG_PWL_CORRECTED);
+    vtf.setSize(c.width, c.height, vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+
+    if (!vtf.setFrameCount(c.frames)) return false;
+    if (c.faces > 1 && !vtf.setFaceCount(true, c.faces == 7)) return false;
+    if (c.depth > 1 && !vtf.setSliceCount(c.depth)) return false;
+
+    // Every subimage gets its own seed, so frames/faces/slices actually differ from each other
+    std::vector<std::byte> pixels((size_t)c.width * c.height * 4);
+    for (int frame = 0; frame < c.frames; frame++) {
+        for (int face = 0; face < c.faces; face++) {
+            for (int slice = 0; slice < c.depth; slice++) {
+                uint64_t subimage_seed = seed + ((uint64_t)frame << 32) + ((uint64_t)face << 16) + slice;
+                vtf_synth_fill_rgba8888(pixels, c.width, c.height, c.content, subimage_seed);
+                bool ok = vtf.setImage(
+                    pixels,
+                    vtfpp::ImageFormat::RGBA8888,
+                    c.width,
+                    c.height,
+                    vtfpp::ImageConversion::ResizeFilter::DEFAULT,
+                    0,
+                    frame,
+                    face,
+                    slice
+                );
+                if (!ok) return false;
+            }
+        }
+    }
+
+    vtf.setMipCount(vtfpp::ImageDimensions::getRecommendedMipCountForDims(c.format, c.width, c.height));
+    vtf.computeMips(vtfpp::ImageConversion::ResizeFilter::KAISER);
+
+    if (c.resources & RES_THUMBNAIL) {
+        vtf.computeThumbnail(vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+    } else {
+        vtf.removeThumbnail();
+    }
+    vtf.computeReflectivity();
+    if (c.resources & RES_CRC) {
+        vtf.setCRCResource((uint32_t)seed);
+    }
+    if (c.resources & RES_LOD) {
+        vtf.setLODResource(8, 8);
+    }
+    if (c.resources & RES_KEYVALUES) {
+        vtf.setKeyValuesDataResource("\"Information\"\n{\n\t\"Author\" \"vtf-corpus\"\n}\n");
+    }
+    if (c.resources & RES_EXTENDED_FLAGS) {
+        vtf.setExtendedFlagsResource(1);
+    }
+
+    vtf.computeTransparencyFlags();
+    vtf.setFormat(c.format, vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+
+    return vtf.bake(path.string());
+}
+
+static void corpus_usage(const char *argv0) {
+    fprintf(stderr,
+        "Usage: %s [--out DIR] [--seed N] [--formats A,B,...] [--quick] [--large]\n"
+        "  --out DIR        Output directory (default: vtf-corpus)\n"
+        "  --seed N         Base seed (default: 0). The same seed always gives the same files.\n"
+        "  --formats LIST   Comma-separated format names (default: every export format)\n"
+        "  --quick          Only small sizes and a reduced set of variations\n"
+        "  --large          Also write 512px and bigger images\n",
+        argv0
+    );
+}
+
+int main(int argc, char **argv) {
+    std::filesystem::path out_dir = "vtf-corpus";
+    uint64_t base_seed = 0;
+    bool quick = false;
+    bool large = false;
+    std::vector<VtfFormatChoice> formats;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            base_seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--formats") == 0 && i + 1 < argc) {
+            std::string list = argv[++i];
+            size_t start = 0;
+            while (start <= list.size()) {
+                size_t end = list.find(',', start);
+                if (end == std::string::npos) end = list.size();
+                std::string nick = list.substr(start, end - start);
+                vtfpp::ImageFormat format;
+                if (!vtf_format_from_nick(nick.c_str(), &format)) {
+                    fprintf(stderr, "Unknown format: %s\n", nick.c_str());
+                    return 2;
+                }
+                formats.push_back({ vtf_format_nick(format), format });
+                start = end + 1;
+            }
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else if (strcmp(argv[i], "--large") == 0) {
+            large = true;
+        } else {
+            corpus_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (formats.empty()) {
+        for (const VtfFormatChoice &format_choice : VTF_EXPORT_FORMATS) {
+            // EMPTY has no image data to write
+            if (format_choice.format == vtfpp::ImageFormat::EMPTY) continue;
+            formats.push_back(format_choice);
+        }
+    }
+
+    std::vector<CorpusCase> plan = corpus_plan(formats, quick, large);
+
+    std::error_code ec;
+    std::filesystem::create_directories(out_dir, ec);
+    FILE *manifest = fopen((out_dir / "manifest.csv").string().c_str(), "w");
+    if (!manifest) {
+        fprintf(stderr, "Could not write %s\n", (out_dir / "manifest.csv").string().c_str());
+        return 1;
+    }
+    fprintf(manifest, "path,format,content,width,height,frames,faces,depth,version,resources,seed,bytes\n");
+
+    int failures = 0;
+    for (const CorpusCase &c : plan) {
+        std::string name = corpus_case_name(c);
+        std::filesystem::path path = out_dir / name;
+        std::filesystem::create_directories(path.parent_path(), ec);
+
+        uint64_t seed = vtf_synth_seed(name, base_seed);
+        if (!corpus_write_case(c, path, seed)) {
+            fprintf(stderr, "Failed: %s\n", name.c_str());
+            failures++;
+            continue;
+        }
+
+        fprintf(
+            manifest, "%s,%s,%s,%d,%d,%d,%d,%d,7.%d,%u,%llu,%llu\n",
+            name.c_str(), c.format_nick, vtf_synth_content_name(c.content),
+            c.width, c.height, c.frames, c.faces, c.depth, c.minor_version, c.resources,
+            (unsigned long long)seed,
+            (unsigned long long)std::filesystem::file_size(path, ec)
+        );
+    }
+    fclose(manifest);
+
+    printf("Wrote %zu of %zu files to %s\n", plan.size() - failures, plan.size(), out_dir.string().c_str());
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,343 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// vtf-diff: what changed between two VTFs.
+//
+// Compares the header field by field, then the resources, then the image data mip by mip.
+//  When both files use the same format, subimages are compared one row of blocks (4 pixel rows)
+//  at a time in their stored form, and only rows that differ get decoded and measured, so a
+//  rebuild that changed a corner of one frame costs about as much as that corner.
+//  Otherwise every subimage is decoded. Error metrics (max error, PSNR) use the SIMD diff kernel.
+//
+// Usage: vtf-diff [--quiet] A B
+// Exits with 0 if the files are the same, 1 if they differ, 2 if either can't be read.
+//  --quiet only sets the exit status.
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-flags.h"
+#include "vtf-formats.h"
+#include "vtf-header.h"
+#include "vtf-kernels.h"
+#include "vtf-pool.h"
+
+// Pixel rows compared at a time: one row of 4x4 blocks
+#define DIFF_STRIP_ROWS 4
+
+struct DiffOutput {
+    bool quiet = false;
+    int differences = 0;
+};
+
+static void report(DiffOutput &out, const char *format, ...) {
+    out.differences++;
+    if (out.quiet) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+//
+// Header
+//
+
+static std::string flag_list(vtfpp::VTF::Flags flags) {
+    std::string out;
+    for (const VtfFlagName &flag_name : VTF_FLAG_NAMES) {
+        if (!(flags & flag_name.flag)) continue;
+        out += out.empty() ? "" : " ";
+        out += flag_name.name;
+    }
+    return out;
+}
+
+static void diff_header(const vtfpp::VTF &a, const vtfpp::VTF &b, DiffOutput &out) {
+    if (a.getMajorVersion() != b.getMajorVersion() || a.getMinorVersion() != b.getMinorVersion()) {
+        report(out, "version: %u.%u -> %u.%u\n", a.getMajorVersion(), a.getMinorVersion(), b.getMajorVersion(), b.getMinorVersion());
+    }
+    if (a.getFormat() != b.getFormat()) {
+        report(out, "format: %s -> %s\n", vtf_format_label(a.getFormat()).c_str(), vtf_format_label(b.getFormat()).c_str());
+    }
+    if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight()) {
+        report(out, "size: %dx%d -> %dx%d\n", a.getWidth(), a.getHeight(), b.getWidth(), b.getHeight());
+    }
+    if (a.getFrameCount() != b.getFrameCount()) {
+        report(out, "frames: %d -> %d\n", a.getFrameCount(), b.getFrameCount());
+    }
+    if (a.getFaceCount() != b.getFaceCount()) {
+        report(out, "faces: %d -> %d\n", a.getFaceCount(), b.getFaceCount());
+    }
+    if (a.getSliceCount() != b.getSliceCount()) {
+        report(out, "depth: %d -> %d\n", a.getSliceCount(), b.getSliceCount());
+    }
+    if (a.getMipCount() != b.getMipCount()) {
+        report(out, "mips: %d -> %d\n", a.getMipCount(), b.getMipCount());
+    }
+    if (a.getStartFrame() != b.getStartFrame()) {
+        report(out, "start frame: %d -> %d\n", a.getStartFrame(), b.getStartFrame());
+    }
+
+    vtfpp::VTF::Flags removed = (vtfpp::VTF::Flags)(a.getFlags() & ~b.getFlags());
+    vtfpp::VTF::Flags added = (vtfpp::VTF::Flags)(b.getFlags() & ~a.getFlags());
+    if (removed) {
+        report(out, "flags removed: %s\n", flag_list(removed).c_str());
+    }
+    if (added) {
+        report(out, "flags added: %s\n", flag_list(added).c_str());
+    }
+
+    sourcepp::math::Vec3f reflectivity_a = a.getReflectivity();
+    sourcepp::math::Vec3f reflectivity_b = b.getReflectivity();
+    if (reflectivity_a[0] != reflectivity_b[0] || reflectivity_a[1] != reflectivity_b[1] || reflectivity_a[2] != reflectivity_b[2]) {
+        report(
+            out, "reflectivity: %.4f %.4f %.4f -> %.4f %.4f %.4f\n",
+            reflectivity_a[0], reflectivity_a[1], reflectivity_a[2],
+            reflectivity_b[0], reflectivity_b[1], reflectivity_b[2]
+        );
+    }
+    if (a.getBumpMapScale() != b.getBumpMapScale()) {
+        report(out, "bumpmap scale: %g -> %g\n", a.getBumpMapScale(), b.getBumpMapScale());
+    }
+}
+
+//
+// Resources
+//
+
+static std::string resource_name(uint32_t tag) {
+    switch (tag) {
+        case VTF_RESOURCE_TAG_THUMBNAIL:    return "thumbnail";
+        case VTF_RESOURCE_TAG_IMAGE_DATA:   return "image data";
+        case 0x000010u:                     return "particle sheet";
+    }
+    char name[16];
+    char c0 = (char)(tag & 0xFF), c1 = (char)((tag >> 8) & 0xFF), c2 = (char)((tag >> 16) & 0xFF);
+    if (isprint((unsigned char)c0) && isprint((unsigned char)c1) && isprint((unsigned char)c2)) {
+        snprintf(name, sizeof(name), "%c%c%c", c0, c1, c2);
+    } else {
+        snprintf(name, sizeof(name), "0x%06x", tag);
+    }
+    return name;
+}
+
+static const vtfpp::Resource *find_resource(const vtfpp::VTF &vtf, uint32_t tag) {
+    for (const vtfpp::Resource &resource : vtf.getResources()) {
+        if (((uint32_t)resource.type & 0xFFFFFF) == tag) {
+            return &resource;
+        }
+    }
+    return nullptr;
+}
+
+static void diff_resources(const vtfpp::VTF &a, const vtfpp::VTF &b, DiffOutput &out) {
+    std::vector<uint32_t> tags;
+    for (const vtfpp::VTF *vtf : { &a, &b }) {
+        for (const vtfpp::Resource &resource : vtf->getResources()) {
+            uint32_t tag = (uint32_t)resource.type & 0xFFFFFF;
+            if (std::find(tags.begin(), tags.end(), tag) == tags.end()) {
+                tags.push_back(tag);
+            }
+        }
+    }
+
+    for (uint32_t tag : tags) {
+        // Image data is compared mip by mip below. The thumbnail is compared on its own since it
+        //  isn't a resource before 7.3, so it would show up as added/removed across versions.
+        if (tag == VTF_RESOURCE_TAG_IMAGE_DATA || tag == VTF_RESOURCE_TAG_THUMBNAIL) continue;
+
+        const vtfpp::Resource *resource_a = find_resource(a, tag);
+        const vtfpp::Resource *resource_b = find_resource(b, tag);
+        std::string name = resource_name(tag);
+        if (!resource_b) {
+            report(out, "resource removed: %s (%zu bytes)\n", name.c_str(), resource_a->data.size());
+        } else if (!resource_a) {
+            report(out, "resource added: %s (%zu bytes)\n", name.c_str(), resource_b->data.size());
+        } else if (!std::equal(resource_a->data.begin(), resource_a->data.end(), resource_b->data.begin(), resource_b->data.end())) {
+            report(out, "resource changed: %s (%zu -> %zu bytes)\n", name.c_str(), resource_a->data.size(), resource_b->data.size());
+        }
+    }
+
+    std::span<const std::byte> thumbnail_a = a.hasThumbnailData() ? a.getThumbnailDataRaw() : std::span<const std::byte>();
+    std::span<const std::byte> thumbnail_b = b.hasThumbnailData() ? b.getThumbnailDataRaw() : std::span<const std::byte>();
+    if (!std::equal(thumbnail_a.begin(), thumbnail_a.end(), thumbnail_b.begin(), thumbnail_b.end())) {
+        report(
+            out, "thumbnail changed: %s %dx%d -> %s %dx%d\n",
+            vtf_format_label(a.getThumbnailFormat()).c_str(), a.getThumbnailWidth(), a.getThumbnailHeight(),
+            vtf_format_label(b.getThumbnailFormat()).c_str(), b.getThumbnailWidth(), b.getThumbnailHeight()
+        );
+    }
+}
+
+//
+// Image data
+//
+
+struct SubimageDiff {
+    bool differs = false;
+    VtfDiffMetrics metrics;
+};
+
+static void measure(std::span<const std::byte> raw_a, vtfpp::ImageFormat format_a, std::span<const std::byte> raw_b, vtfpp::ImageFormat format_b, int width, int height, SubimageDiff &diff) {
+    std::vector<std::byte> rgba_a = vtfpp::ImageConversion::convertImageDataToFormat(raw_a, format_a, vtfpp::ImageFormat::RGBA8888, width, height);
+    std::vector<std::byte> rgba_b = vtfpp::ImageConversion::convertImageDataToFormat(raw_b, format_b, vtfpp::ImageFormat::RGBA8888, width, height);
+    size_t pixel_count = (size_t)width * height;
+    if (rgba_a.size() != pixel_count * 4 || rgba_b.size() != pixel_count * 4) {
+        // Couldn't decode; count every pixel as different
+        diff.metrics.differing_pixels += pixel_count;
+        diff.metrics.pixel_count += pixel_count;
+        return;
+    }
+    vtf_kernel_diff_rgba8888(rgba_a.data(), rgba_b.data(), pixel_count, diff.metrics);
+}
+
+static void diff_subimage(const vtfpp::VTF &a, const vtfpp::VTF &b, int mip, int frame, int face, int slice, SubimageDiff &diff) {
+    int width = a.getWidth(mip);
+    int height = a.getHeight(mip);
+    std::span<const std::byte> raw_a = a.getImageDataRaw(mip, frame, face, slice);
+    std::span<const std::byte> raw_b = b.getImageDataRaw(mip, frame, face, slice);
+
+    if (a.getFormat() != b.getFormat() || raw_a.size() != raw_b.size()) {
+        diff.differs = true;
+        measure(raw_a, a.getFormat(), raw_b, b.getFormat(), width, height, diff);
+        return;
+    }
+
+    // Same format: skip over rows of blocks that are byte-for-byte the same
+    vtfpp::ImageFormat format = a.getFormat();
+    size_t offset = 0;
+    for (int row = 0; row < height; row += DIFF_STRIP_ROWS) {
+        int strip_height = std::min(DIFF_STRIP_ROWS, height - row);
+        size_t strip_length = vtfpp::ImageFormatDetails::getDataLength(format, width, strip_height);
+        if (offset + strip_length > raw_a.size()) {
+            break;
+        }
+
+        std::span<const std::byte> strip_a = raw_a.subspan(offset, strip_length);
+        std::span<const std::byte> strip_b = raw_b.subspan(offset, strip_length);
+        if (memcmp(strip_a.data(), strip_b.data(), strip_length) != 0) {
+            diff.differs = true;
+            measure(strip_a, format, strip_b, format, width, strip_height, diff);
+        }
+        offset += strip_length;
+    }
+}
+
+static double psnr(uint64_t squared_error, uint64_t sample_count) {
+    if (squared_error == 0 || sample_count == 0) {
+        return INFINITY;
+    }
+    double mse = (double)squared_error / (double)sample_count;
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+static void diff_images(const vtfpp::VTF &a, const vtfpp::VTF &b, DiffOutput &out) {
+    if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight() || a.getSliceCount() != b.getSliceCount()) {
+        // Already reported as a header difference; pixels can't be lined up
+        return;
+    }
+
+    int mip_count = std::min(a.getMipCount(), b.getMipCount());
+    int frame_count = std::min(a.getFrameCount(), b.getFrameCount());
+    int face_count = std::min(a.getFaceCount(), b.getFaceCount());
+    VtfPool &pool = vtf_pool_shared();
+
+    for (int mip = 0; mip < mip_count; mip++) {
+        int slice_count = vtfpp::ImageDimensions::getMipDim(mip, a.getSliceCount());
+        int subimage_count = frame_count * face_count * slice_count;
+        std::vector<SubimageDiff> diffs(subimage_count);
+
+        pool.parallel_for(subimage_count, [&](int subimage) {
+            int slice = subimage % slice_count;
+            int face = (subimage / slice_count) % face_count;
+            int frame = subimage / (slice_count * face_count);
+            diff_subimage(a, b, mip, frame, face, slice, diffs[subimage]);
+        });
+
+        int differing_subimages = 0;
+        VtfDiffMetrics metrics;
+        for (const SubimageDiff &diff : diffs) {
+            differing_subimages += diff.differs;
+            for (int channel = 0; channel < 4; channel++) {
+                metrics.squared_error[channel] += diff.metrics.squared_error[channel];
+                metrics.max_error[channel] = std::max(metrics.max_error[channel], diff.metrics.max_error[channel]);
+            }
+            metrics.differing_pixels += diff.metrics.differing_pixels;
+        }
+        if (differing_subimages == 0) {
+            continue;
+        }
+
+        // PSNR over the whole mip, including the rows that were skipped for being identical
+        uint64_t mip_pixels = (uint64_t)a.getWidth(mip) * a.getHeight(mip) * subimage_count;
+        uint64_t rgb_squared_error = metrics.squared_error[0] + metrics.squared_error[1] + metrics.squared_error[2];
+        report(
+            out, "mip %d (%dx%d): %d of %d subimages differ, %llu pixels; max error R %d G %d B %d A %d; PSNR RGB %.2f dB, A %.2f dB\n",
+            mip, a.getWidth(mip), a.getHeight(mip), differing_subimages, subimage_count,
+            (unsigned long long)metrics.differing_pixels,
+            metrics.max_error[0], metrics.max_error[1], metrics.max_error[2], metrics.max_error[3],
+            psnr(rgb_squared_error, mip_pixels * 3), psnr(metrics.squared_error[3], mip_pixels)
+        );
+    }
+}
+
+int main(int argc, char **argv) {
+    DiffOutput out;
+    const char *paths[2] = {};
+    int path_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quiet") == 0) {
+            out.quiet = true;
+        } else if (path_count < 2 && argv[i][0] != '-') {
+            paths[path_count++] = argv[i];
+        } else {
+            path_count = 0;
+            break;
+        }
+    }
+    if (path_count != 2) {
+        fprintf(stderr, "Usage: %s [--quiet] A B\n", argv[0]);
+        return 2;
+    }
+
+    vtfpp::VTF a(std::string(paths[0]), false);
+    vtfpp::VTF b(std::string(paths[1]), false);
+    for (int i = 0; i < 2; i++) {
+        if (!(i == 0 ? a : b)) {
+            fprintf(stderr, "Could not read %s\n", paths[i]);
+            return 2;
+        }
+    }
+
+    diff_header(a, b, out);
+    diff_resources(a, b, out);
+    diff_images(a, b, out);
+
+    return out.differences == 0 ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// vtf-edit: changes header fields of existing VTFs without re-encoding them (see vtf-edit.h).
+//
+// Usage: vtf-edit KEY=VALUE... FILE...
+//  e.g. vtf-edit flag_clamp_s=true flag_clamp_t=true version=7_4 brick01.vtf brick02.vtf
+//
+// Keys: version, start_frame, bumpmap_scale, reflectivity=R,G,B, recompute_reflectivity_enabled,
+//  thumbnail_enabled and the user-settable flag_* names from the export procedure.
+//  e.g. vtf-edit recompute_reflectivity_enabled=true thumbnail_enabled=true materials/**/*.vtf
+//  fixes stale metadata from one small mip per file.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "vtf-edit.h"
+
+int main(int argc, char **argv) {
+    VtfHeaderEdit edit;
+    std::vector<const char *> paths;
+    int edit_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strchr(argv[i], '=')) {
+            std::string error;
+            if (!vtf_edit_set_option(edit, argv[i], error)) {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 2;
+            }
+            edit_count++;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (edit_count == 0 || paths.empty()) {
+        fprintf(stderr, "Usage: %s KEY=VALUE... FILE...\n", argv[0]);
+        return 2;
+    }
+
+    int failures = 0;
+    for (const char *path : paths) {
+        std::string error;
+        VtfEditMethod method;
+        if (!vtf_edit_file(path, edit, error, &method)) {
+            fprintf(stderr, "%s: %s\n", path, error.c_str());
+            failures++;
+            continue;
+        }
+        printf("%s: %s\n", path, method == VtfEditMethod::IN_PLACE ? "edited in place" : "rewritten");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
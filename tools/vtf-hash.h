@@ -0,0 +1,104 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// A fast, non-cryptographic 64-bit hash for the tools' up-to-date checks and comparisons.
+// The result only depends on the bytes hashed (not on how they're split up between update()
+//  calls, or the platform), so hashes can be stored in files and compared later.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+class VtfHash64 {
+public:
+    explicit VtfHash64(uint64_t seed = 0) : state_(seed ^ 0x9E3779B97F4A7C15ull) {}
+
+    void update(std::span<const std::byte> data) {
+        const std::byte *bytes = data.data();
+        size_t size = data.size();
+        length_ += size;
+
+        // Finish a word left over from the last call
+        while (pending_size_ > 0 && pending_size_ < 8 && size > 0) {
+            pending_[pending_size_++] = *bytes++;
+            size--;
+        }
+        if (pending_size_ == 8) {
+            mix(load(pending_));
+            pending_size_ = 0;
+        }
+
+        for (; size >= 8; bytes += 8, size -= 8) {
+            mix(load(bytes));
+        }
+
+        if (size > 0) {
+            memcpy(pending_ + pending_size_, bytes, size);
+            pending_size_ += size;
+        }
+    }
+
+    void update(std::string_view text) {
+        update(std::span<const std::byte>((const std::byte *)text.data(), text.size()));
+    }
+
+    uint64_t digest() const {
+        uint64_t tail = 0;
+        for (size_t i = 0; i < pending_size_; i++) {
+            tail |= (uint64_t)pending_[i] << (i * 8);
+        }
+        // The length goes in too, so trailing zero bytes change the hash
+        uint64_t hash = state_ ^ (tail * 0xC2B2AE3D27D4EB4Full) ^ length_;
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+private:
+    // Little-endian, whatever the platform
+    static uint64_t load(const std::byte *bytes) {
+        uint64_t word = 0;
+        for (int i = 0; i < 8; i++) {
+            word |= (uint64_t)bytes[i] << (i * 8);
+        }
+        return word;
+    }
+
+    void mix(uint64_t word) {
+        word *= 0x87C37B91114253D5ull;
+        word = (word << 31) | (word >> 33);
+        state_ = (state_ ^ word) * 0x4CF5AD432745937Full;
+        state_ = (state_ << 27) | (state_ >> 37);
+    }
+
+    uint64_t state_;
+    uint64_t length_ = 0;
+    std::byte pending_[8] = {};
+    size_t pending_size_ = 0;
+};
+
+static inline uint64_t vtf_hash64(std::span<const std::byte> data, uint64_t seed = 0) {
+    VtfHash64 hash(seed);
+    hash.update(data);
+    return hash.digest();
+}
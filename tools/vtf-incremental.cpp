@@ -0,0 +1,222 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-incremental.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+
+// Changed blocks are encoded together as one 4-pixel-tall strip. vtfpp takes 16-bit widths,
+//  so long strips are split up.
+#define STRIP_MAX_BLOCKS 4096
+
+static bool same_settings(const VtfExportSettings &a, const VtfExportSettings &b) {
+    return a.minor_version == b.minor_version
+        && a.image_format == b.image_format
+        && a.image_type == b.image_type
+        && a.mipmap_filter == b.mipmap_filter
+        && a.resize_method == b.resize_method
+        && a.thumbnail_enabled == b.thumbnail_enabled
+        && a.recompute_reflectivity_enabled == b.recompute_reflectivity_enabled
+        && a.bumpmap_scale == b.bumpmap_scale
+        && a.height_conversion == b.height_conversion
+        && a.height_scale == b.height_scale
+        && a.prefilter_enabled == b.prefilter_enabled
+        && a.prefilter_samples == b.prefilter_samples
+        && a.flags == b.flags;
+}
+
+static bool block_changed(const std::byte *old_rgba, const std::byte *new_rgba, int width, int block_x, int block_y) {
+    for (int row = 0; row < 4; row++) {
+        size_t offset = ((size_t)(block_y * 4 + row) * width + block_x * 4) * 4;
+        if (memcmp(old_rgba + offset, new_rgba + offset, 16) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Re-encodes the changed blocks of one subimage into encoded (which holds the last output)
+static void patch_subimage(
+    std::span<const std::byte> old_rgba,
+    std::span<const std::byte> new_rgba,
+    std::vector<std::byte> &encoded,
+    vtfpp::ImageFormat format,
+    int width,
+    int height,
+    VtfIncrementalStats &stats
+) {
+    int blocks_x = width / 4;
+    int blocks_y = height / 4;
+    size_t block_bytes = vtfpp::ImageFormatDetails::getDataLength(format, 4, 4);
+    stats.blocks_total += (uint64_t)blocks_x * blocks_y;
+
+    std::vector<int> changed;
+    for (int block_y = 0; block_y < blocks_y; block_y++) {
+        for (int block_x = 0; block_x < blocks_x; block_x++) {
+            if (block_changed(old_rgba.data(), new_rgba.data(), width, block_x, block_y)) {
+                changed.push_back(block_y * blocks_x + block_x);
+            }
+        }
+    }
+
+    std::vector<std::byte> strip;
+    for (size_t first = 0; first < changed.size(); first += STRIP_MAX_BLOCKS) {
+        int strip_blocks = (int)std::min(changed.size() - first, (size_t)STRIP_MAX_BLOCKS);
+        int strip_width = strip_blocks * 4;
+        strip.resize((size_t)strip_width * 4 * 4);
+
+        for (int i = 0; i < strip_blocks; i++) {
+            int block = changed[first + i];
+            int block_x = block % blocks_x;
+            int block_y = block / blocks_x;
+            for (int row = 0; row < 4; row++) {
+                memcpy(
+                    strip.data() + ((size_t)row * strip_width + i * 4) * 4,
+                    new_rgba.data() + ((size_t)(block_y * 4 + row) * width + block_x * 4) * 4,
+                    16
+                );
+            }
+        }
+
+        std::vector<std::byte> strip_encoded = vtfpp::ImageConversion::convertImageDataToFormat(
+            strip, vtfpp::ImageFormat::RGBA8888, format, strip_width, 4
+        );
+        if (strip_encoded.size() != strip_blocks * block_bytes) {
+            // Shouldn't happen, but a full encode of the subimage is always correct
+            encoded = vtfpp::ImageConversion::convertImageDataToFormat(new_rgba, vtfpp::ImageFormat::RGBA8888, format, width, height);
+            stats.blocks_encoded += (uint64_t)blocks_x * blocks_y;
+            return;
+        }
+
+        // Blocks are stored row by row
+        for (int i = 0; i < strip_blocks; i++) {
+            memcpy(encoded.data() + changed[first + i] * block_bytes, strip_encoded.data() + i * block_bytes, block_bytes);
+        }
+    }
+    stats.blocks_encoded += changed.size();
+}
+
+// The flags a full vtf_core_encode() of unencoded would end up with. Encoding may add or remove
+//  flags for the format it converts to (alpha ones, say), so instead of guessing which, the same
+//  encode is run on one block with the same version and flags and its flags are used.
+static vtfpp::VTF::Flags encoded_flags(const vtfpp::VTF &unencoded, const VtfExportSettings &settings) {
+    std::byte block[4 * 4 * 4];
+    std::fill(std::begin(block), std::end(block), (std::byte)255);
+    vtfpp::VTF probe;
+    probe.setVersion(7, settings.minor_version);
+    probe.setSize(4, 4, vtfpp::ImageConversion::ResizeFilter::DEFAULT);
+    probe.setImage(block, vtfpp::ImageFormat::RGBA8888, 4, 4);
+    probe.setFlags(unencoded.getFlags());
+    vtf_core_encode(probe, settings);
+    return probe.getFlags();
+}
+
+bool vtf_incremental_build(
+    VtfIncrementalCache &cache,
+    const VtfExportSettings &settings,
+    int width,
+    int height,
+    int layer_count,
+    const VtfLayerFetch &fetch_layer,
+    VtfScratchArena *arena,
+    VtfStageTimings *timings,
+    VtfIncrementalStats *stats
+) {
+    VtfIncrementalStats local_stats;
+    VtfIncrementalStats &out_stats = stats ? *stats : local_stats;
+    out_stats = {};
+
+    // Mips, thumbnail, reflectivity and flags are all cheap next to the encode, so always redo them
+    vtfpp::VTF unencoded;
+    if (!vtf_core_build_unencoded(unencoded, settings, width, height, layer_count, fetch_layer, arena, timings)) {
+        return false;
+    }
+
+    bool reusable = cache.valid
+        && same_settings(cache.settings, settings)
+        && cache.layer_count == layer_count
+        && cache.unencoded.getWidth() == unencoded.getWidth()
+        && cache.unencoded.getHeight() == unencoded.getHeight()
+        && cache.unencoded.getMipCount() == unencoded.getMipCount()
+        && vtfpp::ImageFormatDetails::compressed(settings.image_format);
+
+    if (!reusable) {
+        out_stats.full_export = true;
+        cache.encoded = unencoded;
+        vtf_core_encode(cache.encoded, settings, timings);
+        cache.unencoded = std::move(unencoded);
+        cache.settings = settings;
+        cache.layer_count = layer_count;
+        cache.valid = true;
+        return true;
+    }
+
+    {
+        VtfStageScope encode_stage(timings, TRACE_STAGE_ENCODE);
+        vtfpp::ImageFormat format = settings.image_format;
+        std::vector<std::byte> encoded;
+
+        for (int mip = 0; mip < unencoded.getMipCount(); mip++) {
+            int mip_width = unencoded.getWidth(mip);
+            int mip_height = unencoded.getHeight(mip);
+            for (int frame = 0; frame < unencoded.getFrameCount(); frame++) {
+                for (int face = 0; face < unencoded.getFaceCount(); face++) {
+                    for (int slice = 0; slice < unencoded.getSliceCount(); slice++) {
+                        std::span<const std::byte> old_rgba = cache.unencoded.getImageDataRaw(mip, frame, face, slice);
+                        std::span<const std::byte> new_rgba = unencoded.getImageDataRaw(mip, frame, face, slice);
+                        if (std::equal(old_rgba.begin(), old_rgba.end(), new_rgba.begin(), new_rgba.end())) {
+                            continue;
+                        }
+
+                        if (mip_width % 4 != 0 || mip_height % 4 != 0) {
+                            // The smallest mips are partial blocks; they're tiny, so just encode them whole
+                            encoded = vtfpp::ImageConversion::convertImageDataToFormat(new_rgba, vtfpp::ImageFormat::RGBA8888, format, mip_width, mip_height);
+                        } else {
+                            std::span<const std::byte> last_output = cache.encoded.getImageDataRaw(mip, frame, face, slice);
+                            encoded.assign(last_output.begin(), last_output.end());
+                            patch_subimage(old_rgba, new_rgba, encoded, format, mip_width, mip_height, out_stats);
+                        }
+
+                        // Already in the VTF's format, so vtfpp copies this in as is
+                        cache.encoded.setImage(encoded, format, mip_width, mip_height, vtfpp::ImageConversion::ResizeFilter::DEFAULT, mip, frame, face, slice);
+                    }
+                }
+            }
+        }
+    }
+
+    cache.encoded.setFlags(encoded_flags(unencoded, settings));
+
+    cache.encoded.setReflectivity(unencoded.getReflectivity());
+    if (unencoded.hasThumbnailData()) {
+        cache.encoded.setThumbnail(
+            unencoded.getThumbnailDataRaw(),
+            unencoded.getThumbnailFormat(),
+            unencoded.getThumbnailWidth(),
+            unencoded.getThumbnailHeight()
+        );
+    } else {
+        cache.encoded.removeThumbnail();
+    }
+
+    cache.unencoded = std::move(unencoded);
+    return true;
+}
@@ -0,0 +1,63 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Incremental re-export, for when the same texture is exported over and over with small edits.
+//
+// Encoding block-compressed formats (DXT*, BC7, ...) is most of an export, and each 4x4 block is
+//  encoded on its own. So the cache keeps the last export both before encoding (RGBA8888, mips
+//  included) and after, and the next export only encodes the blocks whose RGBA8888 pixels changed
+//  (in any mip), copying the rest from the last output. The result is the same file a full
+//  export would have written.
+// Anything else (a different size, settings, layer count, or an uncompressed format) is a full export.
+
+#pragma once
+
+#include <cstdint>
+
+#include "vtfpp/VTF.h"
+#include "vtf-arena.h"
+#include "vtf-core.h"
+
+struct VtfIncrementalCache {
+    bool valid = false;
+    VtfExportSettings settings;
+    int layer_count = 0;
+    // The last export, before and after vtf_core_encode()
+    vtfpp::VTF unencoded;
+    vtfpp::VTF encoded;
+};
+
+struct VtfIncrementalStats {
+    bool full_export = false;
+    // 4x4 blocks across every mip/frame/face/slice; 0 for a full export of an uncompressed format
+    uint64_t blocks_total = 0;
+    uint64_t blocks_encoded = 0;
+};
+
+// vtf_core_build(), reusing whatever it can from cache and updating it afterwards.
+// The finished VTF is cache.encoded.
+// Returns false if a layer couldn't be fetched (cache is left as it was).
+bool vtf_incremental_build(
+    VtfIncrementalCache &cache,
+    const VtfExportSettings &settings,
+    int width,
+    int height,
+    int layer_count,
+    const VtfLayerFetch &fetch_layer,
+    VtfScratchArena *arena = nullptr,
+    VtfStageTimings *timings = nullptr,
+    VtfIncrementalStats *stats = nullptr
+);
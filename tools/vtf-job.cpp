@@ -0,0 +1,230 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-job.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-flags.h"
+#include "vtf-formats.h"
+#include "vtf-incremental.h"
+#include "vtf-report.h"
+
+bool vtf_job_set_option(VtfConvertJob &job, std::string_view key, std::string_view value, std::string &error) {
+    // The one option that isn't an export setting
+    if (key == "report_enabled") {
+        if (value == "true" || value == "1" || value == "yes") {
+            job.report_enabled = true;
+            return true;
+        }
+        if (value == "false" || value == "0" || value == "no") {
+            job.report_enabled = false;
+            return true;
+        }
+        error = "Invalid value \"" + std::string(value) + "\" for report_enabled";
+        return false;
+    }
+    return vtf_core_set_option(job.settings, key, value, error);
+}
+
+bool vtf_job_set_option(VtfConvertJob &job, std::string_view option, std::string &error) {
+    size_t equals = option.find('=');
+    if (equals == std::string_view::npos) {
+        error = "Expected key=value, got \"" + std::string(option) + "\"";
+        return false;
+    }
+    return vtf_job_set_option(job, option.substr(0, equals), option.substr(equals + 1), error);
+}
+
+std::string vtf_job_settings_key(const VtfConvertJob &job) {
+    const VtfExportSettings &settings = job.settings;
+    char scale[32];
+    snprintf(scale, sizeof(scale), "%.17g", settings.bumpmap_scale);
+    char height_scale[32];
+    snprintf(height_scale, sizeof(height_scale), "%.17g", settings.height_scale);
+
+    std::string key = "version=7_" + std::to_string(settings.minor_version);
+    // Values without a nick can't come from options, but still shouldn't crash
+    auto append = [&](const char *name, const char *value) {
+        key += std::string("\t") + name + "=" + (value ? value : "?");
+    };
+    append("image_format", vtf_format_label(settings.image_format).c_str());
+    append("image_type", vtf_choice_nick(VTF_IMAGE_TYPE_CHOICES, settings.image_type));
+    append("mipmap_filter", vtf_choice_nick(VTF_MIPMAP_FILTER_CHOICES, settings.mipmap_filter));
+    append("resize_method", vtf_choice_nick(VTF_RESIZE_METHOD_CHOICES, (int)settings.resize_method));
+    append("thumbnail_enabled", settings.thumbnail_enabled ? "true" : "false");
+    append("recompute_reflectivity_enabled", settings.recompute_reflectivity_enabled ? "true" : "false");
+    append("report_enabled", job.report_enabled ? "true" : "false");
+    append("bumpmap_scale", scale);
+    append("height_conversion", vtf_choice_nick(VTF_HEIGHT_CONVERSION_CHOICES, settings.height_conversion));
+    append("height_scale", height_scale);
+    append("prefilter_enabled", settings.prefilter_enabled ? "true" : "false");
+    append("prefilter_samples", std::to_string(settings.prefilter_samples).c_str());
+    for (const VtfFlagName &flag_name : VTF_FLAG_NAMES) {
+        if (flag_name.user_settable && (settings.flags & flag_name.flag)) {
+            append(flag_name.name, "true");
+        }
+    }
+    return key;
+}
+
+// Every layer of the input, as RGBA8888, one after the other
+struct JobLayers {
+    std::vector<std::byte> rgba;
+    int width = 0;
+    int height = 0;
+    int count = 0;
+};
+
+static bool read_file(const std::string &path, std::vector<std::byte> &out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    // -1 if the size can't be told (a directory, a pipe, ...)
+    std::streamoff size = file.tellg();
+    if (size < 0) {
+        return false;
+    }
+    out.resize((size_t)size);
+    file.seekg(0, std::ios::beg);
+    return (bool)file.read((char *)out.data(), (std::streamsize)out.size());
+}
+
+static bool decode_vtf_layers(std::vector<std::byte> &&data, const VtfExportSettings &settings, JobLayers &layers) {
+    vtfpp::VTF vtf(std::move(data), false);
+    if (!vtf) {
+        return false;
+    }
+
+    // Same mapping as vtf_core_build(): frames for standard images, faces otherwise
+    bool standard = settings.image_type == TYPE_STANDARD;
+    layers.width = vtf.getWidth();
+    layers.height = vtf.getHeight();
+    layers.count = standard ? vtf.getFrameCount() : vtf.getFaceCount();
+
+    size_t layer_size = (size_t)layers.width * layers.height * 4;
+    layers.rgba.resize(layer_size * layers.count);
+    for (int layer = 0; layer < layers.count; layer++) {
+        std::span<std::byte> out(layers.rgba.data() + layer * layer_size, layer_size);
+        if (!vtf_core_decode_rgba8888_into(vtf, 0, standard ? layer : 0, standard ? 0 : layer, 0, out)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool decode_image_layers(const std::vector<std::byte> &data, JobLayers &layers) {
+    vtfpp::ImageFormat format;
+    int frame_count = 1;
+    std::vector<std::byte> image = vtfpp::ImageConversion::convertFileToImageData(data, format, layers.width, layers.height, frame_count);
+    if (image.empty() || layers.width <= 0 || layers.height <= 0) {
+        return false;
+    }
+    layers.count = std::max(frame_count, 1);
+
+    // 16-bit and HDR inputs come back in wider formats. Frames are stored one after the other,
+    //  so they can all be converted as one tall image.
+    if (format != vtfpp::ImageFormat::RGBA8888) {
+        image = vtfpp::ImageConversion::convertImageDataToFormat(image, format, vtfpp::ImageFormat::RGBA8888, layers.width, layers.height * layers.count);
+    }
+    layers.rgba = std::move(image);
+    return layers.rgba.size() == (size_t)layers.width * layers.height * 4 * layers.count;
+}
+
+// With a cache, builds through vtf_incremental_build() and the result ends up in cache->encoded
+static bool run_job(
+    const VtfConvertJob &job,
+    VtfIncrementalCache *cache,
+    VtfScratchArena *arena,
+    std::string &error,
+    VtfIncrementalStats *stats
+) {
+    std::vector<std::byte> data;
+    if (!read_file(job.input_path, data)) {
+        error = "Could not read " + job.input_path;
+        return false;
+    }
+
+    JobLayers layers;
+    bool is_vtf = data.size() >= 4 && memcmp(data.data(), "VTF\0", 4) == 0;
+    bool decoded = is_vtf ? decode_vtf_layers(std::move(data), job.settings, layers) : decode_image_layers(data, layers);
+    if (!decoded) {
+        error = "Could not decode " + job.input_path;
+        return false;
+    }
+
+    VtfStageTimings timings;
+    size_t layer_size = (size_t)layers.width * layers.height * 4;
+    VtfLayerFetch fetch_layer = [&](int layer_index, std::span<std::byte> rgba) {
+        memcpy(rgba.data(), layers.rgba.data() + layer_index * layer_size, layer_size);
+        return true;
+    };
+
+    vtfpp::VTF local_vtf;
+    bool build_successful = cache
+        ? vtf_incremental_build(*cache, job.settings, layers.width, layers.height, layers.count, fetch_layer, arena, &timings, stats)
+        : vtf_core_build(local_vtf, job.settings, layers.width, layers.height, layers.count, fetch_layer, arena, &timings);
+    if (!build_successful) {
+        error = "Could not build " + job.output_path;
+        return false;
+    }
+    const vtfpp::VTF &export_vtf = cache ? cache->encoded : local_vtf;
+
+    bool write_successful;
+    {
+        VtfStageScope write_stage(&timings, TRACE_STAGE_WRITE);
+        write_successful = export_vtf.bake(job.output_path);
+    }
+    if (!write_successful) {
+        error = "Could not write " + job.output_path;
+        return false;
+    }
+
+    if (job.report_enabled) {
+        VtfExportReport report = vtf_report_collect(export_vtf, job.settings, job.output_path);
+        report.timings = timings;
+        if (!vtf_report_write_json(report, job.output_path + ".json")) {
+            error = "Could not write " + job.output_path + ".json";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool vtf_job_run(const VtfConvertJob &job, VtfScratchArena *arena, std::string &error) {
+    return run_job(job, nullptr, arena, error, nullptr);
+}
+
+bool vtf_job_run_incremental(
+    const VtfConvertJob &job,
+    VtfIncrementalCache &cache,
+    VtfScratchArena *arena,
+    std::string &error,
+    VtfIncrementalStats *stats
+) {
+    return run_job(job, &cache, arena, error, stats);
+}
@@ -0,0 +1,64 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Conversion jobs for the standalone tools: one image file in, one VTF out.
+//
+// Options use the export procedure's argument names and choice nicks (image_format=DXT5,
+//  mipmap_filter=kaiser, flag_clamp_s=true, ...), so anything scripted against the plugin
+//  works the same way here.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "vtf-arena.h"
+#include "vtf-core.h"
+#include "vtf-incremental.h"
+
+struct VtfConvertJob {
+    std::string input_path;
+    std::string output_path;
+    VtfExportSettings settings;
+    // Also write <output>.json, see vtf-report.h
+    bool report_enabled = false;
+};
+
+// Sets one export option on job. Returns false and fills error if the key or value isn't valid.
+bool vtf_job_set_option(VtfConvertJob &job, std::string_view key, std::string_view value, std::string &error);
+
+// Same, for "key=value"
+bool vtf_job_set_option(VtfConvertJob &job, std::string_view option, std::string &error);
+
+// Every option of job as KEY=VALUE, tab-separated, in a fixed order. Jobs with the same
+//  settings get the same string however their options were written.
+std::string vtf_job_settings_key(const VtfConvertJob &job);
+
+// Reads the input image (anything vtfpp can read: PNG, JPEG, TGA, GIF, HDR, ..., or another VTF),
+//  builds it with vtf_core_build() and writes the output.
+// Animated inputs become frames; VTF inputs keep their frames, or faces for envmaps/volumetrics.
+// Returns false and fills error on failure.
+bool vtf_job_run(const VtfConvertJob &job, VtfScratchArena *arena, std::string &error);
+
+// vtf_job_run() for the same input and output over and over (watch mode): keeps the last export in
+//  cache and only re-encodes the blocks that changed since, see vtf-incremental.h.
+bool vtf_job_run_incremental(
+    const VtfConvertJob &job,
+    VtfIncrementalCache &cache,
+    VtfScratchArena *arena,
+    std::string &error,
+    VtfIncrementalStats *stats = nullptr
+);
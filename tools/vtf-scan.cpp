@@ -0,0 +1,366 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// vtf-scan: indexes every VTF under a game/mod folder, for texture budget audits.
+//
+// Only headers are read (through vtf-header.h, from a memory mapping, so only the first page or
+//  two of each file is ever touched), and files are spread over the thread pool. Each file gets
+//  one row: version, format, size, frame/face/slice/mip counts, flags, resource count, file size
+//  and an estimate of its VRAM footprint (all of its image data, in its own format, which is
+//  what the engine uploads).
+//
+// Usage:
+//  vtf-scan [--format csv|json] [--out FILE] [--threads N] PATH...
+//
+// PATHs can be folders (searched recursively for *.vtf) or single files. Output goes to stdout
+//  unless --out is given; the format defaults to JSON for a .json --out and CSV otherwise.
+//  The CSV loads straight into SQLite and friends, e.g. sqlite3 index.db ".import --csv index.csv vtf".
+// Files that can't be read as VTFs and folders that can't be listed are reported on stderr and
+//  skipped; the exit status is 1 if there were any.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "vtfpp/ImageFormats.h"
+#include "vtf-flags.h"
+#include "vtf-formats.h"
+#include "vtf-header.h"
+#include "vtf-pool.h"
+
+// Files per pool task; single headers are too little work to schedule one by one
+#define SCAN_CHUNK_FILES 64
+
+enum ScanFormat {
+    SCAN_CSV,
+    SCAN_JSON,
+};
+
+struct ScanEntry {
+    std::string path;
+    bool ok = false;
+    const char *error = nullptr;
+    VtfHeaderInfo info;
+    uint64_t file_bytes = 0;
+    uint64_t vram_bytes = 0;
+};
+
+static bool is_vtf_path(const std::filesystem::path &path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return extension == ".vtf";
+}
+
+// Adds root, or every VTF under it if it's a folder. Folders that can't be listed are reported
+//  and skipped, and the rest is still searched; returns how many there were.
+// Each folder gets its own directory_iterator instead of one recursive_directory_iterator,
+//  because a failed increment() leaves that at the end, with no way to skip just the folder
+//  that failed.
+static int collect_paths(const std::filesystem::path &root, std::vector<std::string> &paths) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root, ec)) {
+        paths.push_back(root.generic_string());
+        return 0;
+    }
+
+    int errors = 0;
+    std::vector<std::filesystem::path> folders = { root };
+    while (!folders.empty()) {
+        std::filesystem::path folder = std::move(folders.back());
+        folders.pop_back();
+
+        auto it = std::filesystem::directory_iterator(folder, ec);
+        for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            // Symlinked folders aren't followed (they could loop), symlinked files are
+            std::error_code entry_ec;
+            if (it->is_directory(entry_ec) && !it->is_symlink(entry_ec)) {
+                folders.push_back(it->path());
+            } else if (it->is_regular_file(entry_ec) && is_vtf_path(it->path())) {
+                paths.push_back(it->path().generic_string());
+            }
+        }
+        if (ec) {
+            fprintf(stderr, "%s: %s\n", folder.string().c_str(), ec.message().c_str());
+            errors++;
+            ec.clear();
+        }
+    }
+    return errors;
+}
+
+#if !defined(_WIN32)
+// Maps the whole file, but vtf_header_parse() only reads the header, so that's all that gets paged in
+static void scan_file(ScanEntry &entry) {
+    int fd = open(entry.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        entry.error = "could not open";
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        entry.error = "empty file";
+        return;
+    }
+    entry.file_bytes = (uint64_t)st.st_size;
+
+    void *mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        entry.error = "could not map";
+        return;
+    }
+
+    std::span<const std::byte> data((const std::byte *)mapping, (size_t)st.st_size);
+    entry.ok = vtf_header_parse(data, entry.info);
+    munmap(mapping, (size_t)st.st_size);
+    if (!entry.ok) {
+        entry.error = "not a VTF";
+    }
+}
+#else
+static void scan_file(ScanEntry &entry) {
+    FILE *file = fopen(entry.path.c_str(), "rb");
+    if (!file) {
+        entry.error = "could not open";
+        return;
+    }
+
+    std::error_code ec;
+    entry.file_bytes = std::filesystem::file_size(entry.path, ec);
+
+    std::vector<std::byte> header(VTF_HEADER_READ_SIZE);
+    header.resize(fread(header.data(), 1, header.size(), file));
+    entry.ok = vtf_header_parse(header, entry.info);
+    if (entry.ok && entry.info.header_size > header.size()) {
+        // Lots of resources; read the whole list
+        header.resize(entry.info.header_size);
+        fseek(file, 0, SEEK_SET);
+        header.resize(fread(header.data(), 1, header.size(), file));
+        entry.ok = vtf_header_parse(header, entry.info);
+    }
+    fclose(file);
+    if (!entry.ok) {
+        entry.error = "not a VTF";
+    }
+}
+#endif
+
+static std::string flag_names(vtfpp::VTF::Flags flags) {
+    std::string out;
+    for (const VtfFlagName &flag_name : VTF_FLAG_NAMES) {
+        if (!(flags & flag_name.flag)) continue;
+        out += out.empty() ? "" : "|";
+        out += flag_name.name;
+    }
+    return out;
+}
+
+static std::string csv_field(const std::string &value) {
+    if (value.find_first_of(",\"\n\r") == std::string::npos) {
+        return value;
+    }
+    std::string out = "\"";
+    for (char c : value) {
+        out += (c == '"') ? "\"\"" : std::string(1, c);
+    }
+    return out + "\"";
+}
+
+static std::string json_string(const std::string &value) {
+    std::string out = "\"";
+    for (char c : value) {
+        switch (c) {
+            case '"':   out += "\\\""; break;
+            case '\\':  out += "\\\\"; break;
+            case '\n':  out += "\\n"; break;
+            case '\t':  out += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+static void write_csv(FILE *out, const std::vector<ScanEntry> &entries) {
+    fprintf(out, "path,version,format,width,height,depth,frames,faces,mips,flags,flag_names,resources,compressed,file_bytes,vram_bytes\n");
+    for (const ScanEntry &entry : entries) {
+        if (!entry.ok) continue;
+        const VtfHeaderInfo &info = entry.info;
+        fprintf(
+            out, "%s,%u.%u,%s,%d,%d,%d,%d,%d,%d,0x%08x,%s,%zu,%d,%llu,%llu\n",
+            csv_field(entry.path).c_str(),
+            info.major_version, info.minor_version,
+            vtf_format_label(info.format).c_str(),
+            info.width, info.height, info.slice_count, info.frame_count, info.face_count, info.mip_count,
+            (uint32_t)info.flags, flag_names(info.flags).c_str(),
+            info.resources.size(),
+            (int)info.image_data_compressed,
+            (unsigned long long)entry.file_bytes,
+            (unsigned long long)entry.vram_bytes
+        );
+    }
+}
+
+static void write_json(FILE *out, const std::vector<ScanEntry> &entries) {
+    fprintf(out, "[");
+    bool first = true;
+    for (const ScanEntry &entry : entries) {
+        if (!entry.ok) continue;
+        const VtfHeaderInfo &info = entry.info;
+        fprintf(
+            out,
+            "%s\n  {\"path\": %s, \"version\": \"%u.%u\", \"format\": \"%s\", \"width\": %d, \"height\": %d, "
+            "\"depth\": %d, \"frames\": %d, \"faces\": %d, \"mips\": %d, \"flags\": %u, \"flag_names\": %s, "
+            "\"resources\": %zu, \"compressed\": %s, \"file_bytes\": %llu, \"vram_bytes\": %llu}",
+            first ? "" : ",",
+            json_string(entry.path).c_str(),
+            info.major_version, info.minor_version,
+            vtf_format_label(info.format).c_str(),
+            info.width, info.height, info.slice_count, info.frame_count, info.face_count, info.mip_count,
+            (uint32_t)info.flags, json_string(flag_names(info.flags)).c_str(),
+            info.resources.size(),
+            info.image_data_compressed ? "true" : "false",
+            (unsigned long long)entry.file_bytes,
+            (unsigned long long)entry.vram_bytes
+        );
+        first = false;
+    }
+    fprintf(out, "\n]\n");
+}
+
+static void scan_usage(const char *argv0) {
+    fprintf(stderr, "Usage: %s [--format csv|json] [--out FILE] [--threads N] PATH...\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> roots;
+    std::string out_path;
+    std::string format_name;
+    int threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            format_name = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0) {
+            scan_usage(argv[0]);
+            return 2;
+        } else {
+            roots.push_back(arg);
+        }
+    }
+
+    if (format_name.empty()) {
+        bool json_out = out_path.size() >= 5 && out_path.compare(out_path.size() - 5, 5, ".json") == 0;
+        format_name = json_out ? "json" : "csv";
+    }
+    if (roots.empty() || (format_name != "csv" && format_name != "json")) {
+        scan_usage(argv[0]);
+        return 2;
+    }
+    ScanFormat format = (format_name == "json") ? SCAN_JSON : SCAN_CSV;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::string> paths;
+    int folder_failures = 0;
+    for (const std::string &root : roots) {
+        folder_failures += collect_paths(root, paths);
+    }
+    // Same order every run, whatever order the file system lists things in
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    std::vector<ScanEntry> entries(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        entries[i].path = std::move(paths[i]);
+    }
+
+    VtfPool &pool = vtf_pool_shared();
+    pool.configure(threads);
+    int chunk_count = (int)((entries.size() + SCAN_CHUNK_FILES - 1) / SCAN_CHUNK_FILES);
+    pool.parallel_for(chunk_count, [&](int chunk) {
+        size_t end = std::min(entries.size(), (size_t)(chunk + 1) * SCAN_CHUNK_FILES);
+        for (size_t i = (size_t)chunk * SCAN_CHUNK_FILES; i < end; i++) {
+            scan_file(entries[i]);
+            if (entries[i].ok) {
+                entries[i].vram_bytes = vtf_header_image_data_length(entries[i].info);
+            }
+        }
+    });
+
+    FILE *out = out_path.empty() ? stdout : fopen(out_path.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "Could not write %s\n", out_path.c_str());
+        return 1;
+    }
+    if (format == SCAN_JSON) {
+        write_json(out, entries);
+    } else {
+        write_csv(out, entries);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    size_t failures = 0;
+    uint64_t total_vram = 0;
+    for (const ScanEntry &entry : entries) {
+        if (entry.ok) {
+            total_vram += entry.vram_bytes;
+        } else {
+            fprintf(stderr, "%s: %s\n", entry.path.c_str(), entry.error);
+            failures++;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(
+        stderr, "Scanned %zu files (%zu unreadable) in %.2f s, %.1f MiB estimated VRAM\n",
+        entries.size() - failures, failures, seconds, total_vram / (1024.0 * 1024.0)
+    );
+    if (folder_failures > 0) {
+        fprintf(stderr, "%d folders could not be searched\n", folder_failures);
+    }
+
+    return failures == 0 && folder_failures == 0 ? 0 : 1;
+}
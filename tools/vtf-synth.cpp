@@ -0,0 +1,208 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "vtf-synth.h"
+
+#include <algorithm>
+#include <cmath>
+
+// splitmix64; small, fast, and identical on every platform (unlike std::*_distribution)
+static uint64_t synth_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Hash of an integer lattice point, mapped to [0, 1]
+static float synth_lattice(int x, int y, uint64_t seed) {
+    uint64_t state = seed ^ ((uint64_t)(uint32_t)x << 32) ^ (uint32_t)y;
+    return (float)(synth_next(&state) >> 40) / (float)(1 << 24);
+}
+
+// Bilinearly interpolated value noise with a smoothstep fade
+static float synth_value_noise(float x, float y, uint64_t seed) {
+    int xi = (int)std::floor(x);
+    int yi = (int)std::floor(y);
+    float xf = x - xi;
+    float yf = y - yi;
+    float u = xf * xf * (3.0f - 2.0f * xf);
+    float v = yf * yf * (3.0f - 2.0f * yf);
+
+    float a = synth_lattice(xi, yi, seed);
+    float b = synth_lattice(xi + 1, yi, seed);
+    float c = synth_lattice(xi, yi + 1, seed);
+    float d = synth_lattice(xi + 1, yi + 1, seed);
+
+    return (a + (b - a) * u) * (1.0f - v) + (c + (d - c) * u) * v;
+}
+
+static float synth_fbm(float x, float y, uint64_t seed) {
+    float sum = 0.0f;
+    float amplitude = 0.5f;
+    for (int octave = 0; octave < 5; octave++) {
+        sum += amplitude * synth_value_noise(x, y, seed + octave);
+        x *= 2.0f;
+        y *= 2.0f;
+        amplitude *= 0.5f;
+    }
+    return sum / 0.96875f;
+}
+
+static std::byte synth_u8(float value) {
+    return (std::byte)(uint8_t)std::clamp((int)std::lround(value * 255.0f), 0, 255);
+}
+
+const char *vtf_synth_content_name(SynthContent content) {
+    switch (content) {
+        case SynthContent::PHOTO:       return "photo";
+        case SynthContent::NOISE:       return "noise";
+        case SynthContent::GRADIENT:    return "gradient";
+        case SynthContent::FLAT:        return "flat";
+        case SynthContent::ALPHA_HEAVY: return "alpha";
+    }
+    return "unknown";
+}
+
+bool vtf_synth_content_from_name(std::string_view name, SynthContent *content) {
+    for (SynthContent candidate : SYNTH_CONTENTS) {
+        if (name == vtf_synth_content_name(candidate)) {
+            *content = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t vtf_synth_seed(std::string_view key, uint64_t base_seed) {
+    uint64_t hash = 0xCBF29CE484222325ull ^ base_seed;
+    for (char c : key) {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+void vtf_synth_fill_rgba8888(
+    std::span<std::byte> out,
+    int width,
+    int height,
+    SynthContent content,
+    uint64_t seed
+) {
+    if (width <= 0 || height <= 0 || out.size() < (size_t)width * height * 4) {
+        return;
+    }
+
+    uint64_t state = seed;
+
+    switch (content) {
+        case SynthContent::NOISE: {
+            for (size_t i = 0; i < (size_t)width * height; i++) {
+                uint64_t bits = synth_next(&state);
+                out[i * 4 + 0] = (std::byte)(bits);
+                out[i * 4 + 1] = (std::byte)(bits >> 8);
+                out[i * 4 + 2] = (std::byte)(bits >> 16);
+                out[i * 4 + 3] = (std::byte)(bits >> 24);
+            }
+            break;
+        }
+
+        case SynthContent::GRADIENT: {
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    float fx = (width > 1) ? (float)x / (width - 1) : 0.0f;
+                    float fy = (height > 1) ? (float)y / (height - 1) : 0.0f;
+                    std::byte *pixel = &out[((size_t)y * width + x) * 4];
+                    pixel[0] = synth_u8(fx);
+                    pixel[1] = synth_u8(fy);
+                    pixel[2] = synth_u8((fx + fy) * 0.5f);
+                    pixel[3] = synth_u8(1.0f - fx * 0.5f);
+                }
+            }
+            break;
+        }
+
+        case SynthContent::FLAT: {
+            uint64_t bits = synth_next(&state);
+            for (size_t i = 0; i < (size_t)width * height; i++) {
+                out[i * 4 + 0] = (std::byte)(bits);
+                out[i * 4 + 1] = (std::byte)(bits >> 8);
+                out[i * 4 + 2] = (std::byte)(bits >> 16);
+                out[i * 4 + 3] = (std::byte)255;
+            }
+            break;
+        }
+
+        case SynthContent::PHOTO:
+        case SynthContent::ALPHA_HEAVY: {
+            // Feature size scales with the image, so small and large images look alike
+            float scale = 6.0f / (float)std::max(width, height);
+
+            // A few hard-edged discs, to give block compressors some edges to deal with
+            struct Disc { float x, y, r, red, green, blue; };
+            Disc discs[4];
+            for (Disc &disc : discs) {
+                disc.x = (float)(synth_next(&state) % (uint64_t)width);
+                disc.y = (float)(synth_next(&state) % (uint64_t)height);
+                disc.r = (float)std::max(width, height) * (0.05f + (float)(synth_next(&state) % 100) / 500.0f);
+                disc.red = (float)(synth_next(&state) % 256) / 255.0f;
+                disc.green = (float)(synth_next(&state) % 256) / 255.0f;
+                disc.blue = (float)(synth_next(&state) % 256) / 255.0f;
+            }
+
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    float luma = synth_fbm(x * scale, y * scale, seed);
+                    float tint = synth_fbm(x * scale * 0.5f, y * scale * 0.5f, seed + 101);
+                    float red = luma * (0.7f + 0.3f * tint);
+                    float green = luma * 0.9f;
+                    float blue = luma * (1.0f - 0.3f * tint);
+
+                    for (const Disc &disc : discs) {
+                        float dx = x - disc.x;
+                        float dy = y - disc.y;
+                        if (dx * dx + dy * dy < disc.r * disc.r) {
+                            red = disc.red * (0.6f + 0.4f * luma);
+                            green = disc.green * (0.6f + 0.4f * luma);
+                            blue = disc.blue * (0.6f + 0.4f * luma);
+                        }
+                    }
+
+                    float alpha = 1.0f;
+                    if (content == SynthContent::ALPHA_HEAVY) {
+                        // Most of the image is fully transparent, with soft edges around the opaque parts
+                        float coverage = synth_fbm(x * scale * 1.5f, y * scale * 1.5f, seed + 202);
+                        alpha = std::clamp((coverage - 0.55f) * 6.0f, 0.0f, 1.0f);
+                    }
+
+                    std::byte *pixel = &out[((size_t)y * width + x) * 4];
+                    pixel[0] = synth_u8(red);
+                    pixel[1] = synth_u8(green);
+                    pixel[2] = synth_u8(blue);
+                    pixel[3] = synth_u8(alpha);
+                }
+            }
+            break;
+        }
+    }
+}
+
+std::vector<std::byte> vtf_synth_rgba8888(int width, int height, SynthContent content, uint64_t seed) {
+    std::vector<std::byte> out((size_t)std::max(width, 0) * std::max(height, 0) * 4);
+    vtf_synth_fill_rgba8888(out, width, height, content, seed);
+    return out;
+}
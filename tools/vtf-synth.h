@@ -0,0 +1,64 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Deterministic synthetic image content, used in place of real textures
+//  by the corpus generator, benchmarks and tests.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+enum class SynthContent : uint32_t {
+    // Smooth multi-octave noise with some hard-edged shapes, roughly like a photo or painted texture
+    PHOTO,
+    // Uncorrelated per-pixel noise, the worst case for block compression
+    NOISE,
+    // Linear ramps on each channel
+    GRADIENT,
+    // A single colour
+    FLAT,
+    // Photo-like colour with mostly transparent or partially transparent alpha
+    ALPHA_HEAVY,
+};
+
+static constexpr SynthContent SYNTH_CONTENTS[] = {
+    SynthContent::PHOTO,
+    SynthContent::NOISE,
+    SynthContent::GRADIENT,
+    SynthContent::FLAT,
+    SynthContent::ALPHA_HEAVY,
+};
+
+const char *vtf_synth_content_name(SynthContent content);
+bool vtf_synth_content_from_name(std::string_view name, SynthContent *content);
+
+// Mixes a string key into a base seed (FNV-1a), so each case gets a stable seed of its own.
+uint64_t vtf_synth_seed(std::string_view key, uint64_t base_seed);
+
+// Fills a width * height RGBA8888 buffer. The same arguments always produce the same bytes.
+void vtf_synth_fill_rgba8888(
+    std::span<std::byte> out,
+    int width,
+    int height,
+    SynthContent content,
+    uint64_t seed
+);
+
+std::vector<std::byte> vtf_synth_rgba8888(int width, int height, SynthContent content, uint64_t seed);
@@ -0,0 +1,215 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// freedesktop.org thumbnailer for VTF files (see vtf-thumbnailer.thumbnailer).
+//
+// File managers run this once per file, so it does as little as it can: read the header,
+//  pick the smallest mip that's at least as big as the requested size (or the embedded
+//  thumbnail, if that's big enough), read and decode only that, and write it out as a PNG.
+// Files the header reader can't locate subimages in (compressed 7.6) go through vtfpp instead.
+//
+// Usage: vtf-thumbnailer [-s SIZE] INPUT OUTPUT
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-header.h"
+#include "vtf-pixels.h"
+
+// Default size, from the thumbnail spec's "normal" size
+#define THUMBNAIL_DEFAULT_SIZE 128
+
+struct RgbaImage {
+    std::vector<std::byte> pixels;
+    int width = 0;
+    int height = 0;
+};
+
+static bool read_range(FILE *file, const VtfFileRange &range, std::vector<std::byte> &out) {
+    out.resize(range.length);
+    if (fseek(file, (long)range.offset, SEEK_SET) != 0) {
+        return false;
+    }
+    return fread(out.data(), 1, out.size(), file) == out.size();
+}
+
+static bool decode_range(FILE *file, const VtfFileRange &range, vtfpp::ImageFormat format, int width, int height, RgbaImage &image) {
+    std::vector<std::byte> raw;
+    if (!read_range(file, range, raw)) {
+        return false;
+    }
+
+    if (vtf_pixels_has_pipeline(format, vtfpp::ImageFormat::RGBA8888)) {
+        image.pixels.resize((size_t)width * height * 4);
+        if (!vtf_pixels_convert(format, vtfpp::ImageFormat::RGBA8888, raw, image.pixels)) {
+            return false;
+        }
+    } else {
+        image.pixels = vtfpp::ImageConversion::convertImageDataToFormat(raw, format, vtfpp::ImageFormat::RGBA8888, width, height);
+    }
+    image.width = width;
+    image.height = height;
+    return image.pixels.size() == (size_t)width * height * 4;
+}
+
+// The fast path: header, then one subimage
+static bool decode_partial(FILE *file, int size, RgbaImage &image) {
+    std::vector<std::byte> header(VTF_HEADER_READ_SIZE);
+    header.resize(fread(header.data(), 1, header.size(), file));
+
+    VtfHeaderInfo info;
+    if (!vtf_header_parse(header, info)) {
+        // Might just be a header with lots of resources
+        if (header.size() < 16) return false;
+        uint32_t header_size;
+        memcpy(&header_size, header.data() + 12, sizeof(header_size));
+        if (header_size <= header.size() || !read_range(file, { 0, header_size }, header) || !vtf_header_parse(header, info)) {
+            return false;
+        }
+    }
+
+    // The embedded thumbnail is enough for small requests, and always there to fall back on
+    bool thumbnail_usable = info.thumbnail_present && info.thumbnail.length > 0;
+    if (thumbnail_usable && std::max(info.thumbnail_width, info.thumbnail_height) >= size) {
+        return decode_range(file, info.thumbnail, info.thumbnail_format, info.thumbnail_width, info.thumbnail_height, image);
+    }
+
+    // Smallest mip that still covers the requested size
+    int mip = 0;
+    while (mip + 1 < info.mip_count
+        && std::max(vtfpp::ImageDimensions::getMipDim(mip + 1, info.width), vtfpp::ImageDimensions::getMipDim(mip + 1, info.height)) >= size) {
+        mip++;
+    }
+
+    VtfFileRange range;
+    if (vtf_header_subimage_range(info, mip, 0, 0, 0, range)) {
+        int mip_width = vtfpp::ImageDimensions::getMipDim(mip, info.width);
+        int mip_height = vtfpp::ImageDimensions::getMipDim(mip, info.height);
+        if (decode_range(file, range, info.format, mip_width, mip_height, image)) {
+            return true;
+        }
+    }
+
+    // Image data we can't decode (or locate), but a thumbnail is better than a generic icon
+    if (thumbnail_usable && !info.image_data_compressed) {
+        return decode_range(file, info.thumbnail, info.thumbnail_format, info.thumbnail_width, info.thumbnail_height, image);
+    }
+    return false;
+}
+
+// The slow path: let vtfpp read the whole file
+static bool decode_full(const char *path, int size, RgbaImage &image) {
+    vtfpp::VTF vtf(path, false);
+    if (!vtf) {
+        return false;
+    }
+
+    int mip = 0;
+    while (mip + 1 < vtf.getMipCount() && std::max(vtf.getWidth(mip + 1), vtf.getHeight(mip + 1)) >= size) {
+        mip++;
+    }
+
+    image.pixels = vtf.getImageDataAsRGBA8888(mip, 0, 0, 0);
+    image.width = vtf.getWidth(mip);
+    image.height = vtf.getHeight(mip);
+    return !image.pixels.empty();
+}
+
+int main(int argc, char **argv) {
+    int size = THUMBNAIL_DEFAULT_SIZE;
+    const char *input_path = nullptr;
+    const char *output_path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-s" && i + 1 < argc) {
+            size = std::max(std::atoi(argv[++i]), 1);
+        } else if (!input_path) {
+            input_path = argv[i];
+        } else if (!output_path) {
+            output_path = argv[i];
+        } else {
+            input_path = nullptr;
+            break;
+        }
+    }
+    if (!input_path || !output_path) {
+        fprintf(stderr, "Usage: %s [-s SIZE] INPUT OUTPUT\n", argv[0]);
+        return 2;
+    }
+
+    // File managers pass URIs for %u; this is set up for %i (paths), but accept file:// anyway
+    std::string input = input_path;
+    if (input.rfind("file://", 0) == 0) {
+        input = input.substr(7);
+    }
+
+    FILE *file = fopen(input.c_str(), "rb");
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", input.c_str());
+        return 1;
+    }
+    RgbaImage image;
+    bool decoded = decode_partial(file, size, image);
+    fclose(file);
+
+    if (!decoded && !decode_full(input.c_str(), size, image)) {
+        fprintf(stderr, "Could not read %s\n", input.c_str());
+        return 1;
+    }
+
+    // Fit inside size x size, keeping the aspect ratio
+    if (std::max(image.width, image.height) > size) {
+        int new_width = std::max(image.width * size / std::max(image.width, image.height), 1);
+        int new_height = std::max(image.height * size / std::max(image.width, image.height), 1);
+        image.pixels = vtfpp::ImageConversion::resizeImageData(
+            image.pixels,
+            vtfpp::ImageFormat::RGBA8888,
+            image.width,
+            new_width,
+            image.height,
+            new_height,
+            true,
+            vtfpp::ImageConversion::ResizeFilter::BOX
+        );
+        image.width = new_width;
+        image.height = new_height;
+    }
+
+    std::vector<std::byte> png = vtfpp::ImageConversion::convertImageDataToFile(
+        image.pixels,
+        vtfpp::ImageFormat::RGBA8888,
+        image.width,
+        image.height
+    );
+
+    FILE *output = fopen(output_path, "wb");
+    if (!output || png.empty() || fwrite(png.data(), 1, png.size(), output) != png.size()) {
+        fprintf(stderr, "Could not write %s\n", output_path);
+        if (output) fclose(output);
+        return 1;
+    }
+    fclose(output);
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+// chev2/gimp-vtf - GIMP VTF file plugin
+// Copyright (C) 2025  Chev <riskyrains@proton.me>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// vtf-train: the training workload for profile-guided optimization builds (see cmake/PGO.cmake).
+//
+// Exports synthetic images through vtf_core_build() (the same code export_image() uses) with the
+//  formats and mipmap filters people actually pick, then loads the result back the way load_image()
+//  does. Everything stays in memory, so the profile is dominated by encode, decode and resample.
+//
+// Usage: vtf-train [--iterations N] [--quick]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "vtfpp/ImageConversion.h"
+#include "vtfpp/ImageFormats.h"
+#include "vtfpp/VTF.h"
+#include "vtf-core.h"
+#include "vtf-cpu.h"
+#include "vtf-formats.h"
+#include "vtf-synth.h"
+
+// Roughly ordered by how often they're used for Source textures
+static const vtfpp::ImageFormat TRAIN_FORMATS[] = {
+    vtfpp::ImageFormat::DXT1,
+    vtfpp::ImageFormat::DXT5,
+    vtfpp::ImageFormat::BC7,
+    vtfpp::ImageFormat::RGBA8888,
+    vtfpp::ImageFormat::BGRA8888,
+    vtfpp::ImageFormat::BGR888,
+    vtfpp::ImageFormat::I8,
+    vtfpp::ImageFormat::IA88,
+    vtfpp::ImageFormat::ATI2N,
+    vtfpp::ImageFormat::RGBA16161616F,
+};
+
+static const int TRAIN_FILTERS[] = {
+    (int)vtfpp::ImageConversion::ResizeFilter::KAISER,
+    (int)vtfpp::ImageConversion::ResizeFilter::DEFAULT,
+    (int)vtfpp::ImageConversion::ResizeFilter::BOX,
+    (int)vtfpp::ImageConversion::ResizeFilter::BILINEAR,
+    (int)vtfpp::ImageConversion::ResizeFilter::CUBIC_BSPLINE,
+    VTF_MIPMAP_FILTER_NONE,
+};
+
+struct TrainShape {
+    int width;
+    int height;
+    int layers;
+    VTFImageType image_type;
+};
+
+static const TrainShape TRAIN_SHAPES[] = {
+    { 256,  256,    1,  TYPE_STANDARD },
+    // Not a power of two, so the export resize path gets exercised too
+    { 300,  200,    1,  TYPE_STANDARD },
+    { 64,   64,     4,  TYPE_STANDARD },
+    { 64,   64,     6,  TYPE_ENVIRONMENT_MAP },
+};
+
+static bool train_one(
+    vtfpp::ImageFormat format,
+    int mipmap_filter,
+    const TrainShape &shape,
+    SynthContent content,
+    uint64_t seed
+) {
+    VtfExportSettings settings;
+    settings.image_format = format;
+    settings.mipmap_filter = mipmap_filter;
+    settings.image_type = shape.image_type;
+
+    // Export
+    vtfpp::VTF export_vtf;
+    bool build_successful = vtf_core_build(
+        export_vtf,
+        settings,
+        shape.width,
+        shape.height,
+        shape.layers,
+        [&](int layer_index, std::span<std::byte> rgba) {
+            vtf_synth_fill_rgba8888(rgba, shape.width, shape.height, content, seed + layer_index);
+            return true;
+        }
+    );
+    if (!build_successful) {
+        return false;
+    }
+    std::vector<std::byte> baked = export_vtf.bake();
+
+    // Load
+    vtfpp::VTF loaded_vtf(std::move(baked), false);
+    if (!loaded_vtf) {
+        return false;
+    }
+    for (int frame = 0; frame < loaded_vtf.getFrameCount(); frame++) {
+        for (int face = 0; face < loaded_vtf.getFaceCount(); face++) {
+            std::vector<std::byte> rgba = vtf_core_decode_rgba8888(loaded_vtf, 0, frame, face, 0);
+            if (rgba.empty()) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int iterations = 1;
+    bool quick = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--iterations N] [--quick]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int runs = 0;
+    int failures = 0;
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        for (vtfpp::ImageFormat format : TRAIN_FORMATS) {
+            for (int mipmap_filter : TRAIN_FILTERS) {
+                for (const TrainShape &shape : TRAIN_SHAPES) {
+                    if (quick && shape.width > 64) continue;
+                    for (SynthContent content : { SynthContent::PHOTO, SynthContent::ALPHA_HEAVY }) {
+                        uint64_t seed = vtf_synth_seed(vtf_format_nick(format), iteration);
+                        if (!train_one(format, mipmap_filter, shape, content, seed)) {
+                            fprintf(stderr, "Failed: %s filter %d %dx%d\n", vtf_format_nick(format), mipmap_filter, shape.width, shape.height);
+                            failures++;
+                        }
+                        runs++;
+                    }
+                }
+            }
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%d export/load round trips in %.2fs (%d failed), SIMD level %s\n", runs, seconds, failures, vtf_simd_level_name(vtf_simd_level()));
+
+    return failures == 0 ? 0 : 1;
+}